@@ -8,6 +8,10 @@
 #include <QObject>
 #include <QFuture>
 #include <QFutureWatcher>
+#include <QSharedPointer>
+
+#include <atomic>
+#include <expected>
 
 #include "data/csvhandling.h"
 #include "data/jobtable.h"
@@ -15,6 +19,7 @@
 
 #define ARRIVAL_EXCEL_EXPORT_NEW_ADDED_CELL_COLOR "#248046"
 #define ARRIVAL_EXCEL_EXPORT_REMOVED_CELL_COLOR "#DA373C"
+#define ARRIVAL_EXCEL_EXPORT_MODIFIED_CELL_COLOR "#C27C0E"
 
 namespace Arrival::App
 {
@@ -28,16 +33,93 @@ namespace Arrival::App
 
         Q_PROPERTY(JobTable* jobTable READ jobTable WRITE setJobTable NOTIFY jobTableChanged)
         Q_PROPERTY(SelectedHeadersTemplateList* templateList READ templateList WRITE setTemplateList NOTIFY templateListChanged)
+        Q_PROPERTY(int diffThreadCount READ diffThreadCount WRITE setDiffThreadCount NOTIFY diffThreadCountChanged)
+        Q_PROPERTY(QList<QString> keyColumnNames READ keyColumnNames WRITE setKeyColumnNames NOTIFY keyColumnNamesChanged)
+        Q_PROPERTY(bool parsing READ isParsing NOTIFY parsingChanged)
+        Q_PROPERTY(bool exporting READ isExporting NOTIFY exportingChanged)
+        Q_PROPERTY(int exportRowCount READ exportRowCount NOTIFY exportingChanged)
+        Q_PROPERTY(int exportedRowCount READ exportedRowCount NOTIFY exportProgressChanged)
+        Q_PROPERTY(qint64 exportedByteCount READ exportedByteCount NOTIFY exportProgressChanged)
     public:
+        /*!
+         * \brief parseCSV Compares two .csv files on a worker thread and appends the result to the job table in batches.
+         * A comparison that is still running is canceled and its remaining results are discarded.
+         * \param csvPath1 Path of the first (old) file.
+         * \param csvPath2 Path of the second (new) file.
+         */
         Q_INVOKABLE void parseCSV(const QString &csvPath1, const QString &csvPath2);
+
+        /*!
+         * \brief cancelParsing Cancels the running comparison and discards its remaining results.
+         * Emits \c parsingCanceled if a comparison was running.
+         */
+        Q_INVOKABLE void cancelParsing();
+
+        /*!
+         * \brief xlsxExport Exports the rows of the job table to a .xlsx file.
+         * The export runs on a worker thread and reports its progress with \c exportProgressChanged.
+         * It ends with either \c exportCompleted, \c exportFailed or \c exportCanceled.
+         * Does nothing while another export or a comparison is running, the rows of the job table are still appended then.
+         * \param path Path of the .xlsx file.
+         * \param columns The columns to export.
+         */
         Q_INVOKABLE void xlsxExport(const QString& path, QList<int> columns);
 
+        /*!
+         * \brief cancelXlsxExport Requests the running export to stop. The partial file is removed.
+         */
+        Q_INVOKABLE void cancelXlsxExport();
+
         JobTable* jobTable() const;
         void setJobTable(JobTable* list);
 
         SelectedHeadersTemplateList* templateList() const;
         void setTemplateList(SelectedHeadersTemplateList* list);
 
+        /*!
+         * \brief diffThreadCount Returns the amount of threads used to parse and compare two .csv files.
+         * \return The amount of threads. 0 means \c QThread::idealThreadCount().
+         */
+        int diffThreadCount() const;
+        void setDiffThreadCount(int count);
+
+        /*!
+         * \brief keyColumnNames Returns the headers of the columns the rows are matched by.
+         * \return The header names. Empty means the Jobnumber column is detected.
+         */
+        const QList<QString>& keyColumnNames() const;
+        void setKeyColumnNames(const QList<QString>& names);
+
+        /*!
+         * \brief isParsing Checks whether a comparison is running.
+         * \return True if a comparison is running, false otherwise.
+         */
+        bool isParsing() const;
+
+        /*!
+         * \brief isExporting Checks whether an export is running.
+         * \return True if an export is running, false otherwise.
+         */
+        bool isExporting() const;
+
+        /*!
+         * \brief exportRowCount Returns the amount of rows the running export writes, including the header row.
+         * \return The amount of rows.
+         */
+        int exportRowCount() const;
+
+        /*!
+         * \brief exportedRowCount Returns the amount of rows the running export has written so far.
+         * \return The amount of rows.
+         */
+        int exportedRowCount() const;
+
+        /*!
+         * \brief exportedByteCount Returns the amount of compressed bytes the running export has written so far.
+         * \return The amount of bytes.
+         */
+        qint64 exportedByteCount() const;
+
     public:
         /*!
          * \brief AppModel Constructs a new \c AppModel
@@ -47,9 +129,62 @@ namespace Arrival::App
 
     signals:
         void parsingStarted();
+
+        /*!
+         * \brief parsingResultsAvailable The headers and the first rows of the comparison are in the job table.
+         * The remaining rows keep being appended until \c parsingCompleted.
+         */
+        void parsingResultsAvailable();
+
         void parsingCompleted();
+
+        /*!
+         * \brief parsingCanceled The running comparison has been canceled by \c cancelParsing.
+         * \c parsingCompleted is not emitted for it.
+         */
+        void parsingCanceled();
+
+        /*!
+         * \brief parsingChanged A comparison started or ended.
+         * \param parsing True if a comparison is running.
+         */
+        void parsingChanged(bool parsing);
         void jobTableChanged(JobTable* newValue);
         void templateListChanged(SelectedHeadersTemplateList* list);
+        void diffThreadCountChanged(int count);
+        void keyColumnNamesChanged(const QList<QString>& names);
+
+        /*!
+         * \brief exportingChanged An export started or ended.
+         * \param exporting True if an export is running.
+         */
+        void exportingChanged(bool exporting);
+
+        /*!
+         * \brief exportProgressChanged The running export made progress.
+         * \param rows The amount of rows written.
+         * \param bytes The amount of compressed bytes written.
+         */
+        void exportProgressChanged(int rows, qint64 bytes);
+
+        /*!
+         * \brief exportCompleted The export has been written successfully.
+         * \param filePath Path of the .xlsx file.
+         */
+        void exportCompleted(const QString& filePath);
+
+        /*!
+         * \brief exportFailed The export could not be written. The partial file has been removed.
+         * \param filePath Path of the .xlsx file.
+         * \param error Description of the error.
+         */
+        void exportFailed(const QString& filePath, const QString& error);
+
+        /*!
+         * \brief exportCanceled The export has been canceled. The partial file has been removed.
+         * \param filePath Path of the .xlsx file.
+         */
+        void exportCanceled(const QString& filePath);
 
     private:
         /*!
@@ -57,12 +192,58 @@ namespace Arrival::App
          */
         void onCSVParsed();
 
+        /*!
+         * \brief onXlsxExportProgress Executed when the running export reports progress.
+         * \param rows The amount of rows written.
+         */
+        void onXlsxExportProgress(int rows);
+
+        /*!
+         * \brief onXlsxExported Executed when the running export ended.
+         */
+        void onXlsxExported();
+
     private:
         JobTable* m_jobTable;
         SelectedHeadersTemplateList* m_templateList;
+        int m_diffThreadCount;
+        QList<QString> m_keyColumnNames;
+
+        QFuture<std::expected<void, CSVCombinedData::CombineCSVDocumentsError>> m_jobTableFuture;
+        QFutureWatcher<std::expected<void, CSVCombinedData::CombineCSVDocumentsError>> m_jobTableFutureWatcher;
+
+        /*!
+         * \brief m_isParsing True while a comparison is running.
+         */
+        bool m_isParsing;
+
+        /*!
+         * \brief m_parseCancellationToken Stops the running comparison.
+         */
+        CancellationToken m_parseCancellationToken;
+
+        /*!
+         * \brief m_parseGeneration Counts the comparisons started. Results of older comparisons are discarded.
+         */
+        quint64 m_parseGeneration;
+
+        QString m_exportFilePath;
+        int m_exportRowCount;
+        int m_exportedRowCount;
+        qint64 m_exportedByteCount;
+
+        /*!
+         * \brief m_exportByteCounter The amount of compressed bytes written, updated by the export thread.
+         */
+        QSharedPointer<std::atomic<qint64>> m_exportByteCounter;
+
+        /*!
+         * \brief m_exportCancellationToken Stops the running export.
+         */
+        CancellationToken m_exportCancellationToken;
 
-        QFuture<std::expected<QSharedPointer<CSVCombinedData>, CSVCombinedData::CombineCSVDocumentsError>> m_jobTableFuture;
-        QFutureWatcher<std::expected<QSharedPointer<CSVCombinedData>, CSVCombinedData::CombineCSVDocumentsError>> m_jobTableFutureWatcher;
+        QFuture<std::expected<void, QString>> m_exportFuture;
+        QFutureWatcher<std::expected<void, QString>> m_exportFutureWatcher;
     };
 }
 
@@ -20,6 +20,7 @@ namespace Arrival::App
         Q_PROPERTY(JobTable* jobTable READ jobTable WRITE setJobTable NOTIFY jobTableChanged)
         Q_PROPERTY(QList<bool> selectedHeaders READ selectedHeaders WRITE setSelectedHeaders NOTIFY selectedHeadersChanged)
         Q_PROPERTY(QList<int> selectedHeaderIndices READ selectedHeaderIndices WRITE setSelectedHeaderIndices NOTIFY selectedHeaderIndicesChanged)
+        Q_PROPERTY(QList<QString> keyColumnNames READ keyColumnNames WRITE setKeyColumnNames NOTIFY keyColumnNamesChanged)
     public:
 
         /*!
@@ -34,7 +35,8 @@ namespace Arrival::App
         enum RoleNames
         {
             SelectedRole = Qt::UserRole + 1,
-            HeaderNameRole
+            HeaderNameRole,
+            KeyRole
         };
 
         /*!
@@ -94,6 +96,13 @@ namespace Arrival::App
          */
         const QList<int>& selectedHeaderIndices() const;
 
+        /*!
+         * \brief keyColumnNames Returns the headers of the columns the rows are matched by.
+         * Stored by name, so they are kept when other files with the same columns are loaded.
+         * \return The header names. Empty means the Jobnumber column is detected.
+         */
+        const QList<QString>& keyColumnNames() const;
+
     signals:
         /*!
          * \brief jobTableChanged Called when the \c JobTable changed.
@@ -119,6 +128,12 @@ namespace Arrival::App
          */
         void selectedHeader(int index);
 
+        /*!
+         * \brief keyColumnNamesChanged Called when the key columns changed.
+         * \param names The new header names.
+         */
+        void keyColumnNamesChanged(const QList<QString>& names);
+
     public slots:
         /*!
          * \brief setJobTable Sets the \c JobTable.
@@ -138,6 +153,12 @@ namespace Arrival::App
          */
         void setSelectedHeaderIndices(const QList<int>& indices);
 
+        /*!
+         * \brief setKeyColumnNames Sets the key columns.
+         * \param names The headers of the columns the rows are matched by.
+         */
+        void setKeyColumnNames(const QList<QString>& names);
+
     private:
         /*!
          * \brief updateSelectedHeaderIndices Updates the list of selected header indices.
@@ -168,6 +189,11 @@ namespace Arrival::App
          * \brief m_selectedHeaderIndices Holds the indices of the selcted headers.
          */
         QList<int> m_selectedHeaderIndices;
+
+        /*!
+         * \brief m_keyColumnNames Holds the headers of the columns the rows are matched by.
+         */
+        QList<QString> m_keyColumnNames;
     };
 }
 
@@ -27,6 +27,14 @@ namespace Arrival::App
         Q_INVOKABLE JobTableRowState::State rowState(int index) const;
 
     public:
+        /*!
+         * \brief The RoleNames enum Specifies the roles of this \c QAbstractTableModel besides the display role.
+         */
+        enum RoleNames
+        {
+            ChangedRole = Qt::UserRole + 1,
+            PreviousDisplayRole
+        };
 
         /*!
          * \brief JobTableModel Constructor.
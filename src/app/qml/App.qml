@@ -11,16 +11,62 @@ import Arrival
 Item {
     anchors.fill: parent
 
+    // True while the .csv files are parsed and compared.
+    property bool parsing: false
+
+    // The column selector opens once the loading popup is gone.
+    property bool columnSelectorPending: false
+
+    function openColumnSelector() {
+        if (busyIndicator.shown) {
+            columnSelectorPending = true;
+        } else {
+            columnSelector.open();
+        }
+    }
+
     AppModel {
         id: appModel
 
         onParsingStarted: () => {
-            loadingPopup.open();
+            parsing = true;
+        }
+
+        onParsingResultsAvailable: () => {
+            parsing = false;
+            openColumnSelector();
+        }
+
+        onParsingCanceled: () => {
+            parsing = false;
+            columnSelectorPending = false;
         }
 
         onParsingCompleted: () => {
-            loadingPopup.close();
-            columnSelector.open();
+            // No rows have been appended if the files could not be compared.
+            if (parsing) {
+                parsing = false;
+                openColumnSelector();
+            }
+        }
+
+        onExportingChanged: (exporting) => {
+            if (exporting) {
+                exportPopup.statusText = "";
+                exportPopup.open();
+            }
+        }
+
+        onExportCompleted: (filePath) => {
+            exportPopup.close();
+        }
+
+        onExportFailed: (filePath, error) => {
+            exportPopup.statusText = qsTr("Export failed: ") + error;
+        }
+
+        onExportCanceled: (filePath) => {
+            exportPopup.close();
         }
     }
 
@@ -76,20 +122,88 @@ Item {
             }
         }
 
+        // The popup follows the indicator, so it neither flashes up for quick comparisons
+        // nor disappears right after it showed up.
         ArrivalBusyIndicator {
             id: busyIndicator
             anchors.centerIn: parent
             width: 100
             height: 100
-            running: false
+            busy: parsing
+
+            onShownChanged: () => {
+                if (shown) {
+                    loadingPopup.open();
+                } else {
+                    loadingPopup.close();
+                    if (columnSelectorPending) {
+                        columnSelectorPending = false;
+                        columnSelector.open();
+                    }
+                }
+            }
+        }
+    }
+
+    Popup {
+        id: exportPopup
+        anchors.centerIn: parent
+        modal: true
+        width: 420
+        height: 200
+        closePolicy: Popup.NoAutoClose
+        visible: false
+
+        property string statusText: ""
+
+        background: Rectangle {
+            color: Style.backgroundColor
+            radius: 6
         }
 
-        onOpened: () => {
-            busyIndicator.running = true;
+        Overlay.modal: Rectangle {
+            color: "#BF070809"
         }
 
-        onClosed: () => {
-            busyIndicator.running = false;
+        ColumnLayout {
+            anchors.fill: parent
+            anchors.margins: 12
+            spacing: 12
+
+            Text {
+                Layout.fillWidth: true
+                color: Style.textColor
+                font.pixelSize: 16
+                elide: Text.ElideRight
+                text: exportPopup.statusText !== "" ? exportPopup.statusText
+                    : qsTr("Exported ") + appModel.exportedRowCount + " / " + appModel.exportRowCount + qsTr(" rows")
+                      + " (" + (appModel.exportedByteCount / (1024 * 1024)).toFixed(1) + " MB)"
+            }
+
+            ProgressBar {
+                Layout.fillWidth: true
+                from: 0
+                to: Math.max(appModel.exportRowCount, 1)
+                value: appModel.exportedRowCount
+            }
+
+            Item {
+                Layout.fillHeight: true
+            }
+
+            ArrivalButton {
+                Layout.alignment: Qt.AlignBottom | Qt.AlignRight
+                buttonText: appModel.exporting ? qsTr("Cancel") : qsTr("Close")
+                buttonColor: "#da373c"
+                buttonHoverColor: "#a12828"
+                onClicked: () => {
+                    if (appModel.exporting) {
+                        appModel.cancelXlsxExport();
+                    } else {
+                        exportPopup.close();
+                    }
+                }
+            }
         }
     }
 
@@ -129,7 +243,7 @@ Item {
             InfoLabelArea {
                 color: Style.remainedEntryBackgroundColor
                 border.width: 0
-                text: "Remained  " + (appModel.jobTable.hasData ? (appModel.jobTable.rowCount - (appModel.jobTable.newAddedCount + appModel.jobTable.removedCount)) : "-")
+                text: "Remained  " + (appModel.jobTable.hasData ? (appModel.jobTable.rowCount - (appModel.jobTable.newAddedCount + appModel.jobTable.removedCount + appModel.jobTable.modifiedCount)) : "-")
             }
 
             InfoLabelArea {
@@ -144,6 +258,17 @@ Item {
                 text: "Removed  " + (appModel.jobTable.hasData ? appModel.jobTable.removedCount : "-")
             }
 
+            InfoLabelArea {
+                color: Style.modifiedEntryBackgroundColor
+                border.width: 0
+                text: "Modified  " + (appModel.jobTable.hasData ? appModel.jobTable.modifiedCount : "-")
+            }
+
+            InfoLabelArea {
+                visible: appModel.jobTable.hasData
+                text: "Jobnumber  " + (appModel.jobTable.keyDetectionConfidence >= 0 ? Math.round(appModel.jobTable.keyDetectionConfidence * 100) + " %" : "-")
+            }
+
             Item {
                 Layout.fillWidth: true
             }
@@ -167,6 +292,7 @@ Item {
         ArrivalButton {
             id: exportButton
             buttonText: "Export Excel"
+            enabled: !appModel.exporting && !appModel.parsing
             Layout.alignment: Qt.AlignBottom | Qt.AlignRight
             onClicked: () => {
                 if (appModel.jobTable.rowCount > 0 && jobList.columnsToShow.length > 0) {
@@ -216,8 +342,10 @@ Item {
                 onClicked: () => {
                     leftFileSelectionArea.deselectFiles();
                     rightFileSelectionArea.deselectFiles();
+                    appModel.cancelParsing();
                     appModel.jobTable.clearTable();
                     columnSelector.resetTemplateSelection();
+                    columnSelector.resetKeyColumns();
                 }
             }
 
@@ -226,6 +354,7 @@ Item {
                 buttonText: "Import CSV"
                 onClicked: () => {
                     if (leftFileSelectionArea.fileUrls.length > 0 && rightFileSelectionArea.fileUrls.length > 0) {
+                        appModel.keyColumnNames = columnSelector.keyColumnNames;
                         appModel.parseCSV(leftFileSelectionArea.fileUrls[0], rightFileSelectionArea.fileUrls[0]);
                     }
                 }
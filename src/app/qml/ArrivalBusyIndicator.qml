@@ -9,6 +9,61 @@ BusyIndicator {
     id: control
     property color indicatorColor: "white"//"#5865f2"
 
+    // Set while the work is running. The indicator follows it with the delays below,
+    // so short work does not make it flash.
+    property bool busy: false
+
+    // The indicator only shows up if the work takes longer than this (ms).
+    property int showDelay: 200
+
+    // Once shown, the indicator stays visible for at least this long (ms).
+    property int minimumVisibleTime: 400
+
+    // Whether the indicator is currently shown.
+    readonly property bool shown: policy.shown
+
+    running: shown
+
+    onBusyChanged: () => {
+        if (busy) {
+            if (!policy.shown) {
+                showTimer.restart();
+            }
+        } else {
+            showTimer.stop();
+            if (policy.shown && policy.minimumTimeElapsed) {
+                policy.shown = false;
+            }
+        }
+    }
+
+    QtObject {
+        id: policy
+        property bool shown: false
+        property bool minimumTimeElapsed: false
+    }
+
+    Timer {
+        id: showTimer
+        interval: control.showDelay
+        onTriggered: () => {
+            policy.shown = true;
+            policy.minimumTimeElapsed = false;
+            minimumVisibleTimer.restart();
+        }
+    }
+
+    Timer {
+        id: minimumVisibleTimer
+        interval: control.minimumVisibleTime
+        onTriggered: () => {
+            policy.minimumTimeElapsed = true;
+            if (!control.busy) {
+                policy.shown = false;
+            }
+        }
+    }
+
     contentItem: Item {
         implicitWidth: parent.width
         implicitHeight: parent.height
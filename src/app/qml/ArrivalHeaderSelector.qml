@@ -17,6 +17,7 @@ Popup {
     property color outlineColor: Style.controlBorderColor
 
     readonly property list<int> selectedHeaderIndices: headerListModel.selectedHeaderIndices
+    readonly property list<string> keyColumnNames: headerListModel.keyColumnNames
     required property JobTableBackend table
     required property SelectedHeadersTemplateList selectedHeadersTemplateList
 
@@ -26,6 +27,11 @@ Popup {
         selectedHeadersTemplateListView.currentIndex = -1;
     }
 
+    // Falls back to the detected Jobnumber column.
+    function resetKeyColumns() {
+        headerListModel.keyColumnNames = [];
+    }
+
     background: Rectangle {
         implicitHeight: parent.height
         color: backgroundColor
@@ -34,7 +40,7 @@ Popup {
     }
 
     function saveCurrentSelectionAsTemplate(templateName) {
-        selectedHeadersTemplateList.addNewTemplate(table.formatIdentifier, templateName, selectedHeaderIndices);
+        selectedHeadersTemplateList.addNewTemplate(table.formatIdentifier, templateName, selectedHeaderIndices, keyColumnNames);
     }
 
     HeaderListModel {
@@ -270,6 +276,9 @@ Popup {
                                     // Set the correct indices.
                                     var indices = selectedHeadersTemplateList.getTemplateIndices(index);
                                     headerListModel.selectedHeaderIndices = indices;
+
+                                    // Templates without key columns fall back to the detected Jobnumber column.
+                                    headerListModel.keyColumnNames = selectedHeadersTemplateList.getTemplateKeyColumnNames(index);
                                 }
                             }
 
@@ -300,6 +309,7 @@ Popup {
                     model: headerListModel
 
                     delegate: Rectangle {
+                        width: ListView.view.width
                         height: 40
                         color: "#1E1F22"
 
@@ -321,6 +331,23 @@ Popup {
                                 color: "white"
                                 font.pixelSize: 16
                             }
+
+                            // Rows are matched by the key columns the next time the files are imported.
+                            ArrivalCheckBox {
+                                Layout.alignment: Qt.AlignRight
+                                Layout.rightMargin: 10
+                                text: qsTr("Key")
+                                checked: model.key
+                                onClicked: model.key = checked
+
+                                contentItem: Text {
+                                    leftPadding: parent.indicator.width + parent.spacing
+                                    verticalAlignment: Text.AlignVCenter
+                                    text: parent.text
+                                    color: "white"
+                                    font.pixelSize: 14
+                                }
+                            }
                         }
                     }
                 }
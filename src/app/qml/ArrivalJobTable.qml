@@ -19,6 +19,8 @@ Item {
     property color newAddedEntryBackgroundColor: Style.newAddedEntryBackgroundColor
     property color removedEntryBackgroundColor: Style.removedEntryBackgroundColor
     property color remainedEntryBackgroundColor: Style.remainedEntryBackgroundColor
+    property color modifiedEntryBackgroundColor: Style.modifiedEntryBackgroundColor
+    property color changedCellBackgroundColor: Style.changedCellBackgroundColor
     property color textColor: Style.textColor
     property color headerTextColor: Style.textColor
     property color borderColor: Style.controlBorderColor
@@ -30,6 +32,7 @@ Item {
         case 0: return newAddedEntryBackgroundColor;
         case 1: return removedEntryBackgroundColor;
         case 2: return remainedEntryBackgroundColor;
+        case 3: return modifiedEntryBackgroundColor;
         }
         return backgroundColor;
     }
@@ -98,9 +101,20 @@ Item {
             }
 
             delegate: Rectangle {
-                color: selectRowColor(tableView.model.rowState(row))
+                // Changed cells of modified rows stand out from the rest of their row.
+                color: model.changed ? changedCellBackgroundColor : selectRowColor(tableView.model.rowState(row))
                 border.width: 0
 
+                // Show the value the cell had in the old document.
+                HoverHandler {
+                    id: cellHoverHandler
+                    enabled: model.changed
+                }
+
+                ToolTip.visible: model.changed && cellHoverHandler.hovered
+                ToolTip.delay: 500
+                ToolTip.text: "Previously: " + model.previousDisplay
+
                 TextInput {
                     anchors.margins: 10
                     width: tableView.columnWidthProvider(modelData) - 20 // Margins times two.
@@ -23,4 +23,6 @@ QtObject {
     readonly property color newAddedEntryBackgroundColor: "#248046"
     readonly property color removedEntryBackgroundColor: "#DA373C"
     readonly property color remainedEntryBackgroundColor: "#404249"
+    readonly property color modifiedEntryBackgroundColor: "#4A4237"
+    readonly property color changedCellBackgroundColor: "#C27C0E"
 }
@@ -3,12 +3,14 @@
 // Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
 
 #include <QIcon>
+#include <QQuickWindow>
 
 #include "app.h"
 #include "ui/appmodel.h"
 #include "ui/headerlistmodel.h"
 #include "ui/jobtablemodel.h"
 #include "ui/selectedheaderstemplatemodel.h"
+#include "trace/tracerecorder.h"
 
 namespace Arrival::App
 {
@@ -16,6 +18,9 @@ namespace Arrival::App
         : guiApp(argc, argv)
         , qmlEngine()
     {
+        // Record a trace if ARRIVAL_TRACE names a file. It is written when the app quits.
+        TraceRecorder::instance().startFromEnvironment();
+
         registerUiTypes();
 
         // Appearance
@@ -28,6 +33,20 @@ namespace Arrival::App
             { QCoreApplication::exit(-1); },
             Qt::QueuedConnection);
         qmlEngine.loadFromModule("Arrival", "Main");
+
+#ifdef ARRIVAL_ENABLE_TRACING
+        // The first frame showing new data ends the span begun when the data has been handed to the table.
+        // Frames are swapped on the render thread.
+        if (TraceRecorder::instance().isEnabled() && !qmlEngine.rootObjects().isEmpty())
+        {
+            if (QQuickWindow* window = qobject_cast<QQuickWindow*>(qmlEngine.rootObjects().first()))
+            {
+                QObject::connect(window, &QQuickWindow::frameSwapped, window, []() {
+                    ARRIVAL_TRACE_END("qml.firstFrame");
+                }, Qt::DirectConnection);
+            }
+        }
+#endif
     }
 
     void ArrivalApp::registerUiTypes()
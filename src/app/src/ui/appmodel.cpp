@@ -6,14 +6,23 @@
 #include <QtConcurrent/QtConcurrent>
 #include <QFutureWatcher>
 #include <QThreadPool>
+#include <QPromise>
+#include <QColor>
+#include <QFile>
+#include <QFileInfo>
 
 #include <functional>
 #include <array>
 
-#include "xlsxdocument.h"
-
+#include "data/csvcombineddataexport.h"
 #include "data/csvhandling.h"
+#include "data/xlsxstreamwriter.h"
 #include "ui/appmodel.h"
+#include "trace/tracerecorder.h"
+
+#ifdef QT_DEBUG
+#define ARRIVAL_DEBUG 1
+#endif
 
 namespace Arrival::App
 {
@@ -24,14 +33,61 @@ namespace Arrival::App
         return correctPath.replace(regex, "");
     }
 
+    // The export reports its progress to the ui in steps of this many rows.
+    static constexpr int xlsxExportProgressStep = 4096;
+
+    // Writes the rows of the combined data to a .xlsx file. Runs on a worker thread.
+    // The file is removed if the export fails or is canceled.
+    static void writeXlsx(QPromise<std::expected<void, QString>>& promise, const QSharedPointer<const CSVCombinedData>& data, const QList<int>& columns,
+                          const QString& filePath, const QSharedPointer<std::atomic<qint64>>& byteCounter, const CancellationToken& cancellationToken)
+    {
+        CSVCombinedDataExportOptions options;
+        options.columns = columns;
+        options.addedFill = QColor::fromString(ARRIVAL_EXCEL_EXPORT_NEW_ADDED_CELL_COLOR).rgba();
+        options.removedFill = QColor::fromString(ARRIVAL_EXCEL_EXPORT_REMOVED_CELL_COLOR).rgba();
+        options.modifiedFill = QColor::fromString(ARRIVAL_EXCEL_EXPORT_MODIFIED_CELL_COLOR).rgba();
+        options.progressStep = xlsxExportProgressStep;
+        options.progress = [&](int rows, qint64 bytes)
+        {
+            byteCounter->store(bytes, std::memory_order_relaxed);
+            promise.setProgressValue(rows);
+        };
+        options.cancellationToken = cancellationToken;
+
+        promise.setProgressRange(0, qMin(data->rowCount() + 1, XlsxStreamWriter::maximumRowCount));
+        const std::expected<void, QString> result = CSVCombinedDataExport::toXlsx(*data, filePath, options);
+        if (promise.isCanceled())
+        {
+            return;
+        }
+        promise.addResult(result);
+    }
+
     AppModel::AppModel(QObject* parent)
         : QObject(parent)
         , m_jobTable(new JobTable(this))
         , m_templateList(new SelectedHeadersTemplateList(this))
+        , m_diffThreadCount(0)
+        , m_keyColumnNames()
         , m_jobTableFuture()
         , m_jobTableFutureWatcher()
+        , m_isParsing(false)
+        , m_parseCancellationToken()
+        , m_parseGeneration(0)
+        , m_exportFilePath()
+        , m_exportRowCount(0)
+        , m_exportedRowCount(0)
+        , m_exportedByteCount(0)
+        , m_exportByteCounter()
+        , m_exportCancellationToken()
+        , m_exportFuture()
+        , m_exportFutureWatcher()
     {
         m_templateList->loadFromJson("templates.json");
+
+        connect(&m_jobTableFutureWatcher, &QFutureWatcher<std::expected<void, CSVCombinedData::CombineCSVDocumentsError>>::finished, this, &AppModel::onCSVParsed);
+        connect(&m_exportFutureWatcher, &QFutureWatcher<std::expected<void, QString>>::progressValueChanged, this, &AppModel::onXlsxExportProgress);
+        connect(&m_exportFutureWatcher, &QFutureWatcher<std::expected<void, QString>>::finished, this, &AppModel::onXlsxExported);
     }
 
     JobTable* AppModel::jobTable() const
@@ -56,6 +112,65 @@ namespace Arrival::App
         emit templateListChanged(list);
     }
 
+    int AppModel::diffThreadCount() const
+    {
+        return m_diffThreadCount;
+    }
+
+    void AppModel::setDiffThreadCount(int count)
+    {
+        // Guard.
+        if (count == m_diffThreadCount)
+        {
+            return;
+        }
+
+        m_diffThreadCount = count;
+        emit diffThreadCountChanged(count);
+    }
+
+    const QList<QString>& AppModel::keyColumnNames() const
+    {
+        return m_keyColumnNames;
+    }
+
+    void AppModel::setKeyColumnNames(const QList<QString>& names)
+    {
+        // Guard.
+        if (names == m_keyColumnNames)
+        {
+            return;
+        }
+
+        m_keyColumnNames = names;
+        emit keyColumnNamesChanged(names);
+    }
+
+    bool AppModel::isParsing() const
+    {
+        return m_isParsing;
+    }
+
+    bool AppModel::isExporting() const
+    {
+        return !m_exportFilePath.isEmpty();
+    }
+
+    int AppModel::exportRowCount() const
+    {
+        return m_exportRowCount;
+    }
+
+    int AppModel::exportedRowCount() const
+    {
+        return m_exportedRowCount;
+    }
+
+    qint64 AppModel::exportedByteCount() const
+    {
+        return m_exportedByteCount;
+    }
+
     void AppModel::parseCSV(const QString &csvPath1, const QString &csvPath2)
     {
         // Emit the signal that the .csv parsing started.
@@ -83,37 +198,124 @@ namespace Arrival::App
         // This ensures that the main thread is not blocked and that the ui will run
         // without brakes.
         // Especially important on lower spec pc.
-        m_jobTableFuture = QtConcurrent::run(QThreadPool::globalInstance(), [=](const QString& path1, const QString& path2)
+        // Columnar documents release their files and keep low cardinality columns dictionary encoded.
+        CSVDocumentOptions documentOptions;
+        documentOptions.threadCount = m_diffThreadCount;
+        documentOptions.storage = CSVDocumentStorage::Columnar;
+
+        // A new comparison supersedes the running one. The old worker notices the token within a few rows.
+        if (m_isParsing)
+        {
+            m_parseCancellationToken.cancel();
+        }
+        m_parseCancellationToken = CancellationToken();
+        const bool wasParsing = m_isParsing;
+        m_isParsing = true;
+        const quint64 generation = ++m_parseGeneration;
+        if (!wasParsing)
+        {
+            emit parsingChanged(true);
+        }
+
+        CSVCombineOptions options;
+        options.threadCount = m_diffThreadCount;
+        options.keyColumnNames = m_keyColumnNames;
+        options.cancellationToken = m_parseCancellationToken;
+
+        // Once both files have been compared, the rows are appended to the job table in batches.
+        // Every hand over is queued to the main thread, so the table is only ever touched by the main thread.
+        m_jobTableFuture = QtConcurrent::run(QThreadPool::globalInstance(), [=, this](const QString& path1, const QString& path2)
         {
-            CSVDocument doc1(filePath1);
-            CSVDocument doc2(filePath2);
-            return CSVCombinedData::getCSVCombinedData(doc1, doc2);
+            CSVCombinedDataStream stream;
+            // Batches of a superseded comparison may still be queued, they are dropped by their generation.
+            stream.started = [this, generation](QSharedPointer<CSVCombinedData> data) {
+                QMetaObject::invokeMethod(this, [this, generation, data]() {
+                    if (generation != m_parseGeneration)
+                    {
+                        return;
+                    }
+                    m_jobTable->setTableData(data);
+                    emit parsingResultsAvailable();
+                    ARRIVAL_TRACE_BEGIN("qml.firstFrame");
+                }, Qt::QueuedConnection);
+            };
+            stream.rowsReady = [this, generation](QList<JobTableRow> rows) {
+                QMetaObject::invokeMethod(this, [this, generation, rows = std::move(rows)]() {
+                    if (generation != m_parseGeneration)
+                    {
+                        return;
+                    }
+                    m_jobTable->appendRows(rows);
+                }, Qt::QueuedConnection);
+            };
+
+            // Both files are loaded concurrently. The combined data keeps both documents alive and reads the cells from them.
+            // Files larger than the memory budget are spilled to disk instead, as long as their rows can be matched by a key.
+            CSVCombineTimings timings;
+            const CSVSpillOptions spillOptions;
+            std::expected<void, CSVCombinedData::CombineCSVDocumentsError> result = std::unexpected(CSVCombinedData::CombineCSVDocumentsError::InvalidKeyColumn);
+            if (QFileInfo(path1).size() + QFileInfo(path2).size() >= spillOptions.memoryBudget)
+            {
+                result = CSVCombinedData::streamSpilledCSVFiles(path1, path2, spillOptions, options, stream, &timings);
+            }
+            if (!result.has_value() && result.error() == CSVCombinedData::CombineCSVDocumentsError::InvalidKeyColumn)
+            {
+                result = CSVCombinedData::streamCSVFiles(path1, path2, documentOptions, options, stream, &timings);
+            }
+#if ARRIVAL_DEBUG
+            qDebug() << "Compared" << path1 << "and" << path2 << timings;
+#endif
+            return result;
         }, filePath1, filePath2);
-        connect(&m_jobTableFutureWatcher, &QFutureWatcher<std::expected<QSharedPointer<CSVCombinedData>, CSVCombinedData::CombineCSVDocumentsError>>::finished, this, &AppModel::onCSVParsed);
+
+        // The watcher only follows the latest comparison, a superseded one never reaches onCSVParsed.
         m_jobTableFutureWatcher.setFuture(m_jobTableFuture);
     }
 
+    void AppModel::cancelParsing()
+    {
+        // Guard.
+        if (!m_isParsing)
+        {
+            return;
+        }
+
+        // The worker stops at its next check. Anything it still hands over belongs to an old generation.
+        m_parseCancellationToken.cancel();
+        m_parseGeneration++;
+        m_isParsing = false;
+
+        emit parsingChanged(false);
+        emit parsingCanceled();
+    }
+
     void AppModel::onCSVParsed()
     {
-        // Transfer the data into the list that takes care of displaying the data.
-        std::expected<QSharedPointer<CSVCombinedData>, CSVCombinedData::CombineCSVDocumentsError> result = m_jobTableFutureWatcher.result();
-        if (const auto result = m_jobTableFutureWatcher.result(); result.has_value())
+        // The comparison has been canceled, parsingCanceled has already been emitted.
+        if (!m_isParsing)
+        {
+            return;
+        }
+
+        // The data has already been appended to the job table, the queued batches arrive before this point.
+        if (const auto result = m_jobTableFutureWatcher.result(); !result.has_value())
         {
-            m_jobTable->setTableData(result.value());
+            qWarning() << "The .csv files could not be compared";
         }
 
-        // Disconnect all.
-        m_jobTableFutureWatcher.disconnect();
-        m_jobTableFutureWatcher.setFuture(QFuture<std::expected<QSharedPointer<CSVCombinedData>, CSVCombinedData::CombineCSVDocumentsError>>());
+        m_isParsing = false;
+        m_jobTableFuture = QFuture<std::expected<void, CSVCombinedData::CombineCSVDocumentsError>>();
 
         // Emit the signal that the .csv parsing ended.
+        emit parsingChanged(false);
         emit parsingCompleted();
     }
 
     void AppModel::xlsxExport(const QString& path, QList<int> columns)
     {
         // Catch invalid states.
-        if (path.isEmpty() || !m_jobTable || !m_jobTable->hasData() || m_jobTable->rowCount() <= 0 || columns.empty())
+        // The rows are still appended to the data while a comparison is running, the export must not read them meanwhile.
+        if (path.isEmpty() || !m_jobTable || !m_jobTable->hasData() || m_jobTable->rowCount() <= 0 || columns.empty() || isExporting() || isParsing())
         {
             return;
         }
@@ -129,59 +331,65 @@ namespace Arrival::App
             filePath.append(".xlsx");
         }
 
-        // Create the document on the heap as it gets passed to a different thread later on.
-        // This ensures that it does not run out of scope.
-        QSharedPointer<QXlsx::Document> xlsxDocument = QSharedPointer<QXlsx::Document>::create();
+        // The whole export runs on a different thread and writes the rows straight into the file.
+        // This ensures the ui does not freeze and that the memory needed does not grow with the amount of rows.
+        // The thread keeps the data and thus both documents alive until the export is done.
+        const QSharedPointer<const CSVCombinedData> data = m_jobTable->data();
+        m_exportFilePath = filePath;
+        m_exportRowCount = qMin(data->rowCount() + 1, XlsxStreamWriter::maximumRowCount);
+        m_exportedRowCount = 0;
+        m_exportedByteCount = 0;
+        m_exportByteCounter = QSharedPointer<std::atomic<qint64>>::create(0);
+        m_exportCancellationToken = CancellationToken();
+        m_exportFuture = QtConcurrent::run(QThreadPool::globalInstance(), &writeXlsx, data, columns, filePath, m_exportByteCounter, m_exportCancellationToken);
+        m_exportFutureWatcher.setFuture(m_exportFuture);
 
-        // Format.
-        QXlsx::Format newAddedFormat;
-        newAddedFormat.setPatternBackgroundColor(QColor::fromString(ARRIVAL_EXCEL_EXPORT_NEW_ADDED_CELL_COLOR));
-        QXlsx::Format removedFormat;
-        removedFormat.setPatternBackgroundColor(QColor::fromString(ARRIVAL_EXCEL_EXPORT_REMOVED_CELL_COLOR));
+        emit exportingChanged(true);
+        emit exportProgressChanged(m_exportedRowCount, m_exportedByteCount);
+    }
 
-        // Write the headers.
-        for (int headerIterator = 0; headerIterator < columns.count(); headerIterator++)
+    void AppModel::cancelXlsxExport()
+    {
+        // Guard.
+        if (!isExporting())
         {
-            const QString& cellString = m_jobTable->data()->headerNames().at(columns.at(headerIterator));
-            xlsxDocument->write(1, headerIterator + 1, cellString);
+            return;
         }
 
-        // Write the actual data.
-        for (int i = 0; i < m_jobTable->rowCount(); i++)
-        {
-            int rowIndex = i + 2;
-            const JobTableRow& row = m_jobTable->data()->rows().at(i);
+        // The export notices the request between two rows and ends with exportCanceled.
+        m_exportCancellationToken.cancel();
+        m_exportFuture.cancel();
+    }
 
-            for (int columnIterator = 0; columnIterator < columns.count(); columnIterator++)
-            {
-                const int column = columns.at(columnIterator);
-                QXlsx::Format format;
-                if (row.state == JobTableRowState::Added)
-                {
-                    format = newAddedFormat;
-                }
-                else if (row.state == JobTableRowState::Removed)
-                {
-                    format = removedFormat;
-                }
-                else
-                {
-                    format = QXlsx::Format();
-                }
-                const QString& cellString = row.columns.at(column);
-                xlsxDocument->write(rowIndex, columnIterator + 1, cellString, format);
-            }
-        }
+    void AppModel::onXlsxExportProgress(int rows)
+    {
+        m_exportedRowCount = rows;
+        m_exportedByteCount = m_exportByteCounter->load(std::memory_order_relaxed);
+        emit exportProgressChanged(m_exportedRowCount, m_exportedByteCount);
+    }
 
-        // Writing the file is done on a different thread.
-        // This ensures the ui does not freeze.
-        // Especially important on lower spec pc.
-        auto future = QtConcurrent::run(QThreadPool::globalInstance(), [=](QSharedPointer<QXlsx::Document> document)
+    void AppModel::onXlsxExported()
+    {
+        const QString filePath = m_exportFilePath;
+        m_exportFilePath.clear();
+
+        if (m_exportFuture.isCanceled())
         {
-            if (!xlsxDocument->saveAs(filePath))
-            {
-                qWarning() << "Error saving .xlsx document: " + filePath;
-            }
-        }, xlsxDocument);
+            // The export might have completed right before it was canceled.
+            QFile::remove(filePath);
+            emit exportCanceled(filePath);
+        }
+        else if (const std::expected<void, QString> result = m_exportFuture.result(); result.has_value())
+        {
+            onXlsxExportProgress(m_exportFuture.progressValue());
+            emit exportCompleted(filePath);
+        }
+        else
+        {
+            emit exportFailed(filePath, result.error());
+        }
+
+        m_exportFuture = QFuture<std::expected<void, QString>>();
+        emit exportingChanged(false);
     }
 }
@@ -15,6 +15,8 @@ namespace Arrival::App
     : QAbstractListModel(parent)
     , m_table(nullptr)
     , m_selectedHeaders()
+    , m_selectedHeaderIndices()
+    , m_keyColumnNames()
     {}
 
     int HeaderListModel::rowCount(const QModelIndex &parent) const
@@ -37,11 +39,16 @@ namespace Arrival::App
         const QString& headerName = m_table->data()->headerNames().at(index.row());
         const bool selected = m_selectedHeaders.at(index.row());
 
+        // Without chosen key columns the columns detected by the comparison are the keys.
+        const bool key = m_keyColumnNames.isEmpty() ? m_table->data()->keyColumns().contains(index.row()) : m_keyColumnNames.contains(headerName);
+
         switch (role) {
         case SelectedRole:
             return QVariant(selected);
         case HeaderNameRole:
             return QVariant(headerName);
+        case KeyRole:
+            return QVariant(key);
         }
         return QVariant();
     }
@@ -51,6 +58,7 @@ namespace Arrival::App
         QHash<int, QByteArray> names;
         names[SelectedRole] = "selected";
         names[HeaderNameRole] = "headerName";
+        names[KeyRole] = "key";
         return names;
     }
 
@@ -94,6 +102,36 @@ namespace Arrival::App
             }
             return false;
         }
+        case KeyRole:
+        {
+            const QString& headerName = m_table->data()->headerNames().at(index.row());
+            QList<QString> names = m_keyColumnNames;
+
+            // The first change starts from the detected key columns.
+            if (names.isEmpty())
+            {
+                for (const int keyColumn : m_table->data()->keyColumns())
+                {
+                    names.append(m_table->data()->headerNames().at(keyColumn));
+                }
+            }
+
+            const bool key = value.toBool();
+            if (key == names.contains(headerName))
+            {
+                return false;
+            }
+            if (key)
+            {
+                names.append(headerName);
+            }
+            else
+            {
+                names.removeOne(headerName);
+            }
+            setKeyColumnNames(names);
+            return true;
+        }
         case HeaderNameRole:
             return false;
         }
@@ -132,6 +170,11 @@ namespace Arrival::App
         return m_selectedHeaderIndices;
     }
 
+    const QList<QString>& HeaderListModel::keyColumnNames() const
+    {
+        return m_keyColumnNames;
+    }
+
     void HeaderListModel::setJobTable(JobTable* table)
     {
         if (!table || table == m_table)
@@ -210,4 +253,21 @@ namespace Arrival::App
         emit selectedHeaderIndicesChanged(selectedHeaderIndices());
         emit dataChanged(topLeft, bottomRight, QVector<int>() << HeaderListModel::SelectedRole);
     }
+
+    void HeaderListModel::setKeyColumnNames(const QList<QString>& names)
+    {
+        // Guard.
+        if (names == m_keyColumnNames)
+        {
+            return;
+        }
+
+        m_keyColumnNames = names;
+
+        // Every row may have changed, the detected key columns apply if the list became empty.
+        const QModelIndex topLeft = createIndex(0, 0);
+        const QModelIndex bottomRight = createIndex(rowCount() - 1, 0);
+        emit keyColumnNamesChanged(keyColumnNames());
+        emit dataChanged(topLeft, bottomRight, QVector<int>() << HeaderListModel::KeyRole);
+    }
 }
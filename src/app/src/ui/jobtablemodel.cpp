@@ -32,7 +32,7 @@ namespace Arrival::App
 
     QHash<int, QByteArray> JobTableModel::roleNames() const
     {
-        return { {Qt::DisplayRole, "display"} };
+        return { {Qt::DisplayRole, "display"}, {ChangedRole, "changed"}, {PreviousDisplayRole, "previousDisplay"} };
     }
 
     int JobTableModel::mapColumnIndex(int index) const
@@ -79,11 +79,23 @@ namespace Arrival::App
             return QVariant("");
         }
 
-        if (role == Qt::DisplayRole)
+        const QSharedPointer<CSVCombinedData> combinedData = m_table->data();
+        switch (role)
         {
-            return m_table->data()->rows().at(index.row()).columns.at(mapColumnIndex(index.column()));
+        case Qt::DisplayRole:
+            return combinedData->cell(index.row(), mapColumnIndex(index.column()));
+        case ChangedRole:
+            return combinedData->isChanged(combinedData->rows().at(index.row()), mapColumnIndex(index.column()));
+        case PreviousDisplayRole:
+            // Only changed cells have a previous value worth showing.
+            if (combinedData->isChanged(combinedData->rows().at(index.row()), mapColumnIndex(index.column())))
+            {
+                return combinedData->previousCell(index.row(), mapColumnIndex(index.column()));
+            }
+            return QVariant("");
+        default:
+            return QVariant("");
         }
-        return QVariant("");
     }
 
     JobTable* JobTableModel::jobTable() const
@@ -128,6 +140,15 @@ namespace Arrival::App
             endResetModel();
         });
 
+        // Streamed rows are inserted without resetting the model.
+        connect(m_table, &JobTable::preRowsAppended, this, [=](int first, int last) {
+            beginInsertRows(QModelIndex(), first, last);
+        });
+
+        connect(m_table, &JobTable::postRowsAppended, this, [=]() {
+            endInsertRows();
+        });
+
         endResetModel();
 
         emit jobTableChanged(jobTable);
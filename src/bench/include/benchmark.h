@@ -0,0 +1,171 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#ifndef ARRIVAL_BENCHMARK_H
+#define ARRIVAL_BENCHMARK_H
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <QtGlobal>
+
+#include <functional>
+
+namespace Arrival::Bench
+{
+    /*!
+     * \brief The BenchmarkResult struct holds the measurements of a stage for one input size.
+     */
+    struct BenchmarkResult
+    {
+        /*!
+         * \brief stage The name of the measured stage.
+         */
+        QString stage;
+
+        /*!
+         * \brief rows The amount of rows of the input.
+         */
+        int rows = 0;
+
+        /*!
+         * \brief columns The amount of columns of the input.
+         */
+        int columns = 0;
+
+        /*!
+         * \brief inputBytes The size of the input in bytes.
+         */
+        qint64 inputBytes = 0;
+
+        /*!
+         * \brief iterations The amount of measured runs.
+         */
+        int iterations = 0;
+
+        /*!
+         * \brief bestMilliseconds The fastest run.
+         */
+        double bestMilliseconds = 0.0;
+
+        /*!
+         * \brief medianMilliseconds The median of all runs.
+         */
+        double medianMilliseconds = 0.0;
+
+        /*!
+         * \brief peakResidentSetSize The peak resident set size while the stage ran, in bytes. -1 if unknown.
+         */
+        qint64 peakResidentSetSize = -1;
+
+        /*!
+         * \brief skipped The reason the stage has not been measured, empty if it has.
+         */
+        QString skipped;
+
+        /*!
+         * \brief key Identifies the result across runs.
+         * \return The stage and the input size.
+         */
+        QString key() const;
+
+        /*!
+         * \brief toJson Converts the result to JSON, including the throughput.
+         * \return The JSON object.
+         */
+        QJsonObject toJson() const;
+    };
+
+    /*!
+     * \brief The Benchmark class measures stages and collects their results.
+     */
+    class Benchmark
+    {
+    public:
+        /*!
+         * \brief peakResidentSetSize Returns the peak resident set size of the process.
+         * \return The peak in bytes, -1 if it is not available on this platform.
+         */
+        static qint64 peakResidentSetSize();
+
+        /*!
+         * \brief resetPeakResidentSetSize Resets the peak resident set size to the current one.
+         * Only supported on Linux, elsewhere the peak of the whole process is reported.
+         * \return True if the peak has been reset, false otherwise.
+         */
+        static bool resetPeakResidentSetSize();
+
+        /*!
+         * \brief Benchmark Constructs a benchmark.
+         * \param iterations The amount of runs per stage.
+         */
+        explicit Benchmark(int iterations);
+
+        /*!
+         * \brief measure Runs a stage several times and records the result.
+         * \param stage The name of the stage.
+         * \param rows The amount of rows of the input.
+         * \param columns The amount of columns of the input.
+         * \param inputBytes The size of the input in bytes.
+         * \param run The stage. Everything it allocates has to be released before it returns.
+         */
+        void measure(const QString& stage, int rows, int columns, qint64 inputBytes, const std::function<void()>& run);
+
+        /*!
+         * \brief skip Records a stage that has not been measured.
+         * \param stage The name of the stage.
+         * \param rows The amount of rows of the input.
+         * \param columns The amount of columns of the input.
+         * \param reason Why the stage has been skipped.
+         */
+        void skip(const QString& stage, int rows, int columns, const QString& reason);
+
+        /*!
+         * \brief results Returns the recorded results.
+         * \return The results in the order they have been recorded.
+         */
+        const QList<BenchmarkResult>& results() const
+        {
+            return m_results;
+        }
+
+        /*!
+         * \brief toJson Converts every result to JSON, together with a description of the machine.
+         * \param label A label for the run, e.g. the commit it has been built from.
+         * \return The JSON object.
+         */
+        QJsonObject toJson(const QString& label) const;
+
+        /*!
+         * \brief compare Describes how the results differ from an earlier run.
+         * \param baseline The JSON written by an earlier run.
+         * \return One line per result found in both runs.
+         */
+        QString compare(const QJsonObject& baseline) const;
+
+        /*!
+         * \brief speedups Compares the fastest runs of two stages on every input size both have been measured on.
+         * Every comparison is printed as well.
+         * \param stage The stage that is expected to be faster.
+         * \param baselineStage The stage it is compared to.
+         * \param target The speedup \p stage is expected to reach, e.g. 5 for five times as fast.
+         * \return One JSON object per input size with the speedup and whether it reaches the target.
+         */
+        QJsonArray speedups(const QString& stage, const QString& baselineStage, double target) const;
+
+    private:
+        /*!
+         * \brief m_iterations The amount of runs per stage.
+         */
+        int m_iterations;
+
+        /*!
+         * \brief m_results The recorded results.
+         */
+        QList<BenchmarkResult> m_results;
+    };
+}
+
+#endif // ARRIVAL_BENCHMARK_H
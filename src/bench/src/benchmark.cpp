@@ -0,0 +1,247 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QSysInfo>
+#include <QThread>
+#include <QTextStream>
+
+#include <algorithm>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+#include "benchmark.h"
+
+namespace Arrival::Bench
+{
+    QString BenchmarkResult::key() const
+    {
+        return stage + '/' + QString::number(rows) + 'x' + QString::number(columns);
+    }
+
+    QJsonObject BenchmarkResult::toJson() const
+    {
+        QJsonObject object;
+        object["stage"] = stage;
+        object["rows"] = rows;
+        object["columns"] = columns;
+        if (!skipped.isEmpty())
+        {
+            object["skipped"] = skipped;
+            return object;
+        }
+
+        const double seconds = bestMilliseconds / 1000.0;
+        object["inputBytes"] = inputBytes;
+        object["iterations"] = iterations;
+        object["bestMs"] = bestMilliseconds;
+        object["medianMs"] = medianMilliseconds;
+        object["rowsPerSecond"] = seconds > 0.0 ? rows / seconds : 0.0;
+        object["bytesPerSecond"] = seconds > 0.0 ? inputBytes / seconds : 0.0;
+        object["peakRssBytes"] = peakResidentSetSize;
+        return object;
+    }
+
+    qint64 Benchmark::peakResidentSetSize()
+    {
+#if defined(Q_OS_LINUX)
+        QFile status("/proc/self/status");
+        if (!status.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            return -1;
+        }
+        while (!status.atEnd())
+        {
+            const QByteArray line = status.readLine();
+            if (line.startsWith("VmHWM:"))
+            {
+                // The value is given in kB.
+                return line.mid(6).trimmed().split(' ').first().toLongLong() * 1024;
+            }
+        }
+        return -1;
+#elif defined(Q_OS_WIN)
+        PROCESS_MEMORY_COUNTERS counters;
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        {
+            return -1;
+        }
+        return static_cast<qint64>(counters.PeakWorkingSetSize);
+#elif defined(Q_OS_UNIX)
+        rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+        {
+            return -1;
+        }
+#if defined(Q_OS_DARWIN)
+        // Bytes on macOS, kB everywhere else.
+        return static_cast<qint64>(usage.ru_maxrss);
+#else
+        return static_cast<qint64>(usage.ru_maxrss) * 1024;
+#endif
+#else
+        return -1;
+#endif
+    }
+
+    bool Benchmark::resetPeakResidentSetSize()
+    {
+#if defined(Q_OS_LINUX)
+        // Writing 5 resets the peak to the current resident set size.
+        QFile clearRefs("/proc/self/clear_refs");
+        return clearRefs.open(QIODevice::WriteOnly) && clearRefs.write("5") == 1;
+#else
+        return false;
+#endif
+    }
+
+    Benchmark::Benchmark(int iterations)
+        : m_iterations(qMax(1, iterations))
+        , m_results()
+    {}
+
+    void Benchmark::measure(const QString& stage, int rows, int columns, qint64 inputBytes, const std::function<void()>& run)
+    {
+        resetPeakResidentSetSize();
+
+        QList<double> times;
+        times.reserve(m_iterations);
+        for (int iteration = 0; iteration < m_iterations; iteration++)
+        {
+            QElapsedTimer timer;
+            timer.start();
+            run();
+            times.append(timer.nsecsElapsed() / 1000000.0);
+        }
+        std::sort(times.begin(), times.end());
+
+        BenchmarkResult result;
+        result.stage = stage;
+        result.rows = rows;
+        result.columns = columns;
+        result.inputBytes = inputBytes;
+        result.iterations = m_iterations;
+        result.bestMilliseconds = times.first();
+        result.medianMilliseconds = times.at(times.count() / 2);
+        result.peakResidentSetSize = peakResidentSetSize();
+        m_results.append(result);
+
+        QTextStream(stderr) << result.key() << ": " << result.bestMilliseconds << " ms\n";
+    }
+
+    void Benchmark::skip(const QString& stage, int rows, int columns, const QString& reason)
+    {
+        BenchmarkResult result;
+        result.stage = stage;
+        result.rows = rows;
+        result.columns = columns;
+        result.skipped = reason;
+        m_results.append(result);
+
+        QTextStream(stderr) << result.key() << ": skipped, " << reason << '\n';
+    }
+
+    QJsonObject Benchmark::toJson(const QString& label) const
+    {
+        QJsonObject machine;
+        machine["cpu"] = QSysInfo::currentCpuArchitecture();
+        machine["os"] = QSysInfo::prettyProductName();
+        machine["threads"] = QThread::idealThreadCount();
+        machine["qt"] = qVersion();
+        machine["peakRssResettable"] = resetPeakResidentSetSize();
+
+        QJsonArray results;
+        for (const BenchmarkResult& result : m_results)
+        {
+            results.append(result.toJson());
+        }
+
+        QJsonObject object;
+        object["label"] = label;
+        object["machine"] = machine;
+        object["results"] = results;
+        return object;
+    }
+
+    QString Benchmark::compare(const QJsonObject& baseline) const
+    {
+        QHash<QString, QJsonObject> baselineResults;
+        for (const QJsonValue& value : baseline["results"].toArray())
+        {
+            const QJsonObject object = value.toObject();
+            if (object.contains("skipped"))
+            {
+                continue;
+            }
+            const QString key = object["stage"].toString() + '/' + QString::number(object["rows"].toInt()) + 'x' + QString::number(object["columns"].toInt());
+            baselineResults.insert(key, object);
+        }
+
+        QString text;
+        QTextStream stream(&text);
+        stream << "Compared with " << baseline["label"].toString() << '\n';
+        for (const BenchmarkResult& result : m_results)
+        {
+            const auto iterator = baselineResults.constFind(result.key());
+            if (!result.skipped.isEmpty() || iterator == baselineResults.constEnd())
+            {
+                continue;
+            }
+
+            // Positive changes are slower or larger.
+            const double baselineTime = (*iterator)["bestMs"].toDouble();
+            const double timeChange = baselineTime > 0.0 ? (result.bestMilliseconds / baselineTime - 1.0) * 100.0 : 0.0;
+            const double baselineRss = (*iterator)["peakRssBytes"].toDouble();
+            const double rssChange = baselineRss > 0.0 && result.peakResidentSetSize > 0 ? (result.peakResidentSetSize / baselineRss - 1.0) * 100.0 : 0.0;
+            stream << result.key() << ": " << baselineTime << " ms -> " << result.bestMilliseconds << " ms ("
+                   << Qt::forcesign << qRound(timeChange) << "%), peak rss " << qRound(rssChange) << '%' << Qt::noforcesign << '\n';
+        }
+        return text;
+    }
+
+    QJsonArray Benchmark::speedups(const QString& stage, const QString& baselineStage, double target) const
+    {
+        QHash<QString, const BenchmarkResult*> baselineResults;
+        for (const BenchmarkResult& result : m_results)
+        {
+            if (result.stage == baselineStage && result.skipped.isEmpty())
+            {
+                baselineResults.insert(QString::number(result.rows) + 'x' + QString::number(result.columns), &result);
+            }
+        }
+
+        QJsonArray speedups;
+        for (const BenchmarkResult& result : m_results)
+        {
+            const QString size = QString::number(result.rows) + 'x' + QString::number(result.columns);
+            const auto iterator = baselineResults.constFind(size);
+            if (result.stage != stage || !result.skipped.isEmpty() || iterator == baselineResults.constEnd() || result.bestMilliseconds <= 0.0)
+            {
+                continue;
+            }
+
+            const double speedup = (*iterator)->bestMilliseconds / result.bestMilliseconds;
+            QJsonObject object;
+            object["stage"] = stage;
+            object["baselineStage"] = baselineStage;
+            object["rows"] = result.rows;
+            object["columns"] = result.columns;
+            object["speedup"] = speedup;
+            object["target"] = target;
+            object["reachesTarget"] = speedup >= target;
+            speedups.append(object);
+
+            QTextStream(stderr) << stage << '/' << size << ": " << QString::number(speedup, 'f', 2) << "x of " << baselineStage
+                                << ", target " << target << "x " << (speedup >= target ? "reached" : "missed") << '\n';
+        }
+        return speedups;
+    }
+}
@@ -0,0 +1,413 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <algorithm>
+#include <cstdio>
+
+#include "qtcsv/reader.h"
+
+#include "data/csvcombineddataexport.h"
+#include "data/csvhandling.h"
+#include "data/csvkeyindex.h"
+#include "data/csvsortedmerge.h"
+#include "data/xlsxstreamwriter.h"
+#include "generator/jobsnapshotgenerator.h"
+#include "benchmark.h"
+
+using namespace Arrival::App;
+using namespace Arrival::Bench;
+using namespace Arrival::Generator;
+
+// Every stage, in the order they run.
+static const QStringList benchmarkStages = {
+    "readToListLineBased",
+    "readToList",
+    "document",
+    "documentColumnar",
+    "findJobNumberColumn",
+    "keyIndex",
+    "keyLookup",
+    "compositeKeyLookup",
+    "combineJobNumber",
+    "combineCompositeKey",
+    "combineFallback",
+    "sortedMerge",
+    "combineSpilled",
+    "sortRows",
+    "xlsxExport"
+};
+
+// The speedup of readToList with the structural index over the line based reader the index is aimed at.
+// Whether a run reaches it is reported per size, it has not been reached on every machine.
+static constexpr double readerSpeedupTarget = 5.0;
+
+// The generated files hold the Jobnumber in this column.
+static constexpr int jobNumberColumn = 1;
+
+// The columns of the composite key: the Jobnumber and the status, which is the first column.
+static const QList<int> compositeKeyColumns = { jobNumberColumn, 0 };
+
+static QList<int> parseSizes(const QString& value)
+{
+    QList<int> sizes;
+    for (const QString& size : value.split(',', Qt::SkipEmptyParts))
+    {
+        QString number = size.trimmed().toLower();
+        int factor = 1;
+        if (number.endsWith('k'))
+        {
+            factor = 1000;
+            number.chop(1);
+        }
+        else if (number.endsWith('m'))
+        {
+            factor = 1000000;
+            number.chop(1);
+        }
+        bool isNumber = false;
+        const int parsed = number.toInt(&isNumber);
+        if (isNumber && parsed > 0)
+        {
+            sizes.append(parsed * factor);
+        }
+    }
+    return sizes;
+}
+
+// Collects the rows like readToList() does. A processor is handed every raw line,
+// so the reader takes the line based path readToList() took before the structural index.
+class LineBasedReadToListProcessor : public QtCSV::Reader::AbstractProcessor
+{
+public:
+    QList<QList<QString>> rows;
+
+    bool processRowElements(const QList<QString>& elements) override
+    {
+        rows << elements;
+        return true;
+    }
+};
+
+// Estimates the size of a generated file, so oversized inputs are skipped before they are written.
+static qint64 estimatedFileSize(int rows, int columns)
+{
+    return static_cast<qint64>(rows) * columns * 11;
+}
+
+// Sorts the rows of a comparison by their Jobnumber, as a table sorted by a column would.
+static void sortRows(const CSVCombinedData& data)
+{
+    QList<JobTableRow> rows = data.rows();
+    std::stable_sort(rows.begin(), rows.end(), [&data](const JobTableRow& left, const JobTableRow& right) {
+        return data.document(left.document).cell(left.row, jobNumberColumn) < data.document(right.document).cell(right.row, jobNumberColumn);
+    });
+}
+
+// Looks up every row of a document in an index, as the diff does with the rows of the probed document.
+// Returns the amount of rows found, so the lookups can not be optimized away.
+static int lookupRows(const CSVKeyIndex& index, const CSVDocument& document)
+{
+    int found = 0;
+    for (int rowIterator = 0; rowIterator < document.rowCount(); rowIterator++)
+    {
+        found += index.containsRow(document, rowIterator) ? 1 : 0;
+    }
+    return found;
+}
+
+// Main entry point.
+// Measures every stage of a comparison for every input size and writes the results as JSON.
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("arrival_bench");
+    QCoreApplication::setApplicationVersion("1.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures the parse, diff, sort and export stages of Arrival.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    const QCommandLineOption rowsOption("rows", "Comma separated row counts, k and m suffixes are allowed.", "rows", "10k,100k,1m,10m");
+    const QCommandLineOption columnsOption("columns", "Comma separated column counts.", "columns", "10,50,200");
+    const QCommandLineOption stagesOption("stages", "Comma separated stages to run: " + benchmarkStages.join(", ") + ".", "stages", benchmarkStages.join(','));
+    const QCommandLineOption iterationsOption("iterations", "Runs per stage, the fastest and the median run are reported.", "count", "3");
+    const QCommandLineOption maximumSizeOption("max-input-mb", "Inputs larger than this are skipped.", "megabytes", "2048");
+    const QCommandLineOption readerMaximumSizeOption("max-reader-mb", "Inputs larger than this are skipped by the readToList stages, which keep every cell as a QString.", "megabytes", "256");
+    const QCommandLineOption threadsOption("threads", "Amount of threads used to parse and compare. The ideal thread count by default.", "count", "0");
+    const QCommandLineOption seedOption("seed", "Seed of the generated inputs.", "seed", "1");
+    const QCommandLineOption dataDirectoryOption("data-dir", "Keep the generated inputs in this directory and reuse them.", "directory");
+    const QCommandLineOption outputOption({ "o", "output" }, "Write the JSON results to this file instead of stdout.", "file");
+    const QCommandLineOption labelOption("label", "Label of the run, e.g. the commit.", "label");
+    const QCommandLineOption baselineOption("baseline", "Compare with the JSON results of an earlier run.", "file");
+    parser.addOptions({ rowsOption, columnsOption, stagesOption, iterationsOption, maximumSizeOption, readerMaximumSizeOption, threadsOption, seedOption, dataDirectoryOption, outputOption, labelOption, baselineOption });
+    parser.process(app);
+
+    const QList<int> rowCounts = parseSizes(parser.value(rowsOption));
+    const QList<int> columnCounts = parseSizes(parser.value(columnsOption));
+    const QStringList stages = parser.value(stagesOption).split(',', Qt::SkipEmptyParts);
+    for (const QString& stage : stages)
+    {
+        if (!benchmarkStages.contains(stage))
+        {
+            std::fputs(qPrintable("arrival_bench: unknown stage " + stage + '\n'), stderr);
+            return 1;
+        }
+    }
+    const qint64 maximumSize = parser.value(maximumSizeOption).toLongLong() * 1024 * 1024;
+    const qint64 readerMaximumSize = parser.value(readerMaximumSizeOption).toLongLong() * 1024 * 1024;
+    const int threadCount = parser.value(threadsOption).toInt();
+    const quint64 seed = parser.value(seedOption).toULongLong();
+
+    QTemporaryDir temporaryDirectory;
+    const QString dataDirectory = parser.isSet(dataDirectoryOption) ? parser.value(dataDirectoryOption) : temporaryDirectory.path();
+    QDir().mkpath(dataDirectory);
+
+    Benchmark benchmark(parser.value(iterationsOption).toInt());
+    for (const int columns : columnCounts)
+    {
+        for (const int rows : rowCounts)
+        {
+            const auto runs = [&](const QString& stage) {
+                return stages.contains(stage);
+            };
+
+            if (estimatedFileSize(rows, columns) > maximumSize)
+            {
+                for (const QString& stage : stages)
+                {
+                    benchmark.skip(stage, rows, columns, "input larger than --max-input-mb");
+                }
+                continue;
+            }
+
+            const QString name = QString::number(rows) + 'x' + QString::number(columns) + '-' + QString::number(seed);
+            const QString oldPath = QDir(dataDirectory).filePath(name + "-old.csv");
+            const QString newPath = QDir(dataDirectory).filePath(name + "-new.csv");
+            if (!QFileInfo::exists(oldPath) || !QFileInfo::exists(newPath))
+            {
+                JobSnapshotOptions generatorOptions;
+                generatorOptions.jobCount = rows;
+                generatorOptions.columnCount = columns;
+                generatorOptions.jobNumberColumn = jobNumberColumn;
+                generatorOptions.seed = seed;
+                if (const auto written = JobSnapshotGenerator::write(oldPath, newPath, generatorOptions); !written.has_value())
+                {
+                    std::fputs(qPrintable("arrival_bench: could not generate the inputs: " + written.error() + '\n'), stderr);
+                    return 1;
+                }
+            }
+            const qint64 oldSize = QFileInfo(oldPath).size();
+            const qint64 inputSize = oldSize + QFileInfo(newPath).size();
+
+            CSVDocumentOptions documentOptions;
+            documentOptions.threadCount = threadCount;
+            CSVDocumentOptions columnarOptions = documentOptions;
+            columnarOptions.storage = CSVDocumentStorage::Columnar;
+
+            if (runs("readToListLineBased"))
+            {
+                if (oldSize > readerMaximumSize)
+                {
+                    benchmark.skip("readToListLineBased", rows, columns, "input larger than --max-reader-mb");
+                }
+                else
+                {
+                    benchmark.measure("readToListLineBased", rows, columns, oldSize, [&]() {
+                        LineBasedReadToListProcessor processor;
+                        QtCSV::Reader::readToProcessor(oldPath, processor);
+                    });
+                }
+            }
+            if (runs("readToList"))
+            {
+                if (oldSize > readerMaximumSize)
+                {
+                    benchmark.skip("readToList", rows, columns, "input larger than --max-reader-mb");
+                }
+                else
+                {
+                    benchmark.measure("readToList", rows, columns, oldSize, [&]() {
+                        QtCSV::Reader::readToList(oldPath);
+                    });
+                }
+            }
+            if (runs("document"))
+            {
+                benchmark.measure("document", rows, columns, oldSize, [&]() {
+                    CSVDocument document(oldPath, documentOptions);
+                });
+            }
+            if (runs("documentColumnar"))
+            {
+                benchmark.measure("documentColumnar", rows, columns, oldSize, [&]() {
+                    CSVDocument document(oldPath, columnarOptions);
+                });
+            }
+
+            // The remaining stages share the loaded documents.
+            const QSharedPointer<const CSVDocument> oldDocument = QSharedPointer<const CSVDocument>::create(oldPath, columnarOptions);
+            const QSharedPointer<const CSVDocument> newDocument = QSharedPointer<const CSVDocument>::create(newPath, columnarOptions);
+
+            if (runs("findJobNumberColumn"))
+            {
+                benchmark.measure("findJobNumberColumn", rows, columns, 0, [&]() {
+                    CSVCombinedData::findSingleJobNumberColumnIndex(*oldDocument);
+                });
+            }
+
+            // The lookups are measured on their own, the throughput is in looked up rows per second.
+            volatile int foundRows = 0;
+            if (runs("keyIndex"))
+            {
+                benchmark.measure("keyIndex", oldDocument->rowCount(), columns, 0, [&]() {
+                    CSVKeyIndex index(*oldDocument, { jobNumberColumn });
+                    foundRows = index.keyCount();
+                });
+            }
+            if (runs("keyLookup"))
+            {
+                const CSVKeyIndex index(*oldDocument, { jobNumberColumn });
+                benchmark.measure("keyLookup", newDocument->rowCount(), columns, 0, [&]() {
+                    foundRows = lookupRows(index, *newDocument);
+                });
+            }
+            if (runs("compositeKeyLookup"))
+            {
+                const CSVKeyIndex index(*oldDocument, compositeKeyColumns);
+                benchmark.measure("compositeKeyLookup", newDocument->rowCount(), columns, 0, [&]() {
+                    foundRows = lookupRows(index, *newDocument);
+                });
+            }
+
+            CSVCombineOptions options;
+            options.threadCount = threadCount;
+            if (runs("combineJobNumber"))
+            {
+                benchmark.measure("combineJobNumber", rows, columns, inputSize, [&]() {
+                    CSVCombinedData::getCSVCombinedData(oldDocument, newDocument, options);
+                });
+            }
+            if (runs("combineCompositeKey"))
+            {
+                CSVCombineOptions compositeOptions = options;
+                compositeOptions.keyColumnIndices = compositeKeyColumns;
+                benchmark.measure("combineCompositeKey", rows, columns, inputSize, [&]() {
+                    CSVCombinedData::getCSVCombinedData(oldDocument, newDocument, compositeOptions);
+                });
+            }
+            if (runs("combineFallback"))
+            {
+                CSVCombineOptions fallbackOptions = options;
+                fallbackOptions.keyColumnIndex = CSVCombineOptions::noKeyColumn;
+                benchmark.measure("combineFallback", rows, columns, inputSize, [&]() {
+                    CSVCombinedData::getCSVCombinedData(oldDocument, newDocument, fallbackOptions);
+                });
+            }
+            if (runs("sortedMerge"))
+            {
+                // The generated files are ordered by their Jobnumber. Unlike the combine stages, the files are read as well.
+                CSVCombineOptions mergeOptions = options;
+                mergeOptions.keyColumnIndex = jobNumberColumn;
+                benchmark.measure("sortedMerge", rows, columns, inputSize, [&]() {
+                    CSVSortedMerge merge(oldPath, newPath, mergeOptions);
+                    CSVMergedRow row;
+                    bool hasRow = merge.open().has_value();
+                    while (hasRow)
+                    {
+                        hasRow = merge.next(row).value_or(false);
+                    }
+                    foundRows = static_cast<int>(merge.remainedCount());
+                });
+            }
+            if (runs("combineSpilled"))
+            {
+                // A budget of a quarter of the input spills the files into several partitions. The files are read as well.
+                CSVSpillOptions spillOptions;
+                spillOptions.directory = temporaryDirectory.path();
+                spillOptions.memoryBudget = qMax<qint64>(inputSize / 4, 1);
+                CSVCombinedDataStream stream;
+                stream.rowsReady = [&](QList<JobTableRow> rows) {
+                    foundRows = foundRows + static_cast<int>(rows.count());
+                };
+                benchmark.measure("combineSpilled", rows, columns, inputSize, [&]() {
+                    CSVCombinedData::streamSpilledCSVFiles(oldPath, newPath, spillOptions, options, stream);
+                });
+            }
+
+            if (!runs("sortRows") && !runs("xlsxExport"))
+            {
+                continue;
+            }
+            const auto combined = CSVCombinedData::getCSVCombinedData(oldDocument, newDocument, options);
+            if (!combined.has_value())
+            {
+                std::fputs("arrival_bench: the generated inputs could not be compared\n", stderr);
+                return 1;
+            }
+            const CSVCombinedData& data = **combined;
+            if (runs("sortRows"))
+            {
+                benchmark.measure("sortRows", data.rowCount(), columns, 0, [&]() {
+                    sortRows(data);
+                });
+            }
+            if (runs("xlsxExport"))
+            {
+                CSVCombinedDataExportOptions exportOptions;
+                for (int columnIterator = 0; columnIterator < columns; columnIterator++)
+                {
+                    exportOptions.columns.append(columnIterator);
+                }
+                const QString exportPath = QDir(temporaryDirectory.path()).filePath("export.xlsx");
+                benchmark.measure("xlsxExport", qMin(data.rowCount(), XlsxStreamWriter::maximumRowCount - 1), columns, inputSize, [&]() {
+                    CSVCombinedDataExport::toXlsx(data, exportPath, exportOptions);
+                });
+                QFile::remove(exportPath);
+            }
+        }
+    }
+
+    // Write the results, together with the speedup of the structural index over the line based reader.
+    QJsonObject results = benchmark.toJson(parser.value(labelOption));
+    if (stages.contains("readToList") && stages.contains("readToListLineBased"))
+    {
+        results["speedups"] = benchmark.speedups("readToList", "readToListLineBased", readerSpeedupTarget);
+    }
+    const QByteArray json = QJsonDocument(results).toJson(QJsonDocument::Indented);
+    if (parser.isSet(outputOption))
+    {
+        QFile output(parser.value(outputOption));
+        if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate) || output.write(json) != json.size())
+        {
+            std::fputs(qPrintable("arrival_bench: could not write " + parser.value(outputOption) + '\n'), stderr);
+            return 1;
+        }
+    }
+    else
+    {
+        std::fputs(json.constData(), stdout);
+    }
+
+    if (parser.isSet(baselineOption))
+    {
+        QFile baselineFile(parser.value(baselineOption));
+        if (!baselineFile.open(QIODevice::ReadOnly))
+        {
+            std::fputs(qPrintable("arrival_bench: could not read " + parser.value(baselineOption) + '\n'), stderr);
+            return 1;
+        }
+        QTextStream(stderr) << benchmark.compare(QJsonDocument::fromJson(baselineFile.readAll()).object());
+    }
+
+    return 0;
+}
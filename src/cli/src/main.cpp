@@ -0,0 +1,599 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+
+#include <cstdio>
+#include <expected>
+#include <optional>
+
+#include "data/csvcombineddataexport.h"
+#include "data/csvhandling.h"
+#include "data/csvsortedmerge.h"
+#include "data/selectedheaderstemplatelist.h"
+#include "trace/tracerecorder.h"
+
+using namespace Arrival::App;
+
+// Exit codes, so batch jobs can tell the failures apart.
+static constexpr int exitSuccess = 0;
+static constexpr int exitUsageError = 1;
+static constexpr int exitCompareError = 2;
+static constexpr int exitExportError = 3;
+
+static void printError(const QString& message)
+{
+    std::fputs(qPrintable("arrival-cli: " + message + '\n'), stderr);
+}
+
+static QString compareErrorString(CSVCombinedData::CombineCSVDocumentsError error)
+{
+    switch (error)
+    {
+    case CSVCombinedData::CombineCSVDocumentsError::DifferentFormat:
+        return QStringLiteral("the files do not have the same columns");
+    case CSVCombinedData::CombineCSVDocumentsError::BothEmpty:
+        return QStringLiteral("both files are empty");
+    case CSVCombinedData::CombineCSVDocumentsError::InvalidKeyColumn:
+        return QStringLiteral("the key column does not exist");
+    case CSVCombinedData::CombineCSVDocumentsError::Canceled:
+        return QStringLiteral("the comparison has been canceled");
+    case CSVCombinedData::CombineCSVDocumentsError::NotSorted:
+        return QStringLiteral("the files are not ordered by their key, compare them without --sorted");
+    case CSVCombinedData::CombineCSVDocumentsError::ReadError:
+        return QStringLiteral("a file could not be read");
+    case CSVCombinedData::CombineCSVDocumentsError::SpillError:
+        return QStringLiteral("the rows could not be spilled to disk, check --spill-dir");
+    }
+    return QString();
+}
+
+// Resolves a column given by its index or its header name.
+static int resolveColumn(const QString& column, const QList<QString>& headerNames)
+{
+    bool isIndex = false;
+    const int index = column.toInt(&isIndex);
+    if (isIndex)
+    {
+        return index >= 0 && index < headerNames.count() ? index : -1;
+    }
+    return static_cast<int>(headerNames.indexOf(column));
+}
+
+// Finds the templates saved under a name, one per format of files.
+static std::expected<QList<SelectedHeadersTemplate>, QString> findTemplates(const QString& templateFile, const QString& templateName)
+{
+    if (!QFileInfo::exists(templateFile))
+    {
+        return std::unexpected("template file not found: " + templateFile);
+    }
+
+    SelectedHeadersTemplateList templates;
+    templates.loadFromJson(templateFile);
+    QList<SelectedHeadersTemplate> result;
+    for (const SelectedHeadersTemplate& selectedTemplate : templates.templates())
+    {
+        if (selectedTemplate.templateName() == templateName)
+        {
+            result.append(selectedTemplate);
+        }
+    }
+    if (result.isEmpty())
+    {
+        return std::unexpected("template not found: " + templateName);
+    }
+    return result;
+}
+
+// Finds the key columns of a template. The format of the files is not known before they are compared,
+// so the first template of that name with key columns is used. They are given by header name and checked while comparing.
+static QList<QString> templateKeyColumnNames(const QList<SelectedHeadersTemplate>& templates)
+{
+    for (const SelectedHeadersTemplate& selectedTemplate : templates)
+    {
+        if (!selectedTemplate.keyColumnNames().isEmpty())
+        {
+            return selectedTemplate.keyColumnNames();
+        }
+    }
+    return QList<QString>();
+}
+
+// Finds the columns of a template saved for the format of the compared files.
+static std::expected<QList<int>, QString> templateColumns(const QList<SelectedHeadersTemplate>& templates, const QList<QString>& headerNames)
+{
+    const QString formatIdentifier = CSVCombinedData::computeFormatIdentifier(headerNames);
+    for (const SelectedHeadersTemplate& selectedTemplate : templates)
+    {
+        if (selectedTemplate.headerIdentifier() == formatIdentifier)
+        {
+            return selectedTemplate.headerIndices();
+        }
+    }
+    return std::unexpected("template " + templates.constFirst().templateName() + " has been saved for files with different columns");
+}
+
+// Resolves the columns to export: the columns of the template if there is one, otherwise the given columns, otherwise all columns.
+static std::expected<QList<int>, QString> exportColumns(const QList<QString>& headerNames, const QString& columnList, const QList<SelectedHeadersTemplate>& templates)
+{
+    QList<int> columns;
+    if (!templates.isEmpty())
+    {
+        auto found = templateColumns(templates, headerNames);
+        if (!found.has_value())
+        {
+            return std::unexpected(found.error());
+        }
+        columns = std::move(*found);
+    }
+    else if (!columnList.isEmpty())
+    {
+        for (const QString& column : columnList.split(',', Qt::SkipEmptyParts))
+        {
+            const int index = resolveColumn(column.trimmed(), headerNames);
+            if (index < 0)
+            {
+                return std::unexpected("unknown column: " + column);
+            }
+            columns.append(index);
+        }
+    }
+    else
+    {
+        for (int columnIterator = 0; columnIterator < headerNames.count(); columnIterator++)
+        {
+            columns.append(columnIterator);
+        }
+    }
+    for (const int column : columns)
+    {
+        if (column < 0 || column >= headerNames.count())
+        {
+            return std::unexpected(QStringLiteral("the template references a column that does not exist"));
+        }
+    }
+    return columns;
+}
+
+static QJsonArray toJsonArray(const QList<int>& values)
+{
+    QJsonArray array;
+    for (const int value : values)
+    {
+        array.append(value);
+    }
+    return array;
+}
+
+static void printStatistics(const QJsonObject& statistics, bool asText)
+{
+    if (!asText)
+    {
+        std::fputs(QJsonDocument(statistics).toJson(QJsonDocument::Compact).append('\n').constData(), stdout);
+        return;
+    }
+
+    // One key per line, nested objects are flattened with dots.
+    QByteArray text;
+    for (auto iterator = statistics.constBegin(); iterator != statistics.constEnd(); ++iterator)
+    {
+        if (iterator.value().isObject())
+        {
+            const QJsonObject object = iterator.value().toObject();
+            for (auto member = object.constBegin(); member != object.constEnd(); ++member)
+            {
+                text.append(iterator.key().toUtf8() + '.' + member.key().toUtf8() + ": " + member.value().toVariant().toString().toUtf8() + '\n');
+            }
+            continue;
+        }
+        if (iterator.value().isArray())
+        {
+            // Arrays are comma separated.
+            text.append(iterator.key().toUtf8() + ": " + iterator.value().toVariant().toStringList().join(',').toUtf8() + '\n');
+            continue;
+        }
+        text.append(iterator.key().toUtf8() + ": " + iterator.value().toVariant().toString().toUtf8() + '\n');
+    }
+    std::fputs(text.constData(), stdout);
+}
+
+// Compares two files ordered by their key while they are read and exports the rows as they are compared.
+// Nothing but a few batches of rows is held in memory, so load and diff are a single step.
+static int compareSorted(const QStringList& paths, const CSVCombineOptions& options, const QString& outputPath, const QString& format,
+                         const QString& columnList, const QList<SelectedHeadersTemplate>& templates, const QString& statisticsFormat, const QElapsedTimer& totalTimer)
+{
+    QElapsedTimer mergeTimer;
+    mergeTimer.start();
+
+    CSVSortedMerge merge(paths.at(0), paths.at(1), options);
+    if (const auto opened = merge.open(); !opened.has_value())
+    {
+        printError("could not compare the files: " + compareErrorString(opened.error()));
+        return exitCompareError;
+    }
+
+    // Comparison errors are told apart from export errors, they end the export with a message as well.
+    std::optional<CSVSortedMerge::Error> mergeError;
+    CSVMergedRow mergedRow;
+    const CSVExportRowSource source = [&](CSVExportRow& row) -> std::expected<bool, QString> {
+        const auto hasRow = merge.next(mergedRow);
+        if (!hasRow.has_value())
+        {
+            mergeError = hasRow.error();
+            return std::unexpected(compareErrorString(hasRow.error()));
+        }
+        if (!*hasRow)
+        {
+            return false;
+        }
+        row.state = mergedRow.state;
+        row.cells = std::move(mergedRow.cells);
+        row.changedColumns = std::move(mergedRow.changedColumns);
+        return true;
+    };
+
+    if (!outputPath.isEmpty())
+    {
+        const auto columns = exportColumns(merge.headerNames(), columnList, templates);
+        if (!columns.has_value())
+        {
+            printError(columns.error());
+            return exitUsageError;
+        }
+        CSVCombinedDataExportOptions exportOptions;
+        exportOptions.columns = *columns;
+
+        const std::expected<void, QString> exported = format == "xlsx" ? CSVCombinedDataExport::toXlsx(merge.headerNames(), source, outputPath, exportOptions)
+                                                                       : CSVCombinedDataExport::toCsv(merge.headerNames(), source, outputPath, exportOptions);
+        if (mergeError.has_value())
+        {
+            printError("could not compare the files: " + compareErrorString(*mergeError));
+            return exitCompareError;
+        }
+        if (!exported.has_value())
+        {
+            printError("could not export to " + outputPath + ": " + exported.error());
+            return exitExportError;
+        }
+    }
+    else
+    {
+        // Only the statistics are wanted, the rows are counted by the merge.
+        while (true)
+        {
+            const auto hasRow = merge.next(mergedRow);
+            if (!hasRow.has_value())
+            {
+                printError("could not compare the files: " + compareErrorString(hasRow.error()));
+                return exitCompareError;
+            }
+            if (!*hasRow)
+            {
+                break;
+            }
+        }
+    }
+
+    // Print the statistics.
+    QJsonObject rows;
+    rows["old"] = merge.firstRowCount();
+    rows["new"] = merge.secondRowCount();
+    rows["added"] = merge.newAddedCount();
+    rows["removed"] = merge.removedCount();
+    rows["modified"] = merge.modifiedCount();
+    rows["remained"] = merge.remainedCount();
+
+    QJsonObject times;
+    times["merge"] = mergeTimer.elapsed();
+    times["total"] = totalTimer.elapsed();
+
+    QJsonObject statistics;
+    statistics["old"] = paths.at(0);
+    statistics["new"] = paths.at(1);
+    statistics["sorted"] = true;
+    statistics["columns"] = static_cast<int>(merge.headerNames().count());
+    statistics["keyColumns"] = toJsonArray(merge.keyColumns());
+    if (merge.keyDetection().column >= 0)
+    {
+        statistics["keyConfidence"] = merge.keyDetection().confidence();
+    }
+    statistics["rows"] = rows;
+    statistics["timingsMs"] = times;
+    if (!outputPath.isEmpty())
+    {
+        statistics["output"] = outputPath;
+    }
+    printStatistics(statistics, statisticsFormat == "text");
+
+    return exitSuccess;
+}
+
+// Main entry point.
+// Compares two .csv files without any ui, optionally exports the result and prints statistics about the run.
+int main(int argc, char *argv[])
+{
+    QElapsedTimer totalTimer;
+    totalTimer.start();
+
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("arrival-cli");
+    QCoreApplication::setApplicationVersion("1.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Compares two .csv files and reports the added, removed, modified and remained rows.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("old", "The old .csv file.");
+    parser.addPositionalArgument("new", "The new .csv file.");
+
+    const QCommandLineOption keyColumnOption({ "k", "key-column" }, "Match the rows by these comma separated columns, given by their index or header name. "
+                                                                          "Defaults to the key columns of --template, otherwise the Jobnumber column is detected.", "columns");
+    const QCommandLineOption noKeyOption("no-key", "Match the rows by their whole content.");
+    const QCommandLineOption outputOption({ "o", "output" }, "Export the result to this file.", "file");
+    const QCommandLineOption formatOption({ "f", "format" }, "Format of the export: xlsx or csv. Derived from the output file by default.", "format");
+    const QCommandLineOption columnsOption({ "c", "columns" }, "Comma separated columns to export, given by their index or header name. All columns by default.", "columns");
+    const QCommandLineOption templateOption({ "t", "template" }, "Export the columns of a template saved by the app and match the rows by its key columns.", "name");
+    const QCommandLineOption templateFileOption("templates", "The file the templates are read from.", "file", SelectedHeadersTemplateList::templateFileName);
+    const QCommandLineOption threadsOption("threads", "Amount of threads used to parse and compare. The ideal thread count by default.", "count", "0");
+    const QCommandLineOption statisticsOption("stats", "Format of the statistics printed to stdout: json or text.", "format", "json");
+    const QCommandLineOption traceOption("trace", "Write a Chrome trace of the run to this file. Defaults to the ARRIVAL_TRACE environment variable.", "file");
+    const QCommandLineOption sortedOption("sorted", "Both files are ordered by their key columns. They are compared while they are read, "
+                                                    "so files of any size fit into memory. Fails if the rows are out of order.");
+    const QCommandLineOption spillOption("spill", "Spill the rows to disk and compare them partition by partition, so files larger than the memory can be compared. "
+                                                  "Used by default for files larger than --memory-mb.");
+    const QCommandLineOption memoryOption("memory-mb", "Memory budget of the comparison in MiB. Larger files are spilled to disk.", "size", "2048");
+    const QCommandLineOption spillDirectoryOption("spill-dir", "Directory the rows are spilled to. The temporary directory by default.", "directory");
+    parser.addOptions({ keyColumnOption, noKeyOption, outputOption, formatOption, columnsOption, templateOption, templateFileOption, threadsOption, statisticsOption, traceOption, sortedOption,
+                        spillOption, memoryOption, spillDirectoryOption });
+    parser.process(app);
+
+    // The trace is written when the application is destroyed, whichever way main returns.
+    if (parser.isSet(traceOption))
+    {
+#ifndef ARRIVAL_ENABLE_TRACING
+        printError("built without ARRIVAL_ENABLE_TRACING, the trace stays empty");
+#endif
+        TraceRecorder::instance().start(parser.value(traceOption));
+    }
+    else
+    {
+        TraceRecorder::instance().startFromEnvironment();
+    }
+
+    // Check the arguments before any file is touched.
+    const QStringList paths = parser.positionalArguments();
+    if (paths.count() != 2)
+    {
+        printError("expected exactly two files, see --help");
+        return exitUsageError;
+    }
+    if (parser.isSet(keyColumnOption) && parser.isSet(noKeyOption))
+    {
+        printError("--key-column and --no-key can not be combined");
+        return exitUsageError;
+    }
+    if (parser.isSet(sortedOption) && parser.isSet(noKeyOption))
+    {
+        printError("--sorted and --no-key can not be combined, sorted files are matched by their key");
+        return exitUsageError;
+    }
+    if (parser.isSet(spillOption) && parser.isSet(sortedOption))
+    {
+        printError("--spill and --sorted can not be combined");
+        return exitUsageError;
+    }
+    if (parser.isSet(spillOption) && parser.isSet(noKeyOption))
+    {
+        printError("--spill and --no-key can not be combined, spilled rows are matched by their key");
+        return exitUsageError;
+    }
+    if (parser.isSet(columnsOption) && parser.isSet(templateOption))
+    {
+        printError("--columns and --template can not be combined");
+        return exitUsageError;
+    }
+    const QString statisticsFormat = parser.value(statisticsOption);
+    if (statisticsFormat != "json" && statisticsFormat != "text")
+    {
+        printError("unknown statistics format: " + statisticsFormat);
+        return exitUsageError;
+    }
+    const QString outputPath = parser.value(outputOption);
+    const QString format = parser.isSet(formatOption) ? parser.value(formatOption) : QFileInfo(outputPath).suffix().toLower();
+    if (!outputPath.isEmpty() && format != "xlsx" && format != "csv")
+    {
+        printError("unknown export format: " + format);
+        return exitUsageError;
+    }
+    bool isThreadCount = false;
+    const int threadCount = parser.value(threadsOption).toInt(&isThreadCount);
+    if (!isThreadCount || threadCount < 0)
+    {
+        printError("invalid thread count: " + parser.value(threadsOption));
+        return exitUsageError;
+    }
+    bool isMemoryBudget = false;
+    const qint64 memoryBudget = parser.value(memoryOption).toLongLong(&isMemoryBudget);
+    if (!isMemoryBudget || memoryBudget <= 0)
+    {
+        printError("invalid memory budget: " + parser.value(memoryOption));
+        return exitUsageError;
+    }
+    for (const QString& path : paths)
+    {
+        if (!QFileInfo::exists(path))
+        {
+            printError("file not found: " + path);
+            return exitUsageError;
+        }
+    }
+
+    QList<SelectedHeadersTemplate> templates;
+    if (parser.isSet(templateOption))
+    {
+        auto found = findTemplates(parser.value(templateFileOption), parser.value(templateOption));
+        if (!found.has_value())
+        {
+            printError(found.error());
+            return exitUsageError;
+        }
+        templates = std::move(*found);
+    }
+
+    // Compare the files. The command line is done after a single run, so the documents stay mapped instead of being copied into columns.
+    CSVDocumentOptions documentOptions;
+    documentOptions.threadCount = threadCount;
+    CSVCombineOptions options;
+    options.threadCount = threadCount;
+    if (parser.isSet(noKeyOption))
+    {
+        options.keyColumnIndex = CSVCombineOptions::noKeyColumn;
+    }
+    else if (parser.isSet(keyColumnOption))
+    {
+        // Either every column is given by its index, or every column by its header name.
+        const QStringList keyColumns = parser.value(keyColumnOption).split(',', Qt::SkipEmptyParts);
+        bool allIndices = !keyColumns.isEmpty();
+        for (const QString& keyColumn : keyColumns)
+        {
+            bool isIndex = false;
+            const int keyColumnIndex = keyColumn.trimmed().toInt(&isIndex);
+            if (isIndex && keyColumnIndex < 0)
+            {
+                printError("invalid key column: " + keyColumn);
+                return exitUsageError;
+            }
+            allIndices = allIndices && isIndex;
+            options.keyColumnIndices.append(keyColumnIndex);
+            options.keyColumnNames.append(keyColumn.trimmed());
+        }
+        if (keyColumns.isEmpty())
+        {
+            printError("invalid key column: " + parser.value(keyColumnOption));
+            return exitUsageError;
+        }
+        if (allIndices)
+        {
+            options.keyColumnNames.clear();
+        }
+        else
+        {
+            options.keyColumnIndices.clear();
+        }
+    }
+    else if (!templates.isEmpty())
+    {
+        options.keyColumnNames = templateKeyColumnNames(templates);
+    }
+
+    const QString columnList = parser.value(columnsOption);
+    if (parser.isSet(sortedOption))
+    {
+        return compareSorted(paths, options, outputPath, format, columnList, templates, statisticsFormat, totalTimer);
+    }
+
+    QSharedPointer<CSVCombinedData> data;
+    CSVCombinedDataStream stream;
+    stream.started = [&data](QSharedPointer<CSVCombinedData> combinedData) {
+        data = std::move(combinedData);
+    };
+    stream.rowsReady = [&data](QList<JobTableRow> rows) {
+        data->appendRows(rows);
+    };
+
+    // Files larger than the memory budget are spilled, unless they are matched by their whole content.
+    CSVSpillOptions spillOptions;
+    spillOptions.memoryBudget = memoryBudget * 1024 * 1024;
+    if (parser.isSet(spillDirectoryOption))
+    {
+        spillOptions.directory = parser.value(spillDirectoryOption);
+    }
+    const qint64 inputSize = QFileInfo(paths.at(0)).size() + QFileInfo(paths.at(1)).size();
+    bool isSpilled = parser.isSet(spillOption) || (!parser.isSet(noKeyOption) && inputSize >= spillOptions.memoryBudget);
+
+    CSVCombineTimings timings;
+    auto result = isSpilled ? CSVCombinedData::streamSpilledCSVFiles(paths.at(0), paths.at(1), spillOptions, options, stream, &timings)
+                            : CSVCombinedData::streamCSVFiles(paths.at(0), paths.at(1), documentOptions, options, stream, &timings);
+    if (isSpilled && !parser.isSet(spillOption) && !result.has_value() && result.error() == CSVCombinedData::CombineCSVDocumentsError::InvalidKeyColumn)
+    {
+        // Spilling needs a key, without one the files are compared in memory after all.
+        isSpilled = false;
+        result = CSVCombinedData::streamCSVFiles(paths.at(0), paths.at(1), documentOptions, options, stream, &timings);
+    }
+    if (!result.has_value())
+    {
+        printError("could not compare the files: " + compareErrorString(result.error()));
+        return exitCompareError;
+    }
+
+    // Export the result.
+    qint64 exportTime = 0;
+    if (!outputPath.isEmpty())
+    {
+        const auto columns = exportColumns(data->headerNames(), columnList, templates);
+        if (!columns.has_value())
+        {
+            printError(columns.error());
+            return exitUsageError;
+        }
+        CSVCombinedDataExportOptions exportOptions;
+        exportOptions.columns = *columns;
+
+        QElapsedTimer exportTimer;
+        exportTimer.start();
+        const std::expected<void, QString> exported = format == "xlsx" ? CSVCombinedDataExport::toXlsx(*data, outputPath, exportOptions)
+                                                                       : CSVCombinedDataExport::toCsv(*data, outputPath, exportOptions);
+        exportTime = exportTimer.elapsed();
+        if (!exported.has_value())
+        {
+            printError("could not export to " + outputPath + ": " + exported.error());
+            return exitExportError;
+        }
+    }
+
+    // Print the statistics.
+    QJsonObject rows;
+    rows["old"] = data->document(JobTableRow::FirstDocument).rowCount();
+    rows["new"] = data->document(JobTableRow::SecondDocument).rowCount();
+    rows["added"] = data->newAddedCount();
+    rows["removed"] = data->removedCount();
+    rows["modified"] = data->modifiedCount();
+    rows["remained"] = data->rowCount() - data->newAddedCount() - data->removedCount() - data->modifiedCount();
+
+    QJsonObject times;
+    times["oldLoad"] = timings.firstDocumentLoadTime;
+    times["newLoad"] = timings.secondDocumentLoadTime;
+    times["load"] = timings.loadTime;
+    times["diff"] = timings.diffTime;
+    times["stream"] = timings.streamTime;
+    times["export"] = exportTime;
+    times["total"] = totalTimer.elapsed();
+
+    QJsonObject statistics;
+    statistics["old"] = paths.at(0);
+    statistics["new"] = paths.at(1);
+    statistics["columns"] = data->columnCount();
+    statistics["keyColumns"] = toJsonArray(data->keyColumns());
+    if (data->keyDetection().column >= 0)
+    {
+        statistics["keyConfidence"] = data->keyDetection().confidence();
+    }
+    statistics["rows"] = rows;
+    statistics["timingsMs"] = times;
+    statistics["spilled"] = isSpilled;
+    if (!outputPath.isEmpty())
+    {
+        statistics["output"] = outputPath;
+    }
+    printStatistics(statistics, statisticsFormat == "text");
+
+    return exitSuccess;
+}
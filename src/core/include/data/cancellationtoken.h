@@ -0,0 +1,55 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#ifndef ARRIVAL_CANCELLATIONTOKEN_H
+#define ARRIVAL_CANCELLATIONTOKEN_H
+
+#include <QSharedPointer>
+
+#include <atomic>
+
+namespace Arrival::App
+{
+    /*!
+     * \brief The CancellationToken class asks long running work to stop.
+     * Copies of a token share their state, so the token handed to a worker thread can be canceled by the thread that started it.
+     * Workers poll \c isCanceled in their loops and return early, leaving their results incomplete.
+     */
+    class CancellationToken
+    {
+    public:
+        /*!
+         * \brief CancellationToken Constructs a token that has not been canceled.
+         */
+        CancellationToken()
+            : m_canceled(QSharedPointer<std::atomic<bool>>::create(false))
+        {}
+
+        /*!
+         * \brief cancel Asks the work observing this token to stop.
+         */
+        void cancel() const
+        {
+            m_canceled->store(true, std::memory_order_relaxed);
+        }
+
+        /*!
+         * \brief isCanceled Checks whether the work has been asked to stop.
+         * Cheap enough to be polled for every row.
+         * \return True if the token has been canceled, false otherwise.
+         */
+        bool isCanceled() const
+        {
+            return m_canceled->load(std::memory_order_relaxed);
+        }
+
+    private:
+        /*!
+         * \brief m_canceled The state shared by all copies of the token.
+         */
+        QSharedPointer<std::atomic<bool>> m_canceled;
+    };
+}
+
+#endif // ARRIVAL_CANCELLATIONTOKEN_H
@@ -0,0 +1,218 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#ifndef ARRIVAL_CSVCOLUMN_H
+#define ARRIVAL_CSVCOLUMN_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QList>
+#include <QtGlobal>
+
+#include <limits>
+
+namespace Arrival::App
+{
+    /*!
+     * \brief The CSVColumn class stores every cell of a column back to back in a single UTF-8 arena.
+     * The boundaries of the cells are kept in an offset array, so a column costs two allocations
+     * no matter how many rows it holds. The offsets take 32 bits each, only an arena beyond 4 GiB switches them to 64 bits.
+     * Columns with few distinct values are dictionary encoded instead: the arena holds every distinct value once
+     * and each cell is stored as the 16 bit code of its value.
+     */
+    class CSVColumn
+    {
+    public:
+        /*!
+         * \brief CSVColumn Constructs an empty column.
+         */
+        CSVColumn();
+
+        /*!
+         * \brief maximumDictionarySize The maximum amount of distinct values of a dictionary encoded column.
+         */
+        static constexpr int maximumDictionarySize = 65536;
+
+        /*!
+         * \brief fromDictionary Constructs a dictionary encoded column.
+         * \param values The distinct values, the index of a value is its code.
+         * \param codes The code of every cell.
+         * \return The column.
+         */
+        static CSVColumn fromDictionary(const QList<QByteArrayView>& values, QList<quint16> codes);
+
+        /*!
+         * \brief reserve Allocates memory for the cells up front.
+         * \param rowCount The expected amount of cells.
+         * \param byteCount The expected amount of bytes of all cells.
+         */
+        void reserve(qsizetype rowCount, qsizetype byteCount);
+
+        /*!
+         * \brief append Adds a cell at the end of a column that is not dictionary encoded.
+         * \param value The UTF-8 encoded content of the cell.
+         */
+        void append(QByteArrayView value);
+
+        /*!
+         * \brief squeeze Releases the memory that is not needed to store the cells.
+         */
+        void squeeze();
+
+        /*!
+         * \brief count Returns the amount of cells in the column.
+         * \return The amount of cells.
+         */
+        qsizetype count() const
+        {
+            return m_isDictionaryEncoded ? m_codes.count() : offsetCount() - 1;
+        }
+
+        /*!
+         * \brief isDictionaryEncoded Checks whether the cells are stored as codes of distinct values.
+         * \return True if the column is dictionary encoded, false otherwise.
+         */
+        bool isDictionaryEncoded() const
+        {
+            return m_isDictionaryEncoded;
+        }
+
+        /*!
+         * \brief dictionarySize Returns the amount of distinct values of a dictionary encoded column.
+         * \return The amount of distinct values.
+         */
+        int dictionarySize() const
+        {
+            return m_isDictionaryEncoded ? static_cast<int>(offsetCount() - 1) : 0;
+        }
+
+        /*!
+         * \brief dictionaryValue Returns a distinct value of a dictionary encoded column.
+         * \param code The code of the value.
+         * \return The UTF-8 encoded value.
+         */
+        QByteArrayView dictionaryValue(int code) const
+        {
+            return value(code);
+        }
+
+        /*!
+         * \brief code Returns the code of a cell of a dictionary encoded column.
+         * \param row row index of the cell.
+         * \return The code of the value of the cell.
+         */
+        quint16 code(qsizetype row) const
+        {
+            return m_codes.at(row);
+        }
+
+        /*!
+         * \brief codes Returns the code of every cell of a dictionary encoded column.
+         * \return The codes of the cells.
+         */
+        const QList<quint16>& codes() const
+        {
+            return m_codes;
+        }
+
+        /*!
+         * \brief at Returns the content of a cell.
+         * The view stays valid as long as the column or one of its copies exists.
+         * \param row row index of the cell.
+         * \return The UTF-8 encoded content of the cell.
+         */
+        QByteArrayView at(qsizetype row) const
+        {
+            return value(m_isDictionaryEncoded ? m_codes.at(row) : row);
+        }
+
+        /*!
+         * \brief arena Returns the content of all cells back to back, or every distinct value of a dictionary encoded column.
+         * \return The arena of the column.
+         */
+        const QByteArray& arena() const
+        {
+            return m_arena;
+        }
+
+        /*!
+         * \brief offset Returns the offset of a cell or distinct value in the arena.
+         * \param index The index of the cell or the code of the value. The amount of entries gives the size of the arena.
+         * \return The offset in the arena.
+         */
+        qsizetype offset(qsizetype index) const
+        {
+            return m_wideOffsets.isEmpty() ? static_cast<qsizetype>(m_offsets.at(index)) : m_wideOffsets.at(index);
+        }
+
+        /*!
+         * \brief hasWideOffsets Checks whether the offsets take 64 bits, because the arena is larger than 4 GiB.
+         * \return True if the offsets take 64 bits, false otherwise.
+         */
+        bool hasWideOffsets() const
+        {
+            return !m_wideOffsets.isEmpty();
+        }
+
+        /*!
+         * \brief maximumNarrowOffset The largest offset stored in 32 bits.
+         */
+        static constexpr qsizetype maximumNarrowOffset = std::numeric_limits<quint32>::max();
+
+    private:
+        /*!
+         * \brief value Returns an entry of the arena.
+         * \param index The index of the cell, or the code of the value if the column is dictionary encoded.
+         * \return The UTF-8 encoded entry.
+         */
+        QByteArrayView value(qsizetype index) const
+        {
+            const qsizetype begin = offset(index);
+            return QByteArrayView(m_arena.constData() + begin, offset(index + 1) - begin);
+        }
+
+        /*!
+         * \brief widenOffsets Moves the offsets to 64 bits, once the arena grows beyond \c maximumNarrowOffset.
+         */
+        void widenOffsets();
+
+        /*!
+         * \brief offsetCount Returns the amount of offsets, one more than the amount of entries.
+         * \return The amount of offsets.
+         */
+        qsizetype offsetCount() const
+        {
+            return m_wideOffsets.isEmpty() ? m_offsets.count() : m_wideOffsets.count();
+        }
+
+    private:
+        /*!
+         * \brief m_arena The content of all cells back to back, or every distinct value of a dictionary encoded column.
+         */
+        QByteArray m_arena;
+
+        /*!
+         * \brief m_offsets The offset of every entry in \c m_arena, followed by the size of the arena.
+         * Empty once the arena has grown beyond \c maximumNarrowOffset.
+         */
+        QList<quint32> m_offsets;
+
+        /*!
+         * \brief m_wideOffsets The offsets of \c m_offsets in 64 bits. Only used once the arena has grown beyond \c maximumNarrowOffset.
+         */
+        QList<qint64> m_wideOffsets;
+
+        /*!
+         * \brief m_codes The code of every cell. Only used if the column is dictionary encoded.
+         */
+        QList<quint16> m_codes;
+
+        /*!
+         * \brief m_isDictionaryEncoded Whether the cells are stored as codes.
+         */
+        bool m_isDictionaryEncoded;
+    };
+}
+
+#endif // ARRIVAL_CSVCOLUMN_H
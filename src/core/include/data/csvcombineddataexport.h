@@ -0,0 +1,149 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#ifndef ARRIVAL_CSVCOMBINEDDATAEXPORT_H
+#define ARRIVAL_CSVCOMBINEDDATAEXPORT_H
+
+#include <QByteArrayView>
+#include <QList>
+#include <QString>
+#include <QtGlobal>
+
+#include <expected>
+#include <functional>
+
+#include "data/cancellationtoken.h"
+#include "data/csvhandling.h"
+
+namespace Arrival::App
+{
+    /*!
+     * \brief The CSVCombinedDataExportOptions struct configures how combined data is exported.
+     */
+    struct CSVCombinedDataExportOptions
+    {
+        /*!
+         * \brief columns The columns to export, in the order they are written.
+         */
+        QList<int> columns;
+
+        /*!
+         * \brief addedFill The fill color of added rows in .xlsx files, as 0xAARRGGBB.
+         */
+        quint32 addedFill = 0xFF248046;
+
+        /*!
+         * \brief removedFill The fill color of removed rows in .xlsx files, as 0xAARRGGBB.
+         */
+        quint32 removedFill = 0xFFDA373C;
+
+        /*!
+         * \brief modifiedFill The fill color of the changed cells of modified rows in .xlsx files, as 0xAARRGGBB.
+         */
+        quint32 modifiedFill = 0xFFC27C0E;
+
+        /*!
+         * \brief progressStep The progress is reported every this many rows.
+         */
+        int progressStep = 4096;
+
+        /*!
+         * \brief progress Receives the amount of rows and bytes written so far. May be empty.
+         * Invoked on the exporting thread.
+         */
+        std::function<void(int rows, qint64 bytes)> progress;
+
+        /*!
+         * \brief cancellationToken Stops the export once canceled. The partial file is removed.
+         */
+        CancellationToken cancellationToken;
+    };
+
+    /*!
+     * \brief The CSVExportRow struct is a row handed to the export by a \c CSVExportRowSource.
+     */
+    struct CSVExportRow
+    {
+        /*!
+         * \brief state The state of the row.
+         */
+        JobTableRowState::State state = JobTableRowState::Invalid;
+
+        /*!
+         * \brief cells The cells of the row, by their column.
+         */
+        QList<QString> cells;
+
+        /*!
+         * \brief changedColumns The columns whose cells are filled as changed.
+         */
+        QList<int> changedColumns;
+    };
+
+    /*!
+     * \brief CSVExportRowSource Hands out the rows to export one by one, e.g. while they are compared.
+     * Returns true if \c row has been set, false after the last row, or a description of the error.
+     */
+    using CSVExportRowSource = std::function<std::expected<bool, QString>(CSVExportRow& row)>;
+
+    /*!
+     * \brief The CSVCombinedDataExport class writes the rows of a comparison to a file.
+     * The rows are written one by one straight from the documents or a row source, so the memory needed does not grow with the amount of rows.
+     * A file that could not be written completely is removed.
+     */
+    class CSVCombinedDataExport
+    {
+    public:
+        /*!
+         * \brief toXlsx Writes the header and the rows to a .xlsx file. Added and removed rows are filled with their color,
+         * modified rows only fill their changed cells.
+         * Dictionary encoded columns of columnar documents are written as shared strings.
+         * Rows that do not fit into the sheet are cut off with a warning.
+         * \param data The combined data.
+         * \param filePath Path of the .xlsx file.
+         * \param options Options of the export.
+         * \return Nothing or a description of the error.
+         */
+        static std::expected<void, QString> toXlsx(const CSVCombinedData& data, const QString& filePath, const CSVCombinedDataExportOptions& options);
+
+        /*!
+         * \brief toXlsx Writes the header and the rows handed out by a source to a .xlsx file, like the rows of combined data.
+         * \param headerNames The header names.
+         * \param source Hands out the rows.
+         * \param filePath Path of the .xlsx file.
+         * \param options Options of the export.
+         * \return Nothing or a description of the error, including the errors of \p source.
+         */
+        static std::expected<void, QString> toXlsx(const QList<QString>& headerNames, const CSVExportRowSource& source, const QString& filePath, const CSVCombinedDataExportOptions& options);
+
+        /*!
+         * \brief toCsv Writes the header and the rows to a .csv file.
+         * The state of every row is written into an additional first column named \c State.
+         * \param data The combined data.
+         * \param filePath Path of the .csv file.
+         * \param options Options of the export. The fill colors are not used.
+         * \return Nothing or a description of the error.
+         */
+        static std::expected<void, QString> toCsv(const CSVCombinedData& data, const QString& filePath, const CSVCombinedDataExportOptions& options);
+
+        /*!
+         * \brief toCsv Writes the header and the rows handed out by a source to a .csv file, like the rows of combined data.
+         * \param headerNames The header names.
+         * \param source Hands out the rows.
+         * \param filePath Path of the .csv file.
+         * \param options Options of the export. The fill colors are not used.
+         * \return Nothing or a description of the error, including the errors of \p source.
+         */
+        static std::expected<void, QString> toCsv(const QList<QString>& headerNames, const CSVExportRowSource& source, const QString& filePath, const CSVCombinedDataExportOptions& options);
+
+        /*!
+         * \brief stateName Returns the name of a row state as written by \c toCsv.
+         * \param state The state.
+         * \return The name.
+         */
+        static QByteArrayView stateName(JobTableRowState::State state);
+    };
+}
+
+#endif // ARRIVAL_CSVCOMBINEDDATAEXPORT_H
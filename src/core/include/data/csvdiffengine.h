@@ -0,0 +1,273 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#ifndef ARRIVAL_CSVDIFFENGINE_H
+#define ARRIVAL_CSVDIFFENGINE_H
+
+#include <QList>
+
+#include "data/cancellationtoken.h"
+#include "data/csvdocument.h"
+#include "data/csvkeyindex.h"
+#include "data/csvrowcomparator.h"
+#include "data/rowfingerprinttable.h"
+
+namespace Arrival::App
+{
+    /*!
+     * \brief The CSVDiffEngine class matches the rows of two \c CSVDocument instances against each other.
+     * The key space is hash partitioned. Each partition builds the lookup structures for its own keys
+     * and classifies its own rows, so partitions are processed by different threads without any locking.
+     */
+    class CSVDiffEngine
+    {
+    public:
+        /*!
+         * \brief minimumRowsPerPartition The minimum amount of rows per partition.
+         * Smaller inputs are not worth the overhead of spreading them across threads.
+         */
+        static constexpr int minimumRowsPerPartition = 16384;
+
+        /*!
+         * \brief maximumPairingCells The maximum amount of cells of unmatched rows of the first document
+         * that are indexed to pair rows differing in a single cell. Without a key column larger differences are left alone.
+         */
+        static constexpr qsizetype maximumPairingCells = 1 << 22;
+
+        /*!
+         * \brief CSVDiffEngine Constructs a new \c CSVDiffEngine.
+         * Both documents have to outlive the engine.
+         * \param firstDocument The first (old) document.
+         * \param secondDocument The second (new) document.
+         * \param keyColumns The columns holding the key in both documents, e.g. the Jobnumber column.
+         * Several columns form a composite key. If empty, rows are compared by their fingerprint instead.
+         * \param threadCount The amount of worker threads. If less than 1, the ideal thread count is used.
+         * \param cancellationToken Stops the matching once canceled.
+         */
+        CSVDiffEngine(const CSVDocument& firstDocument, const CSVDocument& secondDocument, const QList<int>& keyColumns, int threadCount, const CancellationToken& cancellationToken = CancellationToken());
+
+        /*!
+         * \brief run Matches the rows of both documents.
+         * \return True if every row has been matched, false if the engine has been canceled.
+         */
+        bool run();
+
+        /*!
+         * \brief threadCount Returns the amount of worker threads.
+         * \return The amount of worker threads.
+         */
+        int threadCount() const
+        {
+            return m_threadCount;
+        }
+
+        /*!
+         * \brief partitionCount Returns the amount of partitions the key space is split into.
+         * \return The amount of partitions.
+         */
+        int partitionCount() const
+        {
+            return m_partitionCount;
+        }
+
+        /*!
+         * \brief firstDocumentMatches Returns for every row of the first document the index of a matching
+         * row in the second document.
+         * \return The matching row indices, -1 for rows that have been removed.
+         */
+        const QList<int>& firstDocumentMatches() const
+        {
+            return m_first.matches;
+        }
+
+        /*!
+         * \brief secondDocumentMatches Returns for every row of the second document the index of a matching
+         * row in the first document.
+         * \return The matching row indices, -1 for rows that have been added.
+         */
+        const QList<int>& secondDocumentMatches() const
+        {
+            return m_second.matches;
+        }
+
+        /*!
+         * \brief changeOffsets Returns for every row of the second document the offset of its changed columns in \c changeMasks.
+         * Rows matched by their key are modified if any other cell differs.
+         * Without a key column, an added and a removed row differing in a single cell are matched as a modified row.
+         * \return The offsets, -1 for rows that are not modified. Empty if no row has been modified.
+         */
+        const QList<int>& changeOffsets() const
+        {
+            return m_changeOffsets;
+        }
+
+        /*!
+         * \brief changeMasks Returns the changed columns of every modified row, a bit per column.
+         * \return The masks, \c CSVRowComparator::maskWordCount words per modified row.
+         */
+        const QList<quint64>& changeMasks() const
+        {
+            return m_changeMasks;
+        }
+
+    private:
+        /*!
+         * \brief The DocumentState struct holds everything the engine knows about one of the documents.
+         */
+        struct DocumentState
+        {
+            /*!
+             * \brief document The document.
+             */
+            const CSVDocument* document = nullptr;
+
+            /*!
+             * \brief fingerprints The fingerprint of every row. Only used without a key column.
+             */
+            QList<RowFingerprint> fingerprints;
+
+            /*!
+             * \brief keys The key of every row. Only used with key columns.
+             */
+            QList<CSVKey> keys;
+
+            /*!
+             * \brief buckets The row indices by chunk and partition.
+             * Concatenating the buckets of a partition chunk by chunk yields its rows in document order.
+             */
+            QList<QList<QList<int>>> buckets;
+
+            /*!
+             * \brief matches For every row the index of the matching row in the other document.
+             */
+            QList<int> matches;
+        };
+
+        /*!
+         * \brief The PartitionChanges struct holds the modified rows of the second document found by a partition.
+         */
+        struct PartitionChanges
+        {
+            /*!
+             * \brief rows The modified rows in document order.
+             */
+            QList<int> rows;
+
+            /*!
+             * \brief masks The changed columns of every row in \c rows.
+             */
+            QList<quint64> masks;
+        };
+
+        /*!
+         * \brief hashChunk Computes the partition of every row in a chunk of a document.
+         * \param state The document.
+         * \param chunk The index of the chunk.
+         */
+        void hashChunk(DocumentState& state, int chunk) const;
+
+        /*!
+         * \brief partitionRows Collects the rows of a document belonging to a partition.
+         * \param state The document.
+         * \param partition The index of the partition.
+         * \return The row indices in document order.
+         */
+        QList<int> partitionRows(const DocumentState& state, int partition) const;
+
+        /*!
+         * \brief matchPartition Matches the rows of a partition in one direction.
+         * \param probe The document whose rows are looked up.
+         * \param build The document the lookup structure is built for.
+         * \param comparator Compares the rows of \p build with the rows of \p probe.
+         * \param partition The index of the partition.
+         */
+        void matchPartition(DocumentState& probe, const DocumentState& build, const CSVRowComparator& comparator, int partition) const;
+
+        /*!
+         * \brief classifyPartition Matches the rows of a partition in both directions.
+         * \param partition The index of the partition.
+         */
+        void classifyPartition(int partition);
+
+        /*!
+         * \brief detectChanges Compares the matched rows of a partition cell by cell.
+         * \param partition The index of the partition.
+         */
+        void detectChanges(int partition);
+
+        /*!
+         * \brief mergeChanges Collects the modified rows found by every partition.
+         */
+        void mergeChanges();
+
+        /*!
+         * \brief pairChangedRows Matches added and removed rows that only differ in a single cell.
+         * Only used without a key column, where such rows are not matched otherwise.
+         */
+        void pairChangedRows();
+
+    private:
+        /*!
+         * \brief m_keyColumns The columns holding the key, empty if rows are compared by their fingerprint.
+         */
+        QList<int> m_keyColumns;
+
+        /*!
+         * \brief m_threadCount The amount of worker threads.
+         */
+        int m_threadCount;
+
+        /*!
+         * \brief m_partitionCount The amount of partitions. Also used as the amount of chunks per document.
+         */
+        int m_partitionCount;
+
+        /*!
+         * \brief m_cancellationToken Stops the matching once canceled.
+         */
+        CancellationToken m_cancellationToken;
+
+        /*!
+         * \brief m_first State of the first document.
+         */
+        DocumentState m_first;
+
+        /*!
+         * \brief m_second State of the second document.
+         */
+        DocumentState m_second;
+
+        /*!
+         * \brief m_firstToSecond Compares the rows of the first document with the rows of the second document.
+         */
+        CSVRowComparator m_firstToSecond;
+
+        /*!
+         * \brief m_secondToFirst Compares the rows of the second document with the rows of the first document.
+         */
+        CSVRowComparator m_secondToFirst;
+
+        /*!
+         * \brief m_maskWordCount The amount of words of the mask of a modified row.
+         */
+        int m_maskWordCount;
+
+        /*!
+         * \brief m_partitionChanges The modified rows found by every partition, until they are merged.
+         */
+        QList<PartitionChanges> m_partitionChanges;
+
+        /*!
+         * \brief m_changeOffsets The offset of the changed columns of every row of the second document, -1 if not modified.
+         */
+        QList<int> m_changeOffsets;
+
+        /*!
+         * \brief m_changeMasks The changed columns of every modified row.
+         */
+        QList<quint64> m_changeMasks;
+    };
+}
+
+#endif // ARRIVAL_CSVDIFFENGINE_H
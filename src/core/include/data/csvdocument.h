@@ -0,0 +1,533 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#ifndef ARRIVAL_CSVDOCUMENT_H
+#define ARRIVAL_CSVDOCUMENT_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+#include <QtGlobal>
+
+#include "qtcsv/structuralindex.h"
+
+#include "data/cancellationtoken.h"
+#include "data/csvcolumn.h"
+#include "data/csvspill.h"
+
+#define ARRIVAL_CSVDOCUMENT_SUPPORTS_HEADER_INDICES 0
+
+namespace Arrival::App
+{
+    class CSVColumnView;
+
+    /*!
+     * \brief The CSVDocumentStorage enum selects how the cells of a \c CSVDocument are kept in memory.
+     */
+    enum class CSVDocumentStorage
+    {
+        /*!
+         * \brief Mapped The file stays mapped into memory, only the boundaries of the cells are stored.
+         */
+        Mapped,
+
+        /*!
+         * \brief Columnar The cells are copied into one arena per column and the file is released.
+         */
+        Columnar,
+
+        /*!
+         * \brief Spilled The rows are read from a \c CSVSpill on disk, only the rows touched become resident.
+         */
+        Spilled
+    };
+
+    /*!
+     * \brief The CSVDocumentOptions struct configures how a .csv file is parsed.
+     */
+    struct CSVDocumentOptions
+    {
+        /*!
+         * \brief parallelParsingThreshold Files of at least this many bytes are parsed on several threads.
+         */
+        qint64 parallelParsingThreshold = 64 * 1024 * 1024;
+
+        /*!
+         * \brief threadCount The amount of threads used to parse large files.
+         * If less than 1, \c QThread::idealThreadCount() threads are used.
+         */
+        int threadCount = 0;
+
+        /*!
+         * \brief storage How the cells are kept in memory once the file has been parsed.
+         */
+        CSVDocumentStorage storage = CSVDocumentStorage::Mapped;
+
+        /*!
+         * \brief dictionaryLimit Columns with at most this many distinct values are dictionary encoded.
+         * Only used with \c CSVDocumentStorage::Columnar. 0 disables the dictionary encoding.
+         */
+        int dictionaryLimit = 1024;
+
+        /*!
+         * \brief dictionaryRowsPerValue Columns are only dictionary encoded if they hold at most one distinct value per this many rows,
+         * besides staying within \c dictionaryLimit. Keeps columns of small documents that are nearly unique, e.g. Jobnumbers, out of the dictionary.
+         * 0 leaves only \c dictionaryLimit.
+         */
+        int dictionaryRowsPerValue = 16;
+
+        /*!
+         * \brief cancellationToken Stops parsing once canceled. A canceled document has no rows.
+         */
+        CancellationToken cancellationToken;
+    };
+
+    /*!
+     * \brief The CSVDocument class gives access to the data found in a .csv file.
+     * The file is mapped into memory and only the boundaries of its fields are stored.
+     * The boundaries are found with the structural index of QtCSV, following the same rules as \c QtCSV::Reader.
+     * Cells are handed out as UTF-8 views into the mapped bytes and only decoded to \c QString on request.
+     * Large files are split into byte ranges that are parsed in parallel, see \c CSVDocumentOptions.
+     * With \c CSVDocumentStorage::Columnar the cells are copied into one contiguous arena per column instead,
+     * which can be iterated with a \c CSVColumnView. Columns with few distinct values, e.g. a status or a country,
+     * are dictionary encoded.
+     * Copies of a document share the mapped file.
+     */
+    class CSVDocument
+    {
+    public:
+
+        /*!
+         * \brief separator The character separating two fields of a row.
+         */
+        static constexpr char separator = ',';
+
+        /*!
+         * \brief textDelimiter The character enclosing fields that contain separators, quotes or line breaks.
+         */
+        static constexpr char textDelimiter = '"';
+
+        /*!
+         * \brief CSVDocument constructs a new \c CSVDocument from a .csv file
+         * \param path Path to the .csv file to construct from.
+         * \param options Options controlling how the file is parsed.
+         */
+        CSVDocument(const QString& path, const CSVDocumentOptions& options = CSVDocumentOptions());
+
+        /*!
+         * \brief CSVDocument constructs a new \c CSVDocument reading its rows from a spill, see \c CSVDocumentStorage::Spilled.
+         * \param spill The spilled .csv file.
+         * \param partition The partition whose rows are the rows of the document,
+         * or \c CSVSpill::allPartitions for every row in the order of the .csv file.
+         */
+        CSVDocument(QSharedPointer<const CSVSpill> spill, int partition = CSVSpill::allPartitions);
+
+        /*!
+         * \brief elementContent Returns the content of an element found by the structural index,
+         * trimmed and unescaped in the same way as the cells of a document.
+         * \param data The indexed bytes.
+         * \param element The element.
+         * \param buffer Holds the content if it differs from the bytes, e.g. because quotes had to be unescaped.
+         * \return The UTF-8 encoded content, a view into \p data or \p buffer.
+         */
+        static QByteArrayView elementContent(const char* data, const QtCSV::RawElement& element, QByteArray& buffer);
+
+        /*!
+         * \brief headersNames Returns the header names.
+         * \return The header names.
+         */
+        const QList<QString>& headersNames() const
+        {
+            return m_headerNames;
+        }
+
+        /*!
+         * \brief rowCount Returns the number of rows in the document.
+         * \return The number of rows in the document.
+         */
+        int rowCount() const
+        {
+            return m_rowCount;
+        }
+
+        /*!
+         * \brief columnCount Returns the column count.
+         * \return The column count.
+         */
+        int columnCount() const
+        {
+            return m_columnCount;
+        }
+
+        /*!
+         * \brief storage Returns how the cells are kept in memory.
+         * \return The storage of the document.
+         */
+        CSVDocumentStorage storage() const
+        {
+            return m_storage;
+        }
+
+        /*!
+         * \brief isEmpty Checks whether the document is empty.
+         * \return True if empty, false otherwise.
+         */
+        bool isEmpty() const
+        {
+            return m_rowCount <= 0 && m_headerNames.empty();
+        }
+
+#if ARRIVAL_CSVDOCUMENT_SUPPORTS_HEADER_INDICES
+        /*!
+         * \brief headerIndices Returns a Hash that maps the hader names to their indices.
+         * \return \c QHash containg the header names and their indices.
+         */
+        const QHash<QString, int>& headerIndices() const
+        {
+            return m_headerIndices;
+        }
+
+        /*!
+         * \brief columnIndex Returns the columns index by the header name.
+         * \param columnName The header name.
+         * \return The index of the header name.
+         */
+        int columnIndex(const QString& columnName) const
+        {
+            return m_headerIndices[columnName];
+        }
+#endif
+
+        /*!
+         * \brief fieldCount Returns the amount of fields in a row.
+         * Malformed rows may hold more or less fields than the document has columns.
+         * \param row row index.
+         * \return The amount of fields in the row.
+         */
+        int fieldCount(int row) const
+        {
+            if (m_storage == CSVDocumentStorage::Spilled)
+            {
+                return m_spill->fieldCount(spillLocation(row));
+            }
+            return static_cast<int>(m_rows.rowFields.at(row + 1) - m_rows.rowFields.at(row));
+        }
+
+        /*!
+         * \brief cell Returns the raw data in a cell without decoding it.
+         * The view stays valid as long as the document or one of its copies exists.
+         * \param row row index of the cell.
+         * \param column column index of the cell.
+         * \return The UTF-8 encoded data in the cell. Empty if the row has no such column.
+         */
+        QByteArrayView cell(int row, int column) const;
+
+        /*!
+         * \brief column Returns a view of a column to iterate its cells.
+         * \param column column index.
+         * \return The view of the column. Cells of rows that have no such column are empty.
+         */
+        CSVColumnView column(int column) const;
+
+        /*!
+         * \brief at Returns the data in a cell
+         * \param row row index of the cell.
+         * \param column column index of the cell.
+         * \return returns the data in the cell as a \c QString.
+         */
+        QString at(int row, int column) const
+        {
+            return QString::fromUtf8(cell(row, column));
+        }
+
+        /*!
+         * \brief row Decodes an entire row.
+         * \param row row index.
+         * \return The data in every field of the row.
+         */
+        QList<QString> row(int row) const;
+
+        /*!
+         * \brief rowEquals Checks whether a row holds exactly the same fields as a row of another document.
+         * \param row row index in this document.
+         * \param other The other document.
+         * \param otherRow row index in \p other.
+         * \return True if both rows are equal, false otherwise.
+         */
+        bool rowEquals(int row, const CSVDocument& other, int otherRow) const;
+
+    private:
+        /*!
+         * \brief The FieldSpan struct locates a field relative to the start of its row.
+         */
+        struct FieldSpan
+        {
+            quint32 offset = 0;
+
+            /*!
+             * \brief length The length of the field in bytes.
+             * The highest bit is set if the field had to be unescaped and is stored in \c RowTable::unescapedFields.
+             */
+            quint32 length = 0;
+        };
+
+        /*!
+         * \brief unescapedFlag Marks fields whose content differs from the bytes in the file.
+         */
+        static constexpr quint32 unescapedFlag = 0x80000000u;
+
+        /*!
+         * \brief The RowTable struct stores the boundaries of a sequence of rows and their fields.
+         */
+        struct RowTable
+        {
+            /*!
+             * \brief rowOffsets The offset of every row.
+             */
+            QList<qint64> rowOffsets;
+
+            /*!
+             * \brief rowFields The index of the first field of every row in \c fields,
+             * followed by the total amount of fields.
+             */
+            QList<qsizetype> rowFields = { 0 };
+
+            /*!
+             * \brief fields The span of every field.
+             */
+            QList<FieldSpan> fields;
+
+            /*!
+             * \brief unescapedFields The content of the fields that contained escaped quotes or line breaks,
+             * by their index in \c fields.
+             */
+            QHash<qsizetype, QByteArray> unescapedFields;
+        };
+
+        /*!
+         * \brief parse Records the boundaries of every row and field of the mapped file.
+         * \param options Options controlling how the file is parsed.
+         */
+        void parse(const CSVDocumentOptions& options);
+
+        /*!
+         * \brief parseRange Records the boundaries of every row and field in a range of the mapped file.
+         * \param begin The offset of the first row.
+         * \param end The end of the range.
+         * \param rows The table receiving the rows.
+         * \param cancellationToken Stops parsing the range once canceled.
+         * \return The offset right after the last row that ends inside of the range.
+         */
+        qint64 parseRange(qint64 begin, qint64 end, RowTable& rows, const CancellationToken& cancellationToken) const;
+
+        /*!
+         * \brief appendRow Records the fields of a row.
+         * \param rows The table receiving the row.
+         * \param rowOffset The offset of the row.
+         * \param elements The raw elements of the row.
+         */
+        void appendRow(RowTable& rows, qint64 rowOffset, const QList<QtCSV::RawElement>& elements) const;
+
+        /*!
+         * \brief appendRows Moves the rows of a table behind the rows of the document.
+         * \param rows The rows to append.
+         */
+        void appendRows(RowTable&& rows);
+
+        /*!
+         * \brief field Returns the bytes of a field.
+         * \param rows The table holding the field.
+         * \param rowOffset The offset of the row holding the field.
+         * \param fieldIndex The index of the field in the table.
+         * \return The UTF-8 encoded data in the field.
+         */
+        QByteArrayView field(const RowTable& rows, qint64 rowOffset, qsizetype fieldIndex) const;
+
+        /*!
+         * \brief buildColumns Copies every cell into the arena of its column and releases the file.
+         * \param options Options controlling how the file is parsed.
+         */
+        void buildColumns(const CSVDocumentOptions& options);
+
+        /*!
+         * \brief buildColumn Copies the cells of a column into an arena.
+         * \param column column index.
+         * \param dictionaryLimit The maximum amount of distinct values of a dictionary encoded column.
+         * \return The column, dictionary encoded if it holds few distinct values.
+         */
+        CSVColumn buildColumn(int column, int dictionaryLimit) const;
+
+        /*!
+         * \brief spillLocation Returns the location of a row inside of the spill.
+         * \param row row index.
+         * \return The location of the row, see \c CSVSpill::cell.
+         */
+        qint64 spillLocation(int row) const
+        {
+            return m_spillPartition == CSVSpill::allPartitions ? m_spill->location(row) : m_rows.rowOffsets.at(row);
+        }
+
+    private:
+        /*!
+         * \brief headerNames The names of the column headers.
+         */
+        QList<QString> m_headerNames;
+
+#if ARRIVAL_CSVDOCUMENT_SUPPORTS_HEADER_INDICES
+        /*!
+         * \brief m_columns stores the index of each column by name.
+         * May be unused. Keep it here because it might become useful in the future.
+         */
+        QHash<QString, int> m_headerIndices;
+#endif
+
+        /*!
+         * \brief m_file The mapped file. The mapping lives as long as the file.
+         */
+        QSharedPointer<QFile> m_file;
+
+        /*!
+         * \brief m_buffer The contents of the file if it could not be mapped.
+         */
+        QByteArray m_buffer;
+
+        /*!
+         * \brief m_bytes The first byte of the file contents.
+         */
+        const char* m_bytes;
+
+        /*!
+         * \brief m_size The size of the file contents in bytes.
+         */
+        qint64 m_size;
+
+        /*!
+         * \brief m_storage How the cells are kept in memory.
+         */
+        CSVDocumentStorage m_storage;
+
+        /*!
+         * \brief m_rows The boundaries of every row without the header row.
+         * Only the amount of fields per row is kept with \c CSVDocumentStorage::Columnar.
+         * With \c CSVDocumentStorage::Spilled only the locations of the rows of a single partition are kept, as row offsets.
+         */
+        RowTable m_rows;
+
+        /*!
+         * \brief m_columns The cells of every column with \c CSVDocumentStorage::Columnar.
+         * Holds as many columns as the widest row.
+         */
+        QList<CSVColumn> m_columns;
+
+        /*!
+         * \brief m_spill The rows with \c CSVDocumentStorage::Spilled.
+         */
+        QSharedPointer<const CSVSpill> m_spill;
+
+        /*!
+         * \brief m_spillPartition The partition of \c m_spill holding the rows, or \c CSVSpill::allPartitions.
+         */
+        int m_spillPartition;
+
+        /*!
+         * \brief m_rowCount Count of rows without the header row.
+         */
+        int m_rowCount;
+
+        /*!
+         * \brief m_columnCount Count of the columns.
+         */
+        int m_columnCount;
+    };
+
+    /*!
+     * \brief The CSVColumnView class gives access to the cells of a single column of a \c CSVDocument.
+     * With \c CSVDocumentStorage::Columnar the cells are read straight from the arena of the column.
+     * The view must not outlive its document.
+     */
+    class CSVColumnView
+    {
+    public:
+        /*!
+         * \brief CSVColumnView Constructs a view of a column.
+         * \param document The document holding the column.
+         * \param column column index.
+         * \param cells The arena of the column, or nullptr if the cells have to be looked up in the document.
+         */
+        CSVColumnView(const CSVDocument& document, int column, const CSVColumn* cells)
+            : m_document(&document)
+            , m_column(column)
+            , m_cells(cells)
+        {}
+
+        /*!
+         * \brief count Returns the amount of cells in the column.
+         * \return The row count of the document.
+         */
+        int count() const
+        {
+            return m_document->rowCount();
+        }
+
+        /*!
+         * \brief at Returns the raw data in a cell without decoding it.
+         * \param row row index of the cell.
+         * \return The UTF-8 encoded data in the cell. Empty if the row has no such column.
+         */
+        QByteArrayView at(int row) const
+        {
+            return m_cells != nullptr ? m_cells->at(row) : m_document->cell(row, m_column);
+        }
+
+        /*!
+         * \brief isDictionaryEncoded Checks whether the cells are stored as codes of distinct values.
+         * \return True if \c code() and \c cells() can be used to access the dictionary.
+         */
+        bool isDictionaryEncoded() const
+        {
+            return m_cells != nullptr && m_cells->isDictionaryEncoded();
+        }
+
+        /*!
+         * \brief code Returns the code of a cell of a dictionary encoded column.
+         * \param row row index of the cell.
+         * \return The code of the value of the cell.
+         */
+        quint16 code(int row) const
+        {
+            return m_cells->code(row);
+        }
+
+        /*!
+         * \brief cells Returns the arena of the column.
+         * \return The arena, or nullptr if the document is not columnar.
+         */
+        const CSVColumn* cells() const
+        {
+            return m_cells;
+        }
+
+    private:
+        /*!
+         * \brief m_document The document holding the column.
+         */
+        const CSVDocument* m_document;
+
+        /*!
+         * \brief m_column The index of the column.
+         */
+        int m_column;
+
+        /*!
+         * \brief m_cells The arena of the column, nullptr if the document is not columnar.
+         */
+        const CSVColumn* m_cells;
+    };
+}
+
+#endif // ARRIVAL_CSVDOCUMENT_H
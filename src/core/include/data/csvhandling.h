@@ -0,0 +1,692 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#ifndef ARRIVAL_CSVHANDLING_H
+#define ARRIVAL_CSVHANDLING_H
+
+#include <QByteArrayView>
+#include <QSharedPointer>
+#include <QSet>
+#include <QString>
+#include <QStringView>
+#include <QList>
+#include <QHash>
+#include <QDebug>
+#include <QCryptographicHash>
+
+#include <expected>
+#include <functional>
+#include <type_traits>
+
+#include "data/cancellationtoken.h"
+#include "data/csvdocument.h"
+#include "data/jobtablerow.h"
+
+namespace Arrival::App
+{
+    /*!
+     * \brief The CSVCombineOptions struct configures how two .csv documents are combined.
+     */
+    struct CSVCombineOptions
+    {
+        /*!
+         * \brief detectKeyColumn Value of \c keyColumnIndex to match the rows by their Jobnumber column, if both documents have the same one.
+         */
+        static constexpr int detectKeyColumn = -1;
+
+        /*!
+         * \brief noKeyColumn Value of \c keyColumnIndex to match the rows by their whole content.
+         */
+        static constexpr int noKeyColumn = -2;
+
+        /*!
+         * \brief keyColumnIndex The column the rows are matched by, \c detectKeyColumn or \c noKeyColumn.
+         */
+        int keyColumnIndex = detectKeyColumn;
+
+        /*!
+         * \brief keyColumnIndices If not empty, the rows are matched by these columns, together forming a composite key.
+         * Overrides \c keyColumnIndex.
+         */
+        QList<int> keyColumnIndices;
+
+        /*!
+         * \brief keyColumnNames If not empty, the rows are matched by the columns with these headers, together forming a composite key.
+         * Overrides \c keyColumnIndices and \c keyColumnIndex.
+         */
+        QList<QString> keyColumnNames;
+
+        /*!
+         * \brief threadCount The amount of threads used to compare the documents.
+         * If less than 1, \c QThread::idealThreadCount() threads are used.
+         */
+        int threadCount = 0;
+
+        /*!
+         * \brief cancellationToken Stops the comparison once canceled, it then fails with \c CombineCSVDocumentsError::Canceled.
+         */
+        CancellationToken cancellationToken;
+    };
+
+    /*!
+     * \brief The CSVSpillOptions struct configures how files larger than the memory are compared, see \c CSVCombinedData::streamSpilledCSVFiles.
+     */
+    struct CSVSpillOptions
+    {
+        /*!
+         * \brief directory The directory the rows are spilled to. The temporary directory of the system if empty.
+         */
+        QString directory;
+
+        /*!
+         * \brief memoryBudget The amount of bytes the comparison may use at once.
+         * Decides into how many partitions the files are split and how many partitions are compared in parallel.
+         */
+        qint64 memoryBudget = Q_INT64_C(2) * 1024 * 1024 * 1024;
+
+        /*!
+         * \brief partitionCount The amount of partitions the rows are spilled to, at most \c CSVSpill::maximumPartitionCount.
+         * If less than 1, it is derived from the size of the files and \c memoryBudget.
+         */
+        int partitionCount = 0;
+    };
+
+    /*!
+     * \brief The CSVKeyDetection struct is the result of searching the Jobnumber column of a document.
+     * Rows are sampled across the document and every column is voted for by the amount of sampled rows holding a Jobnumber in it.
+     */
+    struct CSVKeyDetection
+    {
+        /*!
+         * \brief column The detected Jobnumber column, -1 if no column has been detected.
+         */
+        int column = -1;
+
+        /*!
+         * \brief sampledRowCount The amount of sampled rows.
+         */
+        int sampledRowCount = 0;
+
+        /*!
+         * \brief matchedRowCount The amount of sampled rows holding a Jobnumber in the column with the most votes.
+         */
+        int matchedRowCount = 0;
+
+        /*!
+         * \brief runnerUpMatchedRowCount The amount of sampled rows holding a Jobnumber in the column with the second most votes.
+         */
+        int runnerUpMatchedRowCount = 0;
+
+        /*!
+         * \brief confidence Returns how certain the detection is: the share of sampled rows holding a Jobnumber in the column,
+         * reduced by the share of the runner up. 1 if every sampled row has a single Jobnumber in the same column.
+         * \return The confidence between 0 and 1.
+         */
+        double confidence() const
+        {
+            return sampledRowCount > 0 ? static_cast<double>(qMax(0, matchedRowCount - runnerUpMatchedRowCount)) / sampledRowCount : 0.0;
+        }
+    };
+
+    /*!
+     * \brief The CSVCombineTimings struct holds how long the stages of a comparison took, in milliseconds.
+     */
+    struct CSVCombineTimings
+    {
+        /*!
+         * \brief firstDocumentLoadTime Time it took to parse the first document and find its Jobnumber column.
+         */
+        qint64 firstDocumentLoadTime = 0;
+
+        /*!
+         * \brief secondDocumentLoadTime Time it took to parse the second document and find its Jobnumber column.
+         */
+        qint64 secondDocumentLoadTime = 0;
+
+        /*!
+         * \brief loadTime Time until both documents were ready. Less than the sum of both if they were loaded concurrently.
+         */
+        qint64 loadTime = 0;
+
+        /*!
+         * \brief diffTime Time it took to match the rows of both documents.
+         */
+        qint64 diffTime = 0;
+
+        /*!
+         * \brief streamTime Time it took to hand out the classified rows.
+         */
+        qint64 streamTime = 0;
+    };
+
+    /*!
+     * \brief operator<< Writes the timings of a comparison to a debug stream.
+     */
+    QDebug operator<<(QDebug debug, const CSVCombineTimings& timings);
+
+    class CSVCombinedData;
+
+    /*!
+     * \brief The CSVCombinedDataStream struct receives the result of a comparison piece by piece.
+     * Both callbacks are invoked on the thread that compares the documents, once the comparison has finished.
+     * Only handing the rows over is spread out, the rows are not published while they are classified:
+     * added rows can only be told apart once every row of both documents has been matched,
+     * and the rows of a state keep the order of their document, which a partition of the comparison does not know.
+     */
+    struct CSVCombinedDataStream
+    {
+        /*!
+         * \brief started Receives the combined data without any rows, as soon as the headers are known.
+         * The data must not be modified on the comparing thread.
+         */
+        std::function<void(QSharedPointer<CSVCombinedData> data)> started;
+
+        /*!
+         * \brief rowsReady Receives the next batch of rows, in the order of the table.
+         */
+        std::function<void(QList<JobTableRow> rows)> rowsReady;
+    };
+
+    /*!
+     * \brief The CSVCombinedData class stores data of two .csv documents combinded.
+     */
+    class CSVCombinedData
+    {
+    public:
+        enum class CombineCSVDocumentsError
+        {
+            DifferentFormat,
+            BothEmpty,
+            InvalidKeyColumn,
+            Canceled,
+
+            /*!
+             * \brief NotSorted The rows of a file are not ordered by their key, see \c CSVSortedMerge.
+             */
+            NotSorted,
+
+            /*!
+             * \brief ReadError A file could not be read, see \c CSVSortedMerge.
+             */
+            ReadError,
+
+            /*!
+             * \brief SpillError The rows could not be spilled to disk, see \c streamSpilledCSVFiles.
+             */
+            SpillError
+        };
+
+    public:
+        /*!
+         * \brief getCSVCombinedData takes in two csv documents and combines them.
+         * It checks which rows have been deleted, new added, modified and which rows stayed the same.
+         * The combined data keeps shared ownership of both documents and resolves the cells from them on demand.
+         * \param firstDocument The first document.
+         * \param secondDocument The second document.
+         * \param options Options of the comparison.
+         * \return The combined data or an error.
+         */
+        static std::expected<QSharedPointer<CSVCombinedData>, CombineCSVDocumentsError> getCSVCombinedData(QSharedPointer<const CSVDocument> firstDocument, QSharedPointer<const CSVDocument> secondDocument, const CSVCombineOptions& options = CSVCombineOptions());
+
+        /*!
+         * \brief streamCSVCombinedData takes in two csv documents and combines them like \c getCSVCombinedData,
+         * but hands the rows over in batches once they have been classified.
+         * The first batch is small, so it can be shown right away. The following batches grow up to \c maximumRowBatchSize rows.
+         * Nothing arrives before both documents have been compared, so the first rows are bounded by the time of the whole comparison.
+         * \param firstDocument The first document.
+         * \param secondDocument The second document.
+         * \param options Options of the comparison.
+         * \param stream Receives the combined data and its rows.
+         * \param timings Receives the time the stages took, may be null.
+         * \return Nothing or an error. Nothing is streamed on error, unless the comparison is canceled while the rows are handed out.
+         */
+        static std::expected<void, CombineCSVDocumentsError> streamCSVCombinedData(QSharedPointer<const CSVDocument> firstDocument, QSharedPointer<const CSVDocument> secondDocument, const CSVCombineOptions& options, const CSVCombinedDataStream& stream, CSVCombineTimings* timings = nullptr);
+
+        /*!
+         * \brief streamCSVFiles loads two .csv files and combines them like \c streamCSVCombinedData.
+         * Both files are parsed and searched for their Jobnumber column concurrently, each with half of the threads
+         * of \p documentOptions. The comparison starts as soon as both are ready.
+         * Loading stops as well once the cancellation token of \p options is canceled.
+         * \param firstFilePath Path of the first file.
+         * \param secondFilePath Path of the second file.
+         * \param documentOptions Options used to load the files.
+         * \param options Options of the comparison.
+         * \param stream Receives the combined data and its rows.
+         * \param timings Receives the time the stages took, may be null.
+         * \return Nothing or an error. Nothing is streamed on error, unless the comparison is canceled while the rows are handed out.
+         */
+        static std::expected<void, CombineCSVDocumentsError> streamCSVFiles(const QString& firstFilePath, const QString& secondFilePath, const CSVDocumentOptions& documentOptions, const CSVCombineOptions& options, const CSVCombinedDataStream& stream, CSVCombineTimings* timings = nullptr);
+
+        /*!
+         * \brief streamSpilledCSVFiles combines two .csv files that do not fit into memory like \c streamCSVFiles.
+         * Each file is read once and its rows are spilled to disk, into partitions picked by the hash of their key.
+         * The partitions of both files are then compared pair by pair, in parallel as far as \c CSVSpillOptions::memoryBudget allows.
+         * The combined data reads the cells from the spilled rows on demand, so it is used like any other.
+         * The rows are matched by their key columns, matching them by their whole content is not supported.
+         * \param firstFilePath Path of the first file.
+         * \param secondFilePath Path of the second file.
+         * \param spillOptions Options of the spill.
+         * \param options Options of the comparison.
+         * \param stream Receives the combined data and its rows.
+         * \param timings Receives the time the stages took, may be null. Loading is spilling here.
+         * \return Nothing or an error. \c CombineCSVDocumentsError::InvalidKeyColumn if no key column has been chosen or detected.
+         */
+        static std::expected<void, CombineCSVDocumentsError> streamSpilledCSVFiles(const QString& firstFilePath, const QString& secondFilePath, const CSVSpillOptions& spillOptions, const CSVCombineOptions& options, const CSVCombinedDataStream& stream, CSVCombineTimings* timings = nullptr);
+
+        /*!
+         * \brief firstRowBatchSize The amount of rows in the first batch of \c streamCSVCombinedData.
+         */
+        static constexpr int firstRowBatchSize = 1024;
+
+        /*!
+         * \brief maximumRowBatchSize The maximum amount of rows in a batch of \c streamCSVCombinedData.
+         */
+        static constexpr int maximumRowBatchSize = 65536;
+
+        /*!
+         * \brief jobNumberSampleRowCount The amount of rows sampled to detect the Jobnumber column, spread evenly across a document.
+         */
+        static constexpr int jobNumberSampleRowCount = 64;
+
+        /*!
+         * \brief minimumJobNumberConfidence The confidence a column needs to be detected as the Jobnumber column, see \c CSVKeyDetection::confidence.
+         */
+        static constexpr double minimumJobNumberConfidence = 0.5;
+
+        /*!
+         * \brief jobNumberLength The length of a Jobnumber, 9 digits followed by CL.
+         */
+        static constexpr qsizetype jobNumberLength = 11;
+
+        /*!
+         * \brief detectJobNumberColumn Searches the Jobnumber column of a document.
+         * A single odd row, e.g. an empty cell or a second Jobnumber, no longer decides the key of the whole comparison.
+         * \param document The document to search.
+         * \param sampleRowCount The amount of rows to sample.
+         * \return The detected column and the statistics it has been chosen by.
+         */
+        static CSVKeyDetection detectJobNumberColumn(const CSVDocument& document, int sampleRowCount = jobNumberSampleRowCount);
+
+        /*!
+         * \brief detectJobNumberColumn Searches the Jobnumber column of a few rows, e.g. the first rows of a file.
+         * \param rows The cells of the rows, without the header row.
+         * \return The detected column and the statistics it has been chosen by.
+         */
+        static CSVKeyDetection detectJobNumberColumn(const QList<QList<QString>>& rows);
+
+        /*!
+         * \brief findSingleJobNumberColumnIndex searches for a single Jobnumber column index inside a \c CSVDocument, see \c detectJobNumberColumn.
+         * \param document The docuemt to check.
+         * \return -1 if no column has been detected, the found index otherwise.
+         */
+        static int findSingleJobNumberColumnIndex(const CSVDocument& document);
+
+        /*!
+         * \brief findSingleJobNumberColumnIndex searches for a single Jobnumber column index inside of a row, e.g. the first row of a file.
+         * \param row The cells of the row.
+         * \return -1 if more or less than 1 index has been found, the found index otherwise.
+         */
+        static int findSingleJobNumberColumnIndex(const QList<QString>& row);
+
+        /*!
+         * \brief isJobNumber Checks if a string starts with a Jobnumber, 9 digits followed by CL.
+         * Anything after the Jobnumber is ignored, as some cells hold two of them.
+         * \param str The string to check.
+         * \return True if the string is a Job Number, false otherwise.
+         */
+        static constexpr bool isJobNumber(QStringView str)
+        {
+            return matchesJobNumber(str.utf16(), str.size());
+        }
+
+        /*!
+         * \brief isJobNumber Checks if the UTF-8 encoded data of a cell starts with a Jobnumber, without decoding it.
+         * \param cell The data of the cell.
+         * \return True if the cell holds a Job Number, false otherwise.
+         */
+        static constexpr bool isJobNumber(QByteArrayView cell)
+        {
+            return matchesJobNumber(cell.data(), cell.size());
+        }
+
+        static QString computeFormatIdentifier(const QList<QString>& headerNames);
+
+        /*!
+         * \brief resolveKeyColumns Finds the columns the rows of two documents are matched by.
+         * Key columns chosen in \p options override the detected Jobnumber columns.
+         * \param headerNames The headers of the documents.
+         * \param firstDocumentJobNumberIndex The Jobnumber column of the first document, -1 if there is none.
+         * \param secondDocumentJobNumberIndex The Jobnumber column of the second document, -1 if there is none.
+         * \param options Options of the comparison.
+         * \return The key columns, empty to match the rows by their whole content, or \c CombineCSVDocumentsError::InvalidKeyColumn.
+         */
+        static std::expected<QList<int>, CombineCSVDocumentsError> resolveKeyColumns(const QList<QString>& headerNames, int firstDocumentJobNumberIndex, int secondDocumentJobNumberIndex, const CSVCombineOptions& options);
+
+        /*!
+         * \brief detectedKey Returns the detection the rows have been matched by.
+         * \param firstDetection The detection of the first document.
+         * \param secondDetection The detection of the second document.
+         * \param keyColumns The resolved key columns.
+         * \param options Options of the comparison.
+         * \return The less confident detection, or an empty one if the key columns have been chosen by the caller or no key is used.
+         */
+        static CSVKeyDetection detectedKey(const CSVKeyDetection& firstDetection, const CSVKeyDetection& secondDetection, const QList<int>& keyColumns, const CSVCombineOptions& options);
+
+    private:
+        /*!
+         * \brief matchesJobNumber Checks if code units start with a Jobnumber. The 11 code units are checked without branching on any of them.
+         * \param data The code units.
+         * \param size The amount of code units.
+         * \return True if the code units start with a Jobnumber, false otherwise.
+         */
+        template <typename CodeUnit>
+        static constexpr bool matchesJobNumber(const CodeUnit* data, qsizetype size)
+        {
+            // Guard.
+            if (size < jobNumberLength)
+            {
+                return false;
+            }
+
+            // Every mismatch sets a bit, digits are mapped to 0 to 9 and anything else above.
+            using UnsignedCodeUnit = std::make_unsigned_t<CodeUnit>;
+            quint32 mismatches = 0;
+            for (qsizetype digitIterator = 0; digitIterator < jobNumberLength - 2; digitIterator++)
+            {
+                mismatches |= static_cast<quint32>(static_cast<quint32>(static_cast<UnsignedCodeUnit>(data[digitIterator])) - static_cast<quint32>('0') > 9);
+            }
+            mismatches |= static_cast<quint32>(static_cast<UnsignedCodeUnit>(data[jobNumberLength - 2])) ^ static_cast<quint32>('C');
+            mismatches |= static_cast<quint32>(static_cast<UnsignedCodeUnit>(data[jobNumberLength - 1])) ^ static_cast<quint32>('L');
+            return mismatches == 0;
+        }
+
+        /*!
+         * \brief voteJobNumberColumn Chooses the Jobnumber column by the amount of sampled rows holding a Jobnumber in every column.
+         * \param matchedRowCounts For every column the amount of sampled rows holding a Jobnumber in it.
+         * \param sampledRowCount The amount of sampled rows.
+         * \return The column with the most votes if it is confident enough, and the statistics it has been chosen by.
+         */
+        static CSVKeyDetection voteJobNumberColumn(const QList<int>& matchedRowCounts, int sampledRowCount);
+
+        /*!
+         * \brief streamDocuments Combines two documents whose Jobnumber columns are already known.
+         * \param firstDocument The first document.
+         * \param secondDocument The second document.
+         * \param firstDetection The Jobnumber column of the first document.
+         * \param secondDetection The Jobnumber column of the second document.
+         * \param options Options of the comparison.
+         * \param stream Receives the combined data and its rows.
+         * \param timings Receives the time the stages took, may be null.
+         * \return Nothing or an error. Nothing is streamed on error, unless the comparison is canceled while the rows are handed out.
+         */
+        static std::expected<void, CombineCSVDocumentsError> streamDocuments(QSharedPointer<const CSVDocument> firstDocument, QSharedPointer<const CSVDocument> secondDocument, const CSVKeyDetection& firstDetection, const CSVKeyDetection& secondDetection, const CSVCombineOptions& options, const CSVCombinedDataStream& stream, CSVCombineTimings* timings);
+
+        /*!
+         * \brief streamRows Hands out combined data and then its rows in batches, ordered by their state.
+         * \param result The combined data without any rows.
+         * \param firstDocumentMatches For every row of the first document the matching row of the second document, -1 for removed rows.
+         * \param secondDocumentMatches For every row of the second document the matching row of the first document, -1 for added rows.
+         * \param changeOffsets For every row of the second document the offset of its changed columns, -1 if it is not modified. May be empty.
+         * \param options Options of the comparison.
+         * \param stream Receives the combined data and its rows.
+         * \return Nothing or \c CombineCSVDocumentsError::Canceled.
+         */
+        static std::expected<void, CombineCSVDocumentsError> streamRows(QSharedPointer<CSVCombinedData> result, const QList<int>& firstDocumentMatches, const QList<int>& secondDocumentMatches, const QList<int>& changeOffsets, const CSVCombineOptions& options, const CSVCombinedDataStream& stream);
+
+    public:
+        CSVCombinedData()
+            : m_headerNames()
+#if ARRIVAL_CSVDOCUMENT_SUPPORTS_HEADER_INDICES
+            , m_headerIndices()
+#endif
+            , m_firstDocument()
+            , m_secondDocument()
+            , m_rows()
+            , m_keyColumns()
+            , m_keyDetection()
+            , m_newAddedCount(0)
+            , m_removedCount(0)
+            , m_modifiedCount(0)
+            , m_changeMasks()
+            , m_changeMaskWordCount(0)
+        {}
+
+        QString headerHash() const
+        {
+            if (m_headerNames.empty())
+            {
+                return QString();
+            }
+
+            QString concatenatedString = m_headerNames.join("");
+            QCryptographicHash hash(QCryptographicHash::Sha256);
+            hash.addData(concatenatedString.toUtf8());
+            QByteArray hashData = hash.result();
+            QString uniqueHash = QString(hashData.toHex());
+            return uniqueHash;
+        }
+
+        const QString& formatIdentifier() const
+        {
+            return m_formatIdentifier;
+        }
+
+        /*!
+         * \brief headerNames Returns a list with all header names.
+         * \return \c QList<QString> with all header names.
+         */
+        const QList<QString>& headerNames() const
+        {
+            return m_headerNames;
+        }
+
+#if ARRIVAL_CSVDOCUMENT_SUPPORTS_HEADER_INDICES
+        /*!
+         * \brief headerIndices maps the header names to their column indices.
+         * \return \c QHash<QString, int> containg the header names and their column indices.
+         */
+        const QHash<QString, int>& headerIndices() const
+        {
+            return m_headerIndices;
+        }
+#endif
+        /*!
+         * \brief rows All rows
+         * \return All rows.
+         */
+        const QList<JobTableRow>& rows() const
+        {
+            return m_rows;
+        }
+
+        /*!
+         * \brief document Returns one of the combined documents.
+         * \param id The document to return.
+         * \return The document.
+         */
+        const CSVDocument& document(JobTableRow::Document id) const
+        {
+            return id == JobTableRow::FirstDocument ? *m_firstDocument : *m_secondDocument;
+        }
+
+        /*!
+         * \brief cell Resolves a cell of a row from the document the row belongs to.
+         * \param row The row index.
+         * \param column The column index.
+         * \return The data in the cell as a \c QString.
+         */
+        QString cell(int row, int column) const
+        {
+            const JobTableRow& jobTableRow = m_rows.at(row);
+            return document(jobTableRow.document).at(jobTableRow.row, column);
+        }
+
+        /*!
+         * \brief previousCell Resolves a cell of a row from the row of the first document it has been matched with.
+         * \param row The row index.
+         * \param column The column index.
+         * \return The data in the cell as a \c QString, an empty string if the row has not been matched.
+         */
+        QString previousCell(int row, int column) const
+        {
+            const JobTableRow& jobTableRow = m_rows.at(row);
+            return jobTableRow.matchedRow < 0 ? QString() : m_firstDocument->at(jobTableRow.matchedRow, column);
+        }
+
+        /*!
+         * \brief isChanged Checks whether a cell of a modified row differs from the row it has been matched with.
+         * \param row The row.
+         * \param column The column index.
+         * \return True if the cell has changed, false otherwise.
+         */
+        bool isChanged(const JobTableRow& row, int column) const
+        {
+            // Guard.
+            if (row.changes < 0 || column < 0 || column >= m_changeMaskWordCount * 64)
+            {
+                return false;
+            }
+            return (m_changeMasks.at(row.changes + column / 64) >> (column % 64)) & 1;
+        }
+
+        /*!
+         * \brief rowCount The row count without the headers.
+         * \return The row count without the headers
+         */
+        int rowCount() const
+        {
+            return m_rows.count();
+        }
+
+        /*!
+         * \brief columnCount The column count.
+         * \return The column count.
+         */
+        int columnCount() const
+        {
+            return m_headerNames.count();
+        }
+
+        /*!
+         * \brief keyColumns Returns the columns the rows have been matched by.
+         * \return The column indices, empty if the rows have been matched by their whole content.
+         */
+        const QList<int>& keyColumns() const
+        {
+            return m_keyColumns;
+        }
+
+        /*!
+         * \brief keyDetection Returns how the Jobnumber column the rows have been matched by has been detected.
+         * \return The detection, its column is -1 if the key columns have been chosen or the rows have been matched by their whole content.
+         */
+        const CSVKeyDetection& keyDetection() const
+        {
+            return m_keyDetection;
+        }
+
+        /*!
+         * \brief newAddedCount The count of new added rows.
+         * \return The amount of new added rows.
+         */
+        int newAddedCount() const
+        {
+            return m_newAddedCount;
+        }
+
+        /*!
+         * \brief removedCount The amount of removed rows.
+         * \return The amount of removed rows.
+         */
+        int removedCount() const
+        {
+            return m_removedCount;
+        }
+
+        /*!
+         * \brief modifiedCount The amount of modified rows.
+         * \return The amount of modified rows.
+         */
+        int modifiedCount() const
+        {
+            return m_modifiedCount;
+        }
+
+        /*!
+         * \brief appendRows Appends rows to the end of the table and counts their states.
+         * \param rows The rows.
+         */
+        void appendRows(const QList<JobTableRow>& rows);
+
+        /*!
+         * \brief clear Clears the data.
+         */
+        void clear();
+
+    private:
+        QString m_formatIdentifier;
+
+        /*!
+         * \brief m_headerNames List containg all the header names.
+         */
+        QList<QString> m_headerNames;
+#if ARRIVAL_CSVDOCUMENT_SUPPORTS_HEADER_INDICES
+        /*!
+         * \brief m_headerIndices maps the header names to their column indices.
+         */
+        QHash<QString, int> m_headerIndices;
+#endif
+        /*!
+         * \brief m_firstDocument The first (old) document.
+         */
+        QSharedPointer<const CSVDocument> m_firstDocument;
+
+        /*!
+         * \brief m_secondDocument The second (new) document.
+         */
+        QSharedPointer<const CSVDocument> m_secondDocument;
+
+        /*!
+         * \brief m_rows List referencing the rows of both documents.
+         */
+        QList<JobTableRow> m_rows;
+
+        /*!
+         * \brief m_keyColumns The columns the rows have been matched by, empty for their whole content.
+         */
+        QList<int> m_keyColumns;
+
+        /*!
+         * \brief m_keyDetection How the Jobnumber column the rows have been matched by has been detected.
+         */
+        CSVKeyDetection m_keyDetection;
+
+        /*!
+         * \brief m_newAddedCount Amount of added rows relative to the old document.
+         */
+        int m_newAddedCount;
+
+        /*!
+         * \brief m_removedCount Amount of removed rows relative to the old document.
+         */
+        int m_removedCount;
+
+        /*!
+         * \brief m_modifiedCount Amount of rows found in both documents with different cells.
+         */
+        int m_modifiedCount;
+
+        /*!
+         * \brief m_changeMasks The changed columns of every modified row, a bit per column.
+         */
+        QList<quint64> m_changeMasks;
+
+        /*!
+         * \brief m_changeMaskWordCount The amount of words of the changed columns of a modified row.
+         */
+        int m_changeMaskWordCount;
+    };
+}
+
+#endif // ARRIVAL_CSVHANDLING_H
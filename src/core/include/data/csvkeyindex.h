@@ -0,0 +1,203 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#ifndef ARRIVAL_CSVKEYINDEX_H
+#define ARRIVAL_CSVKEYINDEX_H
+
+#include <QList>
+#include <QtGlobal>
+
+#include "data/csvdocument.h"
+
+namespace Arrival::App
+{
+    /*!
+     * \brief The CSVKey struct is the fixed width binary encoding of the key of a row, built from one or more key columns.
+     * Jobnumbers are parsed to integers, their tail and any other cell are hashed.
+     * Keys are compared as two integers, equal keys are confirmed by their cells to rule out collisions.
+     */
+    struct CSVKey
+    {
+        quint64 high = 0;
+        quint64 low = 0;
+
+        /*!
+         * \brief fromRow Encodes the key of a row.
+         * \param document The document holding the row.
+         * \param row The index of the row.
+         * \param keyColumns The columns forming the key, in the order they are combined.
+         * \return The key of the row.
+         */
+        static CSVKey fromRow(const CSVDocument& document, int row, const QList<int>& keyColumns);
+    };
+
+    inline bool operator==(const CSVKey& lhs, const CSVKey& rhs)
+    {
+        return lhs.high == rhs.high && lhs.low == rhs.low;
+    }
+
+    inline bool operator!=(const CSVKey& lhs, const CSVKey& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    /*!
+     * \brief The CSVKeyIndex class maps the key (e.g. the Jobnumber) of every row in a \c CSVDocument
+     * to the first row holding that key. It is a flat open addressing hash table of \c CSVKey.
+     * The index is built once per document. Looking up a key is a constant time operation afterwards.
+     * The keys are not copied, so the indexed document has to outlive the index.
+     */
+    class CSVKeyIndex
+    {
+    public:
+        /*!
+         * \brief CSVKeyIndex Constructs an empty, invalid index.
+         */
+        CSVKeyIndex();
+
+        /*!
+         * \brief CSVKeyIndex Builds the index of a \c CSVDocument.
+         * Rows that do not have the same amount of columns as the document are not indexed.
+         * \param document The document to index.
+         * \param keyColumns The columns holding the key. Several columns form a composite key.
+         */
+        CSVKeyIndex(const CSVDocument& document, const QList<int>& keyColumns);
+
+        /*!
+         * \brief CSVKeyIndex Builds the index over a subset of the rows of a \c CSVDocument.
+         * The keys have already been encoded, e.g. in parallel.
+         * Rows that do not have the same amount of columns as the document are not indexed.
+         * \param document The document to index.
+         * \param keyColumns The columns holding the key. Several columns form a composite key.
+         * \param keys The key of every row of the document, in document order.
+         * \param rows The indices of the rows to index, in document order.
+         */
+        CSVKeyIndex(const CSVDocument& document, const QList<int>& keyColumns, const QList<CSVKey>& keys, const QList<int>& rows);
+
+        /*!
+         * \brief isValid Checks whether the index has been built for key columns.
+         * \return True if the index is valid, false otherwise.
+         */
+        bool isValid() const
+        {
+            return !m_keyColumns.isEmpty();
+        }
+
+        /*!
+         * \brief keyColumns Returns the columns holding the key.
+         * \return The key columns, empty if the index is invalid.
+         */
+        const QList<int>& keyColumns() const
+        {
+            return m_keyColumns;
+        }
+
+        /*!
+         * \brief keyCount Returns the amount of distinct keys in the index.
+         * \return The amount of distinct keys.
+         */
+        int keyCount() const
+        {
+            return m_keyCount;
+        }
+
+        /*!
+         * \brief containsRow Checks whether the key of a row is in the index.
+         * The document has to be formatted in the same way as the indexed document.
+         * \param document The document holding the row.
+         * \param row The index of the row to look for.
+         * \return True if the key of the row has been found, false otherwise.
+         */
+        bool containsRow(const CSVDocument& document, int row) const
+        {
+            return findRow(document, row) >= 0;
+        }
+
+        /*!
+         * \brief findRow Searches for the first indexed row holding the same key as a row.
+         * The document has to be formatted in the same way as the indexed document.
+         * \param document The document holding the row.
+         * \param row The index of the row to look for.
+         * \return The index of the first row holding the key or -1 if the key is not in the index.
+         */
+        int findRow(const CSVDocument& document, int row) const
+        {
+            return findRow(document, row, CSVKey::fromRow(document, row, m_keyColumns));
+        }
+
+        /*!
+         * \brief findRow Searches for the first indexed row holding the same key as a row.
+         * \param document The document holding the row.
+         * \param row The index of the row to look for.
+         * \param key The key of \p row.
+         * \return The index of the first row holding the key or -1 if the key is not in the index.
+         */
+        int findRow(const CSVDocument& document, int row, const CSVKey& key) const;
+
+    private:
+        /*!
+         * \brief The Slot struct is a single entry of the table.
+         */
+        struct Slot
+        {
+            CSVKey key;
+
+            /*!
+             * \brief row The index of the row in the document, -1 if the slot is empty.
+             */
+            int row = -1;
+        };
+
+        /*!
+         * \brief insert Inserts a row of the document into the index.
+         * Rows whose key is already in the index are not inserted a second time.
+         * \param row The index of the row.
+         * \param key The key of the row.
+         */
+        void insert(int row, const CSVKey& key);
+
+        /*!
+         * \brief allocateSlots Allocates enough empty slots for a given amount of rows.
+         * \param rowCount The amount of rows that are going to be inserted.
+         */
+        void allocateSlots(qsizetype rowCount);
+
+        /*!
+         * \brief keyCellsEqual Compares the key cells of an indexed row with the key cells of another row.
+         * \param row The index of the row in the indexed document.
+         * \param document The document holding the other row.
+         * \param otherRow The index of the other row.
+         * \return True if every key cell is equal, false otherwise.
+         */
+        bool keyCellsEqual(int row, const CSVDocument& document, int otherRow) const;
+
+    private:
+        /*!
+         * \brief m_document The indexed document.
+         */
+        const CSVDocument* m_document;
+
+        /*!
+         * \brief m_keyColumns The columns holding the key.
+         */
+        QList<int> m_keyColumns;
+
+        /*!
+         * \brief m_columnCount The column count of the indexed document.
+         */
+        int m_columnCount;
+
+        /*!
+         * \brief m_keyCount The amount of distinct keys.
+         */
+        int m_keyCount;
+
+        /*!
+         * \brief m_slots The slots of the table. The count is always a power of two.
+         */
+        QList<Slot> m_slots;
+    };
+}
+
+#endif // ARRIVAL_CSVKEYINDEX_H
@@ -0,0 +1,117 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#ifndef ARRIVAL_CSVROWCOMPARATOR_H
+#define ARRIVAL_CSVROWCOMPARATOR_H
+
+#include <QList>
+
+#include "data/csvdocument.h"
+
+namespace Arrival::App
+{
+    /*!
+     * \brief The CSVRowComparator class checks rows of two \c CSVDocument instances for equality.
+     * Columns that are dictionary encoded in both documents are compared by their codes.
+     * The codes of the first document are translated into codes of the second document once,
+     * so comparing such a cell is a single integer compare instead of a byte compare.
+     * Both documents have to outlive the comparator.
+     */
+    class CSVRowComparator
+    {
+    public:
+        /*!
+         * \brief CSVRowComparator Constructs a comparator for the rows of two documents.
+         * \param document The document holding the rows passed as \c row.
+         * \param other The document holding the rows passed as \c otherRow. May be \p document itself.
+         */
+        CSVRowComparator(const CSVDocument& document, const CSVDocument& other);
+
+        /*!
+         * \brief document Returns the document holding the rows passed as \c row.
+         * \return The document.
+         */
+        const CSVDocument& document() const
+        {
+            return *m_document;
+        }
+
+        /*!
+         * \brief other Returns the document holding the rows passed as \c otherRow.
+         * \return The other document.
+         */
+        const CSVDocument& other() const
+        {
+            return *m_other;
+        }
+
+        /*!
+         * \brief equals Checks whether two rows hold exactly the same fields.
+         * \param row row index in \c document().
+         * \param otherRow row index in \c other().
+         * \return True if both rows are equal, false otherwise.
+         */
+        bool equals(int row, int otherRow) const;
+
+        /*!
+         * \brief maskWordCount Returns the amount of words of a mask holding a bit per column.
+         * \param columnCount The amount of columns.
+         * \return The amount of words.
+         */
+        static constexpr int maskWordCount(int columnCount)
+        {
+            return (columnCount + 63) / 64;
+        }
+
+        /*!
+         * \brief changedColumns Compares two rows cell by cell. Both rows have to hold the same amount of fields.
+         * \param row row index in \c document().
+         * \param otherRow row index in \c other().
+         * \param mask Receives a set bit for every column that differs, \c maskWordCount words. Bits of equal columns are left alone.
+         * \return The amount of columns that differ.
+         */
+        int changedColumns(int row, int otherRow, quint64* mask) const;
+
+    private:
+        /*!
+         * \brief The ColumnComparison struct describes how a column is compared.
+         */
+        struct ColumnComparison
+        {
+            /*!
+             * \brief cells The column of the document, nullptr if the column is compared byte by byte.
+             */
+            const CSVColumn* cells = nullptr;
+
+            /*!
+             * \brief otherCells The column of the other document, nullptr if the column is compared byte by byte.
+             */
+            const CSVColumn* otherCells = nullptr;
+
+            /*!
+             * \brief translation For every code of the document the code of the same value in the other document,
+             * -1 if the other document does not hold the value.
+             */
+            QList<int> translation;
+        };
+
+    private:
+        /*!
+         * \brief m_document The document holding the rows passed as \c row.
+         */
+        const CSVDocument* m_document;
+
+        /*!
+         * \brief m_other The document holding the rows passed as \c otherRow.
+         */
+        const CSVDocument* m_other;
+
+        /*!
+         * \brief m_columns How every column is compared.
+         */
+        QList<ColumnComparison> m_columns;
+    };
+}
+
+#endif // ARRIVAL_CSVROWCOMPARATOR_H
@@ -0,0 +1,277 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#ifndef ARRIVAL_CSVSORTEDMERGE_H
+#define ARRIVAL_CSVSORTEDMERGE_H
+
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringView>
+#include <QThreadPool>
+#include <QtGlobal>
+
+#include <expected>
+
+#include "data/csvhandling.h"
+#include "data/jobtablerow.h"
+
+namespace Arrival::App
+{
+    class CSVSortedMergeReader;
+
+    /*!
+     * \brief The CSVMergedRow struct is a row handed out by \c CSVSortedMerge.
+     */
+    struct CSVMergedRow
+    {
+        /*!
+         * \brief state Whether the row has been added, removed, modified or remained.
+         */
+        JobTableRowState::State state = JobTableRowState::Invalid;
+
+        /*!
+         * \brief cells The cells of the row. Taken from the second file, or the first file for removed rows.
+         */
+        QList<QString> cells;
+
+        /*!
+         * \brief previousCells The cells of the row of the first file the row has been matched with, empty for added and removed rows.
+         */
+        QList<QString> previousCells;
+
+        /*!
+         * \brief changedColumns The columns whose cells differ from \c previousCells, only set for modified rows.
+         */
+        QList<int> changedColumns;
+    };
+
+    /*!
+     * \brief The CSVSortedMerge class compares two .csv files that are both ordered by their key, e.g. by their Jobnumber.
+     * Both files are read once, each on its own thread, and their rows are walked in lockstep like the merge step of a merge sort.
+     * Only a few batches of rows per file are held in memory at any time, so files of any size can be compared.
+     * Whether the files are ordered is checked while they are read. Rows out of order end the comparison with
+     * \c CSVCombinedData::CombineCSVDocumentsError::NotSorted, the files have to be compared with \c CSVCombinedData then.
+     * Key cells are ordered by their bytes, runs of digits by their numeric value.
+     * Rows with a duplicate key are matched like \c CSVCombinedData does: every row of the second file with the first row of the first file.
+     */
+    class CSVSortedMerge
+    {
+    public:
+        using Error = CSVCombinedData::CombineCSVDocumentsError;
+
+        /*!
+         * \brief rowBatchSize The amount of rows a reader hands over at once.
+         */
+        static constexpr int rowBatchSize = 512;
+
+        /*!
+         * \brief queuedBatchCount The amount of batches a reader reads ahead of the comparison.
+         */
+        static constexpr int queuedBatchCount = 8;
+
+        /*!
+         * \brief CSVSortedMerge Constructs the comparison of two files. Nothing is read before \c open.
+         * \param firstFilePath Path of the first (old) file.
+         * \param secondFilePath Path of the second (new) file.
+         * \param options Options of the comparison. The rows are matched by the key columns, matching by the whole content is not supported.
+         */
+        CSVSortedMerge(const QString& firstFilePath, const QString& secondFilePath, const CSVCombineOptions& options = CSVCombineOptions());
+
+        /*!
+         * \brief ~CSVSortedMerge Stops both readers and waits for them.
+         */
+        ~CSVSortedMerge();
+
+        CSVSortedMerge(const CSVSortedMerge&) = delete;
+        CSVSortedMerge& operator=(const CSVSortedMerge&) = delete;
+
+        /*!
+         * \brief open Starts reading both files, reads their headers and finds the key columns.
+         * \return Nothing or an error. \c CombineCSVDocumentsError::InvalidKeyColumn if no key column has been chosen or detected.
+         */
+        std::expected<void, Error> open();
+
+        /*!
+         * \brief next Compares the next rows of both files.
+         * \param row Receives the next row.
+         * \return True if a row has been handed out, false once both files have been read completely, or an error.
+         */
+        std::expected<bool, Error> next(CSVMergedRow& row);
+
+        /*!
+         * \brief headerNames Returns the header names of both files.
+         * \return The header names. Empty before \c open.
+         */
+        const QList<QString>& headerNames() const
+        {
+            return m_headerNames;
+        }
+
+        /*!
+         * \brief keyColumns Returns the columns the rows are matched by.
+         * \return The key columns. Empty before \c open.
+         */
+        const QList<int>& keyColumns() const
+        {
+            return m_keyColumns;
+        }
+
+        /*!
+         * \brief keyDetection Returns how the Jobnumber column the rows are matched by has been detected on the first rows of both files.
+         * \return The detection, empty if the key columns have been chosen or before \c open.
+         */
+        const CSVKeyDetection& keyDetection() const
+        {
+            return m_keyDetection;
+        }
+
+        /*!
+         * \brief firstRowCount Returns the amount of rows of the first file handed out so far.
+         * \return The amount of rows without the header.
+         */
+        qint64 firstRowCount() const
+        {
+            return m_firstRowCount;
+        }
+
+        /*!
+         * \brief secondRowCount Returns the amount of rows of the second file handed out so far.
+         * \return The amount of rows without the header.
+         */
+        qint64 secondRowCount() const
+        {
+            return m_secondRowCount;
+        }
+
+        /*!
+         * \brief newAddedCount Returns the amount of added rows handed out so far.
+         * \return The amount of rows.
+         */
+        qint64 newAddedCount() const
+        {
+            return m_newAddedCount;
+        }
+
+        /*!
+         * \brief removedCount Returns the amount of removed rows handed out so far.
+         * \return The amount of rows.
+         */
+        qint64 removedCount() const
+        {
+            return m_removedCount;
+        }
+
+        /*!
+         * \brief modifiedCount Returns the amount of modified rows handed out so far.
+         * \return The amount of rows.
+         */
+        qint64 modifiedCount() const
+        {
+            return m_modifiedCount;
+        }
+
+        /*!
+         * \brief remainedCount Returns the amount of remained rows handed out so far.
+         * \return The amount of rows.
+         */
+        qint64 remainedCount() const
+        {
+            return m_remainedCount;
+        }
+
+        /*!
+         * \brief compareKeys Compares the keys of two rows.
+         * \param row The first row.
+         * \param otherRow The second row.
+         * \param keyColumns The columns forming the key, compared in this order.
+         * \return A negative value if \p row is ordered first, 0 if both keys are equal, a positive value otherwise.
+         */
+        static int compareKeys(const QList<QString>& row, const QList<QString>& otherRow, const QList<int>& keyColumns);
+
+        /*!
+         * \brief compareKeyCells Compares two key cells. Runs of digits are compared by their numeric value,
+         * so 99CL is ordered before 100CL. Everything else is compared by its UTF-16 code units.
+         * \param cell The first cell.
+         * \param otherCell The second cell.
+         * \return A negative value if \p cell is ordered first, 0 if both are equal, a positive value otherwise.
+         */
+        static int compareKeyCells(QStringView cell, QStringView otherCell);
+
+    private:
+        /*!
+         * \brief compareRows Compares a row of the second file with the row of the first file it has been matched with.
+         * \param cells The cells of the row of the second file.
+         * \param previousCells The cells of the matched row of the first file.
+         * \param row Receives the modified or remained row.
+         */
+        void compareRows(const QList<QString>& cells, const QList<QString>& previousCells, CSVMergedRow& row);
+
+    private:
+        /*!
+         * \brief m_firstFilePath Path of the first file.
+         */
+        QString m_firstFilePath;
+
+        /*!
+         * \brief m_secondFilePath Path of the second file.
+         */
+        QString m_secondFilePath;
+
+        /*!
+         * \brief m_options Options of the comparison.
+         */
+        CSVCombineOptions m_options;
+
+        /*!
+         * \brief m_pool Runs both readers.
+         */
+        QThreadPool m_pool;
+
+        /*!
+         * \brief m_firstReader Hands out the rows of the first file.
+         */
+        QSharedPointer<CSVSortedMergeReader> m_firstReader;
+
+        /*!
+         * \brief m_secondReader Hands out the rows of the second file.
+         */
+        QSharedPointer<CSVSortedMergeReader> m_secondReader;
+
+        /*!
+         * \brief m_headerNames The header names of both files.
+         */
+        QList<QString> m_headerNames;
+
+        /*!
+         * \brief m_keyColumns The columns the rows are matched by.
+         */
+        QList<int> m_keyColumns;
+
+        /*!
+         * \brief m_keyDetection How the Jobnumber column has been detected.
+         */
+        CSVKeyDetection m_keyDetection;
+
+        /*!
+         * \brief m_matchedRow The row of the first file the last rows with equal keys have been matched with.
+         * Later rows with its key are matched with it as well, the way the in-memory comparison does.
+         */
+        QList<QString> m_matchedRow;
+
+        /*!
+         * \brief m_hasMatchedRow Whether \c m_matchedRow is set.
+         */
+        bool m_hasMatchedRow;
+
+        qint64 m_firstRowCount;
+        qint64 m_secondRowCount;
+        qint64 m_newAddedCount;
+        qint64 m_removedCount;
+        qint64 m_modifiedCount;
+        qint64 m_remainedCount;
+    };
+}
+
+#endif // ARRIVAL_CSVSORTEDMERGE_H
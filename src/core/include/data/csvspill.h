@@ -0,0 +1,229 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#ifndef ARRIVAL_CSVSPILL_H
+#define ARRIVAL_CSVSPILL_H
+
+#include <QByteArrayView>
+#include <QFile>
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+#include <QTemporaryDir>
+#include <QtGlobal>
+
+#include <expected>
+
+#include "data/cancellationtoken.h"
+
+namespace Arrival::App
+{
+    /*!
+     * \brief The CSVSpill class holds the rows of a .csv file spilled to disk, so files larger than the memory can be compared.
+     * The file is read once and every row is written into one of several partition files, picked by the hash of its key cells.
+     * Rows with the same key end up in the same partition in every file, so the partitions can be compared one by one.
+     * A directory file records the partition and offset of every row in the order of the .csv file.
+     * Every file is mapped once written, rows are decoded from the mapped bytes on request. Only touched pages become resident.
+     *
+     * A spilled row is stored as its row index in the .csv file, its amount of fields and the end of every field,
+     * each as a 32 bit little endian integer, followed by the UTF-8 encoded content of all fields.
+     * The files live in a temporary directory that is removed with the spill.
+     */
+    class CSVSpill
+    {
+    public:
+        /*!
+         * \brief allPartitions Selects every row of a spill in the order of the .csv file instead of the rows of a single partition.
+         */
+        static constexpr int allPartitions = -1;
+
+        /*!
+         * \brief maximumPartitionCount The maximum amount of partitions. Every partition keeps a file open while spilling.
+         */
+        static constexpr int maximumPartitionCount = 256;
+
+        /*!
+         * \brief writeBufferSize The amount of bytes collected per partition before they are written.
+         */
+        static constexpr qsizetype writeBufferSize = 64 * 1024;
+
+        /*!
+         * \brief readFirstRows Reads the first rows of a .csv file without reading the rest of it, e.g. to find its key columns.
+         * The fields are trimmed and unescaped like the cells of a \c CSVDocument.
+         * \param filePath Path of the .csv file.
+         * \param rowCount The amount of rows to read, including the header row.
+         * \return The rows, less if the file is shorter, or a description of the error.
+         */
+        static std::expected<QList<QList<QString>>, QString> readFirstRows(const QString& filePath, int rowCount);
+
+        /*!
+         * \brief create Spills a .csv file to disk.
+         * \param filePath Path of the .csv file.
+         * \param directory The directory the temporary directory of the spill is created in.
+         * \param keyColumns The columns whose cells pick the partition of a row.
+         * \param partitionCount The amount of partitions, at most \c maximumPartitionCount.
+         * \param cancellationToken Stops spilling once canceled.
+         * \return The spill or a description of the error.
+         */
+        static std::expected<QSharedPointer<const CSVSpill>, QString> create(const QString& filePath, const QString& directory, const QList<int>& keyColumns, int partitionCount, const CancellationToken& cancellationToken = CancellationToken());
+
+        /*!
+         * \brief partitionOf Returns the partition of a row by its key cells.
+         * \param keyCells The cells of the key columns, in the order of the key columns.
+         * \param partitionCount The amount of partitions.
+         * \return The partition.
+         */
+        static int partitionOf(const QList<QByteArrayView>& keyCells, int partitionCount);
+
+        CSVSpill(const CSVSpill&) = delete;
+        CSVSpill& operator=(const CSVSpill&) = delete;
+
+        /*!
+         * \brief headerNames Returns the header names of the .csv file.
+         * \return The header names.
+         */
+        const QList<QString>& headerNames() const
+        {
+            return m_headerNames;
+        }
+
+        /*!
+         * \brief rowCount Returns the amount of rows without the header row.
+         * \return The amount of rows.
+         */
+        int rowCount() const
+        {
+            return m_rowCount;
+        }
+
+        /*!
+         * \brief partitionCount Returns the amount of partitions.
+         * \return The amount of partitions.
+         */
+        int partitionCount() const
+        {
+            return static_cast<int>(m_partitions.count());
+        }
+
+        /*!
+         * \brief partitionRowCount Returns the amount of rows in a partition.
+         * \param partition The partition.
+         * \return The amount of rows.
+         */
+        int partitionRowCount(int partition) const
+        {
+            return m_partitions.at(partition).rowCount;
+        }
+
+        /*!
+         * \brief partitionSize Returns the size of a partition file.
+         * \param partition The partition.
+         * \return The size in bytes.
+         */
+        qint64 partitionSize(int partition) const
+        {
+            return m_partitions.at(partition).size;
+        }
+
+        /*!
+         * \brief location Returns the location of a row in the order of the .csv file.
+         * \param row The row index.
+         * \return The location, see \c fieldCount and \c cell.
+         */
+        qint64 location(int row) const;
+
+        /*!
+         * \brief partitionRows Finds every row of a partition by walking its file.
+         * \param partition The partition.
+         * \param locations Receives the location of every row, in the order of the .csv file.
+         * \param sourceRows Receives the index of every row in the .csv file, may be null.
+         */
+        void partitionRows(int partition, QList<qint64>& locations, QList<int>* sourceRows = nullptr) const;
+
+        /*!
+         * \brief fieldCount Returns the amount of fields of a row.
+         * \param location The location of the row.
+         * \return The amount of fields.
+         */
+        int fieldCount(qint64 location) const;
+
+        /*!
+         * \brief cell Returns the raw data in a cell. The view stays valid as long as the spill exists.
+         * \param location The location of the row.
+         * \param column The column index.
+         * \return The UTF-8 encoded data in the cell. Empty if the row has no such column.
+         */
+        QByteArrayView cell(qint64 location, int column) const;
+
+    private:
+        /*!
+         * \brief The Partition struct is a mapped partition file.
+         */
+        struct Partition
+        {
+            QSharedPointer<QFile> file;
+
+            /*!
+             * \brief bytes The mapped contents of the file, nullptr if the file is empty.
+             */
+            const char* bytes = nullptr;
+
+            qint64 size = 0;
+            int rowCount = 0;
+        };
+
+        /*!
+         * \brief offsetBits The amount of low bits of a location holding the offset of the row, the high bits hold its partition.
+         */
+        static constexpr int offsetBits = 48;
+
+        /*!
+         * \brief CSVSpill Constructs an empty spill. The files are added by \c create.
+         */
+        CSVSpill();
+
+        /*!
+         * \brief row Returns the first byte of a row.
+         * \param location The location of the row.
+         * \return The first byte of the row.
+         */
+        const char* row(qint64 location) const
+        {
+            return m_partitions.at(static_cast<int>(location >> offsetBits)).bytes + (location & ((Q_INT64_C(1) << offsetBits) - 1));
+        }
+
+    private:
+        /*!
+         * \brief m_directory The temporary directory holding the files. Declared first, so it is removed after the files are closed.
+         */
+        QSharedPointer<QTemporaryDir> m_directory;
+
+        /*!
+         * \brief m_headerNames The header names of the .csv file.
+         */
+        QList<QString> m_headerNames;
+
+        /*!
+         * \brief m_partitions The partition files.
+         */
+        QList<Partition> m_partitions;
+
+        /*!
+         * \brief m_locationFile The directory file, holding the location of every row as a 64 bit little endian integer.
+         */
+        QSharedPointer<QFile> m_locationFile;
+
+        /*!
+         * \brief m_locations The mapped contents of the directory file, nullptr if there are no rows.
+         */
+        const char* m_locations;
+
+        /*!
+         * \brief m_rowCount The amount of rows without the header row.
+         */
+        int m_rowCount;
+    };
+}
+
+#endif // ARRIVAL_CSVSPILL_H
@@ -0,0 +1,34 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#ifndef ARRIVAL_HASHING_H
+#define ARRIVAL_HASHING_H
+
+#include <QtGlobal>
+
+namespace Arrival::App::Hashing
+{
+    /*!
+     * \brief goldenRatio 2^64 divided by the golden ratio. Multiplied with a position, e.g. a column index,
+     * it spreads consecutive positions over the entire 64 bits. Also the increment of splitmix64.
+     */
+    static constexpr quint64 goldenRatio = 0x9e3779b97f4a7c15ULL;
+
+    /*!
+     * \brief mix The finalizer of splitmix64. Spreads every input bit over the entire output.
+     * \param value The value to mix.
+     * \return The mixed value.
+     */
+    constexpr quint64 mix(quint64 value)
+    {
+        value ^= value >> 30;
+        value *= 0xbf58476d1ce4e5b9ULL;
+        value ^= value >> 27;
+        value *= 0x94d049bb133111ebULL;
+        value ^= value >> 31;
+        return value;
+    }
+}
+
+#endif // ARRIVAL_HASHING_H
@@ -19,11 +19,13 @@ namespace Arrival::App
 
         Q_PROPERTY(int newAddedCount READ newAddedCount NOTIFY newAddedCountChanged)
         Q_PROPERTY(int removedCount READ removedCount NOTIFY removedCountChanged)
+        Q_PROPERTY(int modifiedCount READ modifiedCount NOTIFY modifiedCountChanged)
         Q_PROPERTY(int rowCount READ rowCount NOTIFY rowCountChanged)
         Q_PROPERTY(int columnCount READ columnCount NOTIFY columnCountChanged)
         Q_PROPERTY(bool hasData READ hasData NOTIFY hasDataChanged)
         Q_PROPERTY(QList<QString> headerNames READ headerNames NOTIFY headerNamesChanged)
         Q_PROPERTY(QString formatIdentifier READ formatIdentifier NOTIFY formatIdentifierChanged)
+        Q_PROPERTY(double keyDetectionConfidence READ keyDetectionConfidence NOTIFY keyDetectionConfidenceChanged)
     public:
         /*!
          * \brief JobTable construct a new \c JobTable.
@@ -101,6 +103,19 @@ namespace Arrival::App
             return 0;
         }
 
+        /*!
+         * \brief modifiedCount Returns the modified count. If no data is there 0 is returned.
+         * \return The modified count. If no data is there 0 is returned.
+         */
+        int modifiedCount() const
+        {
+            if (hasData())
+            {
+                return m_data->modifiedCount();
+            }
+            return 0;
+        }
+
         /*!
          * \brief headerNames Returns a list of the header names.
          * \return The list of headers.
@@ -127,6 +142,19 @@ namespace Arrival::App
             return QString();
         }
 
+        /*!
+         * \brief keyDetectionConfidence Returns how certain the detection of the Jobnumber column the rows have been matched by is.
+         * \return The confidence between 0 and 1. -1 if no data is there or the rows have not been matched by a detected Jobnumber column.
+         */
+        double keyDetectionConfidence() const
+        {
+            if (hasData() && m_data->keyDetection().column >= 0)
+            {
+                return m_data->keyDetection().confidence();
+            }
+            return -1.0;
+        }
+
     signals:
         /*!
          * \brief preTableReset Called bevore the table reset.
@@ -138,6 +166,18 @@ namespace Arrival::App
          */
         void postTableReset();
 
+        /*!
+         * \brief preRowsAppended Called before rows are appended to the table.
+         * \param first Index of the first appended row.
+         * \param last Index of the last appended row.
+         */
+        void preRowsAppended(int first, int last);
+
+        /*!
+         * \brief postRowsAppended Called after rows have been appended to the table.
+         */
+        void postRowsAppended();
+
         /*!
          * \brief newAddedCountChanged newAddedCount changed.
          * \param newCount The new count.
@@ -150,6 +190,12 @@ namespace Arrival::App
          */
         void removedCountChanged(int newCount);
 
+        /*!
+         * \brief modifiedCountChanged modifiedCount changed.
+         * \param newCount The new count.
+         */
+        void modifiedCountChanged(int newCount);
+
         /*!
          * \brief rowCountChanged rowCount changed.
          * \param newCount The new rowCount.
@@ -180,6 +226,12 @@ namespace Arrival::App
          */
         void formatIdentifierChanged(const QString& identifier);
 
+        /*!
+         * \brief keyDetectionConfidenceChanged keyDetectionConfidence changed.
+         * \param confidence The new value.
+         */
+        void keyDetectionConfidenceChanged(double confidence);
+
     public slots:
         /*!
          * \brief setTableData Sets the table data (the underlying pointer).
@@ -187,6 +239,12 @@ namespace Arrival::App
          */
         void setTableData(QSharedPointer<CSVCombinedData> data);
 
+        /*!
+         * \brief appendRows Appends rows to the end of the table. Does nothing if the table has no data.
+         * \param rows The rows.
+         */
+        void appendRows(const QList<JobTableRow>& rows);
+
         /*!
          * \brief clearTable Clears the table.
          */
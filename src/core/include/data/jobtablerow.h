@@ -0,0 +1,76 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#ifndef ARRIVAL_JOBTABLEROW_H
+#define ARRIVAL_JOBTABLEROW_H
+
+#include <QObject>
+#include <QtGlobal>
+
+namespace Arrival::App
+{
+    /*!
+     * \brief The JobTableRowState class is only used to expose the \c State enum to QML.
+     */
+    class JobTableRowState : public QObject
+    {
+        Q_OBJECT
+    public:
+
+        enum State
+        {
+            Added = 0,
+            Removed = 1,
+            Remained = 2,
+            Modified = 3,
+            Invalid = -1
+        };
+        Q_ENUM(JobTableRowState::State)
+    };
+
+    /*!
+     * \brief The JobTableRow struct references a row of one of the two compared documents.
+     * The cells are not copied, they are resolved through \c CSVCombinedData when needed.
+     */
+    struct JobTableRow
+    {
+        /*!
+         * \brief The Document enum identifies the document a row belongs to.
+         */
+        enum Document : quint8
+        {
+            FirstDocument = 0,
+            SecondDocument = 1
+        };
+
+        /*!
+         * \brief row The row index inside of the document.
+         */
+        int row;
+
+        /*!
+         * \brief state The state of the row.
+         */
+        JobTableRowState::State state;
+
+        /*!
+         * \brief document The document the row belongs to.
+         */
+        Document document;
+
+        /*!
+         * \brief matchedRow The row of the first document matched with a row of the second document, -1 if there is none.
+         */
+        int matchedRow = -1;
+
+        /*!
+         * \brief changes The offset of the changed columns of a modified row inside of \c CSVCombinedData, -1 if there are none.
+         */
+        int changes = -1;
+    };
+
+
+}
+
+#endif // ARRIVAL_JOBTABLEROW_H
@@ -0,0 +1,167 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#ifndef ARRIVAL_ROWFINGERPRINTTABLE_H
+#define ARRIVAL_ROWFINGERPRINTTABLE_H
+
+#include <QList>
+#include <QtGlobal>
+
+#include "data/csvdocument.h"
+#include "data/csvrowcomparator.h"
+
+namespace Arrival::App
+{
+    /*!
+     * \brief The RowFingerprint struct is a 128 bit hash of an entire row.
+     * The order of the cells and their column positions are part of the fingerprint,
+     * so two rows only share a fingerprint if every column holds the same value.
+     */
+    struct RowFingerprint
+    {
+        quint64 high = 0;
+        quint64 low = 0;
+
+        /*!
+         * \brief fromRow Computes the fingerprint of a row from its UTF-8 encoded fields.
+         * \param document The document holding the row.
+         * \param row The index of the row to fingerprint.
+         * \return The fingerprint of the row.
+         */
+        static RowFingerprint fromRow(const CSVDocument& document, int row);
+    };
+
+    inline bool operator==(const RowFingerprint& lhs, const RowFingerprint& rhs)
+    {
+        return lhs.high == rhs.high && lhs.low == rhs.low;
+    }
+
+    inline bool operator!=(const RowFingerprint& lhs, const RowFingerprint& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    /*!
+     * \brief The RowFingerprintTable class is a flat open addressing hash table holding the fingerprint of every row in a \c CSVDocument.
+     * Each row is fingerprinted once when the table is built.
+     * Rows are only compared cell by cell when their fingerprints match, to rule out hash collisions.
+     */
+    class RowFingerprintTable
+    {
+    public:
+        /*!
+         * \brief RowFingerprintTable Builds the table for a \c CSVDocument.
+         * The document has to outlive the table.
+         * \param document The document to fingerprint.
+         */
+        explicit RowFingerprintTable(const CSVDocument& document);
+
+        /*!
+         * \brief RowFingerprintTable Builds the table over a subset of the rows of a \c CSVDocument.
+         * The fingerprints have already been computed, e.g. in parallel.
+         * The document has to outlive the table.
+         * \param document The fingerprinted document.
+         * \param fingerprints The fingerprint of every row of the document, in document order.
+         * \param rows The indices of the rows to insert, in document order.
+         */
+        RowFingerprintTable(const CSVDocument& document, const QList<RowFingerprint>& fingerprints, const QList<int>& rows);
+
+        /*!
+         * \brief fingerprint Returns the fingerprint of a row of the document.
+         * \param row The index of the row.
+         * \return The fingerprint of the row.
+         */
+        const RowFingerprint& fingerprint(int row) const
+        {
+            return m_fingerprints.at(row);
+        }
+
+        /*!
+         * \brief containsRow Checks whether a row with exactly the same cells is in the table.
+         * \param document The document holding the row.
+         * \param row The index of the row to look for.
+         * \param fingerprint The fingerprint of \p row.
+         * \return True if the row has been found, false otherwise.
+         */
+        bool containsRow(const CSVDocument& document, int row, const RowFingerprint& fingerprint) const
+        {
+            return findRow(document, row, fingerprint) >= 0;
+        }
+
+        /*!
+         * \brief findRow Searches for a row with exactly the same cells.
+         * \param document The document holding the row.
+         * \param row The index of the row to look for.
+         * \param fingerprint The fingerprint of \p row.
+         * \return The index of the matching row in the document or -1 if no row matches.
+         */
+        int findRow(const CSVDocument& document, int row, const RowFingerprint& fingerprint) const;
+
+        /*!
+         * \brief findRow Searches for a row with exactly the same cells.
+         * Use this overload when looking up many rows of the same document, the comparator is built only once.
+         * \param comparator Compares the rows of the fingerprinted document with the rows of the document holding \p row.
+         * \param row The index of the row to look for in \c comparator.other().
+         * \param fingerprint The fingerprint of \p row.
+         * \return The index of the matching row in the fingerprinted document or -1 if no row matches.
+         */
+        int findRow(const CSVRowComparator& comparator, int row, const RowFingerprint& fingerprint) const;
+
+    private:
+        /*!
+         * \brief The Slot struct is a single entry of the table.
+         */
+        struct Slot
+        {
+            RowFingerprint fingerprint;
+
+            /*!
+             * \brief row The index of the row in the document, -1 if the slot is empty.
+             */
+            int row = -1;
+        };
+
+        /*!
+         * \brief insert Inserts a row of the document into the table.
+         * Rows that are already in the table are not inserted a second time.
+         * \param row The index of the row.
+         * \param comparator Compares the rows of the document with each other.
+         */
+        void insert(int row, const CSVRowComparator& comparator);
+
+        /*!
+         * \brief allocateSlots Allocates enough empty slots for a given amount of rows.
+         * \param rowCount The amount of rows that are going to be inserted.
+         */
+        void allocateSlots(qsizetype rowCount);
+
+        /*!
+         * \brief slotIndex Returns the first slot to probe for a fingerprint.
+         * \param fingerprint The fingerprint.
+         * \return The index of the slot.
+         */
+        qsizetype slotIndex(const RowFingerprint& fingerprint) const
+        {
+            return static_cast<qsizetype>(fingerprint.low & static_cast<quint64>(m_slots.count() - 1));
+        }
+
+    private:
+        /*!
+         * \brief m_document The fingerprinted document.
+         */
+        const CSVDocument* m_document;
+
+        /*!
+         * \brief m_fingerprints The fingerprint of every row, in document order.
+         */
+        QList<RowFingerprint> m_fingerprints;
+
+        /*!
+         * \brief m_slots The slots of the table. The count is always a power of two.
+         */
+        QList<Slot> m_slots;
+    };
+}
+
+#endif // ARRIVAL_ROWFINGERPRINTTABLE_H
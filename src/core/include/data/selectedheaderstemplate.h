@@ -30,6 +30,7 @@ namespace Arrival::App
         static constexpr const char* headerIdentifierJsonName = "headerId";
         static constexpr const char* templateNameJsonName = "templateName";
         static constexpr const char* indicesJsonName = "indices";
+        static constexpr const char* keyColumnsJsonName = "keyColumns";
 
     public:
         /*!
@@ -42,16 +43,18 @@ namespace Arrival::App
          * \param headerIdentifier The header identifier.
          * \param templateName The template name.
          * \param indices The indices.
+         * \param keyColumnNames The headers of the columns the rows are matched by, empty to detect the Jobnumber column.
          */
-        SelectedHeadersTemplate(const QString& headerIdentifier, const QString& templateName, const QList<int>& indices);
+        SelectedHeadersTemplate(const QString& headerIdentifier, const QString& templateName, const QList<int>& indices, const QList<QString>& keyColumnNames = QList<QString>());
 
         /*!
          * \brief SelectedHeadersTemplate constructs a new \c SelectedHeadersTemplate.
          * \param templateName The template name.
          * \param headerNames List of all headers to construct this template for.
          * \param indices The indices.
+         * \param keyColumnNames The headers of the columns the rows are matched by, empty to detect the Jobnumber column.
          */
-        SelectedHeadersTemplate(const QString& templateName, const QList<QString>& headerNames, const QList<int>& indices);
+        SelectedHeadersTemplate(const QString& templateName, const QList<QString>& headerNames, const QList<int>& indices, const QList<QString>& keyColumnNames);
 
         /*!
          * \brief fromJson creates a \c SelectedHeadersTemplate from a \c QJsonObject.
@@ -88,6 +91,16 @@ namespace Arrival::App
             return m_headerIndices;
         }
 
+        /*!
+         * \brief keyColumnNames Returns the headers of the columns the rows are matched by.
+         * Stored by name, so they can be resolved before the format of the compared files is known.
+         * \return The header names, empty to detect the Jobnumber column.
+         */
+        const QList<QString>& keyColumnNames() const
+        {
+            return m_keyColumnNames;
+        }
+
     private:
         /*!
          * \brief m_headerIdentifier is created by a hash function that hashes all
@@ -105,11 +118,16 @@ namespace Arrival::App
          * \brief m_headerIndices The indices stored in this template.
          */
         QList<int> m_headerIndices;
+
+        /*!
+         * \brief m_keyColumnNames The headers of the columns the rows are matched by.
+         */
+        QList<QString> m_keyColumnNames;
     };
 
     inline bool operator==(const SelectedHeadersTemplate& lhs, const SelectedHeadersTemplate& rhs)
     {
-        return lhs.headerIdentifier() == rhs.headerIdentifier() &&  lhs.templateName() == rhs.templateName() && lhs.headerIndices() == rhs.headerIndices();
+        return lhs.headerIdentifier() == rhs.headerIdentifier() &&  lhs.templateName() == rhs.templateName() && lhs.headerIndices() == rhs.headerIndices() && lhs.keyColumnNames() == rhs.keyColumnNames();
     }
 
     inline bool operator!=(const SelectedHeadersTemplate& lhs, const SelectedHeadersTemplate& rhs)
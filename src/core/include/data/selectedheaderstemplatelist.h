@@ -22,8 +22,9 @@ namespace Arrival::App
 
         Q_INVOKABLE void saveToJson(const QString& file) const;
         Q_INVOKABLE void loadFromJson(const QString& file);
-        Q_INVOKABLE void addNewTemplate(const QString& formatIdentifier, const QString& templateName, const QList<int>& indices);
+        Q_INVOKABLE void addNewTemplate(const QString& formatIdentifier, const QString& templateName, const QList<int>& indices, const QList<QString>& keyColumnNames = QList<QString>());
         Q_INVOKABLE QList<int> getTemplateIndices(int index) const;
+        Q_INVOKABLE QList<QString> getTemplateKeyColumnNames(int index) const;
 
         int templatesCount() const
         {
@@ -0,0 +1,273 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#ifndef ARRIVAL_XLSXSTREAMWRITER_H
+#define ARRIVAL_XLSXSTREAMWRITER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QtGlobal>
+
+#include "data/zipstreamwriter.h"
+
+namespace Arrival::App
+{
+    /*!
+     * \brief The XlsxStreamWriter class writes a .xlsx workbook with a single sheet row by row.
+     * The sheet XML is generated while the rows are written and compressed straight into the archive,
+     * so the memory needed does not depend on the amount of rows.
+     * Cells are written as inline strings, or as indices of shared strings registered with \c addSharedString.
+     * Formats have to be registered with \c addFillFormat before they are used.
+     */
+    class XlsxStreamWriter
+    {
+    public:
+        /*!
+         * \brief maximumRowCount The maximum amount of rows of a sheet, including the header row.
+         */
+        static constexpr int maximumRowCount = 1048576;
+
+        /*!
+         * \brief maximumCellLength The maximum amount of characters of a cell, longer cells are cut off.
+         */
+        static constexpr int maximumCellLength = 32767;
+
+        /*!
+         * \brief XlsxStreamWriter Constructs a writer for a file.
+         * \param filePath Path of the .xlsx file.
+         */
+        explicit XlsxStreamWriter(const QString& filePath);
+
+        /*!
+         * \brief ~XlsxStreamWriter Destroys the writer. A file that has been opened but not closed is removed.
+         */
+        ~XlsxStreamWriter();
+
+        /*!
+         * \brief addFillFormat Registers a format that fills the background of a cell.
+         * \param argb The fill color as 0xAARRGGBB.
+         * \return The format, to be passed to \c beginRow.
+         */
+        int addFillFormat(quint32 argb);
+
+        /*!
+         * \brief addSharedString Adds a value to the shared strings of the workbook. Equal values share one entry.
+         * Worth it for values repeated in many cells, e.g. the dictionary of a column.
+         * \param value The UTF-8 encoded value.
+         * \return The index of the value, to be passed to \c writeSharedCell.
+         */
+        int addSharedString(QByteArrayView value);
+
+        /*!
+         * \brief open Creates the file and starts the sheet.
+         * \return True on success, false otherwise.
+         */
+        bool open();
+
+        /*!
+         * \brief beginRow Starts a new row.
+         * \param format The format of every cell in the row, 0 for no format.
+         * \return True on success, false if writing failed or the sheet is full.
+         */
+        bool beginRow(int format = 0);
+
+        /*!
+         * \brief writeCell Appends a cell to the current row.
+         * \param value The UTF-8 encoded content of the cell.
+         */
+        void writeCell(QByteArrayView value);
+
+        /*!
+         * \brief writeCell Appends a cell with its own format to the current row.
+         * \param value The UTF-8 encoded content of the cell.
+         * \param format The format of the cell instead of the format of the row, 0 for no format.
+         */
+        void writeCell(QByteArrayView value, int format);
+
+        /*!
+         * \brief writeCell Appends a cell to the current row.
+         * \param value The content of the cell.
+         */
+        void writeCell(const QString& value);
+
+        /*!
+         * \brief writeSharedCell Appends a cell holding a shared string to the current row.
+         * \param index The index returned by \c addSharedString.
+         */
+        void writeSharedCell(int index);
+
+        /*!
+         * \brief writeSharedCell Appends a cell holding a shared string with its own format to the current row.
+         * \param index The index returned by \c addSharedString.
+         * \param format The format of the cell instead of the format of the row, 0 for no format.
+         */
+        void writeSharedCell(int index, int format);
+
+        /*!
+         * \brief endRow Ends the current row.
+         * \return True on success, false otherwise.
+         */
+        bool endRow();
+
+        /*!
+         * \brief close Ends the sheet and writes the remaining parts of the workbook.
+         * \return True on success, false otherwise.
+         */
+        bool close();
+
+        /*!
+         * \brief cancel Stops writing and removes the file if it has been opened.
+         */
+        void cancel();
+
+        /*!
+         * \brief rowCount Returns the amount of rows written.
+         * \return The amount of rows.
+         */
+        int rowCount() const
+        {
+            return m_rowCount;
+        }
+
+        /*!
+         * \brief bytesWritten Returns the amount of compressed bytes written to the file so far.
+         * \return The amount of bytes.
+         */
+        qint64 bytesWritten() const
+        {
+            return static_cast<qint64>(m_zip.bytesWritten());
+        }
+
+        /*!
+         * \brief isFull Checks whether the sheet holds \c maximumRowCount rows.
+         * The rows written so far can still be saved with \c close.
+         * \return True if no more rows can be written, false otherwise.
+         */
+        bool isFull() const
+        {
+            return m_rowCount >= maximumRowCount;
+        }
+
+        /*!
+         * \brief hasError Checks whether writing failed.
+         * \return True if an error occured, false otherwise.
+         */
+        bool hasError() const
+        {
+            return !m_errorString.isEmpty() || m_zip.hasError();
+        }
+
+        /*!
+         * \brief errorString Returns a description of the first error.
+         * \return The description, empty if no error occured.
+         */
+        QString errorString() const
+        {
+            return m_errorString.isEmpty() ? m_zip.errorString() : m_errorString;
+        }
+
+    private:
+        /*!
+         * \brief appendCell Appends a cell to the current row.
+         * \param value The valid UTF-8 encoded content of the cell, at most \c maximumCellLength bytes.
+         */
+        void appendCell(QByteArrayView value);
+
+        /*!
+         * \brief flush Compresses the buffered sheet XML into the archive.
+         * \return True on success, false otherwise.
+         */
+        bool flush();
+
+        /*!
+         * \brief stylesXml Generates the styles part with every registered format.
+         * \return The XML.
+         */
+        QByteArray stylesXml() const;
+
+        /*!
+         * \brief sharedStringsXml Generates the shared strings part with every registered value.
+         * \return The XML.
+         */
+        QByteArray sharedStringsXml() const;
+
+        /*!
+         * \brief contentTypesXml Generates the content types of every part of the workbook.
+         * \return The XML.
+         */
+        QByteArray contentTypesXml() const;
+
+        /*!
+         * \brief workbookRelationshipsXml Generates the relationships of the workbook to its parts.
+         * \return The XML.
+         */
+        QByteArray workbookRelationshipsXml() const;
+
+        /*!
+         * \brief m_file The .xlsx file.
+         */
+        QFile m_file;
+
+        /*!
+         * \brief m_zip Writes the archive to the file.
+         */
+        ZipStreamWriter m_zip;
+
+        /*!
+         * \brief m_fills The fill color of every registered format.
+         */
+        QList<quint32> m_fills;
+
+        /*!
+         * \brief m_sharedStrings The \c si elements of every shared string, in the order of their indices.
+         */
+        QByteArray m_sharedStrings;
+
+        /*!
+         * \brief m_sharedStringIndices The index of every shared string by its value.
+         */
+        QHash<QByteArray, int> m_sharedStringIndices;
+
+        /*!
+         * \brief m_buffer Sheet XML that has not been compressed yet.
+         */
+        QByteArray m_buffer;
+
+        /*!
+         * \brief m_cellPrefix The XML that starts a cell of the current row.
+         */
+        QByteArray m_cellPrefix;
+
+        /*!
+         * \brief m_sharedCellPrefix The XML that starts a cell holding a shared string of the current row.
+         */
+        QByteArray m_sharedCellPrefix;
+
+        /*!
+         * \brief m_rowCount The amount of rows written.
+         */
+        int m_rowCount;
+
+        /*!
+         * \brief m_isOpen True between \c open and \c close.
+         */
+        bool m_isOpen;
+
+        /*!
+         * \brief m_isFinished True once the file has been closed successfully.
+         */
+        bool m_isFinished;
+
+        /*!
+         * \brief m_errorString The description of the first error that did not occur in the archive.
+         */
+        QString m_errorString;
+    };
+}
+
+#endif // ARRIVAL_XLSXSTREAMWRITER_H
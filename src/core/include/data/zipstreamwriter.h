@@ -0,0 +1,196 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#ifndef ARRIVAL_ZIPSTREAMWRITER_H
+#define ARRIVAL_ZIPSTREAMWRITER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QIODevice>
+#include <QList>
+#include <QScopedPointer>
+#include <QString>
+#include <QtGlobal>
+
+namespace Arrival::App
+{
+    /*!
+     * \brief The ZipStreamWriter class writes a zip archive entry by entry.
+     * The content of an entry is compressed while it is written, so an entry never has to be kept in memory as a whole.
+     * Entries are deflated if zlib is available and stored uncompressed otherwise.
+     * The sizes and the checksum of an entry are patched into its local header once the entry ends,
+     * which requires a device that supports random access.
+     * Entries and archives beyond 4 GiB or 65535 entries use the zip64 extension.
+     */
+    class ZipStreamWriter
+    {
+    public:
+        /*!
+         * \brief defaultCompressionLevel The zlib compression level used if none is given.
+         * Favors speed over size, large exports are dominated by the time it takes to compress them.
+         */
+        static constexpr int defaultCompressionLevel = 1;
+
+        /*!
+         * \brief ZipStreamWriter Constructs a writer that writes to an open device.
+         * \param device The device, has to be opened for writing and support random access.
+         * \param compressionLevel The zlib compression level from 0 to 9.
+         */
+        explicit ZipStreamWriter(QIODevice* device, int compressionLevel = defaultCompressionLevel);
+
+        /*!
+         * \brief ~ZipStreamWriter Destroys the writer. Does not close the archive.
+         */
+        ~ZipStreamWriter();
+
+        /*!
+         * \brief beginEntry Starts a new entry. Ends the current entry if there is one.
+         * \param name The path of the entry inside of the archive.
+         * \return True on success, false otherwise.
+         */
+        bool beginEntry(const QString& name);
+
+        /*!
+         * \brief write Appends data to the current entry.
+         * \param data The data to append.
+         * \return True on success, false otherwise.
+         */
+        bool write(QByteArrayView data);
+
+        /*!
+         * \brief endEntry Ends the current entry.
+         * \return True on success, false otherwise.
+         */
+        bool endEntry();
+
+        /*!
+         * \brief addEntry Adds an entry with the given content.
+         * \param name The path of the entry inside of the archive.
+         * \param data The content of the entry.
+         * \return True on success, false otherwise.
+         */
+        bool addEntry(const QString& name, QByteArrayView data);
+
+        /*!
+         * \brief close Ends the current entry and writes the central directory.
+         * The device is not closed.
+         * \return True on success, false otherwise.
+         */
+        bool close();
+
+        /*!
+         * \brief bytesWritten Returns the amount of bytes written to the device so far.
+         * \return The amount of bytes.
+         */
+        quint64 bytesWritten() const
+        {
+            return m_offset;
+        }
+
+        /*!
+         * \brief hasError Checks whether writing failed.
+         * \return True if an error occured, false otherwise.
+         */
+        bool hasError() const
+        {
+            return !m_errorString.isEmpty();
+        }
+
+        /*!
+         * \brief errorString Returns a description of the first error.
+         * \return The description, empty if no error occured.
+         */
+        const QString& errorString() const
+        {
+            return m_errorString;
+        }
+
+    private:
+        class Deflater;
+
+        /*!
+         * \brief The Entry struct describes a finished entry for the central directory.
+         */
+        struct Entry
+        {
+            QByteArray name;
+            quint32 crc;
+            quint64 compressedSize;
+            quint64 uncompressedSize;
+            quint64 localHeaderOffset;
+        };
+
+        /*!
+         * \brief writeToDevice Writes bytes to the device at the current position.
+         * \param data The bytes.
+         * \return True on success, false otherwise.
+         */
+        bool writeToDevice(QByteArrayView data);
+
+        /*!
+         * \brief flush Writes the compressed bytes of the current entry to the device.
+         * \return True on success, false otherwise.
+         */
+        bool flush();
+
+        /*!
+         * \brief setError Remembers the first error.
+         * \param errorString The description of the error.
+         * \return Always false.
+         */
+        bool setError(const QString& errorString);
+
+        /*!
+         * \brief m_device The device the archive is written to.
+         */
+        QIODevice* m_device;
+
+        /*!
+         * \brief m_deflater Compresses the content of the current entry.
+         */
+        QScopedPointer<Deflater> m_deflater;
+
+        /*!
+         * \brief m_entries The finished entries.
+         */
+        QList<Entry> m_entries;
+
+        /*!
+         * \brief m_current The current entry.
+         */
+        Entry m_current;
+
+        /*!
+         * \brief m_hasCurrent True while an entry is written.
+         */
+        bool m_hasCurrent;
+
+        /*!
+         * \brief m_buffer Compressed bytes of the current entry that have not been written yet.
+         */
+        QByteArray m_buffer;
+
+        /*!
+         * \brief m_offset The position at which the next bytes are written.
+         */
+        quint64 m_offset;
+
+        /*!
+         * \brief m_dosTime The modification time of the entries in MS-DOS format.
+         */
+        quint16 m_dosTime;
+
+        /*!
+         * \brief m_dosDate The modification date of the entries in MS-DOS format.
+         */
+        quint16 m_dosDate;
+
+        /*!
+         * \brief m_errorString The description of the first error.
+         */
+        QString m_errorString;
+    };
+}
+
+#endif // ARRIVAL_ZIPSTREAMWRITER_H
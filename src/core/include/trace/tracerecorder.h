@@ -0,0 +1,239 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#ifndef ARRIVAL_TRACERECORDER_H
+#define ARRIVAL_TRACERECORDER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QtGlobal>
+
+#include <atomic>
+
+namespace Arrival::App
+{
+    /*!
+     * \brief The TraceRecorder class records spans and writes them as Chrome trace events.
+     * The written file can be opened with chrome://tracing or https://ui.perfetto.dev.
+     * Spans are only recorded once \c start has been called, until then every span costs a single atomic load.
+     */
+    class TraceRecorder
+    {
+    public:
+        /*!
+         * \brief environmentVariable The environment variable holding the path of the trace file.
+         */
+        static constexpr const char* environmentVariable = "ARRIVAL_TRACE";
+
+        /*!
+         * \brief instance Returns the recorder of the process.
+         * \return The recorder.
+         */
+        static TraceRecorder& instance();
+
+        /*!
+         * \brief isEnabled Checks whether spans are recorded.
+         * \return True if spans are recorded, false otherwise.
+         */
+        bool isEnabled() const
+        {
+            return m_isEnabled.load(std::memory_order_relaxed);
+        }
+
+        /*!
+         * \brief start Starts recording. The trace is written to the file by \c stop,
+         * or when the \c QCoreApplication is destroyed.
+         * \param filePath The file the trace is written to.
+         */
+        void start(const QString& filePath);
+
+        /*!
+         * \brief startFromEnvironment Starts recording if \c environmentVariable is set.
+         * \return True if recording has been started, false otherwise.
+         */
+        bool startFromEnvironment();
+
+        /*!
+         * \brief stop Stops recording and writes the trace.
+         * \return True if the trace has been written or nothing has been recorded, false otherwise.
+         */
+        bool stop();
+
+        /*!
+         * \brief now Returns the time since the recorder has been created.
+         * \return The time in nanoseconds.
+         */
+        qint64 now() const
+        {
+            return m_timer.nsecsElapsed();
+        }
+
+        /*!
+         * \brief record Records a span on the calling thread.
+         * \param name The name of the span. Has to outlive the recorder, e.g. a string literal.
+         * \param begin The begin of the span, see \c now.
+         * \param end The end of the span, see \c now.
+         */
+        void record(const char* name, qint64 begin, qint64 end);
+
+        /*!
+         * \brief begin Begins a span that ends somewhere else, e.g. on another thread.
+         * Beginning a span that has already begun restarts it.
+         * \param name The name of the span. Has to outlive the recorder, e.g. a string literal.
+         */
+        void begin(const char* name);
+
+        /*!
+         * \brief end Ends a span begun by \c begin and records it on the calling thread.
+         * Nothing is recorded if the span has not begun.
+         * \param name The name of the span.
+         */
+        void end(const char* name);
+
+    private:
+        /*!
+         * \brief The TraceEvent struct is a recorded span.
+         */
+        struct TraceEvent
+        {
+            /*!
+             * \brief name The name of the span.
+             */
+            const char* name;
+
+            /*!
+             * \brief thread The thread the span has been recorded on.
+             */
+            int thread;
+
+            /*!
+             * \brief begin The begin in nanoseconds.
+             */
+            qint64 begin;
+
+            /*!
+             * \brief end The end in nanoseconds.
+             */
+            qint64 end;
+        };
+
+        /*!
+         * \brief TraceRecorder Constructs a recorder that does not record yet.
+         */
+        TraceRecorder();
+
+        /*!
+         * \brief currentThread Returns the id of the calling thread, registering it on first use.
+         * \return The id of the thread.
+         */
+        int currentThread();
+
+        /*!
+         * \brief toJson Converts the recorded spans to Chrome trace events. The mutex has to be locked.
+         * \return The trace.
+         */
+        QByteArray toJson() const;
+
+    private:
+        /*!
+         * \brief m_isEnabled Whether spans are recorded.
+         */
+        std::atomic<bool> m_isEnabled;
+
+        /*!
+         * \brief m_timer Measures the time since the recorder has been created.
+         */
+        QElapsedTimer m_timer;
+
+        /*!
+         * \brief m_mutex Guards every member below.
+         */
+        QMutex m_mutex;
+
+        /*!
+         * \brief m_filePath The file the trace is written to.
+         */
+        QString m_filePath;
+
+        /*!
+         * \brief m_events The recorded spans.
+         */
+        QList<TraceEvent> m_events;
+
+        /*!
+         * \brief m_threadNames The names of the threads, by their id.
+         */
+        QList<QByteArray> m_threadNames;
+
+        /*!
+         * \brief m_pending The begin of every span begun by \c begin, by its name.
+         */
+        QHash<QByteArray, qint64> m_pending;
+    };
+
+    /*!
+     * \brief The TraceSpan class records a span from its construction to its destruction.
+     * Use \c ARRIVAL_TRACE_SCOPE instead, so the span compiles to nothing without \c ARRIVAL_ENABLE_TRACING.
+     */
+    class TraceSpan
+    {
+    public:
+        /*!
+         * \brief TraceSpan Begins the span.
+         * \param name The name of the span. Has to outlive the recorder, e.g. a string literal.
+         */
+        explicit TraceSpan(const char* name)
+            : m_name(name)
+            , m_begin(TraceRecorder::instance().isEnabled() ? TraceRecorder::instance().now() : -1)
+        {}
+
+        /*!
+         * \brief ~TraceSpan Ends the span and records it.
+         */
+        ~TraceSpan()
+        {
+            if (m_begin >= 0)
+            {
+                TraceRecorder& recorder = TraceRecorder::instance();
+                recorder.record(m_name, m_begin, recorder.now());
+            }
+        }
+
+        TraceSpan(const TraceSpan&) = delete;
+        TraceSpan& operator=(const TraceSpan&) = delete;
+
+    private:
+        /*!
+         * \brief m_name The name of the span.
+         */
+        const char* m_name;
+
+        /*!
+         * \brief m_begin The begin of the span, -1 if recording has been off.
+         */
+        qint64 m_begin;
+    };
+}
+
+#define ARRIVAL_TRACE_CONCAT_IMPL(a, b) a##b
+#define ARRIVAL_TRACE_CONCAT(a, b) ARRIVAL_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef ARRIVAL_ENABLE_TRACING
+// Records a span until the end of the enclosing scope.
+#define ARRIVAL_TRACE_SCOPE(name) const ::Arrival::App::TraceSpan ARRIVAL_TRACE_CONCAT(arrivalTraceSpan, __LINE__)(name)
+// Begins a span that is ended by ARRIVAL_TRACE_END, possibly on another thread.
+#define ARRIVAL_TRACE_BEGIN(name) ::Arrival::App::TraceRecorder::instance().isEnabled() ? ::Arrival::App::TraceRecorder::instance().begin(name) : static_cast<void>(0)
+// Ends a span begun by ARRIVAL_TRACE_BEGIN.
+#define ARRIVAL_TRACE_END(name) ::Arrival::App::TraceRecorder::instance().isEnabled() ? ::Arrival::App::TraceRecorder::instance().end(name) : static_cast<void>(0)
+#else
+#define ARRIVAL_TRACE_SCOPE(name) static_cast<void>(0)
+#define ARRIVAL_TRACE_BEGIN(name) static_cast<void>(0)
+#define ARRIVAL_TRACE_END(name) static_cast<void>(0)
+#endif
+
+#endif // ARRIVAL_TRACERECORDER_H
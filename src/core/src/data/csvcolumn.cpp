@@ -0,0 +1,96 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#include <utility>
+
+#include "data/csvcolumn.h"
+
+namespace Arrival::App
+{
+    CSVColumn::CSVColumn()
+        : m_arena()
+        , m_offsets({ 0 })
+        , m_wideOffsets()
+        , m_codes()
+        , m_isDictionaryEncoded(false)
+    {}
+
+    CSVColumn CSVColumn::fromDictionary(const QList<QByteArrayView>& values, QList<quint16> codes)
+    {
+        qsizetype byteCount = 0;
+        for (const QByteArrayView value : values)
+        {
+            byteCount += value.size();
+        }
+
+        CSVColumn column;
+        column.reserve(values.count(), byteCount);
+        for (const QByteArrayView value : values)
+        {
+            column.append(value);
+        }
+        column.m_codes = std::move(codes);
+        column.m_isDictionaryEncoded = true;
+        return column;
+    }
+
+    void CSVColumn::reserve(qsizetype rowCount, qsizetype byteCount)
+    {
+        if (byteCount > maximumNarrowOffset)
+        {
+            widenOffsets();
+        }
+        if (m_wideOffsets.isEmpty())
+        {
+            m_offsets.reserve(rowCount + 1);
+        }
+        else
+        {
+            m_wideOffsets.reserve(rowCount + 1);
+        }
+        m_arena.reserve(byteCount);
+    }
+
+    void CSVColumn::append(QByteArrayView value)
+    {
+        m_arena.append(value.data(), value.size());
+        if (m_arena.size() > maximumNarrowOffset)
+        {
+            widenOffsets();
+        }
+
+        if (m_wideOffsets.isEmpty())
+        {
+            m_offsets.append(static_cast<quint32>(m_arena.size()));
+        }
+        else
+        {
+            m_wideOffsets.append(m_arena.size());
+        }
+    }
+
+    void CSVColumn::widenOffsets()
+    {
+        // Guard.
+        if (!m_wideOffsets.isEmpty())
+        {
+            return;
+        }
+
+        m_wideOffsets.reserve(m_offsets.count());
+        for (const quint32 offset : std::as_const(m_offsets))
+        {
+            m_wideOffsets.append(offset);
+        }
+        m_offsets = QList<quint32>();
+    }
+
+    void CSVColumn::squeeze()
+    {
+        m_arena.squeeze();
+        m_offsets.squeeze();
+        m_wideOffsets.squeeze();
+        m_codes.squeeze();
+    }
+}
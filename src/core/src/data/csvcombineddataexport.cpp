@@ -0,0 +1,448 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#include <QByteArray>
+#include <QDebug>
+#include <QFile>
+
+#include <array>
+
+#include "data/csvcolumn.h"
+#include "data/csvcombineddataexport.h"
+#include "data/xlsxstreamwriter.h"
+#include "trace/tracerecorder.h"
+
+namespace Arrival::App
+{
+    // The .csv export is written to the file in blocks of this size.
+    static constexpr qsizetype csvFlushSize = 64 * 1024;
+
+    static const QString exportCanceledError = QStringLiteral("The export has been canceled");
+
+    // Appends a field, enclosed in text delimiters if it contains a separator, a text delimiter or a line break.
+    static void appendCsvField(QByteArray& out, QByteArrayView value)
+    {
+        bool needsDelimiters = false;
+        for (const char character : value)
+        {
+            if (character == CSVDocument::separator || character == CSVDocument::textDelimiter || character == '\n' || character == '\r')
+            {
+                needsDelimiters = true;
+                break;
+            }
+        }
+        if (!needsDelimiters)
+        {
+            out.append(value);
+            return;
+        }
+
+        out.append(CSVDocument::textDelimiter);
+        for (const char character : value)
+        {
+            if (character == CSVDocument::textDelimiter)
+            {
+                out.append(CSVDocument::textDelimiter);
+            }
+            out.append(character);
+        }
+        out.append(CSVDocument::textDelimiter);
+    }
+
+    // Hands the rows of combined data to the writers, the cells are read from the documents without decoding them.
+    class CombinedDataRows
+    {
+    public:
+        explicit CombinedDataRows(const CSVCombinedData& data)
+            : m_data(data)
+            , m_index(-1)
+            , m_sharedStrings()
+        {}
+
+        // Registers the dictionaries of dictionary encoded columns as shared strings,
+        // so their cells are written as the index of their value instead of the value itself.
+        void addSharedStrings(XlsxStreamWriter& writer, const QList<int>& columns)
+        {
+            ARRIVAL_TRACE_SCOPE("export.sharedStrings");
+
+            for (const JobTableRow::Document id : {JobTableRow::FirstDocument, JobTableRow::SecondDocument})
+            {
+                QList<SharedStrings>& documentStrings = m_sharedStrings[id];
+                for (const int column : columns)
+                {
+                    const CSVColumnView view = m_data.document(id).column(column);
+                    if (!view.isDictionaryEncoded())
+                    {
+                        continue;
+                    }
+                    if (documentStrings.count() <= column)
+                    {
+                        documentStrings.resize(column + 1);
+                    }
+
+                    SharedStrings& strings = documentStrings[column];
+                    if (strings.cells != nullptr)
+                    {
+                        continue;
+                    }
+                    const CSVColumn* cells = view.cells();
+                    strings.cells = cells;
+                    strings.indices.reserve(cells->dictionarySize());
+                    for (int code = 0; code < cells->dictionarySize(); code++)
+                    {
+                        strings.indices.append(writer.addSharedString(cells->dictionaryValue(code)));
+                    }
+                }
+            }
+        }
+
+        std::expected<bool, QString> next()
+        {
+            m_index++;
+            return m_index < m_data.rowCount();
+        }
+
+        JobTableRowState::State state() const
+        {
+            return m_data.rows().at(m_index).state;
+        }
+
+        QByteArrayView cell(int column) const
+        {
+            const JobTableRow& row = m_data.rows().at(m_index);
+            return m_data.document(row.document).cell(row.row, column);
+        }
+
+        // The shared string of the cell, -1 if the column is not dictionary encoded.
+        int sharedString(int column) const
+        {
+            const JobTableRow& row = m_data.rows().at(m_index);
+            const QList<SharedStrings>& documentStrings = m_sharedStrings[row.document];
+            if (column >= documentStrings.count() || documentStrings.at(column).cells == nullptr)
+            {
+                return -1;
+            }
+            const SharedStrings& strings = documentStrings.at(column);
+            return strings.indices.at(strings.cells->code(row.row));
+        }
+
+        bool isChanged(int column) const
+        {
+            return m_data.isChanged(m_data.rows().at(m_index), column);
+        }
+
+    private:
+        // The shared string of every code of a dictionary encoded column.
+        struct SharedStrings
+        {
+            const CSVColumn* cells = nullptr;
+            QList<int> indices;
+        };
+
+        const CSVCombinedData& m_data;
+        int m_index;
+
+        // The shared strings of both documents by column.
+        std::array<QList<SharedStrings>, 2> m_sharedStrings;
+    };
+
+    // Hands the rows of a row source to the writers.
+    class SourceRows
+    {
+    public:
+        explicit SourceRows(const CSVExportRowSource& source)
+            : m_source(source)
+            , m_row()
+            , m_cell()
+        {}
+
+        // The cells of a source are not dictionary encoded.
+        void addSharedStrings(XlsxStreamWriter& writer, const QList<int>& columns)
+        {
+            Q_UNUSED(writer);
+            Q_UNUSED(columns);
+        }
+
+        std::expected<bool, QString> next()
+        {
+            return m_source(m_row);
+        }
+
+        JobTableRowState::State state() const
+        {
+            return m_row.state;
+        }
+
+        // The view stays valid until the next cell is requested.
+        QByteArrayView cell(int column)
+        {
+            m_cell = m_row.cells.value(column).toUtf8();
+            return m_cell;
+        }
+
+        int sharedString(int column) const
+        {
+            Q_UNUSED(column);
+            return -1;
+        }
+
+        bool isChanged(int column) const
+        {
+            return m_row.changedColumns.contains(column);
+        }
+
+    private:
+        const CSVExportRowSource& m_source;
+        CSVExportRow m_row;
+        QByteArray m_cell;
+    };
+
+    template <typename Rows>
+    static std::expected<void, QString> writeXlsx(const QList<QString>& headerNames, Rows& rows, const QString& filePath, const CSVCombinedDataExportOptions& options)
+    {
+        ARRIVAL_TRACE_SCOPE("export.xlsx");
+
+        XlsxStreamWriter writer(filePath);
+        const int addedFormat = writer.addFillFormat(options.addedFill);
+        const int removedFormat = writer.addFillFormat(options.removedFill);
+        const int modifiedFormat = writer.addFillFormat(options.modifiedFill);
+        rows.addSharedStrings(writer, options.columns);
+
+        const auto reportProgress = [&]()
+        {
+            if (options.progress)
+            {
+                options.progress(writer.rowCount(), writer.bytesWritten());
+            }
+        };
+
+        if (!writer.open())
+        {
+            return std::unexpected(writer.errorString());
+        }
+
+        // Write the headers.
+        writer.beginRow();
+        for (const int column : options.columns)
+        {
+            writer.writeCell(headerNames.at(column));
+        }
+        writer.endRow();
+
+        // Write the actual data.
+        while (true)
+        {
+            // The writer removes the partial file when it goes out of scope.
+            if (options.cancellationToken.isCanceled())
+            {
+                return std::unexpected(exportCanceledError);
+            }
+
+            const std::expected<bool, QString> hasRow = rows.next();
+            if (!hasRow.has_value())
+            {
+                return std::unexpected(hasRow.error());
+            }
+            if (!*hasRow)
+            {
+                break;
+            }
+
+            int format = 0;
+            if (rows.state() == JobTableRowState::Added)
+            {
+                format = addedFormat;
+            }
+            else if (rows.state() == JobTableRowState::Removed)
+            {
+                format = removedFormat;
+            }
+
+            if (!writer.beginRow(format))
+            {
+                if (writer.isFull())
+                {
+                    qWarning() << "The .xlsx document cannot hold every row, the export is cut off: " + filePath;
+                }
+                break;
+            }
+            for (const int column : options.columns)
+            {
+                const int sharedString = rows.sharedString(column);
+                const bool isChanged = rows.isChanged(column);
+                if (sharedString >= 0 && isChanged)
+                {
+                    writer.writeSharedCell(sharedString, modifiedFormat);
+                }
+                else if (sharedString >= 0)
+                {
+                    writer.writeSharedCell(sharedString);
+                }
+                else if (isChanged)
+                {
+                    writer.writeCell(rows.cell(column), modifiedFormat);
+                }
+                else
+                {
+                    writer.writeCell(rows.cell(column));
+                }
+            }
+            if (!writer.endRow())
+            {
+                break;
+            }
+
+            if (options.progressStep > 0 && writer.rowCount() % options.progressStep == 0)
+            {
+                reportProgress();
+            }
+        }
+
+        if (options.cancellationToken.isCanceled())
+        {
+            return std::unexpected(exportCanceledError);
+        }
+        if (!writer.close())
+        {
+            return std::unexpected(writer.errorString());
+        }
+        reportProgress();
+        return {};
+    }
+
+    template <typename Rows>
+    static std::expected<void, QString> writeCsv(const QList<QString>& headerNames, Rows& rows, const QString& filePath, const CSVCombinedDataExportOptions& options)
+    {
+        ARRIVAL_TRACE_SCOPE("export.csv");
+
+        QFile file(filePath);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            return std::unexpected(file.errorString());
+        }
+
+        // Do not leave a broken file behind.
+        const auto fail = [&file](const QString& error) -> std::expected<void, QString>
+        {
+            file.close();
+            file.remove();
+            return std::unexpected(error);
+        };
+
+        QByteArray buffer;
+        buffer.reserve(csvFlushSize + 4 * 1024);
+        qint64 bytesWritten = 0;
+        const auto flush = [&]()
+        {
+            if (file.write(buffer) != buffer.size())
+            {
+                return false;
+            }
+            bytesWritten += buffer.size();
+
+            // Keep the capacity of the buffer.
+            buffer.resize(0);
+            return true;
+        };
+
+        // Write the headers.
+        buffer.append("State");
+        for (const int column : options.columns)
+        {
+            buffer.append(CSVDocument::separator);
+            appendCsvField(buffer, headerNames.at(column).toUtf8());
+        }
+        buffer.append('\n');
+
+        // Write the actual data.
+        int rowCount = 1;
+        while (true)
+        {
+            if (options.cancellationToken.isCanceled())
+            {
+                return fail(exportCanceledError);
+            }
+
+            const std::expected<bool, QString> hasRow = rows.next();
+            if (!hasRow.has_value())
+            {
+                return fail(hasRow.error());
+            }
+            if (!*hasRow)
+            {
+                break;
+            }
+
+            buffer.append(CSVCombinedDataExport::stateName(rows.state()));
+            for (const int column : options.columns)
+            {
+                buffer.append(CSVDocument::separator);
+                appendCsvField(buffer, rows.cell(column));
+            }
+            buffer.append('\n');
+            rowCount++;
+
+            if (buffer.size() >= csvFlushSize && !flush())
+            {
+                return fail(file.errorString());
+            }
+            if (options.progress && options.progressStep > 0 && rowCount % options.progressStep == 0)
+            {
+                options.progress(rowCount, bytesWritten);
+            }
+        }
+
+        if (!flush() || !file.flush())
+        {
+            return fail(file.errorString());
+        }
+        file.close();
+        if (options.progress)
+        {
+            options.progress(rowCount, bytesWritten);
+        }
+        return {};
+    }
+
+    std::expected<void, QString> CSVCombinedDataExport::toXlsx(const CSVCombinedData& data, const QString& filePath, const CSVCombinedDataExportOptions& options)
+    {
+        CombinedDataRows rows(data);
+        return writeXlsx(data.headerNames(), rows, filePath, options);
+    }
+
+    std::expected<void, QString> CSVCombinedDataExport::toXlsx(const QList<QString>& headerNames, const CSVExportRowSource& source, const QString& filePath, const CSVCombinedDataExportOptions& options)
+    {
+        SourceRows rows(source);
+        return writeXlsx(headerNames, rows, filePath, options);
+    }
+
+    std::expected<void, QString> CSVCombinedDataExport::toCsv(const CSVCombinedData& data, const QString& filePath, const CSVCombinedDataExportOptions& options)
+    {
+        CombinedDataRows rows(data);
+        return writeCsv(data.headerNames(), rows, filePath, options);
+    }
+
+    std::expected<void, QString> CSVCombinedDataExport::toCsv(const QList<QString>& headerNames, const CSVExportRowSource& source, const QString& filePath, const CSVCombinedDataExportOptions& options)
+    {
+        SourceRows rows(source);
+        return writeCsv(headerNames, rows, filePath, options);
+    }
+
+    QByteArrayView CSVCombinedDataExport::stateName(JobTableRowState::State state)
+    {
+        switch (state)
+        {
+        case JobTableRowState::Added:
+            return "Added";
+        case JobTableRowState::Removed:
+            return "Removed";
+        case JobTableRowState::Remained:
+            return "Remained";
+        case JobTableRowState::Modified:
+            return "Modified";
+        default:
+            return "Invalid";
+        }
+    }
+}
@@ -0,0 +1,412 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#include <QHashFunctions>
+#include <QMultiHash>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+
+#include <numeric>
+
+#include "data/csvdiffengine.h"
+#include "data/csvkeyindex.h"
+#include "data/hashing.h"
+#include "trace/tracerecorder.h"
+
+namespace Arrival::App
+{
+    // The cancellation token is polled every this many rows.
+    static constexpr int cancellationCheckMask = 1023;
+
+    // Seed of the hashes of single cells when pairing rows differing in a single cell.
+    static constexpr size_t pairingSeed = 0x27d4eb2f;
+
+    // The key of a row with one column left out. The column is mixed in,
+    // so rows only match if the same column is left out.
+    static quint64 leaveOneOutKey(quint64 rowHash, quint64 cellHash, int column)
+    {
+        return (rowHash - cellHash) ^ (static_cast<quint64>(column + 1) * Hashing::goldenRatio);
+    }
+
+    // Collects the unmatched rows of a document that have a cell for every column.
+    static QList<int> unmatchedRows(const CSVDocument& document, const QList<int>& matches)
+    {
+        QList<int> rows;
+        for (int rowIterator = 0; rowIterator < matches.count(); rowIterator++)
+        {
+            if (matches.at(rowIterator) < 0 && document.fieldCount(rowIterator) == document.columnCount())
+            {
+                rows.append(rowIterator);
+            }
+        }
+        return rows;
+    }
+
+    // Hashes every cell of a row into hashes and returns their sum.
+    static quint64 hashCells(const CSVDocument& document, int row, QList<quint64>& hashes)
+    {
+        quint64 rowHash = 0;
+        for (int columnIterator = 0; columnIterator < hashes.count(); columnIterator++)
+        {
+            hashes[columnIterator] = static_cast<quint64>(qHash(document.cell(row, columnIterator), pairingSeed + static_cast<size_t>(columnIterator)));
+            rowHash += hashes.at(columnIterator);
+        }
+        return rowHash;
+    }
+
+    CSVDiffEngine::CSVDiffEngine(const CSVDocument& firstDocument, const CSVDocument& secondDocument, const QList<int>& keyColumns, int threadCount, const CancellationToken& cancellationToken)
+        : m_keyColumns(keyColumns)
+        , m_threadCount(threadCount > 0 ? threadCount : QThread::idealThreadCount())
+        , m_partitionCount(1)
+        , m_cancellationToken(cancellationToken)
+        , m_first()
+        , m_second()
+        , m_firstToSecond(firstDocument, secondDocument)
+        , m_secondToFirst(secondDocument, firstDocument)
+        , m_maskWordCount(CSVRowComparator::maskWordCount(secondDocument.columnCount()))
+        , m_partitionChanges()
+        , m_changeOffsets()
+        , m_changeMasks()
+    {
+        m_first.document = &firstDocument;
+        m_second.document = &secondDocument;
+
+        // Only spread the work if every thread gets a reasonable amount of rows.
+        const qsizetype totalRowCount = static_cast<qsizetype>(firstDocument.rowCount()) + secondDocument.rowCount();
+        const qsizetype maximumPartitionCount = qMax<qsizetype>(1, totalRowCount / minimumRowsPerPartition);
+        m_partitionCount = static_cast<int>(qMin<qsizetype>(m_threadCount, maximumPartitionCount));
+    }
+
+    bool CSVDiffEngine::run()
+    {
+        ARRIVAL_TRACE_SCOPE("diff.run");
+
+        for (DocumentState* state : { &m_first, &m_second })
+        {
+            const int rowCount = state->document->rowCount();
+            state->matches = QList<int>(rowCount, -1);
+            state->buckets = QList<QList<QList<int>>>(m_partitionCount);
+            if (m_keyColumns.isEmpty())
+            {
+                state->fingerprints.resize(rowCount);
+            }
+            else
+            {
+                state->keys.resize(rowCount);
+            }
+        }
+
+        m_partitionChanges = QList<PartitionChanges>(m_partitionCount);
+        m_changeOffsets.clear();
+        m_changeMasks.clear();
+
+        QList<int> indices(m_partitionCount);
+        std::iota(indices.begin(), indices.end(), 0);
+
+        // Nothing to spread, stay on the calling thread.
+        if (m_partitionCount == 1)
+        {
+            hashChunk(m_first, 0);
+            hashChunk(m_second, 0);
+            classifyPartition(0);
+            mergeChanges();
+            pairChangedRows();
+            return !m_cancellationToken.isCanceled();
+        }
+
+        // A dedicated pool is used, as the calling thread usually is a thread of the global pool itself.
+        QThreadPool pool;
+        pool.setMaxThreadCount(m_threadCount);
+
+        // Hash the rows of both documents chunk by chunk.
+        QtConcurrent::blockingMap(&pool, indices, [this](int chunk) {
+            hashChunk(m_first, chunk);
+            hashChunk(m_second, chunk);
+        });
+
+        // Each partition builds its lookup structures and classifies its own rows.
+        QtConcurrent::blockingMap(&pool, indices, [this](int partition) {
+            classifyPartition(partition);
+        });
+        mergeChanges();
+        pairChangedRows();
+        return !m_cancellationToken.isCanceled();
+    }
+
+    void CSVDiffEngine::hashChunk(DocumentState& state, int chunk) const
+    {
+        ARRIVAL_TRACE_SCOPE("diff.hash");
+
+        const CSVDocument& document = *state.document;
+        const qsizetype rowCount = document.rowCount();
+        const int begin = static_cast<int>(rowCount * chunk / m_partitionCount);
+        const int end = static_cast<int>(rowCount * (chunk + 1) / m_partitionCount);
+
+        QList<QList<int>>& buckets = state.buckets[chunk];
+        buckets.resize(m_partitionCount);
+        for (QList<int>& bucket : buckets)
+        {
+            bucket.reserve((end - begin) / m_partitionCount + 1);
+        }
+
+        for (int rowIterator = begin; rowIterator < end; rowIterator++)
+        {
+            if ((rowIterator & cancellationCheckMask) == 0 && m_cancellationToken.isCanceled())
+            {
+                return;
+            }
+
+            // The high half picks the partition, the low half the slot inside of the partition,
+            // so the rows of a partition still spread over the whole table.
+            size_t partitionHash = 0;
+            if (m_keyColumns.isEmpty())
+            {
+                const RowFingerprint fingerprint = RowFingerprint::fromRow(document, rowIterator);
+                state.fingerprints[rowIterator] = fingerprint;
+                partitionHash = static_cast<size_t>(fingerprint.high);
+            }
+            else
+            {
+                // Malformed rows can not be compared by their key and never match.
+                if (document.fieldCount(rowIterator) != document.columnCount())
+                {
+                    continue;
+                }
+                const CSVKey key = CSVKey::fromRow(document, rowIterator, m_keyColumns);
+                state.keys[rowIterator] = key;
+                partitionHash = static_cast<size_t>(key.high);
+            }
+
+            buckets[static_cast<int>(partitionHash % static_cast<size_t>(m_partitionCount))].append(rowIterator);
+        }
+    }
+
+    QList<int> CSVDiffEngine::partitionRows(const DocumentState& state, int partition) const
+    {
+        qsizetype count = 0;
+        for (const QList<QList<int>>& chunk : state.buckets)
+        {
+            count += chunk.at(partition).count();
+        }
+
+        QList<int> rows;
+        rows.reserve(count);
+        for (const QList<QList<int>>& chunk : state.buckets)
+        {
+            rows.append(chunk.at(partition));
+        }
+        return rows;
+    }
+
+    void CSVDiffEngine::matchPartition(DocumentState& probe, const DocumentState& build, const CSVRowComparator& comparator, int partition) const
+    {
+        ARRIVAL_TRACE_SCOPE("diff.classify");
+
+        const QList<int> probeRows = partitionRows(probe, partition);
+        const QList<int> buildRows = partitionRows(build, partition);
+
+        // Guard.
+        if (m_cancellationToken.isCanceled())
+        {
+            return;
+        }
+
+        // Every row of the partition is written by this partition only.
+        int* matches = probe.matches.data();
+
+        if (m_keyColumns.isEmpty())
+        {
+            const RowFingerprintTable table(*build.document, build.fingerprints, buildRows);
+            for (qsizetype rowIterator = 0; rowIterator < probeRows.count(); rowIterator++)
+            {
+                if ((rowIterator & cancellationCheckMask) == 0 && m_cancellationToken.isCanceled())
+                {
+                    return;
+                }
+                const int row = probeRows.at(rowIterator);
+                matches[row] = table.findRow(comparator, row, probe.fingerprints.at(row));
+            }
+        }
+        else
+        {
+            const CSVKeyIndex index(*build.document, m_keyColumns, build.keys, buildRows);
+            for (qsizetype rowIterator = 0; rowIterator < probeRows.count(); rowIterator++)
+            {
+                if ((rowIterator & cancellationCheckMask) == 0 && m_cancellationToken.isCanceled())
+                {
+                    return;
+                }
+                const int row = probeRows.at(rowIterator);
+                matches[row] = index.findRow(*probe.document, row, probe.keys.at(row));
+            }
+        }
+    }
+
+    void CSVDiffEngine::classifyPartition(int partition)
+    {
+        // Added and remained rows.
+        matchPartition(m_second, m_first, m_firstToSecond, partition);
+
+        // Removed rows.
+        matchPartition(m_first, m_second, m_secondToFirst, partition);
+
+        // Rows matched by their key may still differ in other cells.
+        if (!m_keyColumns.isEmpty())
+        {
+            detectChanges(partition);
+        }
+    }
+
+    void CSVDiffEngine::detectChanges(int partition)
+    {
+        ARRIVAL_TRACE_SCOPE("diff.changes");
+
+        // Guard.
+        if (m_cancellationToken.isCanceled())
+        {
+            return;
+        }
+
+        PartitionChanges& changes = m_partitionChanges[partition];
+        const QList<int> rows = partitionRows(m_second, partition);
+        for (qsizetype rowIterator = 0; rowIterator < rows.count(); rowIterator++)
+        {
+            if ((rowIterator & cancellationCheckMask) == 0 && m_cancellationToken.isCanceled())
+            {
+                return;
+            }
+
+            const int row = rows.at(rowIterator);
+            const int match = m_second.matches.at(row);
+            if (match < 0)
+            {
+                continue;
+            }
+
+            // The mask is written in place and dropped again if nothing changed.
+            const qsizetype offset = changes.masks.count();
+            changes.masks.resize(offset + m_maskWordCount);
+            if (m_firstToSecond.changedColumns(match, row, changes.masks.data() + offset) > 0)
+            {
+                changes.rows.append(row);
+            }
+            else
+            {
+                changes.masks.resize(offset);
+            }
+        }
+    }
+
+    void CSVDiffEngine::mergeChanges()
+    {
+        qsizetype wordCount = 0;
+        for (const PartitionChanges& changes : m_partitionChanges)
+        {
+            wordCount += changes.masks.count();
+        }
+
+        // Guard.
+        if (wordCount == 0)
+        {
+            m_partitionChanges.clear();
+            return;
+        }
+
+        m_changeOffsets = QList<int>(m_second.document->rowCount(), -1);
+        m_changeMasks.reserve(wordCount);
+        for (const PartitionChanges& changes : m_partitionChanges)
+        {
+            const int base = static_cast<int>(m_changeMasks.count());
+            for (qsizetype rowIterator = 0; rowIterator < changes.rows.count(); rowIterator++)
+            {
+                m_changeOffsets[changes.rows.at(rowIterator)] = base + static_cast<int>(rowIterator) * m_maskWordCount;
+            }
+            m_changeMasks.append(changes.masks);
+        }
+        m_partitionChanges.clear();
+    }
+
+    void CSVDiffEngine::pairChangedRows()
+    {
+        // Guard.
+        if (!m_keyColumns.isEmpty() || m_cancellationToken.isCanceled())
+        {
+            return;
+        }
+
+        ARRIVAL_TRACE_SCOPE("diff.pair");
+
+        const int columnCount = m_second.document->columnCount();
+        const QList<int> removedRows = unmatchedRows(*m_first.document, m_first.matches);
+        const QList<int> addedRows = unmatchedRows(*m_second.document, m_second.matches);
+
+        // Guard.
+        if (columnCount < 2 || removedRows.isEmpty() || addedRows.isEmpty() || removedRows.count() * columnCount > maximumPairingCells)
+        {
+            return;
+        }
+
+        // Two rows differing in a single column share the hash of the row without that column.
+        QMultiHash<quint64, int> candidates;
+        candidates.reserve(removedRows.count() * columnCount);
+        QList<quint64> hashes(columnCount);
+        for (qsizetype rowIterator = 0; rowIterator < removedRows.count(); rowIterator++)
+        {
+            if ((rowIterator & cancellationCheckMask) == 0 && m_cancellationToken.isCanceled())
+            {
+                return;
+            }
+
+            const int row = removedRows.at(rowIterator);
+            const quint64 rowHash = hashCells(*m_first.document, row, hashes);
+            for (int columnIterator = 0; columnIterator < columnCount; columnIterator++)
+            {
+                candidates.insert(leaveOneOutKey(rowHash, hashes.at(columnIterator), columnIterator), row);
+            }
+        }
+
+        QList<quint64> mask(m_maskWordCount);
+        for (qsizetype rowIterator = 0; rowIterator < addedRows.count(); rowIterator++)
+        {
+            if ((rowIterator & cancellationCheckMask) == 0 && m_cancellationToken.isCanceled())
+            {
+                return;
+            }
+
+            const int row = addedRows.at(rowIterator);
+            const quint64 rowHash = hashCells(*m_second.document, row, hashes);
+            bool isPaired = false;
+            for (int columnIterator = 0; columnIterator < columnCount && !isPaired; columnIterator++)
+            {
+                auto [candidate, end] = candidates.equal_range(leaveOneOutKey(rowHash, hashes.at(columnIterator), columnIterator));
+                for (; candidate != end && !isPaired; ++candidate)
+                {
+                    const int match = candidate.value();
+                    if (m_first.matches.at(match) >= 0)
+                    {
+                        continue;
+                    }
+
+                    // Hashes may collide, the cells decide.
+                    mask.fill(0);
+                    if (m_firstToSecond.changedColumns(match, row, mask.data()) != 1)
+                    {
+                        continue;
+                    }
+
+                    if (m_changeOffsets.isEmpty())
+                    {
+                        m_changeOffsets = QList<int>(m_second.document->rowCount(), -1);
+                    }
+                    m_first.matches[match] = row;
+                    m_second.matches[row] = match;
+                    m_changeOffsets[row] = static_cast<int>(m_changeMasks.count());
+                    m_changeMasks.append(mask);
+                    isPaired = true;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,633 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#include <QDebug>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+#include "data/csvdocument.h"
+#include "trace/tracerecorder.h"
+
+namespace Arrival::App
+{
+    // Returns the length of the space separator (Unicode category Zs) starting at position, 0 if there is none.
+    static qint64 spaceLengthAt(const char* data, qint64 position, qint64 end)
+    {
+        const auto byte = [&](qint64 offset) { return static_cast<uchar>(data[position + offset]); };
+        const qint64 available = end - position;
+
+        if (available >= 1 && byte(0) == 0x20)
+        {
+            return 1;
+        }
+        if (available >= 2 && byte(0) == 0xc2 && byte(1) == 0xa0)
+        {
+            return 2;
+        }
+        if (available >= 3)
+        {
+            // U+1680, U+2000 to U+200A, U+202F, U+205F and U+3000.
+            if ((byte(0) == 0xe1 && byte(1) == 0x9a && byte(2) == 0x80)
+                || (byte(0) == 0xe2 && byte(1) == 0x80 && (byte(2) <= 0x8a || byte(2) == 0xaf) && byte(2) >= 0x80)
+                || (byte(0) == 0xe2 && byte(1) == 0x81 && byte(2) == 0x9f)
+                || (byte(0) == 0xe3 && byte(1) == 0x80 && byte(2) == 0x80))
+            {
+                return 3;
+            }
+        }
+        return 0;
+    }
+
+    // Returns the length of the space separator ending right before position, 0 if there is none.
+    static qint64 spaceLengthBefore(const char* data, qint64 begin, qint64 position)
+    {
+        for (const qint64 length : { 1, 2, 3 })
+        {
+            if (position - length >= begin && spaceLengthAt(data, position - length, position) == length)
+            {
+                return length;
+            }
+        }
+        return 0;
+    }
+
+    // Removes the spaces and the text delimiters surrounding a field in the same way QtCSV::Reader does.
+    // If nothing but spaces and delimiters is left, the field is kept as it is.
+    static void trimField(const char* data, qint64& begin, qint64& end)
+    {
+        qint64 start = begin;
+        qint64 stop = end;
+        for (qint64 length = 0; start < stop && (length = spaceLengthAt(data, start, stop)) > 0; )
+        {
+            start += length;
+        }
+        for (qint64 length = 0; stop > start && (length = spaceLengthBefore(data, start, stop)) > 0; )
+        {
+            stop -= length;
+        }
+
+        // Guard.
+        if (start >= stop)
+        {
+            return;
+        }
+
+        const bool startsWithDelimiter = data[start] == CSVDocument::textDelimiter;
+        const bool endsWithDelimiter = data[stop - 1] == CSVDocument::textDelimiter;
+        start += startsWithDelimiter ? 1 : 0;
+        stop -= endsWithDelimiter ? 1 : 0;
+
+        if (start < stop)
+        {
+            begin = start;
+            end = stop;
+        }
+    }
+
+    // Replaces every pair of text delimiters with a single one.
+    static QByteArray unescapeDelimiters(QByteArrayView field)
+    {
+        QByteArray result;
+        result.reserve(field.size());
+        for (qsizetype byteIterator = 0; byteIterator < field.size(); byteIterator++)
+        {
+            result.append(field.at(byteIterator));
+            if (field.at(byteIterator) == CSVDocument::textDelimiter
+                && byteIterator + 1 < field.size() && field.at(byteIterator + 1) == CSVDocument::textDelimiter)
+            {
+                byteIterator++;
+            }
+        }
+        return result;
+    }
+
+    // Joins the lines of a field that spans several lines with LF.
+    // Just like QtCSV::Reader, the spaces and text delimiters at the end of every line are removed.
+    static QByteArray joinLines(const char* data, qint64 begin, qint64 end, bool hasTextDelimiter)
+    {
+        QByteArray content;
+        content.reserve(end - begin);
+        for (qint64 lineBegin = begin; ; )
+        {
+            const char* lineBreak = static_cast<const char*>(std::memchr(data + lineBegin, '\n', end - lineBegin));
+            const bool isLastLine = lineBreak == nullptr;
+            qint64 lineEnd = isLastLine ? end : lineBreak - data;
+            if (!isLastLine && lineEnd > lineBegin && data[lineEnd - 1] == '\r')
+            {
+                lineEnd--;
+            }
+
+            qint64 contentBegin = lineBegin;
+            qint64 contentEnd = lineEnd;
+            if (lineBegin == begin)
+            {
+                trimField(data, contentBegin, contentEnd);
+            }
+            else
+            {
+                // The leading line break keeps the start of the line untouched.
+                for (qint64 length = 0; contentEnd > contentBegin && (length = spaceLengthBefore(data, contentBegin, contentEnd)) > 0; )
+                {
+                    contentEnd -= length;
+                }
+                if (contentEnd > contentBegin && data[contentEnd - 1] == CSVDocument::textDelimiter)
+                {
+                    contentEnd--;
+                }
+                content.append('\n');
+            }
+            content.append(data + contentBegin, contentEnd - contentBegin);
+
+            if (isLastLine)
+            {
+                break;
+            }
+            lineBegin = lineBreak - data + 1;
+        }
+
+        return hasTextDelimiter ? unescapeDelimiters(content) : content;
+    }
+
+    CSVDocument::CSVDocument(const QString& path, const CSVDocumentOptions& options)
+        : m_headerNames()
+#if ARRIVAL_CSVDOCUMENT_SUPPORTS_HEADER_INDICES
+        , m_headerIndices()
+#endif
+        , m_file(QSharedPointer<QFile>::create(path))
+        , m_buffer()
+        , m_bytes(nullptr)
+        , m_size(0)
+        , m_storage(CSVDocumentStorage::Mapped)
+        , m_rows()
+        , m_columns()
+        , m_spill()
+        , m_spillPartition(CSVSpill::allPartitions)
+        , m_rowCount(0)
+        , m_columnCount(0)
+    {
+        ARRIVAL_TRACE_SCOPE("csv.load");
+
+        if (!m_file->open(QIODevice::ReadOnly))
+        {
+            qWarning() << "Could not open csv file: " + path;
+            m_file.reset();
+            return;
+        }
+
+        // Map the file, so only the pages that are touched while parsing become resident.
+        // Fall back to reading the file if it can not be mapped, e.g. because it is not a regular file.
+        {
+            ARRIVAL_TRACE_SCOPE("csv.read");
+
+            m_size = m_file->size();
+            if (m_size > 0)
+            {
+                m_bytes = reinterpret_cast<const char*>(m_file->map(0, m_size));
+            }
+            if (m_bytes == nullptr)
+            {
+                m_buffer = m_file->readAll();
+                m_file.reset();
+                m_bytes = m_buffer.constData();
+                m_size = m_buffer.size();
+            }
+        }
+
+        parse(options);
+        if (options.cancellationToken.isCanceled())
+        {
+            m_rows = RowTable();
+            m_rowCount = 0;
+            return;
+        }
+        if (options.storage == CSVDocumentStorage::Columnar)
+        {
+            buildColumns(options);
+        }
+
+        // If no row is present, no data is in the document as a whole.
+        // Escape the funtion early in that case.
+        if (m_headerNames.isEmpty() && m_rowCount <= 0)
+        {
+            qWarning() << "Empty csv file: " + path;
+            return;
+        }
+
+#if ARRIVAL_CSVDOCUMENT_SUPPORTS_HEADER_INDICES
+        // Set up the header indices.
+        m_headerIndices.reserve(m_columnCount);
+        for (int columnIterator = 0; columnIterator < m_headerNames.count(); columnIterator++)
+        {
+            m_headerIndices.insert(m_headerNames.at(columnIterator), columnIterator);
+        }
+#endif
+    }
+
+    CSVDocument::CSVDocument(QSharedPointer<const CSVSpill> spill, int partition)
+        : m_headerNames(spill->headerNames())
+#if ARRIVAL_CSVDOCUMENT_SUPPORTS_HEADER_INDICES
+        , m_headerIndices()
+#endif
+        , m_file()
+        , m_buffer()
+        , m_bytes(nullptr)
+        , m_size(0)
+        , m_storage(CSVDocumentStorage::Spilled)
+        , m_rows()
+        , m_columns()
+        , m_spill(std::move(spill))
+        , m_spillPartition(partition)
+        , m_rowCount(0)
+        , m_columnCount(static_cast<int>(m_headerNames.count()))
+    {
+        // The rows of a partition are found by walking its file once, every other row is located by the directory of the spill.
+        if (m_spillPartition == CSVSpill::allPartitions)
+        {
+            m_rowCount = m_spill->rowCount();
+        }
+        else
+        {
+            m_spill->partitionRows(m_spillPartition, m_rows.rowOffsets);
+            m_rowCount = static_cast<int>(m_rows.rowOffsets.count());
+        }
+
+#if ARRIVAL_CSVDOCUMENT_SUPPORTS_HEADER_INDICES
+        m_headerIndices.reserve(m_columnCount);
+        for (int columnIterator = 0; columnIterator < m_headerNames.count(); columnIterator++)
+        {
+            m_headerIndices.insert(m_headerNames.at(columnIterator), columnIterator);
+        }
+#endif
+    }
+
+    QByteArrayView CSVDocument::elementContent(const char* data, const QtCSV::RawElement& element, QByteArray& buffer)
+    {
+        if (element.hasLineBreak)
+        {
+            buffer = joinLines(data, element.begin, element.end, element.hasTextDelimiter);
+            return buffer;
+        }
+
+        qint64 begin = element.begin;
+        qint64 end = element.end;
+        trimField(data, begin, end);
+        const QByteArrayView content(data + begin, end - begin);
+        if (element.hasTextDelimiter && content.contains("\"\""))
+        {
+            buffer = unescapeDelimiters(content);
+            return buffer;
+        }
+        return content;
+    }
+
+    void CSVDocument::parse(const CSVDocumentOptions& options)
+    {
+        qint64 begin = 0;
+
+        // Skip the byte order mark.
+        if (m_size >= 3 && std::memcmp(m_bytes, "\xef\xbb\xbf", 3) == 0)
+        {
+            begin = 3;
+        }
+
+        // The headers are at the first row.
+        QtCSV::StructuralIndex index(separator, textDelimiter);
+        {
+            ARRIVAL_TRACE_SCOPE("csv.header");
+
+            RowTable header;
+            qint64 headerOffset = begin;
+            begin = index.splitRows(m_bytes, begin, m_size, true, [&](qsizetype rowOffset, const QList<QtCSV::RawElement>& elements)
+            {
+                headerOffset = rowOffset;
+                appendRow(header, rowOffset, elements);
+                return false;
+            });
+
+            m_headerNames.reserve(header.fields.count());
+            for (qsizetype fieldIterator = 0; fieldIterator < header.fields.count(); fieldIterator++)
+            {
+                m_headerNames.append(QString::fromUtf8(field(header, headerOffset, fieldIterator)));
+            }
+            m_columnCount = static_cast<int>(m_headerNames.count());
+        }
+
+        const int threadCount = options.threadCount > 0 ? options.threadCount : QThread::idealThreadCount();
+        const int chunkCount = m_size - begin >= options.parallelParsingThreshold ? qMax(1, threadCount) : 1;
+
+        // Small files are parsed on the calling thread.
+        if (chunkCount == 1)
+        {
+            parseRange(begin, m_size, m_rows, options.cancellationToken);
+            m_rowCount = static_cast<int>(m_rows.rowOffsets.count());
+            return;
+        }
+
+        // A dedicated pool is used, as the calling thread usually is a thread of the global pool itself.
+        QThreadPool pool;
+        pool.setMaxThreadCount(chunkCount);
+
+        // The boundaries of the chunks are guessed by the parity of the text delimiters in front of them,
+        // so fields spanning several lines are not torn apart.
+        QList<qsizetype> boundaries = QtCSV::StructuralIndex::chunkBoundaries(m_bytes + begin, m_size - begin, textDelimiter, chunkCount, &pool);
+        for (qsizetype& boundary : boundaries)
+        {
+            boundary += begin;
+        }
+
+        QList<RowTable> chunks(chunkCount);
+        QList<qint64> chunkEnds(chunkCount);
+        RowTable* chunkRows = chunks.data();
+        qint64* chunkEnd = chunkEnds.data();
+
+        QList<int> indices(chunkCount);
+        std::iota(indices.begin(), indices.end(), 0);
+        QtConcurrent::blockingMap(&pool, indices, [&](int chunk) {
+            chunkEnd[chunk] = parseRange(boundaries.at(chunk), boundaries.at(chunk + 1), chunkRows[chunk], options.cancellationToken);
+        });
+
+        // Canceled chunks end early, they must not be mistaken for wrong guesses.
+        if (options.cancellationToken.isCanceled())
+        {
+            return;
+        }
+
+        // A chunk is only parsed right if the chunk before it ended exactly at its start.
+        // The guess can be wrong for malformed files, parse the rest of the file again from the first chunk that did not.
+        for (int chunkIterator = 0; chunkIterator < chunkCount; chunkIterator++)
+        {
+            appendRows(std::move(chunkRows[chunkIterator]));
+            if (chunkEnd[chunkIterator] != boundaries.at(chunkIterator + 1))
+            {
+                RowTable rest;
+                parseRange(chunkEnd[chunkIterator], m_size, rest, options.cancellationToken);
+                appendRows(std::move(rest));
+                break;
+            }
+        }
+
+        m_rowCount = static_cast<int>(m_rows.rowOffsets.count());
+    }
+
+    qint64 CSVDocument::parseRange(qint64 begin, qint64 end, RowTable& rows, const CancellationToken& cancellationToken) const
+    {
+        ARRIVAL_TRACE_SCOPE("csv.split");
+
+        QtCSV::StructuralIndex index(separator, textDelimiter);
+        return index.splitRows(m_bytes, begin, end, end == m_size, [&](qsizetype rowOffset, const QList<QtCSV::RawElement>& elements)
+        {
+            appendRow(rows, rowOffset, elements);
+            return !cancellationToken.isCanceled();
+        });
+    }
+
+    void CSVDocument::appendRow(RowTable& rows, qint64 rowOffset, const QList<QtCSV::RawElement>& elements) const
+    {
+        for (const QtCSV::RawElement& element : elements)
+        {
+            const qsizetype fieldIndex = rows.fields.count();
+            qint64 begin = element.begin;
+            qint64 end = element.end;
+
+            if (element.hasLineBreak)
+            {
+                const QByteArray content = joinLines(m_bytes, begin, end, element.hasTextDelimiter);
+                rows.fields.append({ 0, static_cast<quint32>(content.size()) | unescapedFlag });
+                rows.unescapedFields.insert(fieldIndex, content);
+                continue;
+            }
+
+            trimField(m_bytes, begin, end);
+            const QByteArrayView content(m_bytes + begin, end - begin);
+
+            const quint64 offset = static_cast<quint64>(begin - rowOffset);
+            const bool needsUnescaping = element.hasTextDelimiter && content.contains("\"\"");
+            if (needsUnescaping || offset > std::numeric_limits<quint32>::max() || static_cast<quint64>(content.size()) >= unescapedFlag)
+            {
+                const QByteArray unescaped = needsUnescaping ? unescapeDelimiters(content) : content.toByteArray();
+                rows.fields.append({ 0, static_cast<quint32>(unescaped.size()) | unescapedFlag });
+                rows.unescapedFields.insert(fieldIndex, unescaped);
+                continue;
+            }
+
+            rows.fields.append({ static_cast<quint32>(offset), static_cast<quint32>(content.size()) });
+        }
+
+        rows.rowOffsets.append(rowOffset);
+        rows.rowFields.append(rows.fields.count());
+    }
+
+    void CSVDocument::appendRows(RowTable&& rows)
+    {
+        // Guard.
+        if (m_rows.rowOffsets.isEmpty())
+        {
+            m_rows = std::move(rows);
+            return;
+        }
+
+        // The field indices of the appended rows continue after the fields of the document.
+        const qsizetype fieldBase = m_rows.fields.count();
+        m_rows.rowOffsets.append(rows.rowOffsets);
+        m_rows.rowFields.reserve(m_rows.rowFields.count() + rows.rowOffsets.count());
+        for (qsizetype rowIterator = 1; rowIterator < rows.rowFields.count(); rowIterator++)
+        {
+            m_rows.rowFields.append(fieldBase + rows.rowFields.at(rowIterator));
+        }
+        m_rows.fields.append(rows.fields);
+        for (auto iterator = rows.unescapedFields.cbegin(); iterator != rows.unescapedFields.cend(); ++iterator)
+        {
+            m_rows.unescapedFields.insert(fieldBase + iterator.key(), iterator.value());
+        }
+    }
+
+    QByteArrayView CSVDocument::field(const RowTable& rows, qint64 rowOffset, qsizetype fieldIndex) const
+    {
+        const FieldSpan& span = rows.fields.at(fieldIndex);
+        if (span.length & unescapedFlag)
+        {
+            const auto iterator = rows.unescapedFields.constFind(fieldIndex);
+            return QByteArrayView(iterator->constData(), iterator->size());
+        }
+        return QByteArrayView(m_bytes + rowOffset + span.offset, span.length);
+    }
+
+    void CSVDocument::buildColumns(const CSVDocumentOptions& options)
+    {
+        ARRIVAL_TRACE_SCOPE("csv.columns");
+
+        // Malformed rows may hold more fields than there are headers, keep them as well.
+        int width = m_columnCount;
+        for (int rowIterator = 0; rowIterator < m_rowCount; rowIterator++)
+        {
+            width = qMax(width, fieldCount(rowIterator));
+        }
+
+        // Only columns with few distinct values compared to their rows are worth a dictionary.
+        int dictionaryLimit = qMin(options.dictionaryLimit, CSVColumn::maximumDictionarySize);
+        if (options.dictionaryRowsPerValue > 0)
+        {
+            dictionaryLimit = qMin(dictionaryLimit, m_rowCount / options.dictionaryRowsPerValue);
+        }
+        QList<CSVColumn> columns(width);
+        CSVColumn* columnData = columns.data();
+
+        // Every column is built on its own, large files spread the columns across threads.
+        const int threadCount = options.threadCount > 0 ? options.threadCount : QThread::idealThreadCount();
+        if (m_size < options.parallelParsingThreshold || threadCount <= 1 || width <= 1)
+        {
+            for (int columnIterator = 0; columnIterator < width && !options.cancellationToken.isCanceled(); columnIterator++)
+            {
+                columnData[columnIterator] = buildColumn(columnIterator, dictionaryLimit);
+            }
+        }
+        else
+        {
+            QThreadPool pool;
+            pool.setMaxThreadCount(threadCount);
+
+            QList<int> indices(width);
+            std::iota(indices.begin(), indices.end(), 0);
+            QtConcurrent::blockingMap(&pool, indices, [&](int column) {
+                if (!options.cancellationToken.isCanceled())
+                {
+                    columnData[column] = buildColumn(column, dictionaryLimit);
+                }
+            });
+        }
+
+        // Some columns are missing, leave the document empty.
+        if (options.cancellationToken.isCanceled())
+        {
+            m_rows = RowTable();
+            m_rowCount = 0;
+            return;
+        }
+
+        m_columns = std::move(columns);
+        m_storage = CSVDocumentStorage::Columnar;
+
+        // Only the amount of fields per row is needed from now on.
+        // The cells no longer point into the file, so it is released as well.
+        m_rows.rowOffsets = QList<qint64>();
+        m_rows.fields = QList<FieldSpan>();
+        m_rows.unescapedFields = QHash<qsizetype, QByteArray>();
+        m_file.reset();
+        m_buffer = QByteArray();
+        m_bytes = nullptr;
+    }
+
+    CSVColumn CSVDocument::buildColumn(int column, int dictionaryLimit) const
+    {
+        // Try a dictionary first and give up as soon as the column holds too many distinct values.
+        // Rows lacking the column get an empty cell in it.
+        if (dictionaryLimit > 0)
+        {
+            QHash<QByteArray, quint16> dictionary;
+            QList<QByteArrayView> values;
+            QList<quint16> codes;
+            codes.reserve(m_rowCount);
+
+            bool isLowCardinality = true;
+            for (int rowIterator = 0; rowIterator < m_rowCount; rowIterator++)
+            {
+                const QByteArrayView value = cell(rowIterator, column);
+                const QByteArray key = QByteArray::fromRawData(value.data(), value.size());
+
+                auto iterator = dictionary.constFind(key);
+                if (iterator == dictionary.constEnd())
+                {
+                    if (values.count() >= dictionaryLimit)
+                    {
+                        isLowCardinality = false;
+                        break;
+                    }
+                    iterator = dictionary.insert(key, static_cast<quint16>(values.count()));
+                    values.append(value);
+                }
+                codes.append(*iterator);
+            }
+
+            if (isLowCardinality)
+            {
+                return CSVColumn::fromDictionary(values, std::move(codes));
+            }
+        }
+
+        // Measure the column first, so the arena is allocated once.
+        qsizetype byteCount = 0;
+        for (int rowIterator = 0; rowIterator < m_rowCount; rowIterator++)
+        {
+            byteCount += cell(rowIterator, column).size();
+        }
+
+        CSVColumn result;
+        result.reserve(m_rowCount, byteCount);
+        for (int rowIterator = 0; rowIterator < m_rowCount; rowIterator++)
+        {
+            result.append(cell(rowIterator, column));
+        }
+        return result;
+    }
+
+    QByteArrayView CSVDocument::cell(int row, int column) const
+    {
+        // Guard.
+        if (row < 0 || row >= m_rowCount || column < 0 || column >= fieldCount(row))
+        {
+            return QByteArrayView();
+        }
+        if (m_storage == CSVDocumentStorage::Columnar)
+        {
+            return m_columns.at(column).at(row);
+        }
+        if (m_storage == CSVDocumentStorage::Spilled)
+        {
+            return m_spill->cell(spillLocation(row), column);
+        }
+        return field(m_rows, m_rows.rowOffsets.at(row), m_rows.rowFields.at(row) + column);
+    }
+
+    CSVColumnView CSVDocument::column(int column) const
+    {
+        const bool hasArena = m_storage == CSVDocumentStorage::Columnar && column >= 0 && column < m_columns.count();
+        return CSVColumnView(*this, column, hasArena ? &m_columns.at(column) : nullptr);
+    }
+
+    QList<QString> CSVDocument::row(int row) const
+    {
+        const int count = fieldCount(row);
+
+        QList<QString> result;
+        result.reserve(count);
+        for (int columnIterator = 0; columnIterator < count; columnIterator++)
+        {
+            result.append(at(row, columnIterator));
+        }
+        return result;
+    }
+
+    bool CSVDocument::rowEquals(int row, const CSVDocument& other, int otherRow) const
+    {
+        const int count = fieldCount(row);
+        if (count != other.fieldCount(otherRow))
+        {
+            return false;
+        }
+
+        for (int columnIterator = 0; columnIterator < count; columnIterator++)
+        {
+            if (cell(row, columnIterator) != other.cell(otherRow, columnIterator))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
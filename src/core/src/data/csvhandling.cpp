@@ -0,0 +1,688 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+#include <QDebug>
+
+#include <utility>
+#include <algorithm>
+#include <numeric>
+
+#include "data/csvdiffengine.h"
+#include "data/csvhandling.h"
+#include "data/csvspill.h"
+#include "trace/tracerecorder.h"
+
+#ifdef QT_DEBUG
+#define ARRIVAL_DEBUG 1
+#endif
+
+namespace Arrival::App
+{
+    // A pair of partitions needs about this many times its spilled size while it is compared:
+    // the touched pages of both files, the keys, the lookup table and the matches.
+    static constexpr qint64 partitionMemoryFactor = 3;
+
+    QDebug operator<<(QDebug debug, const CSVCombineTimings& timings)
+    {
+        QDebugStateSaver saver(debug);
+        debug.nospace() << "CSVCombineTimings(first document: " << timings.firstDocumentLoadTime << " ms"
+                        << ", second document: " << timings.secondDocumentLoadTime << " ms"
+                        << ", load: " << timings.loadTime << " ms"
+                        << ", diff: " << timings.diffTime << " ms"
+                        << ", stream: " << timings.streamTime << " ms)";
+        return debug;
+    }
+
+    // The Jobnumber matcher is checked at compile time.
+    static_assert(CSVCombinedData::isJobNumber(QStringView(u"123456789CL")));
+    static_assert(CSVCombinedData::isJobNumber(QStringView(u"123456789CL 987654321CL")));
+    static_assert(!CSVCombinedData::isJobNumber(QStringView(u"12345678CL")));
+    static_assert(!CSVCombinedData::isJobNumber(QStringView(u"12345678xCL")));
+    static_assert(!CSVCombinedData::isJobNumber(QStringView(u"123456789CX")));
+    static_assert(!CSVCombinedData::isJobNumber(QStringView(u"/23456789CL")));
+    static_assert(CSVCombinedData::isJobNumber(QByteArrayView("123456789CL")));
+    static_assert(!CSVCombinedData::isJobNumber(QByteArrayView("123456789cl")));
+
+    CSVKeyDetection CSVCombinedData::detectJobNumberColumn(const CSVDocument& document, int sampleRowCount)
+    {
+        ARRIVAL_TRACE_SCOPE("csv.detectKey");
+
+        // The sampled rows are spread evenly across the document, all rows are sampled if there are fewer.
+        const int rowCount = document.rowCount();
+        const int sampledRowCount = qMin(rowCount, qMax(1, sampleRowCount));
+        QList<int> matchedRowCounts(document.columnCount(), 0);
+        for (int sampleIterator = 0; sampleIterator < sampledRowCount; sampleIterator++)
+        {
+            const int row = static_cast<int>(static_cast<qint64>(sampleIterator) * rowCount / sampledRowCount);
+            const int fieldCount = qMin(document.fieldCount(row), static_cast<int>(matchedRowCounts.count()));
+            for (int columnIterator = 0; columnIterator < fieldCount; columnIterator++)
+            {
+                matchedRowCounts[columnIterator] += isJobNumber(document.cell(row, columnIterator)) ? 1 : 0;
+            }
+        }
+        return voteJobNumberColumn(matchedRowCounts, sampledRowCount);
+    }
+
+    CSVKeyDetection CSVCombinedData::detectJobNumberColumn(const QList<QList<QString>>& rows)
+    {
+        QList<int> matchedRowCounts;
+        for (const QList<QString>& row : rows)
+        {
+            if (matchedRowCounts.count() < row.count())
+            {
+                matchedRowCounts.resize(row.count(), 0);
+            }
+            for (int columnIterator = 0; columnIterator < row.count(); columnIterator++)
+            {
+                matchedRowCounts[columnIterator] += isJobNumber(row.at(columnIterator)) ? 1 : 0;
+            }
+        }
+        return voteJobNumberColumn(matchedRowCounts, static_cast<int>(rows.count()));
+    }
+
+    CSVKeyDetection CSVCombinedData::voteJobNumberColumn(const QList<int>& matchedRowCounts, int sampledRowCount)
+    {
+        CSVKeyDetection detection;
+        detection.sampledRowCount = sampledRowCount;
+
+        // Find the columns with the most and the second most votes.
+        int bestColumn = -1;
+        for (int columnIterator = 0; columnIterator < matchedRowCounts.count(); columnIterator++)
+        {
+            const int matchedRowCount = matchedRowCounts.at(columnIterator);
+            if (bestColumn < 0 || matchedRowCount > detection.matchedRowCount)
+            {
+                detection.runnerUpMatchedRowCount = bestColumn < 0 ? 0 : detection.matchedRowCount;
+                detection.matchedRowCount = matchedRowCount;
+                bestColumn = columnIterator;
+            }
+            else if (matchedRowCount > detection.runnerUpMatchedRowCount)
+            {
+                detection.runnerUpMatchedRowCount = matchedRowCount;
+            }
+        }
+
+        // Two columns holding Jobnumbers equally often can not be told apart, the confidence is 0 then.
+        if (detection.matchedRowCount > 0 && detection.confidence() >= minimumJobNumberConfidence)
+        {
+            detection.column = bestColumn;
+        }
+        return detection;
+    }
+
+    int CSVCombinedData::findSingleJobNumberColumnIndex(const CSVDocument& document)
+    {
+        return detectJobNumberColumn(document).column;
+    }
+
+    int CSVCombinedData::findSingleJobNumberColumnIndex(const QList<QString>& row)
+    {
+        return detectJobNumberColumn(QList<QList<QString>>{ row }).column;
+    }
+
+    CSVKeyDetection CSVCombinedData::detectedKey(const CSVKeyDetection& firstDetection, const CSVKeyDetection& secondDetection, const QList<int>& keyColumns, const CSVCombineOptions& options)
+    {
+        // Key columns chosen by the caller have not been detected.
+        const bool isChosen = !options.keyColumnNames.isEmpty() || !options.keyColumnIndices.isEmpty() || options.keyColumnIndex >= 0;
+        if (isChosen || keyColumns.count() != 1 || keyColumns.first() != firstDetection.column || firstDetection.column != secondDetection.column)
+        {
+            return CSVKeyDetection();
+        }
+        return firstDetection.confidence() <= secondDetection.confidence() ? firstDetection : secondDetection;
+    }
+
+    std::expected<QList<int>, CSVCombinedData::CombineCSVDocumentsError> CSVCombinedData::resolveKeyColumns(const QList<QString>& headerNames, int firstDocumentJobNumberIndex, int secondDocumentJobNumberIndex, const CSVCombineOptions& options)
+    {
+        // If no job number has been found inside the document a hashing method is used to compare the
+        // rows inside the documents.
+        // Hashing each row of the documents takes longer and might result in ugly program outputs
+        // because one change in a row result in the program trating the entire row as new added/removed.
+        const bool useFallbackHashing = (firstDocumentJobNumberIndex == -1 || secondDocumentJobNumberIndex == -1 || firstDocumentJobNumberIndex != secondDocumentJobNumberIndex);
+
+        // Key columns chosen by the caller override the detected one.
+        QList<int> keyColumns;
+        if (!useFallbackHashing)
+        {
+            keyColumns.append(firstDocumentJobNumberIndex);
+        }
+        if (!options.keyColumnNames.isEmpty())
+        {
+            keyColumns.clear();
+            for (const QString& keyColumnName : options.keyColumnNames)
+            {
+                const int keyColumnIndex = static_cast<int>(headerNames.indexOf(keyColumnName));
+                if (keyColumnIndex < 0)
+                {
+                    return std::unexpected<CSVCombinedData::CombineCSVDocumentsError>(CSVCombinedData::CombineCSVDocumentsError::InvalidKeyColumn);
+                }
+                keyColumns.append(keyColumnIndex);
+            }
+        }
+        else if (!options.keyColumnIndices.isEmpty() || options.keyColumnIndex >= 0)
+        {
+            keyColumns = options.keyColumnIndices.isEmpty() ? QList<int>{ options.keyColumnIndex } : options.keyColumnIndices;
+            for (const int keyColumnIndex : keyColumns)
+            {
+                if (keyColumnIndex < 0 || keyColumnIndex >= headerNames.count())
+                {
+                    return std::unexpected<CSVCombinedData::CombineCSVDocumentsError>(CSVCombinedData::CombineCSVDocumentsError::InvalidKeyColumn);
+                }
+            }
+        }
+        else if (options.keyColumnIndex == CSVCombineOptions::noKeyColumn)
+        {
+            keyColumns.clear();
+        }
+        return keyColumns;
+    }
+
+    QString CSVCombinedData::computeFormatIdentifier(const QList<QString>& headerNames)
+    {
+        if (headerNames.empty())
+        {
+            return QString();
+        }
+
+        QString concatenatedString = headerNames.join("");
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+        hash.addData(concatenatedString.toUtf8());
+        QByteArray hashData = hash.result();
+        QString uniqueHash = QString(hashData.toHex());
+        return uniqueHash;
+    }
+
+    // Collects the rows streamed by streamCSVCombinedData into a single table.
+    std::expected<QSharedPointer<CSVCombinedData>, CSVCombinedData::CombineCSVDocumentsError> CSVCombinedData::getCSVCombinedData(QSharedPointer<const CSVDocument> firstDocument, QSharedPointer<const CSVDocument> secondDocument, const CSVCombineOptions& options)
+    {
+#if ARRIVAL_DEBUG
+        QElapsedTimer timer;
+        timer.start();
+#endif
+
+        // Collect the streamed rows. Everything happens on this thread, so the data can be filled directly.
+        QSharedPointer<CSVCombinedData> result;
+        CSVCombinedDataStream stream;
+        stream.started = [&result](QSharedPointer<CSVCombinedData> data) {
+            result = std::move(data);
+        };
+        stream.rowsReady = [&result](QList<JobTableRow> rows) {
+            result->appendRows(rows);
+        };
+
+        const std::expected<void, CSVCombinedData::CombineCSVDocumentsError> streamed = streamCSVCombinedData(std::move(firstDocument), std::move(secondDocument), options, stream);
+        if (!streamed.has_value())
+        {
+            return std::unexpected<CSVCombinedData::CombineCSVDocumentsError>(streamed.error());
+        }
+
+#if ARRIVAL_DEBUG
+        qDebug() << "getCSVCombinedData() took " << timer.elapsed() << "milliseconds to execute";
+#endif
+
+        return result;
+    }
+
+    // This function takes in tow CSVDocuments and combines them.
+    // It filters which rows have been added, removed and which stayed the same.
+    // It tries to find a Jobnumber inside the files and then compares the rows based on their Jobnumber.
+    // If no Jobnumber is found in one of the files or the column index of these Jobnumbers is different
+    // in these two files, a different comparison method is used.
+    // This method fingerprints the entire row and compares the fingerprints.
+    // This means that a single change in the row would lead to a the recognition of removed/added,
+    // unless the removed and the added row only differ in a single cell, they are paired as modified then.
+    //
+    // The Jobnumber column is voted for by rows sampled across each file, see detectJobNumberColumn.
+    // A cell holding two Jobnumbers counts for its column. Two columns holding Jobnumbers about equally often can not be told apart,
+    // the rows are matched by their whole content then.
+    std::expected<void, CSVCombinedData::CombineCSVDocumentsError> CSVCombinedData::streamCSVCombinedData(QSharedPointer<const CSVDocument> firstDocument, QSharedPointer<const CSVDocument> secondDocument, const CSVCombineOptions& options, const CSVCombinedDataStream& stream, CSVCombineTimings* timings)
+    {
+        Q_ASSERT(!firstDocument.isNull() && !secondDocument.isNull());
+
+        const CSVKeyDetection firstDetection = detectJobNumberColumn(*firstDocument);
+        const CSVKeyDetection secondDetection = detectJobNumberColumn(*secondDocument);
+        return streamDocuments(std::move(firstDocument), std::move(secondDocument), firstDetection, secondDetection, options, stream, timings);
+    }
+
+    std::expected<void, CSVCombinedData::CombineCSVDocumentsError> CSVCombinedData::streamCSVFiles(const QString& firstFilePath, const QString& secondFilePath, const CSVDocumentOptions& documentOptions, const CSVCombineOptions& options, const CSVCombinedDataStream& stream, CSVCombineTimings* timings)
+    {
+        ARRIVAL_TRACE_SCOPE("compare");
+
+        // A document and its Jobnumber column.
+        struct LoadedDocument
+        {
+            QSharedPointer<const CSVDocument> document;
+            CSVKeyDetection detection;
+            qint64 loadTime;
+        };
+
+        // Both files share the threads, so loading them at once does not oversubscribe the machine.
+        CSVDocumentOptions sharedOptions = documentOptions;
+        sharedOptions.cancellationToken = options.cancellationToken;
+        const int threadCount = documentOptions.threadCount > 0 ? documentOptions.threadCount : QThread::idealThreadCount();
+        sharedOptions.threadCount = qMax(1, threadCount / 2);
+
+        const auto load = [&sharedOptions](const QString& filePath) {
+            QElapsedTimer timer;
+            timer.start();
+            QSharedPointer<const CSVDocument> document = QSharedPointer<const CSVDocument>::create(filePath, sharedOptions);
+            const CSVKeyDetection detection = detectJobNumberColumn(*document);
+            return LoadedDocument{ std::move(document), detection, timer.elapsed() };
+        };
+
+        QElapsedTimer timer;
+        timer.start();
+
+        // The first file is loaded by a dedicated pool, as the calling thread usually is a thread of the global pool itself.
+        // The second file is loaded on the calling thread meanwhile.
+        QThreadPool pool;
+        pool.setMaxThreadCount(1);
+        QFuture<LoadedDocument> firstFuture = QtConcurrent::run(&pool, load, firstFilePath);
+        LoadedDocument second = load(secondFilePath);
+        LoadedDocument first = firstFuture.result();
+        if (options.cancellationToken.isCanceled())
+        {
+            return std::unexpected<CSVCombinedData::CombineCSVDocumentsError>(CSVCombinedData::CombineCSVDocumentsError::Canceled);
+        }
+
+        if (timings)
+        {
+            timings->firstDocumentLoadTime = first.loadTime;
+            timings->secondDocumentLoadTime = second.loadTime;
+            timings->loadTime = timer.elapsed();
+        }
+        return streamDocuments(std::move(first.document), std::move(second.document), first.detection, second.detection, options, stream, timings);
+    }
+
+    std::expected<void, CSVCombinedData::CombineCSVDocumentsError> CSVCombinedData::streamDocuments(QSharedPointer<const CSVDocument> firstDocumentPointer, QSharedPointer<const CSVDocument> secondDocumentPointer, const CSVKeyDetection& firstDetection, const CSVKeyDetection& secondDetection, const CSVCombineOptions& options, const CSVCombinedDataStream& stream, CSVCombineTimings* timings)
+    {
+        Q_ASSERT(!firstDocumentPointer.isNull() && !secondDocumentPointer.isNull());
+
+        const CSVDocument& firstDocument = *firstDocumentPointer;
+        const CSVDocument& secondDocument = *secondDocumentPointer;
+
+        // Two empty documents are not going to be compared.
+        if (firstDocument.isEmpty() && secondDocument.isEmpty())
+        {
+            return std::unexpected<CSVCombinedData::CombineCSVDocumentsError>(CSVCombinedData::CombineCSVDocumentsError::BothEmpty);
+        }
+
+        // The two documents do not have the same amount of columns.
+        // As they are not the same format, they cannot be compared.
+        if (firstDocument.columnCount() != secondDocument.columnCount())
+        {
+            return std::unexpected<CSVCombinedData::CombineCSVDocumentsError>(CSVCombinedData::CombineCSVDocumentsError::DifferentFormat);
+        }
+
+        const std::expected<QList<int>, CombineCSVDocumentsError> resolvedKeyColumns = resolveKeyColumns(secondDocument.headersNames(), firstDetection.column, secondDetection.column, options);
+        if (!resolvedKeyColumns.has_value())
+        {
+            return std::unexpected<CSVCombinedData::CombineCSVDocumentsError>(resolvedKeyColumns.error());
+        }
+        const QList<int>& keyColumns = *resolvedKeyColumns;
+
+        // Match the rows of both documents.
+        // The key space is partitioned across the worker threads, each partition classifies its own rows.
+        QElapsedTimer timer;
+        timer.start();
+        CSVDiffEngine engine(firstDocument, secondDocument, keyColumns, options.threadCount, options.cancellationToken);
+        if (!engine.run())
+        {
+            return std::unexpected<CSVCombinedData::CombineCSVDocumentsError>(CSVCombinedData::CombineCSVDocumentsError::Canceled);
+        }
+        if (timings)
+        {
+            timings->diffTime = timer.restart();
+        }
+
+        // Hand out the data before any row, so the headers can be shown right away.
+        // Rows only reference their document, the cells are resolved on demand.
+        QSharedPointer<CSVCombinedData> result = QSharedPointer<CSVCombinedData>::create();
+        result->m_formatIdentifier = computeFormatIdentifier(secondDocument.headersNames());
+        result->m_headerNames = secondDocument.headersNames();
+#if ARRIVAL_CSVDOCUMENT_SUPPORTS_HEADER_INDICES
+        result->m_headerIndices = secondDocument.headerIndices();
+#endif
+        result->m_firstDocument = std::move(firstDocumentPointer);
+        result->m_secondDocument = std::move(secondDocumentPointer);
+        result->m_keyColumns = keyColumns;
+        result->m_keyDetection = detectedKey(firstDetection, secondDetection, keyColumns, options);
+        result->m_changeMasks = engine.changeMasks();
+        result->m_changeMaskWordCount = CSVRowComparator::maskWordCount(secondDocument.columnCount());
+
+        const std::expected<void, CSVCombinedData::CombineCSVDocumentsError> streamed = streamRows(std::move(result), engine.firstDocumentMatches(), engine.secondDocumentMatches(), engine.changeOffsets(), options, stream);
+        if (timings)
+        {
+            timings->streamTime = timer.elapsed();
+        }
+        return streamed;
+    }
+
+    std::expected<void, CSVCombinedData::CombineCSVDocumentsError> CSVCombinedData::streamSpilledCSVFiles(const QString& firstFilePath, const QString& secondFilePath, const CSVSpillOptions& spillOptions, const CSVCombineOptions& options, const CSVCombinedDataStream& stream, CSVCombineTimings* timings)
+    {
+        ARRIVAL_TRACE_SCOPE("compare");
+
+        QElapsedTimer timer;
+        timer.start();
+
+        // The key has to be known before the first row is spilled, so it is found from the headers and the first rows alone.
+        const std::expected<QList<QList<QString>>, QString> firstRows = CSVSpill::readFirstRows(firstFilePath, 1 + jobNumberSampleRowCount);
+        const std::expected<QList<QList<QString>>, QString> secondRows = CSVSpill::readFirstRows(secondFilePath, 1 + jobNumberSampleRowCount);
+        if (!firstRows.has_value() || !secondRows.has_value())
+        {
+            qWarning() << "Could not read csv file:" << (firstRows.has_value() ? secondRows.error() : firstRows.error());
+            return std::unexpected<CSVCombinedData::CombineCSVDocumentsError>(CSVCombinedData::CombineCSVDocumentsError::ReadError);
+        }
+        const QList<QString> headerNames = secondRows->value(0);
+        if (firstRows->value(0).isEmpty() && headerNames.isEmpty())
+        {
+            return std::unexpected<CSVCombinedData::CombineCSVDocumentsError>(CSVCombinedData::CombineCSVDocumentsError::BothEmpty);
+        }
+        if (firstRows->value(0).count() != headerNames.count())
+        {
+            return std::unexpected<CSVCombinedData::CombineCSVDocumentsError>(CSVCombinedData::CombineCSVDocumentsError::DifferentFormat);
+        }
+
+        const CSVKeyDetection firstDetection = detectJobNumberColumn(firstRows->mid(1));
+        const CSVKeyDetection secondDetection = detectJobNumberColumn(secondRows->mid(1));
+        const std::expected<QList<int>, CombineCSVDocumentsError> resolvedKeyColumns = resolveKeyColumns(headerNames, firstDetection.column, secondDetection.column, options);
+        if (!resolvedKeyColumns.has_value())
+        {
+            return std::unexpected<CSVCombinedData::CombineCSVDocumentsError>(resolvedKeyColumns.error());
+        }
+
+        // Only rows with the same key are spilled to the same partition. Rows matched by their whole content could end up anywhere.
+        if (resolvedKeyColumns->isEmpty())
+        {
+            return std::unexpected<CSVCombinedData::CombineCSVDocumentsError>(CSVCombinedData::CombineCSVDocumentsError::InvalidKeyColumn);
+        }
+        const QList<int>& keyColumns = *resolvedKeyColumns;
+
+        // Enough partitions are spilled so every thread can compare one within the budget.
+        const int threadCount = options.threadCount > 0 ? options.threadCount : QThread::idealThreadCount();
+        const qint64 memoryBudget = qMax<qint64>(1, spillOptions.memoryBudget);
+        int partitionCount = spillOptions.partitionCount;
+        if (partitionCount < 1)
+        {
+            const qint64 inputSize = QFileInfo(firstFilePath).size() + QFileInfo(secondFilePath).size();
+            partitionCount = static_cast<int>(qMin<qint64>(CSVSpill::maximumPartitionCount, inputSize * partitionMemoryFactor * threadCount / memoryBudget + 1));
+        }
+        const QString directory = spillOptions.directory.isEmpty() ? QDir::tempPath() : spillOptions.directory;
+
+        // A spilled file, or the reason it could not be spilled.
+        struct SpilledFile
+        {
+            QSharedPointer<const CSVSpill> spill;
+            QString error;
+            qint64 spillTime;
+        };
+
+        const auto spillFile = [&](const QString& filePath) {
+            QElapsedTimer spillTimer;
+            spillTimer.start();
+            std::expected<QSharedPointer<const CSVSpill>, QString> spill = CSVSpill::create(filePath, directory, keyColumns, partitionCount, options.cancellationToken);
+            return spill.has_value() ? SpilledFile{ std::move(*spill), QString(), spillTimer.elapsed() } : SpilledFile{ nullptr, spill.error(), spillTimer.elapsed() };
+        };
+
+        // Both files are spilled at once, the first one by a dedicated pool and the second one on the calling thread.
+        QThreadPool pool;
+        pool.setMaxThreadCount(1);
+        QFuture<SpilledFile> firstFuture = QtConcurrent::run(&pool, spillFile, firstFilePath);
+        const SpilledFile second = spillFile(secondFilePath);
+        const SpilledFile first = firstFuture.result();
+        if (options.cancellationToken.isCanceled())
+        {
+            return std::unexpected<CSVCombinedData::CombineCSVDocumentsError>(CSVCombinedData::CombineCSVDocumentsError::Canceled);
+        }
+        if (first.spill.isNull() || second.spill.isNull())
+        {
+            qWarning() << "Could not spill csv file:" << (first.spill.isNull() ? first.error : second.error);
+            return std::unexpected<CSVCombinedData::CombineCSVDocumentsError>(CSVCombinedData::CombineCSVDocumentsError::SpillError);
+        }
+        if (timings)
+        {
+            timings->firstDocumentLoadTime = first.spillTime;
+            timings->secondDocumentLoadTime = second.spillTime;
+            timings->loadTime = timer.restart();
+        }
+
+        // The partitions write the matches of their rows straight into the tables of the files, no two partitions share a row.
+        const CSVSpill& firstSpill = *first.spill;
+        const CSVSpill& secondSpill = *second.spill;
+        QList<int> firstDocumentMatches(firstSpill.rowCount(), -1);
+        QList<int> secondDocumentMatches(secondSpill.rowCount(), -1);
+        QList<int> changeOffsets(secondSpill.rowCount(), -1);
+        int* firstDocumentMatch = firstDocumentMatches.data();
+        int* secondDocumentMatch = secondDocumentMatches.data();
+        int* changeOffset = changeOffsets.data();
+
+        // The modified rows of a partition, by their row in the second file, and their changed columns.
+        struct PartitionChanges
+        {
+            QList<int> rows;
+            QList<quint64> masks;
+        };
+        QList<PartitionChanges> partitionChanges(partitionCount);
+        PartitionChanges* changes = partitionChanges.data();
+
+        // As many partitions are compared at once as the budget allows for the largest of them.
+        qint64 largestPartitionSize = 1;
+        for (int partitionIterator = 0; partitionIterator < partitionCount; partitionIterator++)
+        {
+            largestPartitionSize = qMax(largestPartitionSize, (firstSpill.partitionSize(partitionIterator) + secondSpill.partitionSize(partitionIterator)) * partitionMemoryFactor);
+        }
+        QThreadPool diffPool;
+        diffPool.setMaxThreadCount(static_cast<int>(qBound<qint64>(1, memoryBudget / largestPartitionSize, threadCount)));
+
+        QList<int> partitions(partitionCount);
+        std::iota(partitions.begin(), partitions.end(), 0);
+        QtConcurrent::blockingMap(&diffPool, partitions, [&](int partition) {
+            ARRIVAL_TRACE_SCOPE("diff.partition");
+
+            // Guard.
+            if (options.cancellationToken.isCanceled())
+            {
+                return;
+            }
+
+            const CSVDocument firstPartition(first.spill, partition);
+            const CSVDocument secondPartition(second.spill, partition);
+            CSVDiffEngine engine(firstPartition, secondPartition, keyColumns, 1, options.cancellationToken);
+            if (!engine.run())
+            {
+                return;
+            }
+
+            // Translate the rows of the partition back to the rows of the files.
+            QList<qint64> locations;
+            QList<int> firstSourceRows;
+            QList<int> secondSourceRows;
+            firstSpill.partitionRows(partition, locations, &firstSourceRows);
+            secondSpill.partitionRows(partition, locations, &secondSourceRows);
+
+            const QList<int>& firstMatches = engine.firstDocumentMatches();
+            for (qsizetype rowIterator = 0; rowIterator < firstMatches.count(); rowIterator++)
+            {
+                const int match = firstMatches.at(rowIterator);
+                firstDocumentMatch[firstSourceRows.at(rowIterator)] = match < 0 ? -1 : secondSourceRows.at(match);
+            }
+            const QList<int>& secondMatches = engine.secondDocumentMatches();
+            const QList<int>& offsets = engine.changeOffsets();
+            for (qsizetype rowIterator = 0; rowIterator < secondMatches.count(); rowIterator++)
+            {
+                const int match = secondMatches.at(rowIterator);
+                const int sourceRow = secondSourceRows.at(rowIterator);
+                secondDocumentMatch[sourceRow] = match < 0 ? -1 : firstSourceRows.at(match);
+                if (!offsets.isEmpty() && offsets.at(rowIterator) >= 0)
+                {
+                    changeOffset[sourceRow] = offsets.at(rowIterator);
+                    changes[partition].rows.append(sourceRow);
+                }
+            }
+            changes[partition].masks = engine.changeMasks();
+        });
+        if (options.cancellationToken.isCanceled())
+        {
+            return std::unexpected<CSVCombinedData::CombineCSVDocumentsError>(CSVCombinedData::CombineCSVDocumentsError::Canceled);
+        }
+
+        // The changed columns of all partitions are joined, the offsets of a partition move behind the masks of the partitions before it.
+        QList<quint64> changeMasks;
+        for (const PartitionChanges& partition : partitionChanges)
+        {
+            const int maskOffset = static_cast<int>(changeMasks.count());
+            for (const int row : partition.rows)
+            {
+                changeOffset[row] += maskOffset;
+            }
+            changeMasks.append(partition.masks);
+        }
+        if (timings)
+        {
+            timings->diffTime = timer.restart();
+        }
+
+        // The documents read the spilled rows in the order of the files.
+        QSharedPointer<CSVCombinedData> result = QSharedPointer<CSVCombinedData>::create();
+        result->m_formatIdentifier = computeFormatIdentifier(headerNames);
+        result->m_headerNames = headerNames;
+        result->m_firstDocument = QSharedPointer<const CSVDocument>::create(first.spill);
+        result->m_secondDocument = QSharedPointer<const CSVDocument>::create(second.spill);
+#if ARRIVAL_CSVDOCUMENT_SUPPORTS_HEADER_INDICES
+        result->m_headerIndices = result->m_secondDocument->headerIndices();
+#endif
+        result->m_keyColumns = keyColumns;
+        result->m_keyDetection = detectedKey(firstDetection, secondDetection, keyColumns, options);
+        result->m_changeMasks = std::move(changeMasks);
+        result->m_changeMaskWordCount = CSVRowComparator::maskWordCount(static_cast<int>(headerNames.count()));
+
+        const std::expected<void, CSVCombinedData::CombineCSVDocumentsError> streamed = streamRows(std::move(result), firstDocumentMatches, secondDocumentMatches, changeOffsets, options, stream);
+        if (timings)
+        {
+            timings->streamTime = timer.elapsed();
+        }
+        return streamed;
+    }
+
+    std::expected<void, CSVCombinedData::CombineCSVDocumentsError> CSVCombinedData::streamRows(QSharedPointer<CSVCombinedData> result, const QList<int>& firstDocumentMatches, const QList<int>& secondDocumentMatches, const QList<int>& changeOffsets, const CSVCombineOptions& options, const CSVCombinedDataStream& stream)
+    {
+        const int firstDocumentRowCount = static_cast<int>(firstDocumentMatches.count());
+        const int secondDocumentRowCount = static_cast<int>(secondDocumentMatches.count());
+        const int removedCount = static_cast<int>(std::count(firstDocumentMatches.cbegin(), firstDocumentMatches.cend(), -1));
+
+        result->m_rows.reserve(secondDocumentRowCount + removedCount);
+        if (stream.started)
+        {
+            stream.started(result);
+        }
+
+        // The rows are handed out in batches that double in size, so the first rows arrive quickly
+        // and the later rows do not cost a hand over each.
+        int batchSize = firstRowBatchSize;
+        QList<JobTableRow> batch;
+        batch.reserve(batchSize);
+        const auto appendRow = [&](int row, JobTableRowState::State state, JobTableRow::Document document, int matchedRow = -1, int changes = -1) {
+            batch.append(JobTableRow{ row, state, document, matchedRow, changes });
+            if (batch.count() >= batchSize)
+            {
+                // Once canceled, the remaining rows are dropped.
+                if (stream.rowsReady && !options.cancellationToken.isCanceled())
+                {
+                    stream.rowsReady(std::move(batch));
+                }
+                batchSize = qMin(batchSize * 2, maximumRowBatchSize);
+                batch = QList<JobTableRow>();
+                batch.reserve(batchSize);
+            }
+        };
+
+        ARRIVAL_TRACE_SCOPE("diff.order");
+
+        // The rows are ordered by their state: added rows first, removed rows second, modified rows third and remained rows last.
+        // Within a state the rows keep the order of their document.
+        for (int rowIterator = 0; rowIterator < secondDocumentRowCount; rowIterator++)
+        {
+            if (secondDocumentMatches.at(rowIterator) < 0)
+            {
+                appendRow(rowIterator, JobTableRowState::Added, JobTableRow::SecondDocument);
+            }
+        }
+        for (int rowIterator = 0; rowIterator < firstDocumentRowCount; rowIterator++)
+        {
+            if (firstDocumentMatches.at(rowIterator) < 0)
+            {
+                appendRow(rowIterator, JobTableRowState::Removed, JobTableRow::FirstDocument);
+            }
+        }
+        const auto changeOffset = [&changeOffsets](int row) {
+            return changeOffsets.isEmpty() ? -1 : changeOffsets.at(row);
+        };
+        for (int rowIterator = 0; rowIterator < secondDocumentRowCount; rowIterator++)
+        {
+            if (changeOffset(rowIterator) >= 0)
+            {
+                appendRow(rowIterator, JobTableRowState::Modified, JobTableRow::SecondDocument, secondDocumentMatches.at(rowIterator), changeOffset(rowIterator));
+            }
+        }
+        for (int rowIterator = 0; rowIterator < secondDocumentRowCount; rowIterator++)
+        {
+            if (secondDocumentMatches.at(rowIterator) >= 0 && changeOffset(rowIterator) < 0)
+            {
+                appendRow(rowIterator, JobTableRowState::Remained, JobTableRow::SecondDocument, secondDocumentMatches.at(rowIterator));
+            }
+        }
+        if (options.cancellationToken.isCanceled())
+        {
+            return std::unexpected<CSVCombinedData::CombineCSVDocumentsError>(CSVCombinedData::CombineCSVDocumentsError::Canceled);
+        }
+        if (!batch.isEmpty() && stream.rowsReady)
+        {
+            stream.rowsReady(std::move(batch));
+        }
+        return {};
+    }
+
+    void CSVCombinedData::appendRows(const QList<JobTableRow>& rows)
+    {
+        m_rows.append(rows);
+        for (const JobTableRow& row : rows)
+        {
+            if (row.state == JobTableRowState::Added)
+            {
+                m_newAddedCount++;
+            }
+            else if (row.state == JobTableRowState::Removed)
+            {
+                m_removedCount++;
+            }
+            else if (row.state == JobTableRowState::Modified)
+            {
+                m_modifiedCount++;
+            }
+        }
+    }
+
+    void CSVCombinedData::clear()
+    {
+        m_headerNames.clear();
+#if ARRIVAL_CSVDOCUMENT_SUPPORTS_HEADER_INDICES
+        m_headerIndices.clear();
+#endif
+        m_rows.clear();
+        m_firstDocument.clear();
+        m_secondDocument.clear();
+        m_keyColumns.clear();
+        m_keyDetection = CSVKeyDetection();
+        m_newAddedCount = 0;
+        m_removedCount = 0;
+        m_modifiedCount = 0;
+        m_changeMasks.clear();
+        m_changeMaskWordCount = 0;
+    }
+}
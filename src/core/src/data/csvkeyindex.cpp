@@ -0,0 +1,203 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#include <QHashFunctions>
+
+#include <algorithm>
+
+#include "data/csvkeyindex.h"
+#include "data/hashing.h"
+#include "trace/tracerecorder.h"
+
+namespace Arrival::App
+{
+    // Seeds of the two 64 bit halves of a key.
+    static constexpr quint64 keyHighSeed = 0xa4093822299f31d0ULL;
+    static constexpr quint64 keyLowSeed = 0x082efa98ec4e6c89ULL;
+
+    // The amount of digits of a Jobnumber, followed by CL.
+    static constexpr qsizetype jobNumberDigits = 9;
+
+    // Parses the digits of a Jobnumber, see CSVCombinedData::isJobNumber. Anything following CL is the tail.
+    // Branch free over the digits, so Jobnumbers do not cost more than hashing them.
+    static inline bool parseJobNumber(QByteArrayView cell, quint64& number)
+    {
+        if (cell.size() < jobNumberDigits + 2 || cell.at(jobNumberDigits) != 'C' || cell.at(jobNumberDigits + 1) != 'L')
+        {
+            return false;
+        }
+
+        quint64 value = 0;
+        unsigned int invalid = 0;
+        for (qsizetype digitIterator = 0; digitIterator < jobNumberDigits; digitIterator++)
+        {
+            const unsigned int digit = static_cast<unsigned char>(cell.at(digitIterator)) - static_cast<unsigned int>('0');
+            invalid |= static_cast<unsigned int>(digit > 9);
+            value = value * 10 + digit;
+        }
+        number = value;
+        return invalid == 0;
+    }
+
+    CSVKey CSVKey::fromRow(const CSVDocument& document, int row, const QList<int>& keyColumns)
+    {
+        CSVKey key;
+        key.high = Hashing::mix(keyHighSeed ^ static_cast<quint64>(keyColumns.count()));
+        key.low = Hashing::mix(keyLowSeed ^ static_cast<quint64>(keyColumns.count()));
+
+        for (qsizetype columnIterator = 0; columnIterator < keyColumns.count(); columnIterator++)
+        {
+            const QByteArrayView cell = document.cell(row, keyColumns.at(columnIterator));
+            const quint64 position = static_cast<quint64>(columnIterator + 1) * Hashing::goldenRatio;
+
+            // Jobnumbers become their integer and the hash of their tail, which is usually empty.
+            // Any other cell is hashed twice.
+            quint64 value = 0;
+            quint64 tail = 0;
+            if (parseJobNumber(cell, value))
+            {
+                const QByteArrayView jobNumberTail = cell.sliced(jobNumberDigits + 2);
+                tail = jobNumberTail.isEmpty() ? 0 : static_cast<quint64>(qHash(jobNumberTail, static_cast<size_t>(keyLowSeed)));
+            }
+            else
+            {
+                value = static_cast<quint64>(qHash(cell, static_cast<size_t>(keyHighSeed))) | (1ULL << 63);
+                tail = static_cast<quint64>(qHash(cell, static_cast<size_t>(keyLowSeed)));
+            }
+
+            key.high = Hashing::mix(key.high ^ value ^ position) ^ tail;
+            key.low = Hashing::mix(key.low ^ value ^ tail ^ position);
+        }
+        return key;
+    }
+
+    CSVKeyIndex::CSVKeyIndex()
+        : m_document(nullptr)
+        , m_keyColumns()
+        , m_columnCount(0)
+        , m_keyCount(0)
+        , m_slots()
+    {}
+
+    CSVKeyIndex::CSVKeyIndex(const CSVDocument& document, const QList<int>& keyColumns)
+        : m_document(&document)
+        , m_keyColumns()
+        , m_columnCount(document.columnCount())
+        , m_keyCount(0)
+        , m_slots()
+    {
+        // Guard.
+        if (keyColumns.isEmpty() || std::any_of(keyColumns.cbegin(), keyColumns.cend(), [this](int column) { return column < 0 || column >= m_columnCount; }))
+        {
+            return;
+        }
+        m_keyColumns = keyColumns;
+
+        // Most keys are unique, so the amount of keys is close to the amount of rows.
+        allocateSlots(document.rowCount());
+        for (int rowIterator = 0; rowIterator < document.rowCount(); rowIterator++)
+        {
+            insert(rowIterator, CSVKey::fromRow(document, rowIterator, m_keyColumns));
+        }
+    }
+
+    CSVKeyIndex::CSVKeyIndex(const CSVDocument& document, const QList<int>& keyColumns, const QList<CSVKey>& keys, const QList<int>& rows)
+        : m_document(&document)
+        , m_keyColumns()
+        , m_columnCount(document.columnCount())
+        , m_keyCount(0)
+        , m_slots()
+    {
+        ARRIVAL_TRACE_SCOPE("diff.index");
+
+        // Guard.
+        if (keyColumns.isEmpty() || std::any_of(keyColumns.cbegin(), keyColumns.cend(), [this](int column) { return column < 0 || column >= m_columnCount; }))
+        {
+            return;
+        }
+        m_keyColumns = keyColumns;
+
+        allocateSlots(rows.count());
+        for (const int row : rows)
+        {
+            insert(row, keys.at(row));
+        }
+    }
+
+    void CSVKeyIndex::allocateSlots(qsizetype rowCount)
+    {
+        // Keep the load factor at or below one half so probe sequences stay short.
+        qsizetype slotCount = 16;
+        while (slotCount < rowCount * 2)
+        {
+            slotCount *= 2;
+        }
+        m_slots.resize(slotCount);
+    }
+
+    void CSVKeyIndex::insert(int row, const CSVKey& key)
+    {
+        // Malformed rows can not be compared by their key.
+        if (m_document->fieldCount(row) != m_columnCount)
+        {
+            return;
+        }
+
+        const qsizetype mask = m_slots.count() - 1;
+        for (qsizetype slotIterator = static_cast<qsizetype>(key.low & static_cast<quint64>(mask)); ; slotIterator = (slotIterator + 1) & mask)
+        {
+            Slot& slot = m_slots[slotIterator];
+            if (slot.row < 0)
+            {
+                slot.key = key;
+                slot.row = row;
+                m_keyCount++;
+                return;
+            }
+
+            // Only the first row holding a key is stored.
+            if (slot.key == key && keyCellsEqual(slot.row, *m_document, row))
+            {
+                return;
+            }
+        }
+    }
+
+    int CSVKeyIndex::findRow(const CSVDocument& document, int row, const CSVKey& key) const
+    {
+        // Guard.
+        if (!isValid() || document.fieldCount(row) != m_columnCount)
+        {
+            return -1;
+        }
+
+        const qsizetype mask = m_slots.count() - 1;
+        for (qsizetype slotIterator = static_cast<qsizetype>(key.low & static_cast<quint64>(mask)); ; slotIterator = (slotIterator + 1) & mask)
+        {
+            const Slot& slot = m_slots.at(slotIterator);
+            if (slot.row < 0)
+            {
+                return -1;
+            }
+
+            // Matching keys are confirmed by their cells to rule out collisions.
+            if (slot.key == key && keyCellsEqual(slot.row, document, row))
+            {
+                return slot.row;
+            }
+        }
+    }
+
+    bool CSVKeyIndex::keyCellsEqual(int row, const CSVDocument& document, int otherRow) const
+    {
+        for (const int column : m_keyColumns)
+        {
+            if (m_document->cell(row, column) != document.cell(otherRow, column))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
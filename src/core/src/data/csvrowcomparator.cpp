@@ -0,0 +1,105 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#include <QByteArray>
+#include <QHash>
+
+#include "data/csvrowcomparator.h"
+
+namespace Arrival::App
+{
+    CSVRowComparator::CSVRowComparator(const CSVDocument& document, const CSVDocument& other)
+        : m_document(&document)
+        , m_other(&other)
+        , m_columns()
+    {
+        const int columnCount = qMin(document.columnCount(), other.columnCount());
+        m_columns.resize(columnCount);
+
+        for (int columnIterator = 0; columnIterator < columnCount; columnIterator++)
+        {
+            const CSVColumnView view = document.column(columnIterator);
+            const CSVColumnView otherView = other.column(columnIterator);
+
+            // Guard.
+            if (!view.isDictionaryEncoded() || !otherView.isDictionaryEncoded())
+            {
+                continue;
+            }
+
+            ColumnComparison& comparison = m_columns[columnIterator];
+            comparison.cells = view.cells();
+            comparison.otherCells = otherView.cells();
+
+            // Look up every distinct value of the document in the dictionary of the other document.
+            QHash<QByteArray, int> otherCodes;
+            otherCodes.reserve(comparison.otherCells->dictionarySize());
+            for (int codeIterator = 0; codeIterator < comparison.otherCells->dictionarySize(); codeIterator++)
+            {
+                const QByteArrayView value = comparison.otherCells->dictionaryValue(codeIterator);
+                otherCodes.insert(QByteArray::fromRawData(value.data(), value.size()), codeIterator);
+            }
+
+            comparison.translation.reserve(comparison.cells->dictionarySize());
+            for (int codeIterator = 0; codeIterator < comparison.cells->dictionarySize(); codeIterator++)
+            {
+                const QByteArrayView value = comparison.cells->dictionaryValue(codeIterator);
+                comparison.translation.append(otherCodes.value(QByteArray::fromRawData(value.data(), value.size()), -1));
+            }
+        }
+    }
+
+    bool CSVRowComparator::equals(int row, int otherRow) const
+    {
+        const int count = m_document->fieldCount(row);
+        if (count != m_other->fieldCount(otherRow))
+        {
+            return false;
+        }
+
+        for (int columnIterator = 0; columnIterator < count; columnIterator++)
+        {
+            if (columnIterator < m_columns.count() && m_columns.at(columnIterator).cells != nullptr)
+            {
+                const ColumnComparison& comparison = m_columns.at(columnIterator);
+                if (comparison.translation.at(comparison.cells->code(row)) != comparison.otherCells->code(otherRow))
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            if (m_document->cell(row, columnIterator) != m_other->cell(otherRow, columnIterator))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int CSVRowComparator::changedColumns(int row, int otherRow, quint64* mask) const
+    {
+        const int count = m_document->fieldCount(row);
+        Q_ASSERT(count == m_other->fieldCount(otherRow));
+
+        // Unlike equals, every column is visited. The bit is set without a branch.
+        int changedCount = 0;
+        for (int columnIterator = 0; columnIterator < count; columnIterator++)
+        {
+            bool isChanged = false;
+            if (columnIterator < m_columns.count() && m_columns.at(columnIterator).cells != nullptr)
+            {
+                const ColumnComparison& comparison = m_columns.at(columnIterator);
+                isChanged = comparison.translation.at(comparison.cells->code(row)) != comparison.otherCells->code(otherRow);
+            }
+            else
+            {
+                isChanged = m_document->cell(row, columnIterator) != m_other->cell(otherRow, columnIterator);
+            }
+            mask[columnIterator / 64] |= static_cast<quint64>(isChanged) << (columnIterator % 64);
+            changedCount += isChanged;
+        }
+        return changedCount;
+    }
+}
@@ -0,0 +1,514 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QtConcurrent/QtConcurrent>
+
+#include <utility>
+
+#include "qtcsv/reader.h"
+
+#include "data/csvsortedmerge.h"
+#include "trace/tracerecorder.h"
+
+namespace Arrival::App
+{
+    /*!
+     * \brief The CSVSortedMergeReader class reads a .csv file on a thread of its own and hands its rows to the comparison.
+     * The rows are handed over in batches through a queue holding at most \c CSVSortedMerge::queuedBatchCount batches.
+     * The reading thread waits while the queue is full, the comparison waits while it is empty.
+     */
+    class CSVSortedMergeReader : public QtCSV::Reader::AbstractProcessor
+    {
+    public:
+        explicit CSVSortedMergeReader(const CancellationToken& cancellationToken)
+            : m_cancellationToken(cancellationToken)
+            , m_mutex()
+            , m_batchQueued()
+            , m_batchTaken()
+            , m_queue()
+            , m_isFinished(false)
+            , m_hasFailed(false)
+            , m_isClosed(false)
+            , m_pendingBatch()
+            , m_batch()
+            , m_index(0)
+            , m_previousRow()
+        {}
+
+        // Reading thread.
+
+        /*!
+         * \brief read Reads the file. Returns once it has been read, it could not be read or the reader has been closed.
+         * \param filePath Path of the file.
+         */
+        void read(const QString& filePath)
+        {
+            ARRIVAL_TRACE_SCOPE("merge.read");
+
+            const bool succeeded = QtCSV::Reader::readToProcessor(filePath, *this) && queueBatch();
+            QMutexLocker locker(&m_mutex);
+            m_isFinished = true;
+            m_hasFailed = !succeeded && !m_isClosed;
+            m_batchQueued.wakeAll();
+        }
+
+        bool processRowElements(const QList<QString>& elements) override
+        {
+            m_pendingBatch.append(elements);
+            if (m_pendingBatch.count() >= CSVSortedMerge::rowBatchSize)
+            {
+                return queueBatch();
+            }
+            return true;
+        }
+
+        // Comparing thread.
+
+        /*!
+         * \brief current Returns the current row.
+         * \return The row or nullptr once every row has been handed out.
+         */
+        const QList<QString>* current() const
+        {
+            return m_index < m_batch.count() ? &m_batch.at(m_index) : nullptr;
+        }
+
+        /*!
+         * \brief upcomingRows Returns the current row and the rows following it in the current batch.
+         * \return The rows, at most \c CSVSortedMerge::rowBatchSize.
+         */
+        QList<QList<QString>> upcomingRows() const
+        {
+            return m_batch.mid(m_index);
+        }
+
+        /*!
+         * \brief previousRow Returns the row handed out before the current one.
+         * \return The row, empty before the first row.
+         */
+        const QList<QString>& previousRow() const
+        {
+            return m_previousRow;
+        }
+
+        /*!
+         * \brief advance Moves to the next row, waiting for it to be read.
+         * \return True if there is a next row, false once every row has been handed out.
+         */
+        bool advance()
+        {
+            if (m_index < m_batch.count())
+            {
+                m_previousRow = m_batch.at(m_index);
+                m_index++;
+            }
+            if (m_index < m_batch.count())
+            {
+                return true;
+            }
+
+            QMutexLocker locker(&m_mutex);
+            while (m_queue.isEmpty() && !m_isFinished)
+            {
+                m_batchQueued.wait(&m_mutex);
+            }
+            m_index = 0;
+            if (m_queue.isEmpty())
+            {
+                m_batch.clear();
+                return false;
+            }
+            m_batch = m_queue.takeFirst();
+            m_batchTaken.wakeAll();
+            return true;
+        }
+
+        /*!
+         * \brief hasFailed Checks whether the file could not be read completely.
+         * Only meaningful once every row has been handed out.
+         * \return True if reading failed, false otherwise.
+         */
+        bool hasFailed() const
+        {
+            QMutexLocker locker(&m_mutex);
+            return m_hasFailed;
+        }
+
+        /*!
+         * \brief close Stops reading. Rows that have not been handed out yet are dropped.
+         */
+        void close()
+        {
+            QMutexLocker locker(&m_mutex);
+            m_isClosed = true;
+            m_queue.clear();
+            m_batchTaken.wakeAll();
+        }
+
+    private:
+        /*!
+         * \brief queueBatch Hands the pending rows over, waiting while the queue is full.
+         * \return False if reading has to stop, true otherwise.
+         */
+        bool queueBatch()
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_queue.count() >= CSVSortedMerge::queuedBatchCount && !m_isClosed && !m_cancellationToken.isCanceled())
+            {
+                // Wake up now and then, cancellation is not signaled.
+                m_batchTaken.wait(&m_mutex, 100);
+            }
+            if (m_isClosed || m_cancellationToken.isCanceled())
+            {
+                return false;
+            }
+            if (!m_pendingBatch.isEmpty())
+            {
+                m_queue.append(std::exchange(m_pendingBatch, QList<QList<QString>>()));
+                m_pendingBatch.reserve(CSVSortedMerge::rowBatchSize);
+                m_batchQueued.wakeAll();
+            }
+            return true;
+        }
+
+    private:
+        /*!
+         * \brief m_cancellationToken Stops reading once canceled.
+         */
+        CancellationToken m_cancellationToken;
+
+        /*!
+         * \brief m_mutex Guards the queue and the flags below.
+         */
+        mutable QMutex m_mutex;
+
+        QWaitCondition m_batchQueued;
+        QWaitCondition m_batchTaken;
+
+        /*!
+         * \brief m_queue The batches read but not handed out yet.
+         */
+        QList<QList<QList<QString>>> m_queue;
+
+        bool m_isFinished;
+        bool m_hasFailed;
+        bool m_isClosed;
+
+        /*!
+         * \brief m_pendingBatch The rows read since the last batch has been queued. Only used by the reading thread.
+         */
+        QList<QList<QString>> m_pendingBatch;
+
+        /*!
+         * \brief m_batch The batch holding the current row. Only used by the comparing thread.
+         */
+        QList<QList<QString>> m_batch;
+
+        /*!
+         * \brief m_index The index of the current row in \c m_batch.
+         */
+        qsizetype m_index;
+
+        /*!
+         * \brief m_previousRow The row handed out before the current one.
+         */
+        QList<QString> m_previousRow;
+    };
+
+    // Moves a reader to its next row and checks that the rows stay ordered by their key.
+    static std::expected<void, CSVSortedMerge::Error> advance(CSVSortedMergeReader& reader, const QList<int>& keyColumns)
+    {
+        if (!reader.advance())
+        {
+            if (reader.hasFailed())
+            {
+                return std::unexpected(CSVSortedMerge::Error::ReadError);
+            }
+            return {};
+        }
+        if (CSVSortedMerge::compareKeys(reader.previousRow(), *reader.current(), keyColumns) > 0)
+        {
+            return std::unexpected(CSVSortedMerge::Error::NotSorted);
+        }
+        return {};
+    }
+
+    static bool isDigit(QChar character)
+    {
+        return character >= u'0' && character <= u'9';
+    }
+
+    CSVSortedMerge::CSVSortedMerge(const QString& firstFilePath, const QString& secondFilePath, const CSVCombineOptions& options)
+        : m_firstFilePath(firstFilePath)
+        , m_secondFilePath(secondFilePath)
+        , m_options(options)
+        , m_pool()
+        , m_firstReader(QSharedPointer<CSVSortedMergeReader>::create(options.cancellationToken))
+        , m_secondReader(QSharedPointer<CSVSortedMergeReader>::create(options.cancellationToken))
+        , m_headerNames()
+        , m_keyColumns()
+        , m_keyDetection()
+        , m_matchedRow()
+        , m_hasMatchedRow(false)
+        , m_firstRowCount(0)
+        , m_secondRowCount(0)
+        , m_newAddedCount(0)
+        , m_removedCount(0)
+        , m_modifiedCount(0)
+        , m_remainedCount(0)
+    {
+        // One thread per file, the comparison runs on the calling thread.
+        m_pool.setMaxThreadCount(2);
+    }
+
+    CSVSortedMerge::~CSVSortedMerge()
+    {
+        m_firstReader->close();
+        m_secondReader->close();
+        m_pool.waitForDone();
+    }
+
+    std::expected<void, CSVSortedMerge::Error> CSVSortedMerge::open()
+    {
+        ARRIVAL_TRACE_SCOPE("merge.open");
+
+        // Both readers keep themselves alive until they are done.
+        const auto read = [](QSharedPointer<CSVSortedMergeReader> reader, const QString& filePath) {
+            reader->read(filePath);
+        };
+        QtConcurrent::run(&m_pool, read, m_firstReader, m_firstFilePath);
+        QtConcurrent::run(&m_pool, read, m_secondReader, m_secondFilePath);
+
+        // The first row of each file is its header.
+        const bool firstHasHeader = m_firstReader->advance();
+        const bool secondHasHeader = m_secondReader->advance();
+        if (m_firstReader->hasFailed() || m_secondReader->hasFailed())
+        {
+            return std::unexpected(Error::ReadError);
+        }
+        if (!firstHasHeader && !secondHasHeader)
+        {
+            return std::unexpected(Error::BothEmpty);
+        }
+        const QList<QString> firstHeaderNames = firstHasHeader ? *m_firstReader->current() : QList<QString>();
+        m_headerNames = secondHasHeader ? *m_secondReader->current() : QList<QString>();
+
+        // The two files do not have the same amount of columns.
+        // As they are not the same format, they cannot be compared.
+        if (firstHeaderNames.count() != m_headerNames.count())
+        {
+            return std::unexpected(Error::DifferentFormat);
+        }
+
+        // Move to the first rows. The headers are not part of the order.
+        m_firstReader->advance();
+        m_secondReader->advance();
+        if (m_firstReader->hasFailed() || m_secondReader->hasFailed())
+        {
+            return std::unexpected(Error::ReadError);
+        }
+
+        // The Jobnumber column is detected on the rows of the first batch of each file.
+        const CSVKeyDetection firstDetection = CSVCombinedData::detectJobNumberColumn(m_firstReader->upcomingRows());
+        const CSVKeyDetection secondDetection = CSVCombinedData::detectJobNumberColumn(m_secondReader->upcomingRows());
+        std::expected<QList<int>, Error> keyColumns = CSVCombinedData::resolveKeyColumns(m_headerNames, firstDetection.column, secondDetection.column, m_options);
+        if (!keyColumns.has_value())
+        {
+            return std::unexpected(keyColumns.error());
+        }
+
+        // Rows can only be merged by a key they are ordered by.
+        if (keyColumns->isEmpty())
+        {
+            return std::unexpected(Error::InvalidKeyColumn);
+        }
+        m_keyColumns = std::move(*keyColumns);
+        m_keyDetection = CSVCombinedData::detectedKey(firstDetection, secondDetection, m_keyColumns, m_options);
+        return {};
+    }
+
+    std::expected<bool, CSVSortedMerge::Error> CSVSortedMerge::next(CSVMergedRow& row)
+    {
+        if (m_options.cancellationToken.isCanceled())
+        {
+            return std::unexpected(Error::Canceled);
+        }
+
+        const QList<QString>* firstRow = m_firstReader->current();
+        const QList<QString>* secondRow = m_secondReader->current();
+
+        // Rows sharing the key of the last matched rows are matched like the index of the in-memory comparison does:
+        // every row of the second file against the first row of the first file with that key,
+        // the other rows of the first file with that key have been matched and are not handed out.
+        while (m_hasMatchedRow)
+        {
+            if (secondRow && compareKeys(m_matchedRow, *secondRow, m_keyColumns) == 0)
+            {
+                compareRows(*secondRow, m_matchedRow, row);
+                m_secondRowCount++;
+                if (const auto advanced = advance(*m_secondReader, m_keyColumns); !advanced.has_value())
+                {
+                    return std::unexpected(advanced.error());
+                }
+                return true;
+            }
+            if (firstRow && compareKeys(m_matchedRow, *firstRow, m_keyColumns) == 0)
+            {
+                m_firstRowCount++;
+                if (const auto advanced = advance(*m_firstReader, m_keyColumns); !advanced.has_value())
+                {
+                    return std::unexpected(advanced.error());
+                }
+                firstRow = m_firstReader->current();
+                continue;
+            }
+            m_hasMatchedRow = false;
+        }
+
+        if (!firstRow && !secondRow)
+        {
+            return false;
+        }
+
+        // The smaller key is only found in its own file, equal keys are found in both.
+        const int order = !firstRow ? 1 : (!secondRow ? -1 : compareKeys(*firstRow, *secondRow, m_keyColumns));
+        if (order < 0)
+        {
+            row.state = JobTableRowState::Removed;
+            row.cells = *firstRow;
+            row.previousCells.clear();
+            row.changedColumns.clear();
+            m_removedCount++;
+            m_firstRowCount++;
+            if (const auto advanced = advance(*m_firstReader, m_keyColumns); !advanced.has_value())
+            {
+                return std::unexpected(advanced.error());
+            }
+            return true;
+        }
+        if (order > 0)
+        {
+            row.state = JobTableRowState::Added;
+            row.cells = *secondRow;
+            row.previousCells.clear();
+            row.changedColumns.clear();
+            m_newAddedCount++;
+            m_secondRowCount++;
+            if (const auto advanced = advance(*m_secondReader, m_keyColumns); !advanced.has_value())
+            {
+                return std::unexpected(advanced.error());
+            }
+            return true;
+        }
+
+        compareRows(*secondRow, *firstRow, row);
+        m_matchedRow = *firstRow;
+        m_hasMatchedRow = true;
+        m_firstRowCount++;
+        m_secondRowCount++;
+        if (const auto advanced = advance(*m_firstReader, m_keyColumns); !advanced.has_value())
+        {
+            return std::unexpected(advanced.error());
+        }
+        if (const auto advanced = advance(*m_secondReader, m_keyColumns); !advanced.has_value())
+        {
+            return std::unexpected(advanced.error());
+        }
+        return true;
+    }
+
+    void CSVSortedMerge::compareRows(const QList<QString>& cells, const QList<QString>& previousCells, CSVMergedRow& row)
+    {
+        row.cells = cells;
+        row.previousCells = previousCells;
+        row.changedColumns.clear();
+        const qsizetype columnCount = qMax(row.cells.count(), row.previousCells.count());
+        for (qsizetype columnIterator = 0; columnIterator < columnCount; columnIterator++)
+        {
+            if (row.cells.value(columnIterator) != row.previousCells.value(columnIterator))
+            {
+                row.changedColumns.append(static_cast<int>(columnIterator));
+            }
+        }
+        if (row.changedColumns.isEmpty())
+        {
+            row.state = JobTableRowState::Remained;
+            m_remainedCount++;
+        }
+        else
+        {
+            row.state = JobTableRowState::Modified;
+            m_modifiedCount++;
+        }
+    }
+
+    int CSVSortedMerge::compareKeys(const QList<QString>& row, const QList<QString>& otherRow, const QList<int>& keyColumns)
+    {
+        for (const int keyColumn : keyColumns)
+        {
+            // Missing cells of malformed rows are empty.
+            const QStringView cell = keyColumn < row.count() ? QStringView(row.at(keyColumn)) : QStringView();
+            const QStringView otherCell = keyColumn < otherRow.count() ? QStringView(otherRow.at(keyColumn)) : QStringView();
+            if (const int order = compareKeyCells(cell, otherCell); order != 0)
+            {
+                return order;
+            }
+        }
+        return 0;
+    }
+
+    int CSVSortedMerge::compareKeyCells(QStringView cell, QStringView otherCell)
+    {
+        qsizetype position = 0;
+        qsizetype otherPosition = 0;
+        while (position < cell.size() && otherPosition < otherCell.size())
+        {
+            if (!isDigit(cell.at(position)) || !isDigit(otherCell.at(otherPosition)))
+            {
+                if (cell.at(position) != otherCell.at(otherPosition))
+                {
+                    return cell.at(position) < otherCell.at(otherPosition) ? -1 : 1;
+                }
+                position++;
+                otherPosition++;
+                continue;
+            }
+
+            // Both runs of digits without their leading zeros. The longer number is the larger one.
+            const auto digits = [](QStringView text, qsizetype& index) {
+                while (index < text.size() - 1 && text.at(index) == u'0' && isDigit(text.at(index + 1)))
+                {
+                    index++;
+                }
+                const qsizetype begin = index;
+                while (index < text.size() && isDigit(text.at(index)))
+                {
+                    index++;
+                }
+                return text.sliced(begin, index - begin);
+            };
+            const QStringView number = digits(cell, position);
+            const QStringView otherNumber = digits(otherCell, otherPosition);
+            if (number.size() != otherNumber.size())
+            {
+                return number.size() < otherNumber.size() ? -1 : 1;
+            }
+            if (const int order = number.compare(otherNumber); order != 0)
+            {
+                return order < 0 ? -1 : 1;
+            }
+        }
+        if (position < cell.size() || otherPosition < otherCell.size())
+        {
+            return position < cell.size() ? 1 : -1;
+        }
+
+        // Equal numbers written with different leading zeros are still different keys.
+        const int order = cell.compare(otherCell);
+        return order < 0 ? -1 : (order > 0 ? 1 : 0);
+    }
+}
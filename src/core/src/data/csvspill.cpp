@@ -0,0 +1,351 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#include <QDir>
+#include <QHashFunctions>
+#include <QtEndian>
+
+#include <cstring>
+
+#include "qtcsv/structuralindex.h"
+
+#include "data/csvdocument.h"
+#include "data/csvspill.h"
+#include "trace/tracerecorder.h"
+
+namespace Arrival::App
+{
+    // Seeds the hash picking the partition of a row. Differs from the seeds of the key index,
+    // so the rows of a partition are still spread across the partitions of the diff engine.
+    static constexpr size_t partitionSeed = 0x5bd1e995;
+
+    // A partition file while it is written.
+    struct PartitionWriter
+    {
+        QSharedPointer<QFile> file;
+        QByteArray buffer;
+        qint64 size = 0;
+        int rowCount = 0;
+    };
+
+    static void appendUInt32(QByteArray& buffer, quint32 value)
+    {
+        const quint32 littleEndian = qToLittleEndian(value);
+        buffer.append(reinterpret_cast<const char*>(&littleEndian), sizeof(littleEndian));
+    }
+
+    static void appendInt64(QByteArray& buffer, qint64 value)
+    {
+        const qint64 littleEndian = qToLittleEndian(value);
+        buffer.append(reinterpret_cast<const char*>(&littleEndian), sizeof(littleEndian));
+    }
+
+    static quint32 readUInt32(const char* bytes)
+    {
+        return qFromLittleEndian<quint32>(bytes);
+    }
+
+    // Writes the collected bytes of a file.
+    static bool flush(QFile& file, QByteArray& buffer)
+    {
+        if (file.write(buffer) != buffer.size())
+        {
+            return false;
+        }
+        buffer.resize(0);
+        return true;
+    }
+
+    // Opens a file that has been written completely and maps it. Empty files are not mapped.
+    static std::expected<const char*, QString> mapFile(QFile& file)
+    {
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            return std::unexpected("could not open " + file.fileName());
+        }
+        const qint64 size = file.size();
+        if (size <= 0)
+        {
+            return nullptr;
+        }
+        const char* bytes = reinterpret_cast<const char*>(file.map(0, size));
+        if (bytes == nullptr)
+        {
+            return std::unexpected("could not map " + file.fileName());
+        }
+        return bytes;
+    }
+
+    // Maps a .csv file, falling back to reading it if it can not be mapped. Returns the contents without the byte order mark.
+    static std::expected<QByteArrayView, QString> openInput(QFile& file, QByteArray& buffer)
+    {
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            return std::unexpected("could not open " + file.fileName());
+        }
+
+        const qint64 size = file.size();
+        const char* bytes = size > 0 ? reinterpret_cast<const char*>(file.map(0, size)) : nullptr;
+        QByteArrayView contents(bytes, bytes == nullptr ? 0 : size);
+        if (bytes == nullptr && size > 0)
+        {
+            buffer = file.readAll();
+            contents = buffer;
+        }
+
+        if (contents.size() >= 3 && std::memcmp(contents.data(), "\xef\xbb\xbf", 3) == 0)
+        {
+            contents = contents.sliced(3);
+        }
+        return contents;
+    }
+
+    CSVSpill::CSVSpill()
+        : m_directory()
+        , m_headerNames()
+        , m_partitions()
+        , m_locationFile()
+        , m_locations(nullptr)
+        , m_rowCount(0)
+    {}
+
+    std::expected<QList<QList<QString>>, QString> CSVSpill::readFirstRows(const QString& filePath, int rowCount)
+    {
+        QFile file(filePath);
+        QByteArray buffer;
+        const auto input = openInput(file, buffer);
+        if (!input.has_value())
+        {
+            return std::unexpected(input.error());
+        }
+
+        QList<QList<QString>> rows;
+        QByteArray content;
+        QtCSV::StructuralIndex index(CSVDocument::separator, CSVDocument::textDelimiter);
+        if (rowCount > 0)
+        {
+            index.splitRows(input->data(), 0, input->size(), true, [&](qsizetype, const QList<QtCSV::RawElement>& elements)
+            {
+                QList<QString> row;
+                row.reserve(elements.count());
+                for (const QtCSV::RawElement& element : elements)
+                {
+                    row.append(QString::fromUtf8(CSVDocument::elementContent(input->data(), element, content)));
+                }
+                rows.append(row);
+                return rows.count() < rowCount;
+            });
+        }
+        return rows;
+    }
+
+    std::expected<QSharedPointer<const CSVSpill>, QString> CSVSpill::create(const QString& filePath, const QString& directory, const QList<int>& keyColumns, int partitionCount, const CancellationToken& cancellationToken)
+    {
+        ARRIVAL_TRACE_SCOPE("spill.write");
+
+        partitionCount = qBound(1, partitionCount, maximumPartitionCount);
+
+        QFile inputFile(filePath);
+        QByteArray inputBuffer;
+        const auto input = openInput(inputFile, inputBuffer);
+        if (!input.has_value())
+        {
+            return std::unexpected(input.error());
+        }
+        const char* data = input->data();
+        const qsizetype size = input->size();
+
+        QSharedPointer<CSVSpill> spill(new CSVSpill());
+        spill->m_directory = QSharedPointer<QTemporaryDir>::create(QDir(directory).filePath("arrival-spill-XXXXXX"));
+        if (!spill->m_directory->isValid())
+        {
+            return std::unexpected("could not create a temporary directory in " + directory);
+        }
+
+        QList<PartitionWriter> writers(partitionCount);
+        for (int partitionIterator = 0; partitionIterator < partitionCount; partitionIterator++)
+        {
+            PartitionWriter& writer = writers[partitionIterator];
+            writer.file = QSharedPointer<QFile>::create(spill->m_directory->filePath(QString::number(partitionIterator) + ".rows"));
+            if (!writer.file->open(QIODevice::WriteOnly))
+            {
+                return std::unexpected("could not create " + writer.file->fileName());
+            }
+            writer.buffer.reserve(writeBufferSize + 1024);
+        }
+        spill->m_locationFile = QSharedPointer<QFile>::create(spill->m_directory->filePath("rows.locations"));
+        if (!spill->m_locationFile->open(QIODevice::WriteOnly))
+        {
+            return std::unexpected("could not create " + spill->m_locationFile->fileName());
+        }
+        QByteArray locationBuffer;
+        locationBuffer.reserve(writeBufferSize);
+
+        // The headers are at the first row.
+        QtCSV::StructuralIndex index(CSVDocument::separator, CSVDocument::textDelimiter);
+        QList<QByteArray> contents;
+        const qsizetype begin = index.splitRows(data, 0, size, true, [&](qsizetype, const QList<QtCSV::RawElement>& elements)
+        {
+            contents.resize(1);
+            for (const QtCSV::RawElement& element : elements)
+            {
+                spill->m_headerNames.append(QString::fromUtf8(CSVDocument::elementContent(data, element, contents[0])));
+            }
+            return false;
+        });
+
+        // Every other row is written to its partition as it is found, nothing but the write buffers is kept.
+        bool isWritten = true;
+        QList<QByteArrayView> cells;
+        QList<QByteArrayView> keyCells(keyColumns.count());
+        index.splitRows(data, begin, size, true, [&](qsizetype, const QList<QtCSV::RawElement>& elements)
+        {
+            cells.resize(0);
+            if (contents.count() < elements.count())
+            {
+                contents.resize(elements.count());
+            }
+            for (qsizetype elementIterator = 0; elementIterator < elements.count(); elementIterator++)
+            {
+                cells.append(CSVDocument::elementContent(data, elements.at(elementIterator), contents[elementIterator]));
+            }
+            for (qsizetype keyIterator = 0; keyIterator < keyColumns.count(); keyIterator++)
+            {
+                keyCells[keyIterator] = cells.value(keyColumns.at(keyIterator));
+            }
+
+            const int partition = partitionOf(keyCells, partitionCount);
+            PartitionWriter& writer = writers[partition];
+            appendInt64(locationBuffer, (static_cast<qint64>(partition) << offsetBits) | (writer.size + writer.buffer.size()));
+
+            appendUInt32(writer.buffer, static_cast<quint32>(spill->m_rowCount));
+            appendUInt32(writer.buffer, static_cast<quint32>(cells.count()));
+            quint32 end = 0;
+            for (const QByteArrayView cell : cells)
+            {
+                end += static_cast<quint32>(cell.size());
+                appendUInt32(writer.buffer, end);
+            }
+            for (const QByteArrayView cell : cells)
+            {
+                writer.buffer.append(cell.data(), cell.size());
+            }
+            writer.rowCount++;
+            spill->m_rowCount++;
+
+            if (writer.buffer.size() >= writeBufferSize)
+            {
+                writer.size += writer.buffer.size();
+                isWritten = flush(*writer.file, writer.buffer);
+            }
+            if (isWritten && locationBuffer.size() >= writeBufferSize)
+            {
+                isWritten = flush(*spill->m_locationFile, locationBuffer);
+            }
+            return isWritten && !cancellationToken.isCanceled();
+        });
+        if (cancellationToken.isCanceled())
+        {
+            return std::unexpected(QStringLiteral("canceled"));
+        }
+
+        // Write what is left and map every file.
+        for (PartitionWriter& writer : writers)
+        {
+            writer.size += writer.buffer.size();
+            isWritten = isWritten && flush(*writer.file, writer.buffer);
+            writer.file->close();
+        }
+        isWritten = isWritten && flush(*spill->m_locationFile, locationBuffer);
+        spill->m_locationFile->close();
+        if (!isWritten)
+        {
+            return std::unexpected("could not write to " + spill->m_directory->path());
+        }
+
+        spill->m_partitions.reserve(partitionCount);
+        for (PartitionWriter& writer : writers)
+        {
+            const auto bytes = mapFile(*writer.file);
+            if (!bytes.has_value())
+            {
+                return std::unexpected(bytes.error());
+            }
+            spill->m_partitions.append(Partition{ std::move(writer.file), *bytes, writer.size, writer.rowCount });
+        }
+        const auto locations = mapFile(*spill->m_locationFile);
+        if (!locations.has_value())
+        {
+            return std::unexpected(locations.error());
+        }
+        spill->m_locations = *locations;
+
+        return spill;
+    }
+
+    int CSVSpill::partitionOf(const QList<QByteArrayView>& keyCells, int partitionCount)
+    {
+        size_t hash = partitionSeed;
+        for (const QByteArrayView cell : keyCells)
+        {
+            hash = qHash(cell, hash);
+        }
+        return static_cast<int>(static_cast<quint64>(hash) % static_cast<quint64>(partitionCount));
+    }
+
+    qint64 CSVSpill::location(int row) const
+    {
+        return qFromLittleEndian<qint64>(m_locations + static_cast<qint64>(row) * sizeof(qint64));
+    }
+
+    void CSVSpill::partitionRows(int partition, QList<qint64>& locations, QList<int>* sourceRows) const
+    {
+        ARRIVAL_TRACE_SCOPE("spill.rows");
+
+        const Partition& file = m_partitions.at(partition);
+        locations.clear();
+        locations.reserve(file.rowCount);
+        if (sourceRows)
+        {
+            sourceRows->clear();
+            sourceRows->reserve(file.rowCount);
+        }
+
+        // Every row starts with its source row, its field count and the end of every field, the content follows.
+        for (qint64 offset = 0; offset < file.size; )
+        {
+            const char* row = file.bytes + offset;
+            const quint32 fieldCount = readUInt32(row + 4);
+            const quint32 contentSize = fieldCount > 0 ? readUInt32(row + 8 + 4 * (fieldCount - 1)) : 0;
+            locations.append((static_cast<qint64>(partition) << offsetBits) | offset);
+            if (sourceRows)
+            {
+                sourceRows->append(static_cast<int>(readUInt32(row)));
+            }
+            offset += 8 + 4 * static_cast<qint64>(fieldCount) + contentSize;
+        }
+    }
+
+    int CSVSpill::fieldCount(qint64 location) const
+    {
+        return static_cast<int>(readUInt32(row(location) + 4));
+    }
+
+    QByteArrayView CSVSpill::cell(qint64 location, int column) const
+    {
+        const char* bytes = row(location);
+        const quint32 fieldCount = readUInt32(bytes + 4);
+
+        // Guard.
+        if (column < 0 || static_cast<quint32>(column) >= fieldCount)
+        {
+            return QByteArrayView();
+        }
+
+        const char* ends = bytes + 8;
+        const quint32 begin = column > 0 ? readUInt32(ends + 4 * (column - 1)) : 0;
+        const quint32 end = readUInt32(ends + 4 * column);
+        return QByteArrayView(ends + 4 * static_cast<qint64>(fieldCount) + begin, end - begin);
+    }
+}
@@ -3,6 +3,7 @@
 // Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
 
 #include "data/jobtable.h"
+#include "trace/tracerecorder.h"
 
 namespace Arrival::App
 {
@@ -14,6 +15,8 @@ namespace Arrival::App
 
     void JobTable::setTableData(QSharedPointer<CSVCombinedData> data)
     {
+        ARRIVAL_TRACE_SCOPE("model.reset");
+
         // Guard
         if (data == m_data)
         {
@@ -34,9 +37,32 @@ namespace Arrival::App
         emit columnCountChanged(columnCount());
         emit newAddedCountChanged(newAddedCount());
         emit removedCountChanged(removedCount());
+        emit modifiedCountChanged(modifiedCount());
         emit hasDataChanged(hasData());
         emit headerNamesChanged(headerNames());
         emit formatIdentifierChanged(formatIdentifier());
+        emit keyDetectionConfidenceChanged(keyDetectionConfidence());
+    }
+
+    void JobTable::appendRows(const QList<JobTableRow>& rows)
+    {
+        ARRIVAL_TRACE_SCOPE("model.appendRows");
+
+        // Guard.
+        if (!hasData() || rows.isEmpty())
+        {
+            return;
+        }
+
+        const int first = rowCount();
+        emit preRowsAppended(first, first + static_cast<int>(rows.count()) - 1);
+        m_data->appendRows(rows);
+        emit postRowsAppended();
+
+        emit rowCountChanged(rowCount());
+        emit newAddedCountChanged(newAddedCount());
+        emit removedCountChanged(removedCount());
+        emit modifiedCountChanged(modifiedCount());
     }
 
     void JobTable::clearTable()
@@ -47,9 +73,8 @@ namespace Arrival::App
             return;
         }
 
-        // Clear the actual list
+        // Release the data. It is shared with running exports, so it is not cleared in place.
         emit preTableReset();
-        m_data->clear();
         m_data.clear();
         emit postTableReset();
 
@@ -58,8 +83,10 @@ namespace Arrival::App
         emit columnCountChanged(columnCount());
         emit newAddedCountChanged(newAddedCount());
         emit removedCountChanged(removedCount());
+        emit modifiedCountChanged(modifiedCount());
         emit hasDataChanged(hasData());
         emit headerNamesChanged(headerNames());
         emit formatIdentifierChanged(formatIdentifier());
+        emit keyDetectionConfidenceChanged(keyDetectionConfidence());
     }
 }
@@ -0,0 +1,172 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#include <cstring>
+
+#include "data/hashing.h"
+#include "data/rowfingerprinttable.h"
+#include "trace/tracerecorder.h"
+
+namespace Arrival::App
+{
+    // Seeds of the two 64 bit halves of a fingerprint.
+    static constexpr quint64 fingerprintHighSeed = 0x243f6a8885a308d3ULL;
+    static constexpr quint64 fingerprintLowSeed = 0x13198a2e03707344ULL;
+
+    // Hashes a block of memory eight bytes at a time.
+    static quint64 hashBytes(const char* data, qsizetype size, quint64 seed)
+    {
+        quint64 hash = Hashing::mix(seed ^ static_cast<quint64>(size));
+        while (size >= 8)
+        {
+            quint64 word;
+            std::memcpy(&word, data, sizeof(word));
+            hash = Hashing::mix(hash ^ word);
+            data += 8;
+            size -= 8;
+        }
+
+        quint64 tail = 0;
+        if (size > 0)
+        {
+            std::memcpy(&tail, data, static_cast<size_t>(size));
+        }
+        return Hashing::mix(hash ^ tail);
+    }
+
+    RowFingerprint RowFingerprint::fromRow(const CSVDocument& document, int row)
+    {
+        const int fieldCount = document.fieldCount(row);
+
+        RowFingerprint result;
+        result.high = Hashing::mix(fingerprintHighSeed ^ static_cast<quint64>(fieldCount));
+        result.low = Hashing::mix(fingerprintLowSeed ^ static_cast<quint64>(fieldCount));
+
+        // Chaining the cell hashes makes the fingerprint depend on the order of the cells,
+        // mixing in the column keeps empty or repeated cells from cancelling each other out.
+        for (int columnIterator = 0; columnIterator < fieldCount; columnIterator++)
+        {
+            const QByteArrayView cell = document.cell(row, columnIterator);
+            const quint64 column = static_cast<quint64>(columnIterator) * Hashing::goldenRatio;
+
+            result.high = Hashing::mix(result.high ^ hashBytes(cell.data(), cell.size(), fingerprintHighSeed ^ column));
+            result.low = Hashing::mix(result.low ^ hashBytes(cell.data(), cell.size(), fingerprintLowSeed + column));
+        }
+
+        return result;
+    }
+
+    RowFingerprintTable::RowFingerprintTable(const CSVDocument& document)
+        : m_document(&document)
+        , m_fingerprints()
+        , m_slots()
+    {
+        const int rowCount = document.rowCount();
+        allocateSlots(rowCount);
+
+        // Fingerprint every row exactly once.
+        m_fingerprints.reserve(rowCount);
+        for (int rowIterator = 0; rowIterator < rowCount; rowIterator++)
+        {
+            m_fingerprints.append(RowFingerprint::fromRow(document, rowIterator));
+        }
+
+        const CSVRowComparator comparator(document, document);
+        for (int rowIterator = 0; rowIterator < rowCount; rowIterator++)
+        {
+            insert(rowIterator, comparator);
+        }
+    }
+
+    RowFingerprintTable::RowFingerprintTable(const CSVDocument& document, const QList<RowFingerprint>& fingerprints, const QList<int>& rows)
+        : m_document(&document)
+        , m_fingerprints(fingerprints)
+        , m_slots()
+    {
+        ARRIVAL_TRACE_SCOPE("diff.index");
+
+        allocateSlots(rows.count());
+
+        const CSVRowComparator comparator(document, document);
+        for (const int row : rows)
+        {
+            insert(row, comparator);
+        }
+    }
+
+    void RowFingerprintTable::allocateSlots(qsizetype rowCount)
+    {
+        // Keep the load factor at or below one half so probe sequences stay short.
+        qsizetype slotCount = 16;
+        while (slotCount < rowCount * 2)
+        {
+            slotCount *= 2;
+        }
+        m_slots.resize(slotCount);
+    }
+
+    void RowFingerprintTable::insert(int row, const CSVRowComparator& comparator)
+    {
+        const RowFingerprint& fingerprint = m_fingerprints.at(row);
+        const qsizetype mask = m_slots.count() - 1;
+
+        for (qsizetype slotIterator = slotIndex(fingerprint); ; slotIterator = (slotIterator + 1) & mask)
+        {
+            Slot& slot = m_slots[slotIterator];
+            if (slot.row < 0)
+            {
+                slot.fingerprint = fingerprint;
+                slot.row = row;
+                return;
+            }
+
+            // Identical rows are only stored once.
+            // This keeps files with many duplicated rows from building long probe sequences.
+            if (slot.fingerprint == fingerprint && comparator.equals(slot.row, row))
+            {
+                return;
+            }
+        }
+    }
+
+    int RowFingerprintTable::findRow(const CSVDocument& document, int row, const RowFingerprint& fingerprint) const
+    {
+        const qsizetype mask = m_slots.count() - 1;
+
+        for (qsizetype slotIterator = slotIndex(fingerprint); ; slotIterator = (slotIterator + 1) & mask)
+        {
+            const Slot& slot = m_slots.at(slotIterator);
+            if (slot.row < 0)
+            {
+                return -1;
+            }
+
+            // Matching fingerprints are confirmed cell by cell to rule out collisions.
+            if (slot.fingerprint == fingerprint && m_document->rowEquals(slot.row, document, row))
+            {
+                return slot.row;
+            }
+        }
+    }
+
+    int RowFingerprintTable::findRow(const CSVRowComparator& comparator, int row, const RowFingerprint& fingerprint) const
+    {
+        const qsizetype mask = m_slots.count() - 1;
+
+        for (qsizetype slotIterator = slotIndex(fingerprint); ; slotIterator = (slotIterator + 1) & mask)
+        {
+            const Slot& slot = m_slots.at(slotIterator);
+            if (slot.row < 0)
+            {
+                return -1;
+            }
+
+            // Matching fingerprints are confirmed cell by cell to rule out collisions.
+            if (slot.fingerprint == fingerprint && comparator.equals(slot.row, row))
+            {
+                return slot.row;
+            }
+        }
+    }
+}
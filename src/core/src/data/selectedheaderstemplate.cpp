@@ -5,7 +5,6 @@
 #include <QCryptographicHash>
 #include <QDebug>
 #include <QJsonObject>
-#include <QJSValue>
 #include <QJsonArray>
 
 #include "data/selectedheaderstemplate.h"
@@ -16,15 +15,17 @@ namespace Arrival::App
         : m_headerIdentifier()
         , m_templateName()
         , m_headerIndices()
+        , m_keyColumnNames()
     {}
 
-    SelectedHeadersTemplate::SelectedHeadersTemplate(const QString& headerIdentifier, const QString& templateName, const QList<int>& indices)
+    SelectedHeadersTemplate::SelectedHeadersTemplate(const QString& headerIdentifier, const QString& templateName, const QList<int>& indices, const QList<QString>& keyColumnNames)
         : m_headerIdentifier(headerIdentifier)
         , m_templateName(templateName)
         , m_headerIndices(indices)
+        , m_keyColumnNames(keyColumnNames)
     {}
 
-    SelectedHeadersTemplate::SelectedHeadersTemplate(const QString& templateName, const QList<QString>& headerNames, const QList<int>& indices)
+    SelectedHeadersTemplate::SelectedHeadersTemplate(const QString& templateName, const QList<QString>& headerNames, const QList<int>& indices, const QList<QString>& keyColumnNames)
     {
         // Get the hash.
         if (const auto result = generateUniqueIdentifierFromHeaderList(headerNames); result.has_value())
@@ -44,6 +45,7 @@ namespace Arrival::App
 
         m_templateName = templateName;
         m_headerIndices = indices;
+        m_keyColumnNames = keyColumnNames;
     }
 
     std::expected<SelectedHeadersTemplate, SelectedHeadersTemplate::FromJsonError> SelectedHeadersTemplate::fromJson(const QJsonObject& jsonObject)
@@ -90,6 +92,25 @@ namespace Arrival::App
             return std::unexpected<SelectedHeadersTemplate::FromJsonError>(SelectedHeadersTemplate::FromJsonError::ParseError);
         }
 
+        // Get the key columns. Templates saved before key columns existed do not have any.
+        if (const QJsonValue value = jsonObject[keyColumnsJsonName]; value.isArray())
+        {
+            const QJsonArray keyColumns = value.toArray();
+            result.m_keyColumnNames.reserve(keyColumns.count());
+            for (const QJsonValue& keyColumn : keyColumns)
+            {
+                if (!keyColumn.isString())
+                {
+                    return std::unexpected<SelectedHeadersTemplate::FromJsonError>(SelectedHeadersTemplate::FromJsonError::ParseError);
+                }
+                result.m_keyColumnNames.append(keyColumn.toString());
+            }
+        }
+        else if (!value.isUndefined())
+        {
+            return std::unexpected<SelectedHeadersTemplate::FromJsonError>(SelectedHeadersTemplate::FromJsonError::ParseError);
+        }
+
         return result;
     }
 
@@ -127,6 +148,12 @@ namespace Arrival::App
         }
         result[indicesJsonName] = indicesArray;
 
+        // Only written if set, so the file stays readable by older versions.
+        if (!m_keyColumnNames.isEmpty())
+        {
+            result[keyColumnsJsonName] = QJsonArray::fromStringList(m_keyColumnNames);
+        }
+
         return result;
     }
 }
@@ -23,6 +23,11 @@ namespace Arrival::App
         return m_templates.at(index).headerIndices();
     }
 
+    QList<QString> SelectedHeadersTemplateList::getTemplateKeyColumnNames(int index) const
+    {
+        return m_templates.at(index).keyColumnNames();
+    }
+
     void SelectedHeadersTemplateList::saveToJson(const QString& file) const
     {
         if (file.isEmpty())
@@ -109,9 +114,9 @@ namespace Arrival::App
         emit postListReset();
     }
 
-    void SelectedHeadersTemplateList::addNewTemplate(const QString& formatIdentifier, const QString& templateName, const QList<int>& indices)
+    void SelectedHeadersTemplateList::addNewTemplate(const QString& formatIdentifier, const QString& templateName, const QList<int>& indices, const QList<QString>& keyColumnNames)
     {
-        SelectedHeadersTemplate newTemplate(formatIdentifier, templateName, indices);
+        SelectedHeadersTemplate newTemplate(formatIdentifier, templateName, indices, keyColumnNames);
         appendItem(newTemplate);
 
         saveToJson(templateFileName);
@@ -0,0 +1,419 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#include <utility>
+
+#include "data/xlsxstreamwriter.h"
+#include "trace/tracerecorder.h"
+
+namespace Arrival::App
+{
+    // Sheet XML is compressed in blocks of this size.
+    static constexpr qsizetype xlsxFlushSize = 64 * 1024;
+
+    static constexpr char xlsxSheetPath[] = "xl/worksheets/sheet1.xml";
+
+    static constexpr char xlsxSheetBegin[] =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+        "<worksheet xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\"><sheetData>";
+
+    static constexpr char xlsxSheetEnd[] = "</sheetData></worksheet>";
+
+    static constexpr char xlsxContentTypesBegin[] =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+        "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"
+        "<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>"
+        "<Default Extension=\"xml\" ContentType=\"application/xml\"/>"
+        "<Override PartName=\"/xl/workbook.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.sheet.main+xml\"/>"
+        "<Override PartName=\"/xl/worksheets/sheet1.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.worksheet+xml\"/>"
+        "<Override PartName=\"/xl/styles.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.styles+xml\"/>";
+
+    static constexpr char xlsxSharedStringsContentType[] =
+        "<Override PartName=\"/xl/sharedStrings.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.sharedStrings+xml\"/>";
+
+    static constexpr char xlsxContentTypesEnd[] = "</Types>";
+
+    static constexpr char xlsxRootRelationships[] =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+        "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+        "<Relationship Id=\"rId1\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/officeDocument\" Target=\"xl/workbook.xml\"/>"
+        "</Relationships>";
+
+    static constexpr char xlsxWorkbook[] =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+        "<workbook xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\" "
+        "xmlns:r=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships\">"
+        "<sheets><sheet name=\"Sheet1\" sheetId=\"1\" r:id=\"rId1\"/></sheets>"
+        "</workbook>";
+
+    static constexpr char xlsxWorkbookRelationshipsBegin[] =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+        "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+        "<Relationship Id=\"rId1\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/worksheet\" Target=\"worksheets/sheet1.xml\"/>"
+        "<Relationship Id=\"rId2\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/styles\" Target=\"styles.xml\"/>";
+
+    static constexpr char xlsxSharedStringsRelationship[] =
+        "<Relationship Id=\"rId3\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/sharedStrings\" Target=\"sharedStrings.xml\"/>";
+
+    static constexpr char xlsxWorkbookRelationshipsEnd[] = "</Relationships>";
+
+    // The XML that starts a cell with a format, 0 for no format.
+    static QByteArray cellPrefix(int format)
+    {
+        return format > 0 ? "<c t=\"inlineStr\" s=\"" + QByteArray::number(format) + "\"><is><t" : QByteArray("<c t=\"inlineStr\"><is><t");
+    }
+
+    // The XML that starts a cell holding a shared string with a format, 0 for no format.
+    static QByteArray sharedCellPrefix(int format)
+    {
+        return format > 0 ? "<c t=\"s\" s=\"" + QByteArray::number(format) + "\"><v>" : QByteArray("<c t=\"s\"><v>");
+    }
+
+    // Appends UTF-8 text escaped for XML character data.
+    // Characters that are not allowed in XML are dropped.
+    static void appendEscaped(QByteArray& out, QByteArrayView value)
+    {
+        const char* data = value.data();
+        const qsizetype size = value.size();
+        qsizetype begin = 0;
+        for (qsizetype i = 0; i < size; i++)
+        {
+            const char character = data[i];
+            const char* replacement = nullptr;
+            switch (character)
+            {
+            case '&':
+                replacement = "&amp;";
+                break;
+            case '<':
+                replacement = "&lt;";
+                break;
+            case '>':
+                replacement = "&gt;";
+                break;
+            case '\r':
+                // A plain carriage return would be normalized away by the XML parser.
+                replacement = "&#13;";
+                break;
+            case '\t':
+            case '\n':
+                continue;
+            default:
+                if (static_cast<quint8>(character) >= 0x20)
+                {
+                    continue;
+                }
+                replacement = "";
+                break;
+            }
+            out.append(data + begin, i - begin);
+            out.append(replacement);
+            begin = i + 1;
+        }
+        out.append(data + begin, size - begin);
+    }
+
+    static bool isXmlWhitespace(char character)
+    {
+        return character == ' ' || character == '\t' || character == '\n' || character == '\r';
+    }
+
+    // Appends the rest of an opened \c t element: its attributes, the escaped text and the closing tag.
+    static void appendText(QByteArray& out, QByteArrayView value)
+    {
+        if (!value.isEmpty() && (isXmlWhitespace(value.front()) || isXmlWhitespace(value.back())))
+        {
+            out.append(" xml:space=\"preserve\"");
+        }
+        out.append('>');
+        appendEscaped(out, value);
+        out.append("</t>");
+    }
+
+    XlsxStreamWriter::XlsxStreamWriter(const QString& filePath)
+        : m_file(filePath)
+        , m_zip(&m_file)
+        , m_fills()
+        , m_sharedStrings()
+        , m_sharedStringIndices()
+        , m_buffer()
+        , m_cellPrefix()
+        , m_sharedCellPrefix()
+        , m_rowCount(0)
+        , m_isOpen(false)
+        , m_isFinished(false)
+        , m_errorString()
+    {
+        m_buffer.reserve(xlsxFlushSize + 4 * 1024);
+    }
+
+    XlsxStreamWriter::~XlsxStreamWriter()
+    {
+        // Do not leave a broken file behind.
+        cancel();
+    }
+
+    int XlsxStreamWriter::addFillFormat(quint32 argb)
+    {
+        m_fills.append(argb);
+        return static_cast<int>(m_fills.count());
+    }
+
+    int XlsxStreamWriter::addSharedString(QByteArrayView value)
+    {
+        QByteArray key = value.toByteArray();
+        const auto iterator = m_sharedStringIndices.constFind(key);
+        if (iterator != m_sharedStringIndices.constEnd())
+        {
+            return *iterator;
+        }
+
+        const int index = static_cast<int>(m_sharedStringIndices.count());
+        m_sharedStringIndices.insert(std::move(key), index);
+
+        // Values that might not fit into Excel or contain invalid UTF-8 are cut and repaired like the cells.
+        m_sharedStrings.append("<si><t");
+        if (value.size() > maximumCellLength || !value.isValidUtf8())
+        {
+            appendText(m_sharedStrings, QString::fromUtf8(value).left(maximumCellLength).toUtf8());
+        }
+        else
+        {
+            appendText(m_sharedStrings, value);
+        }
+        m_sharedStrings.append("</si>");
+        return index;
+    }
+
+    bool XlsxStreamWriter::open()
+    {
+        ARRIVAL_TRACE_SCOPE("xlsx.open");
+
+        // Guard.
+        if (m_isOpen || m_isFinished)
+        {
+            return false;
+        }
+        if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            m_errorString = m_file.errorString();
+            return false;
+        }
+        m_isOpen = true;
+
+        // The sheet is the only large part, it is streamed first. The other parts are written by close().
+        m_buffer.append(xlsxSheetBegin);
+        return m_zip.beginEntry(QString::fromLatin1(xlsxSheetPath));
+    }
+
+    bool XlsxStreamWriter::beginRow(int format)
+    {
+        // Guard.
+        if (!m_isOpen || hasError())
+        {
+            return false;
+        }
+        if (isFull())
+        {
+            return false;
+        }
+        Q_ASSERT(format >= 0 && format <= m_fills.count());
+
+        m_rowCount++;
+        m_buffer.append("<row r=\"");
+        m_buffer.append(QByteArray::number(m_rowCount));
+        m_buffer.append("\">");
+
+        // Every cell of the row starts the same way, so the prefixes are only built once per row.
+        m_cellPrefix = cellPrefix(format);
+        m_sharedCellPrefix = sharedCellPrefix(format);
+        return true;
+    }
+
+    void XlsxStreamWriter::writeCell(QByteArrayView value)
+    {
+        // Cells that might not fit into Excel or contain invalid UTF-8 take the slow path.
+        if (value.size() > maximumCellLength || !value.isValidUtf8())
+        {
+            writeCell(QString::fromUtf8(value));
+            return;
+        }
+        appendCell(value);
+    }
+
+    void XlsxStreamWriter::writeCell(QByteArrayView value, int format)
+    {
+        Q_ASSERT(format >= 0 && format <= m_fills.count());
+
+        // Only a few cells differ from their row, so the prefix of the row is swapped for a single cell.
+        const QByteArray rowPrefix = std::exchange(m_cellPrefix, cellPrefix(format));
+        writeCell(value);
+        m_cellPrefix = rowPrefix;
+    }
+
+    void XlsxStreamWriter::writeCell(const QString& value)
+    {
+        appendCell(value.left(maximumCellLength).toUtf8());
+    }
+
+    void XlsxStreamWriter::writeSharedCell(int index)
+    {
+        Q_ASSERT(index >= 0 && index < m_sharedStringIndices.count());
+
+        m_buffer.append(m_sharedCellPrefix);
+        m_buffer.append(QByteArray::number(index));
+        m_buffer.append("</v></c>");
+    }
+
+    void XlsxStreamWriter::writeSharedCell(int index, int format)
+    {
+        Q_ASSERT(format >= 0 && format <= m_fills.count());
+
+        const QByteArray rowPrefix = std::exchange(m_sharedCellPrefix, sharedCellPrefix(format));
+        writeSharedCell(index);
+        m_sharedCellPrefix = rowPrefix;
+    }
+
+    bool XlsxStreamWriter::endRow()
+    {
+        m_buffer.append("</row>");
+        return m_buffer.size() < xlsxFlushSize || flush();
+    }
+
+    bool XlsxStreamWriter::close()
+    {
+        ARRIVAL_TRACE_SCOPE("xlsx.close");
+
+        // Guard.
+        if (!m_isOpen || hasError())
+        {
+            return false;
+        }
+
+        m_buffer.append(xlsxSheetEnd);
+        const bool success = flush()
+            && m_zip.endEntry()
+            && (m_sharedStringIndices.isEmpty() || m_zip.addEntry(QStringLiteral("xl/sharedStrings.xml"), sharedStringsXml()))
+            && m_zip.addEntry(QStringLiteral("xl/styles.xml"), stylesXml())
+            && m_zip.addEntry(QStringLiteral("xl/workbook.xml"), xlsxWorkbook)
+            && m_zip.addEntry(QStringLiteral("xl/_rels/workbook.xml.rels"), workbookRelationshipsXml())
+            && m_zip.addEntry(QStringLiteral("_rels/.rels"), xlsxRootRelationships)
+            && m_zip.addEntry(QStringLiteral("[Content_Types].xml"), contentTypesXml())
+            && m_zip.close()
+            && m_file.flush();
+        if (!success)
+        {
+            cancel();
+            return false;
+        }
+
+        m_file.close();
+        m_isOpen = false;
+        m_isFinished = true;
+        return true;
+    }
+
+    void XlsxStreamWriter::cancel()
+    {
+        // Guard.
+        if (!m_isOpen)
+        {
+            return;
+        }
+
+        m_isOpen = false;
+        m_buffer.clear();
+        m_file.close();
+        m_file.remove();
+    }
+
+    void XlsxStreamWriter::appendCell(QByteArrayView value)
+    {
+        m_buffer.append(m_cellPrefix);
+        appendText(m_buffer, value);
+        m_buffer.append("</is></c>");
+    }
+
+    bool XlsxStreamWriter::flush()
+    {
+        ARRIVAL_TRACE_SCOPE("xlsx.flush");
+
+        if (!m_zip.write(m_buffer))
+        {
+            return false;
+        }
+
+        // Keep the capacity of the buffer.
+        m_buffer.resize(0);
+        return true;
+    }
+
+    QByteArray XlsxStreamWriter::stylesXml() const
+    {
+        QByteArray xml;
+        xml.append("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+                   "<styleSheet xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\">"
+                   "<fonts count=\"1\"><font><sz val=\"11\"/><name val=\"Calibri\"/><family val=\"2\"/></font></fonts>");
+
+        // The first two fills are reserved by Excel.
+        xml.append("<fills count=\"" + QByteArray::number(m_fills.count() + 2) + "\">"
+                   "<fill><patternFill patternType=\"none\"/></fill>"
+                   "<fill><patternFill patternType=\"gray125\"/></fill>");
+        for (const quint32 argb : m_fills)
+        {
+            const QByteArray color = QByteArray::number(argb, 16).rightJustified(8, '0').toUpper();
+            xml.append("<fill><patternFill patternType=\"solid\"><fgColor rgb=\"" + color + "\"/><bgColor indexed=\"64\"/></patternFill></fill>");
+        }
+        xml.append("</fills>"
+                   "<borders count=\"1\"><border><left/><right/><top/><bottom/><diagonal/></border></borders>"
+                   "<cellStyleXfs count=\"1\"><xf numFmtId=\"0\" fontId=\"0\" fillId=\"0\" borderId=\"0\"/></cellStyleXfs>");
+
+        // Format n uses fill n + 1, format 0 is the default format.
+        xml.append("<cellXfs count=\"" + QByteArray::number(m_fills.count() + 1) + "\">"
+                   "<xf numFmtId=\"0\" fontId=\"0\" fillId=\"0\" borderId=\"0\" xfId=\"0\"/>");
+        for (qsizetype i = 0; i < m_fills.count(); i++)
+        {
+            xml.append("<xf numFmtId=\"0\" fontId=\"0\" fillId=\"" + QByteArray::number(i + 2) + "\" borderId=\"0\" xfId=\"0\" applyFill=\"1\"/>");
+        }
+        xml.append("</cellXfs>"
+                   "<cellStyles count=\"1\"><cellStyle name=\"Normal\" xfId=\"0\" builtinId=\"0\"/></cellStyles>"
+                   "</styleSheet>");
+        return xml;
+    }
+
+    QByteArray XlsxStreamWriter::sharedStringsXml() const
+    {
+        QByteArray xml;
+        xml.reserve(m_sharedStrings.size() + 256);
+        xml.append("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+                   "<sst xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\" uniqueCount=\"");
+        xml.append(QByteArray::number(m_sharedStringIndices.count()));
+        xml.append("\">");
+        xml.append(m_sharedStrings);
+        xml.append("</sst>");
+        return xml;
+    }
+
+    QByteArray XlsxStreamWriter::contentTypesXml() const
+    {
+        QByteArray xml(xlsxContentTypesBegin);
+        if (!m_sharedStringIndices.isEmpty())
+        {
+            xml.append(xlsxSharedStringsContentType);
+        }
+        xml.append(xlsxContentTypesEnd);
+        return xml;
+    }
+
+    QByteArray XlsxStreamWriter::workbookRelationshipsXml() const
+    {
+        QByteArray xml(xlsxWorkbookRelationshipsBegin);
+        if (!m_sharedStringIndices.isEmpty())
+        {
+            xml.append(xlsxSharedStringsRelationship);
+        }
+        xml.append(xlsxWorkbookRelationshipsEnd);
+        return xml;
+    }
+}
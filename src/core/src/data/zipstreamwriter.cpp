@@ -0,0 +1,504 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#include <QDateTime>
+#include <QtEndian>
+
+#include <array>
+#include <limits>
+
+#if ARRIVAL_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+#include "data/zipstreamwriter.h"
+#include "trace/tracerecorder.h"
+
+namespace Arrival::App
+{
+    // Compressed bytes are handed to the device in blocks of this size.
+    static constexpr qsizetype zipFlushSize = 256 * 1024;
+
+    // Sizes and offsets from this value on are moved into the zip64 extension,
+    // the 32 bit fields then hold this value to point readers there.
+    static constexpr quint64 zipMaximumSize = std::numeric_limits<quint32>::max();
+
+    // Entry counts from this value on are moved into the zip64 end of central directory record.
+    static constexpr quint64 zipMaximumCount = std::numeric_limits<quint16>::max();
+
+    static constexpr quint16 zipVersion = 20;
+    static constexpr quint16 zipVersionZip64 = 45;
+    static constexpr quint16 zipUtf8NameFlag = 0x0800;
+    static constexpr quint16 zipMethodStored = 0;
+    static constexpr quint16 zipMethodDeflated = 8;
+
+    static constexpr quint16 zipZip64Tag = 0x0001;
+
+    // Readers skip extra fields they do not know. The local header reserves one with this tag,
+    // endEntry() turns it into the zip64 extra field if the sizes of the entry do not fit into 32 bits.
+    static constexpr quint16 zipReservedTag = 0xD935;
+
+    // The zip64 extra field of a local header holds both sizes.
+    static constexpr quint16 zipLocalZip64Size = 16;
+
+    static bool exceedsZip(quint64 value)
+    {
+        return value >= zipMaximumSize;
+    }
+
+    static void appendLittleEndian16(QByteArray& out, quint16 value)
+    {
+        char bytes[2];
+        qToLittleEndian<quint16>(value, bytes);
+        out.append(bytes, 2);
+    }
+
+    static void appendLittleEndian32(QByteArray& out, quint32 value)
+    {
+        char bytes[4];
+        qToLittleEndian<quint32>(value, bytes);
+        out.append(bytes, 4);
+    }
+
+    static void appendLittleEndian64(QByteArray& out, quint64 value)
+    {
+        char bytes[8];
+        qToLittleEndian<quint64>(value, bytes);
+        out.append(bytes, 8);
+    }
+
+    // Appends a size or offset to a 32 bit field, or the marker if it is stored in the zip64 extension.
+    static void appendZip32(QByteArray& out, quint64 value)
+    {
+        appendLittleEndian32(out, exceedsZip(value) ? static_cast<quint32>(zipMaximumSize) : static_cast<quint32>(value));
+    }
+
+#if !ARRIVAL_HAS_ZLIB
+    static constexpr std::array<quint32, 256> crc32Table = []()
+    {
+        std::array<quint32, 256> table = {};
+        for (quint32 i = 0; i < 256; i++)
+        {
+            quint32 crc = i;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+            }
+            table[i] = crc;
+        }
+        return table;
+    }();
+#endif
+
+    static quint32 updateCrc32(quint32 crc, QByteArrayView data)
+    {
+#if ARRIVAL_HAS_ZLIB
+        // zlib takes 32 bit lengths.
+        const char* bytes = data.data();
+        qsizetype remaining = data.size();
+        while (remaining > 0)
+        {
+            const uInt size = static_cast<uInt>(qMin<qsizetype>(remaining, 1 << 30));
+            crc = static_cast<quint32>(::crc32(crc, reinterpret_cast<const Bytef*>(bytes), size));
+            bytes += size;
+            remaining -= size;
+        }
+        return crc;
+#else
+        crc = ~crc;
+        for (const char byte : data)
+        {
+            crc = crc32Table[(crc ^ static_cast<quint8>(byte)) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+#endif
+    }
+
+    /*!
+     * \brief The ZipStreamWriter::Deflater class compresses the content of one entry at a time.
+     * Without zlib the content is passed through and the entry is stored.
+     */
+    class ZipStreamWriter::Deflater
+    {
+    public:
+        explicit Deflater(int compressionLevel)
+#if ARRIVAL_HAS_ZLIB
+            : m_stream()
+            , m_isInitialized(false)
+#endif
+        {
+#if ARRIVAL_HAS_ZLIB
+            // Negative window bits produce a raw deflate stream as required by the zip format.
+            m_isInitialized = deflateInit2(&m_stream, qBound(0, compressionLevel, 9), Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+#else
+            Q_UNUSED(compressionLevel);
+#endif
+        }
+
+        ~Deflater()
+        {
+#if ARRIVAL_HAS_ZLIB
+            if (m_isInitialized)
+            {
+                deflateEnd(&m_stream);
+            }
+#endif
+        }
+
+        quint16 method() const
+        {
+#if ARRIVAL_HAS_ZLIB
+            return zipMethodDeflated;
+#else
+            return zipMethodStored;
+#endif
+        }
+
+        bool reset()
+        {
+#if ARRIVAL_HAS_ZLIB
+            return m_isInitialized && deflateReset(&m_stream) == Z_OK;
+#else
+            return true;
+#endif
+        }
+
+        /*!
+         * \brief deflate Compresses data and appends the compressed bytes to output.
+         * \param data The data to compress.
+         * \param finish True to flush every remaining byte and end the stream.
+         * \param output Receives the compressed bytes.
+         * \return True on success, false otherwise.
+         */
+        bool deflate(QByteArrayView data, bool finish, QByteArray& output)
+        {
+#if ARRIVAL_HAS_ZLIB
+            const char* bytes = data.data();
+            qsizetype remaining = data.size();
+            do
+            {
+                // zlib takes 32 bit lengths.
+                const uInt inputSize = static_cast<uInt>(qMin<qsizetype>(remaining, 1 << 30));
+                remaining -= inputSize;
+                const bool isLast = remaining == 0;
+
+                m_stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(bytes));
+                m_stream.avail_in = inputSize;
+                bytes += inputSize;
+
+                const int flush = finish && isLast ? Z_FINISH : Z_NO_FLUSH;
+                int result = Z_OK;
+                do
+                {
+                    const qsizetype outputSize = output.size();
+                    const uInt chunkSize = static_cast<uInt>(qMax<qsizetype>(deflateBound(&m_stream, m_stream.avail_in), 64 * 1024));
+                    output.resize(outputSize + chunkSize);
+                    m_stream.next_out = reinterpret_cast<Bytef*>(output.data() + outputSize);
+                    m_stream.avail_out = chunkSize;
+
+                    result = ::deflate(&m_stream, flush);
+                    output.resize(outputSize + (chunkSize - m_stream.avail_out));
+                    if (result == Z_STREAM_ERROR)
+                    {
+                        return false;
+                    }
+                } while (m_stream.avail_out == 0 || (flush == Z_FINISH && result != Z_STREAM_END));
+            } while (remaining > 0);
+            return true;
+#else
+            Q_UNUSED(finish);
+            output.append(data);
+            return true;
+#endif
+        }
+
+    private:
+#if ARRIVAL_HAS_ZLIB
+        z_stream m_stream;
+        bool m_isInitialized;
+#endif
+    };
+
+    ZipStreamWriter::ZipStreamWriter(QIODevice* device, int compressionLevel)
+        : m_device(device)
+        , m_deflater(new Deflater(compressionLevel))
+        , m_entries()
+        , m_current()
+        , m_hasCurrent(false)
+        , m_buffer()
+        , m_offset(0)
+        , m_dosTime(0)
+        , m_dosDate(0)
+        , m_errorString()
+    {
+        Q_CHECK_PTR(device);
+        Q_ASSERT(!device->isSequential());
+
+        // Every entry gets the time the archive was created.
+        const QDateTime now = QDateTime::currentDateTime();
+        const QDate date = now.date();
+        const QTime time = now.time();
+        m_dosTime = static_cast<quint16>((time.hour() << 11) | (time.minute() << 5) | (time.second() / 2));
+        m_dosDate = static_cast<quint16>((qMax(date.year() - 1980, 0) << 9) | (date.month() << 5) | date.day());
+
+        m_offset = static_cast<quint64>(qMax<qint64>(device->pos(), 0));
+        m_buffer.reserve(zipFlushSize + 64 * 1024);
+    }
+
+    ZipStreamWriter::~ZipStreamWriter()
+    {
+    }
+
+    bool ZipStreamWriter::beginEntry(const QString& name)
+    {
+        // Guard.
+        if (hasError() || (m_hasCurrent && !endEntry()))
+        {
+            return false;
+        }
+        if (!m_deflater->reset())
+        {
+            return setError(QStringLiteral("Could not initialize the compression"));
+        }
+
+        m_current = Entry();
+        m_current.name = name.toUtf8();
+        m_current.crc = 0;
+        m_current.compressedSize = 0;
+        m_current.uncompressedSize = 0;
+        m_current.localHeaderOffset = m_offset;
+        m_hasCurrent = true;
+
+        // The checksum and the sizes are not known yet, they are patched in by endEntry().
+        QByteArray header;
+        header.reserve(30 + m_current.name.size() + 4 + zipLocalZip64Size);
+        appendLittleEndian32(header, 0x04034b50);
+        appendLittleEndian16(header, zipVersion);
+        appendLittleEndian16(header, zipUtf8NameFlag);
+        appendLittleEndian16(header, m_deflater->method());
+        appendLittleEndian16(header, m_dosTime);
+        appendLittleEndian16(header, m_dosDate);
+        appendLittleEndian32(header, 0);
+        appendLittleEndian32(header, 0);
+        appendLittleEndian32(header, 0);
+        appendLittleEndian16(header, static_cast<quint16>(m_current.name.size()));
+        appendLittleEndian16(header, static_cast<quint16>(4 + zipLocalZip64Size));
+        header.append(m_current.name);
+        appendLittleEndian16(header, zipReservedTag);
+        appendLittleEndian16(header, zipLocalZip64Size);
+        header.append(QByteArray(zipLocalZip64Size, '\0'));
+        return writeToDevice(header);
+    }
+
+    bool ZipStreamWriter::write(QByteArrayView data)
+    {
+        // Guard.
+        if (hasError() || !m_hasCurrent)
+        {
+            return false;
+        }
+
+        m_current.crc = updateCrc32(m_current.crc, data);
+        m_current.uncompressedSize += static_cast<quint64>(data.size());
+        if (!m_deflater->deflate(data, false, m_buffer))
+        {
+            return setError(QStringLiteral("Could not compress the entry"));
+        }
+        return m_buffer.size() < zipFlushSize || flush();
+    }
+
+    bool ZipStreamWriter::endEntry()
+    {
+        // Guard.
+        if (hasError() || !m_hasCurrent)
+        {
+            return false;
+        }
+        m_hasCurrent = false;
+
+        if (!m_deflater->deflate(QByteArrayView(), true, m_buffer))
+        {
+            return setError(QStringLiteral("Could not compress the entry"));
+        }
+        if (!flush())
+        {
+            return false;
+        }
+        // Patch the checksum and the sizes into the local header.
+        // Sizes beyond 32 bits go into the reserved extra field, which becomes the zip64 extra field.
+        const bool isZip64 = exceedsZip(m_current.uncompressedSize) || exceedsZip(m_current.compressedSize);
+        QByteArray version;
+        appendLittleEndian16(version, isZip64 ? zipVersionZip64 : zipVersion);
+        QByteArray sizes;
+        appendLittleEndian32(sizes, m_current.crc);
+        if (isZip64)
+        {
+            appendLittleEndian32(sizes, static_cast<quint32>(zipMaximumSize));
+            appendLittleEndian32(sizes, static_cast<quint32>(zipMaximumSize));
+        }
+        else
+        {
+            appendLittleEndian32(sizes, static_cast<quint32>(m_current.compressedSize));
+            appendLittleEndian32(sizes, static_cast<quint32>(m_current.uncompressedSize));
+        }
+        QByteArray extra;
+        appendLittleEndian16(extra, isZip64 ? zipZip64Tag : zipReservedTag);
+        appendLittleEndian16(extra, zipLocalZip64Size);
+        appendLittleEndian64(extra, isZip64 ? m_current.uncompressedSize : 0);
+        appendLittleEndian64(extra, isZip64 ? m_current.compressedSize : 0);
+
+        const qint64 headerOffset = static_cast<qint64>(m_current.localHeaderOffset);
+        if (!m_device->seek(headerOffset + 4) ||
+            m_device->write(version) != version.size() ||
+            !m_device->seek(headerOffset + 14) ||
+            m_device->write(sizes) != sizes.size() ||
+            !m_device->seek(headerOffset + 30 + m_current.name.size()) ||
+            m_device->write(extra) != extra.size() ||
+            !m_device->seek(static_cast<qint64>(m_offset)))
+        {
+            return setError(m_device->errorString());
+        }
+
+        m_entries.append(m_current);
+        return true;
+    }
+
+    bool ZipStreamWriter::addEntry(const QString& name, QByteArrayView data)
+    {
+        return beginEntry(name) && write(data) && endEntry();
+    }
+
+    bool ZipStreamWriter::close()
+    {
+        ARRIVAL_TRACE_SCOPE("zip.close");
+
+        // Guard.
+        if (hasError() || (m_hasCurrent && !endEntry()))
+        {
+            return false;
+        }
+
+        const quint64 centralDirectoryOffset = m_offset;
+        QByteArray centralDirectory;
+        for (const Entry& entry : m_entries)
+        {
+            // The zip64 extra field holds only the values that do not fit, in this order.
+            QByteArray zip64;
+            if (exceedsZip(entry.uncompressedSize))
+            {
+                appendLittleEndian64(zip64, entry.uncompressedSize);
+            }
+            if (exceedsZip(entry.compressedSize))
+            {
+                appendLittleEndian64(zip64, entry.compressedSize);
+            }
+            if (exceedsZip(entry.localHeaderOffset))
+            {
+                appendLittleEndian64(zip64, entry.localHeaderOffset);
+            }
+            const quint16 version = zip64.isEmpty() ? zipVersion : zipVersionZip64;
+
+            appendLittleEndian32(centralDirectory, 0x02014b50);
+            appendLittleEndian16(centralDirectory, version);
+            appendLittleEndian16(centralDirectory, version);
+            appendLittleEndian16(centralDirectory, zipUtf8NameFlag);
+            appendLittleEndian16(centralDirectory, m_deflater->method());
+            appendLittleEndian16(centralDirectory, m_dosTime);
+            appendLittleEndian16(centralDirectory, m_dosDate);
+            appendLittleEndian32(centralDirectory, entry.crc);
+            appendZip32(centralDirectory, entry.compressedSize);
+            appendZip32(centralDirectory, entry.uncompressedSize);
+            appendLittleEndian16(centralDirectory, static_cast<quint16>(entry.name.size()));
+            appendLittleEndian16(centralDirectory, static_cast<quint16>(zip64.isEmpty() ? 0 : 4 + zip64.size()));
+            appendLittleEndian16(centralDirectory, 0);
+            appendLittleEndian16(centralDirectory, 0);
+            appendLittleEndian16(centralDirectory, 0);
+            appendLittleEndian32(centralDirectory, 0);
+            appendZip32(centralDirectory, entry.localHeaderOffset);
+            centralDirectory.append(entry.name);
+            if (!zip64.isEmpty())
+            {
+                appendLittleEndian16(centralDirectory, zipZip64Tag);
+                appendLittleEndian16(centralDirectory, static_cast<quint16>(zip64.size()));
+                centralDirectory.append(zip64);
+            }
+        }
+
+        const quint64 entryCount = static_cast<quint64>(m_entries.count());
+        const quint64 centralDirectorySize = static_cast<quint64>(centralDirectory.size());
+        const bool isZip64 = entryCount >= zipMaximumCount || exceedsZip(centralDirectorySize) || exceedsZip(centralDirectoryOffset);
+        if (isZip64)
+        {
+            // The zip64 end of central directory record, followed by the locator that points to it.
+            const quint64 recordOffset = centralDirectoryOffset + centralDirectorySize;
+            appendLittleEndian32(centralDirectory, 0x06064b50);
+            appendLittleEndian64(centralDirectory, 44);
+            appendLittleEndian16(centralDirectory, zipVersionZip64);
+            appendLittleEndian16(centralDirectory, zipVersionZip64);
+            appendLittleEndian32(centralDirectory, 0);
+            appendLittleEndian32(centralDirectory, 0);
+            appendLittleEndian64(centralDirectory, entryCount);
+            appendLittleEndian64(centralDirectory, entryCount);
+            appendLittleEndian64(centralDirectory, centralDirectorySize);
+            appendLittleEndian64(centralDirectory, centralDirectoryOffset);
+
+            appendLittleEndian32(centralDirectory, 0x07064b50);
+            appendLittleEndian32(centralDirectory, 0);
+            appendLittleEndian64(centralDirectory, recordOffset);
+            appendLittleEndian32(centralDirectory, 1);
+        }
+
+        const quint16 count = static_cast<quint16>(qMin(entryCount, zipMaximumCount));
+        appendLittleEndian32(centralDirectory, 0x06054b50);
+        appendLittleEndian16(centralDirectory, 0);
+        appendLittleEndian16(centralDirectory, 0);
+        appendLittleEndian16(centralDirectory, count);
+        appendLittleEndian16(centralDirectory, count);
+        appendZip32(centralDirectory, centralDirectorySize);
+        appendZip32(centralDirectory, centralDirectoryOffset);
+        appendLittleEndian16(centralDirectory, 0);
+        return writeToDevice(centralDirectory);
+    }
+
+    bool ZipStreamWriter::writeToDevice(QByteArrayView data)
+    {
+        if (m_device->write(data.data(), data.size()) != data.size())
+        {
+            return setError(m_device->errorString());
+        }
+        m_offset += static_cast<quint64>(data.size());
+        return true;
+    }
+
+    bool ZipStreamWriter::flush()
+    {
+        ARRIVAL_TRACE_SCOPE("zip.deflate");
+
+        // Guard.
+        if (m_buffer.isEmpty())
+        {
+            return true;
+        }
+
+        const qsizetype size = m_buffer.size();
+        if (!writeToDevice(m_buffer))
+        {
+            return false;
+        }
+        m_current.compressedSize += static_cast<quint64>(size);
+
+        // Keep the capacity of the buffer.
+        m_buffer.resize(0);
+        return true;
+    }
+
+    bool ZipStreamWriter::setError(const QString& errorString)
+    {
+        if (m_errorString.isEmpty())
+        {
+            m_errorString = errorString.isEmpty() ? QStringLiteral("Unknown error") : errorString;
+        }
+        return false;
+    }
+}
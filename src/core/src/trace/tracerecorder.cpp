@@ -0,0 +1,222 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QMutexLocker>
+#include <QThread>
+
+#include "trace/tracerecorder.h"
+
+namespace Arrival::App
+{
+    // The id of the calling thread inside the trace, -1 until the thread records its first span.
+    static thread_local int traceThread = -1;
+
+    // Writes the trace once the application is destroyed.
+    static void stopOnExit()
+    {
+        TraceRecorder::instance().stop();
+    }
+
+    // Appends a time in nanoseconds as microseconds, the unit of trace events.
+    static void appendMicroseconds(QByteArray& out, qint64 nanoseconds)
+    {
+        out.append(QByteArray::number(nanoseconds / 1000)).append('.').append(QByteArray::number(nanoseconds % 1000).rightJustified(3, '0'));
+    }
+
+    // Appends a string, escaping what JSON requires.
+    static void appendString(QByteArray& out, QByteArrayView value)
+    {
+        out.append('"');
+        for (const char character : value)
+        {
+            if (character == '"' || character == '\\')
+            {
+                out.append('\\');
+            }
+            if (static_cast<unsigned char>(character) < 0x20)
+            {
+                out.append(' ');
+                continue;
+            }
+            out.append(character);
+        }
+        out.append('"');
+    }
+
+    TraceRecorder& TraceRecorder::instance()
+    {
+        static TraceRecorder recorder;
+        return recorder;
+    }
+
+    TraceRecorder::TraceRecorder()
+        : m_isEnabled(false)
+        , m_timer()
+        , m_mutex()
+        , m_filePath()
+        , m_events()
+        , m_threadNames()
+        , m_pending()
+    {
+        m_timer.start();
+    }
+
+    void TraceRecorder::start(const QString& filePath)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_filePath = filePath;
+        m_events.clear();
+        m_pending.clear();
+
+        // Once is enough, stop does nothing while not recording.
+        static bool stopOnExitAdded = false;
+        if (!stopOnExitAdded && QCoreApplication::instance())
+        {
+            qAddPostRoutine(stopOnExit);
+            stopOnExitAdded = true;
+        }
+        m_isEnabled.store(true, std::memory_order_relaxed);
+    }
+
+    bool TraceRecorder::startFromEnvironment()
+    {
+        const QString filePath = qEnvironmentVariable(environmentVariable);
+        if (filePath.isEmpty())
+        {
+            return false;
+        }
+        start(filePath);
+        return true;
+    }
+
+    bool TraceRecorder::stop()
+    {
+        QMutexLocker locker(&m_mutex);
+
+        // Guard.
+        if (!m_isEnabled.load(std::memory_order_relaxed))
+        {
+            return true;
+        }
+        m_isEnabled.store(false, std::memory_order_relaxed);
+
+        const QByteArray json = toJson();
+        m_events.clear();
+        m_pending.clear();
+
+        QFile file(m_filePath);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(json) != json.size())
+        {
+            qWarning() << "The trace could not be written to" << m_filePath;
+            return false;
+        }
+        return true;
+    }
+
+    void TraceRecorder::record(const char* name, qint64 begin, qint64 end)
+    {
+        QMutexLocker locker(&m_mutex);
+
+        // Spans ending after stop are dropped.
+        if (!m_isEnabled.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+        m_events.append(TraceEvent{ name, currentThread(), begin, end });
+    }
+
+    void TraceRecorder::begin(const char* name)
+    {
+        const qint64 timestamp = now();
+        QMutexLocker locker(&m_mutex);
+        m_pending.insert(QByteArray(name), timestamp);
+    }
+
+    void TraceRecorder::end(const char* name)
+    {
+        const qint64 timestamp = now();
+        QMutexLocker locker(&m_mutex);
+        const auto iterator = m_pending.constFind(QByteArray::fromRawData(name, static_cast<qsizetype>(qstrlen(name))));
+        if (iterator == m_pending.constEnd() || !m_isEnabled.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+        m_events.append(TraceEvent{ name, currentThread(), iterator.value(), timestamp });
+        m_pending.erase(iterator);
+    }
+
+    int TraceRecorder::currentThread()
+    {
+        if (traceThread >= 0)
+        {
+            return traceThread;
+        }
+
+        traceThread = static_cast<int>(m_threadNames.count());
+        const QCoreApplication* application = QCoreApplication::instance();
+        if (application && application->thread() == QThread::currentThread())
+        {
+            m_threadNames.append("main");
+        }
+        else
+        {
+            const QString objectName = QThread::currentThread()->objectName();
+            m_threadNames.append((objectName.isEmpty() ? QByteArray("worker") : objectName.toUtf8()) + ' ' + QByteArray::number(traceThread));
+        }
+        return traceThread;
+    }
+
+    QByteArray TraceRecorder::toJson() const
+    {
+        const QByteArray processId = QByteArray::number(QCoreApplication::applicationPid());
+
+        QByteArray json;
+        json.reserve(128 * (m_events.count() + m_threadNames.count()) + 64);
+        json.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+        bool first = true;
+        const auto separate = [&]() {
+            if (!first)
+            {
+                json.append(",\n");
+            }
+            first = false;
+        };
+
+        for (qsizetype threadIterator = 0; threadIterator < m_threadNames.count(); threadIterator++)
+        {
+            separate();
+            json.append("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":").append(processId);
+            json.append(",\"tid\":").append(QByteArray::number(threadIterator)).append(",\"args\":{\"name\":");
+            appendString(json, m_threadNames.at(threadIterator));
+            json.append("}}");
+        }
+
+        for (const TraceEvent& event : m_events)
+        {
+            // The category is the prefix of the name, e.g. csv for csv.split.
+            const QByteArrayView name(event.name);
+            const qsizetype dot = name.indexOf('.');
+
+            separate();
+            json.append("{\"name\":");
+            appendString(json, name);
+            json.append(",\"cat\":");
+            appendString(json, dot > 0 ? name.first(dot) : QByteArrayView("arrival"));
+            json.append(",\"ph\":\"X\",\"pid\":").append(processId);
+            json.append(",\"tid\":").append(QByteArray::number(event.thread));
+            json.append(",\"ts\":");
+            appendMicroseconds(json, event.begin);
+            json.append(",\"dur\":");
+            appendMicroseconds(json, qMax<qint64>(0, event.end - event.begin));
+            json.append('}');
+        }
+
+        json.append("]}\n");
+        return json;
+    }
+}
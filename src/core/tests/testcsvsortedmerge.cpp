@@ -0,0 +1,134 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#include <QDir>
+#include <QHash>
+#include <QtTest>
+
+#include <algorithm>
+
+#include "data/csvhandling.h"
+#include "data/csvsortedmerge.h"
+#include "generator/jobsnapshotgenerator.h"
+#include "testcsvsortedmerge.h"
+
+using namespace Arrival::App;
+using namespace Arrival::Generator;
+
+namespace Arrival::Tests
+{
+    // Describes a row by its state, its cells, the cells it has been matched with if modified and its changed columns.
+    // Both comparisons hand out their rows in a different order, so the rows are compared by their descriptions.
+    static QString describe(JobTableRowState::State state, const QList<QString>& cells, const QList<QString>& previousCells, const QList<int>& changedColumns)
+    {
+        QStringList changed;
+        for (const int column : changedColumns)
+        {
+            changed.append(QString::number(column));
+        }
+        const QString cellSeparator = QStringLiteral("\x1f");
+        const QString fieldSeparator = QStringLiteral("\x1e");
+        return QString::number(state) + fieldSeparator + cells.join(cellSeparator) + fieldSeparator + previousCells.join(cellSeparator) + fieldSeparator + changed.join(QStringLiteral(","));
+    }
+
+    void TestCSVSortedMerge::initTestCase()
+    {
+        QVERIFY(m_directory.isValid());
+        m_oldPath = QDir(m_directory.path()).filePath("old.csv");
+        m_newPath = QDir(m_directory.path()).filePath("new.csv");
+
+        // The generated files are ordered by their Jobnumber. Duplicate Jobnumbers follow each other.
+        JobSnapshotOptions options;
+        options.jobCount = 20000;
+        options.columnCount = 12;
+        options.commentColumn = 7;
+        options.modifiedRate = 0.1;
+        options.multiLineRate = 0.05;
+        options.duplicateKeyRate = 0.03;
+        const auto written = JobSnapshotGenerator::write(m_oldPath, m_newPath, options);
+        QVERIFY2(written.has_value(), qPrintable(written.has_value() ? QString() : written.error()));
+    }
+
+    void TestCSVSortedMerge::testMergeMatchesInMemory()
+    {
+        QSharedPointer<CSVCombinedData> data;
+        QList<JobTableRow> rows;
+        CSVCombinedDataStream stream;
+        stream.started = [&data](QSharedPointer<CSVCombinedData> result) {
+            data = std::move(result);
+        };
+        stream.rowsReady = [&rows](QList<JobTableRow> readyRows) {
+            rows.append(readyRows);
+        };
+        QVERIFY(CSVCombinedData::streamCSVFiles(m_oldPath, m_newPath, CSVDocumentOptions(), CSVCombineOptions(), stream).has_value());
+
+        const int columnCount = data->columnCount();
+        QStringList expected;
+        QHash<int, qint64> stateCounts;
+        int duplicateCount = 0;
+        for (const JobTableRow& row : rows)
+        {
+            stateCounts[row.state]++;
+            const CSVDocument& document = data->document(row.document);
+            QList<QString> cells;
+            QList<QString> previousCells;
+            QList<int> changedColumns;
+            for (int columnIterator = 0; columnIterator < columnCount; columnIterator++)
+            {
+                cells.append(document.at(row.row, columnIterator));
+                if (row.state == JobTableRowState::Modified)
+                {
+                    previousCells.append(data->document(JobTableRow::FirstDocument).at(row.matchedRow, columnIterator));
+                }
+                if (data->isChanged(row, columnIterator))
+                {
+                    changedColumns.append(columnIterator);
+                }
+            }
+            expected.append(describe(row.state, cells, previousCells, changedColumns));
+        }
+
+        CSVSortedMerge merge(m_oldPath, m_newPath);
+        const auto opened = merge.open();
+        QVERIFY(opened.has_value());
+        QCOMPARE(merge.keyColumns(), data->keyColumns());
+        QCOMPARE(merge.keyDetection().column, data->keyDetection().column);
+        QVERIFY(merge.keyDetection().confidence() >= CSVCombinedData::minimumJobNumberConfidence);
+
+        QStringList merged;
+        CSVMergedRow row;
+        const QList<int> keyColumns = merge.keyColumns();
+        QList<QString> previousKeyRow;
+        while (true)
+        {
+            const auto next = merge.next(row);
+            QVERIFY(next.has_value());
+            if (!*next)
+            {
+                break;
+            }
+            if (!previousKeyRow.isEmpty() && CSVSortedMerge::compareKeys(previousKeyRow, row.cells, keyColumns) == 0)
+            {
+                duplicateCount++;
+            }
+            previousKeyRow = row.cells;
+            merged.append(describe(row.state, row.cells, row.state == JobTableRowState::Modified ? row.previousCells : QList<QString>(), row.changedColumns));
+        }
+
+        // Rows with duplicate keys have to be handed out for the comparison to cover them.
+        QVERIFY(duplicateCount > 0);
+        QCOMPARE(merge.newAddedCount(), stateCounts.value(JobTableRowState::Added));
+        QCOMPARE(merge.removedCount(), stateCounts.value(JobTableRowState::Removed));
+        QCOMPARE(merge.modifiedCount(), stateCounts.value(JobTableRowState::Modified));
+        QCOMPARE(merge.remainedCount(), stateCounts.value(JobTableRowState::Remained));
+
+        std::sort(expected.begin(), expected.end());
+        std::sort(merged.begin(), merged.end());
+        QCOMPARE(merged.count(), expected.count());
+        for (qsizetype rowIterator = 0; rowIterator < expected.count(); rowIterator++)
+        {
+            QCOMPARE(merged.at(rowIterator), expected.at(rowIterator));
+        }
+    }
+}
@@ -0,0 +1,34 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#ifndef ARRIVAL_TESTCSVSORTEDMERGE_H
+#define ARRIVAL_TESTCSVSORTEDMERGE_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+namespace Arrival::Tests
+{
+    /*!
+     * \brief The TestCSVSortedMerge class checks that merging sorted files hands out the rows of in-memory comparisons.
+     */
+    class TestCSVSortedMerge : public QObject
+    {
+        Q_OBJECT
+
+    private Q_SLOTS:
+        void initTestCase();
+        void testMergeMatchesInMemory();
+
+    private:
+        /*!
+         * \brief m_directory Holds the generated files.
+         */
+        QTemporaryDir m_directory;
+        QString m_oldPath;
+        QString m_newPath;
+    };
+}
+
+#endif // ARRIVAL_TESTCSVSORTEDMERGE_H
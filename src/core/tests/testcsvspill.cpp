@@ -0,0 +1,150 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#include <QDir>
+#include <QtTest>
+
+#include "data/csvhandling.h"
+#include "data/csvspill.h"
+#include "generator/jobsnapshotgenerator.h"
+#include "testcsvspill.h"
+
+using namespace Arrival::App;
+using namespace Arrival::Generator;
+
+namespace Arrival::Tests
+{
+    // A streamed comparison.
+    struct StreamedComparison
+    {
+        QSharedPointer<CSVCombinedData> data;
+        QList<JobTableRow> rows;
+    };
+
+    // Collects the rows of a comparison as they are streamed.
+    static CSVCombinedDataStream collect(StreamedComparison& comparison)
+    {
+        CSVCombinedDataStream stream;
+        stream.started = [&comparison](QSharedPointer<CSVCombinedData> data) {
+            comparison.data = std::move(data);
+        };
+        stream.rowsReady = [&comparison](QList<JobTableRow> rows) {
+            comparison.rows.append(rows);
+        };
+        return stream;
+    }
+
+    void TestCSVSpill::initTestCase()
+    {
+        QVERIFY(m_directory.isValid());
+        m_oldPath = QDir(m_directory.path()).filePath("old.csv");
+        m_newPath = QDir(m_directory.path()).filePath("new.csv");
+
+        // Comments spanning several lines and duplicate Jobnumbers cover the edge cases of both the spill and the matching.
+        JobSnapshotOptions options;
+        options.jobCount = 20000;
+        options.columnCount = 12;
+        options.commentColumn = 7;
+        options.modifiedRate = 0.1;
+        options.multiLineRate = 0.05;
+        options.duplicateKeyRate = 0.03;
+        const auto written = JobSnapshotGenerator::write(m_oldPath, m_newPath, options);
+        QVERIFY2(written.has_value(), qPrintable(written.has_value() ? QString() : written.error()));
+    }
+
+    void TestCSVSpill::testSpilledMatchesInMemory_data()
+    {
+        QTest::addColumn<int>("partitionCount");
+        QTest::addColumn<qint64>("memoryBudget");
+
+        const qint64 defaultBudget = CSVSpillOptions().memoryBudget;
+        QTest::newRow("1 partition") << 1 << defaultBudget;
+        QTest::newRow("7 partitions") << 7 << defaultBudget;
+        QTest::newRow("64 partitions") << 64 << defaultBudget;
+        QTest::newRow("derived from a small budget") << 0 << qint64(256 * 1024);
+    }
+
+    void TestCSVSpill::testSpilledMatchesInMemory()
+    {
+        QFETCH(int, partitionCount);
+        QFETCH(qint64, memoryBudget);
+
+        StreamedComparison expected;
+        QVERIFY(CSVCombinedData::streamCSVFiles(m_oldPath, m_newPath, CSVDocumentOptions(), CSVCombineOptions(), collect(expected)).has_value());
+
+        CSVSpillOptions spillOptions;
+        spillOptions.directory = m_directory.path();
+        spillOptions.partitionCount = partitionCount;
+        spillOptions.memoryBudget = memoryBudget;
+        StreamedComparison spilled;
+        QVERIFY(CSVCombinedData::streamSpilledCSVFiles(m_oldPath, m_newPath, spillOptions, CSVCombineOptions(), collect(spilled)).has_value());
+
+        QCOMPARE(spilled.data->keyColumns(), expected.data->keyColumns());
+        QCOMPARE(spilled.data->headerNames(), expected.data->headerNames());
+        QCOMPARE(spilled.rows.count(), expected.rows.count());
+
+        // The rows are handed out in the same order, reference the same rows of the files and carry the same changed cells.
+        const int columnCount = expected.data->columnCount();
+        int modifiedCount = 0;
+        for (qsizetype rowIterator = 0; rowIterator < expected.rows.count(); rowIterator++)
+        {
+            const JobTableRow& expectedRow = expected.rows.at(rowIterator);
+            const JobTableRow& spilledRow = spilled.rows.at(rowIterator);
+            QCOMPARE(spilledRow.state, expectedRow.state);
+            QCOMPARE(spilledRow.document, expectedRow.document);
+            QCOMPARE(spilledRow.row, expectedRow.row);
+            QCOMPARE(spilledRow.matchedRow, expectedRow.matchedRow);
+            for (int columnIterator = 0; columnIterator < columnCount; columnIterator++)
+            {
+                QCOMPARE(spilled.data->document(spilledRow.document).at(spilledRow.row, columnIterator),
+                         expected.data->document(expectedRow.document).at(expectedRow.row, columnIterator));
+                QCOMPARE(spilled.data->isChanged(spilledRow, columnIterator), expected.data->isChanged(expectedRow, columnIterator));
+            }
+            modifiedCount += expectedRow.state == JobTableRowState::Modified ? 1 : 0;
+        }
+        QVERIFY(modifiedCount > 0);
+    }
+
+    void TestCSVSpill::testSpillRequiresKey()
+    {
+        // Rows matched by their whole content can not be partitioned.
+        CSVCombineOptions options;
+        options.keyColumnIndex = CSVCombineOptions::noKeyColumn;
+        StreamedComparison spilled;
+        const auto result = CSVCombinedData::streamSpilledCSVFiles(m_oldPath, m_newPath, CSVSpillOptions(), options, collect(spilled));
+        QVERIFY(!result.has_value());
+        QCOMPARE(result.error(), CSVCombinedData::CombineCSVDocumentsError::InvalidKeyColumn);
+        QVERIFY(spilled.data.isNull());
+    }
+
+    void TestCSVSpill::testPartitionsHoldEveryRow()
+    {
+        const auto spill = CSVSpill::create(m_oldPath, m_directory.path(), { 1 }, 5);
+        QVERIFY2(spill.has_value(), qPrintable(spill.has_value() ? QString() : spill.error()));
+        const CSVDocument document(m_oldPath);
+        QCOMPARE((*spill)->rowCount(), document.rowCount());
+        QCOMPARE((*spill)->headerNames(), document.headersNames());
+
+        // Every row is in exactly one partition, and its cells read back unchanged.
+        QList<int> seen(document.rowCount(), 0);
+        QList<qint64> locations;
+        QList<int> sourceRows;
+        for (int partitionIterator = 0; partitionIterator < (*spill)->partitionCount(); partitionIterator++)
+        {
+            (*spill)->partitionRows(partitionIterator, locations, &sourceRows);
+            QCOMPARE(locations.count(), qsizetype((*spill)->partitionRowCount(partitionIterator)));
+            for (qsizetype rowIterator = 0; rowIterator < locations.count(); rowIterator++)
+            {
+                const int row = sourceRows.at(rowIterator);
+                seen[row]++;
+                QCOMPARE((*spill)->fieldCount(locations.at(rowIterator)), document.fieldCount(row));
+                for (int columnIterator = 0; columnIterator < document.fieldCount(row); columnIterator++)
+                {
+                    QVERIFY((*spill)->cell(locations.at(rowIterator), columnIterator) == document.cell(row, columnIterator));
+                }
+            }
+        }
+        QCOMPARE(seen.count(1), seen.count());
+    }
+}
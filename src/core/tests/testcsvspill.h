@@ -0,0 +1,37 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#ifndef ARRIVAL_TESTCSVSPILL_H
+#define ARRIVAL_TESTCSVSPILL_H
+
+#include <QObject>
+#include <QTemporaryDir>
+
+namespace Arrival::Tests
+{
+    /*!
+     * \brief The TestCSVSpill class checks that spilled comparisons hand out exactly the rows of in-memory comparisons.
+     */
+    class TestCSVSpill : public QObject
+    {
+        Q_OBJECT
+
+    private Q_SLOTS:
+        void initTestCase();
+        void testSpilledMatchesInMemory_data();
+        void testSpilledMatchesInMemory();
+        void testSpillRequiresKey();
+        void testPartitionsHoldEveryRow();
+
+    private:
+        /*!
+         * \brief m_directory Holds the generated files and the spills.
+         */
+        QTemporaryDir m_directory;
+        QString m_oldPath;
+        QString m_newPath;
+    };
+}
+
+#endif // ARRIVAL_TESTCSVSPILL_H
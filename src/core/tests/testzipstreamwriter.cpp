@@ -0,0 +1,268 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#include <QIODevice>
+#include <QList>
+#include <QPair>
+#include <QtEndian>
+#include <QtTest>
+
+#include <cstring>
+
+#include "data/zipstreamwriter.h"
+#include "testzipstreamwriter.h"
+
+using namespace Arrival::App;
+
+namespace Arrival::Tests
+{
+    /*!
+     * \brief The SparseDevice class keeps the headers written to it but drops the content of large entries,
+     * so archives beyond 4 GiB can be checked in memory.
+     */
+    class SparseDevice : public QIODevice
+    {
+    public:
+        // Writes of at least this size are content of an entry and dropped.
+        static constexpr qint64 maximumKeptSize = 64 * 1024;
+
+        SparseDevice()
+            : m_chunks()
+            , m_size(0)
+        {
+            open(QIODevice::WriteOnly | QIODevice::Unbuffered);
+        }
+
+        qint64 size() const override
+        {
+            return m_size;
+        }
+
+        // Returns the bytes at a position. Later writes overlay earlier ones, dropped bytes read as zeros.
+        QByteArray bytesAt(qint64 position, qint64 size) const
+        {
+            QByteArray bytes(size, '\0');
+            for (const QPair<qint64, QByteArray>& chunk : m_chunks)
+            {
+                const qint64 begin = qMax(chunk.first, position);
+                const qint64 end = qMin(chunk.first + chunk.second.size(), position + size);
+                if (begin < end)
+                {
+                    std::memcpy(bytes.data() + (begin - position), chunk.second.constData() + (begin - chunk.first), end - begin);
+                }
+            }
+            return bytes;
+        }
+
+    protected:
+        qint64 readData(char* data, qint64 maxSize) override
+        {
+            Q_UNUSED(data);
+            Q_UNUSED(maxSize);
+            return -1;
+        }
+
+        qint64 writeData(const char* data, qint64 size) override
+        {
+            if (size < maximumKeptSize)
+            {
+                m_chunks.append(qMakePair(pos(), QByteArray(data, size)));
+            }
+            m_size = qMax(m_size, pos() + size);
+            return size;
+        }
+
+    private:
+        QList<QPair<qint64, QByteArray>> m_chunks;
+        qint64 m_size;
+    };
+
+    // An entry of the central directory with the zip64 values already resolved.
+    struct CentralEntry
+    {
+        QByteArray name;
+        quint16 version;
+        quint16 extraSize;
+        quint64 compressedSize;
+        quint64 uncompressedSize;
+        quint64 localHeaderOffset;
+    };
+
+    static constexpr quint32 zip64Marker = 0xFFFFFFFF;
+
+    static quint16 le16(const QByteArray& bytes, qsizetype offset)
+    {
+        return qFromLittleEndian<quint16>(bytes.constData() + offset);
+    }
+
+    static quint32 le32(const QByteArray& bytes, qsizetype offset)
+    {
+        return qFromLittleEndian<quint32>(bytes.constData() + offset);
+    }
+
+    static quint64 le64(const QByteArray& bytes, qsizetype offset)
+    {
+        return qFromLittleEndian<quint64>(bytes.constData() + offset);
+    }
+
+    // Reads the central directory. Values that are marked in their 32 bit field are taken from the zip64 extra field.
+    static QList<CentralEntry> readCentralDirectory(const SparseDevice& device, quint64 offset, quint64 size)
+    {
+        const QByteArray directory = device.bytesAt(static_cast<qint64>(offset), static_cast<qint64>(size));
+        QList<CentralEntry> entries;
+        qsizetype position = 0;
+        while (position + 46 <= directory.size() && le32(directory, position) == 0x02014b50)
+        {
+            CentralEntry entry;
+            entry.version = le16(directory, position + 6);
+            entry.compressedSize = le32(directory, position + 20);
+            entry.uncompressedSize = le32(directory, position + 24);
+            const quint16 nameSize = le16(directory, position + 28);
+            entry.extraSize = le16(directory, position + 30);
+            const quint16 commentSize = le16(directory, position + 32);
+            entry.localHeaderOffset = le32(directory, position + 42);
+            entry.name = directory.mid(position + 46, nameSize);
+
+            qsizetype extra = position + 46 + nameSize;
+            const qsizetype extraEnd = extra + entry.extraSize;
+            while (extra + 4 <= extraEnd)
+            {
+                const quint16 tag = le16(directory, extra);
+                const quint16 fieldSize = le16(directory, extra + 2);
+                qsizetype value = extra + 4;
+                if (tag == 0x0001)
+                {
+                    for (quint64* field : {&entry.uncompressedSize, &entry.compressedSize, &entry.localHeaderOffset})
+                    {
+                        if (*field == zip64Marker)
+                        {
+                            *field = le64(directory, value);
+                            value += 8;
+                        }
+                    }
+                }
+                extra += 4 + fieldSize;
+            }
+
+            entries.append(entry);
+            position = extraEnd + commentSize;
+        }
+        return entries;
+    }
+
+    void TestZipStreamWriter::testSmallArchiveWithoutZip64()
+    {
+        SparseDevice device;
+        ZipStreamWriter zip(&device, 0);
+        QVERIFY(zip.addEntry("first.txt", "first"));
+        QVERIFY(zip.addEntry("second.txt", "second entry"));
+        QVERIFY2(zip.close(), qPrintable(zip.errorString()));
+
+        const qint64 end = device.size();
+        const QByteArray eocd = device.bytesAt(end - 22, 22);
+        QCOMPARE(le32(eocd, 0), quint32(0x06054b50));
+        QCOMPARE(le16(eocd, 10), quint16(2));
+
+        // No zip64 locator in front of the end of central directory record.
+        QVERIFY(le32(device.bytesAt(end - 42, 20), 0) != 0x07064b50);
+
+        const QList<CentralEntry> entries = readCentralDirectory(device, le32(eocd, 16), le32(eocd, 12));
+        QCOMPARE(entries.size(), 2);
+        QCOMPARE(entries[0].name, QByteArray("first.txt"));
+        QCOMPARE(entries[0].uncompressedSize, quint64(5));
+        QCOMPARE(entries[1].name, QByteArray("second.txt"));
+        QCOMPARE(entries[1].uncompressedSize, quint64(12));
+        for (const CentralEntry& entry : entries)
+        {
+            QCOMPARE(entry.version, quint16(20));
+            QCOMPARE(entry.extraSize, quint16(0));
+
+            // The local header carries the patched sizes and keeps the reserved extra field.
+            const QByteArray header = device.bytesAt(static_cast<qint64>(entry.localHeaderOffset), 30 + entry.name.size() + 4);
+            QCOMPARE(le32(header, 0), quint32(0x04034b50));
+            QCOMPARE(le16(header, 4), quint16(20));
+            QCOMPARE(quint64(le32(header, 18)), entry.compressedSize);
+            QCOMPARE(quint64(le32(header, 22)), entry.uncompressedSize);
+            QCOMPARE(le16(header, 30 + entry.name.size()), quint16(0xD935));
+        }
+    }
+
+    void TestZipStreamWriter::testLargeEntryUsesZip64()
+    {
+        // Compression level 0 stores the content, so both sizes of the large entry exceed 32 bits.
+        SparseDevice device;
+        ZipStreamWriter zip(&device, 0);
+        QVERIFY(zip.addEntry("small.txt", "small"));
+
+        const QByteArray block(1024 * 1024, 'x');
+        const quint64 largeSize = (quint64(4) << 30) + static_cast<quint64>(block.size());
+        QVERIFY(zip.beginEntry("large.bin"));
+        for (quint64 written = 0; written < largeSize; written += static_cast<quint64>(block.size()))
+        {
+            QVERIFY(zip.write(block));
+        }
+
+        // Starts beyond 4 GiB.
+        QVERIFY(zip.addEntry("after.txt", "after"));
+        QVERIFY2(zip.close(), qPrintable(zip.errorString()));
+
+        // The end of central directory record points to the zip64 record through the locator.
+        const qint64 end = device.size();
+        const QByteArray eocd = device.bytesAt(end - 22, 22);
+        QCOMPARE(le32(eocd, 0), quint32(0x06054b50));
+        QCOMPARE(le16(eocd, 10), quint16(3));
+        QCOMPARE(le32(eocd, 16), zip64Marker);
+
+        const QByteArray locator = device.bytesAt(end - 42, 20);
+        QCOMPARE(le32(locator, 0), quint32(0x07064b50));
+        const quint64 recordOffset = le64(locator, 8);
+
+        const QByteArray record = device.bytesAt(static_cast<qint64>(recordOffset), 56);
+        QCOMPARE(le32(record, 0), quint32(0x06064b50));
+        QCOMPARE(le64(record, 4), quint64(44));
+        QCOMPARE(le64(record, 32), quint64(3));
+        const quint64 centralDirectorySize = le64(record, 40);
+        const quint64 centralDirectoryOffset = le64(record, 48);
+        QCOMPARE(centralDirectoryOffset + centralDirectorySize, recordOffset);
+        QVERIFY(centralDirectoryOffset > largeSize);
+
+        const QList<CentralEntry> entries = readCentralDirectory(device, centralDirectoryOffset, centralDirectorySize);
+        QCOMPARE(entries.size(), 3);
+
+        const CentralEntry& small = entries[0];
+        QCOMPARE(small.name, QByteArray("small.txt"));
+        QCOMPARE(small.version, quint16(20));
+        QCOMPARE(small.localHeaderOffset, quint64(0));
+
+        const CentralEntry& large = entries[1];
+        QCOMPARE(large.name, QByteArray("large.bin"));
+        QCOMPARE(large.version, quint16(45));
+        QCOMPARE(large.uncompressedSize, largeSize);
+        QVERIFY(large.compressedSize >= largeSize);
+
+        // The local header of the large entry holds its sizes in the zip64 extra field.
+        const qsizetype largeHeaderSize = 30 + large.name.size() + 20;
+        const QByteArray largeHeader = device.bytesAt(static_cast<qint64>(large.localHeaderOffset), largeHeaderSize);
+        QCOMPARE(le32(largeHeader, 0), quint32(0x04034b50));
+        QCOMPARE(le16(largeHeader, 4), quint16(45));
+        QCOMPARE(le32(largeHeader, 18), zip64Marker);
+        QCOMPARE(le32(largeHeader, 22), zip64Marker);
+        QCOMPARE(le16(largeHeader, 30 + large.name.size()), quint16(0x0001));
+        QCOMPARE(le16(largeHeader, 32 + large.name.size()), quint16(16));
+        QCOMPARE(le64(largeHeader, 34 + large.name.size()), large.uncompressedSize);
+        QCOMPARE(le64(largeHeader, 42 + large.name.size()), large.compressedSize);
+
+        // The entry after the large one is found through the zip64 offset.
+        const CentralEntry& after = entries[2];
+        QCOMPARE(after.name, QByteArray("after.txt"));
+        QCOMPARE(after.version, quint16(45));
+        QCOMPARE(after.localHeaderOffset, large.localHeaderOffset + static_cast<quint64>(largeHeaderSize) + large.compressedSize);
+        QCOMPARE(after.uncompressedSize, quint64(5));
+
+        const QByteArray afterHeader = device.bytesAt(static_cast<qint64>(after.localHeaderOffset), 30 + after.name.size());
+        QCOMPARE(le32(afterHeader, 0), quint32(0x04034b50));
+        QCOMPARE(le16(afterHeader, 4), quint16(20));
+        QCOMPARE(afterHeader.mid(30), QByteArray("after.txt"));
+    }
+}
@@ -0,0 +1,25 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#ifndef ARRIVAL_TESTZIPSTREAMWRITER_H
+#define ARRIVAL_TESTZIPSTREAMWRITER_H
+
+#include <QObject>
+
+namespace Arrival::Tests
+{
+    /*!
+     * \brief The TestZipStreamWriter class checks the structure of the written archives, with and without zip64.
+     */
+    class TestZipStreamWriter : public QObject
+    {
+        Q_OBJECT
+
+    private Q_SLOTS:
+        void testSmallArchiveWithoutZip64();
+        void testLargeEntryUsesZip64();
+    };
+}
+
+#endif // ARRIVAL_TESTZIPSTREAMWRITER_H
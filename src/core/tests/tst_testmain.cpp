@@ -0,0 +1,30 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#include <QCoreApplication>
+#include <QtTest>
+
+#include "testcsvsortedmerge.h"
+#include "testcsvspill.h"
+#include "testzipstreamwriter.h"
+
+// Runs every test class and fails if any of them fails.
+static int runTest(QObject* test, int argc, char* argv[])
+{
+    const int status = QTest::qExec(test, argc, argv);
+    delete test;
+    return status;
+}
+
+int main(int argc, char* argv[])
+{
+    // The comparisons run on thread pools, which need an application instance.
+    QCoreApplication app(argc, argv);
+
+    int status = 0;
+    status |= runTest(new Arrival::Tests::TestCSVSpill(), argc, argv);
+    status |= runTest(new Arrival::Tests::TestCSVSortedMerge(), argc, argv);
+    status |= runTest(new Arrival::Tests::TestZipStreamWriter(), argc, argv);
+    return status;
+}
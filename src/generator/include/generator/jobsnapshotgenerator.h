@@ -0,0 +1,161 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#ifndef ARRIVAL_JOBSNAPSHOTGENERATOR_H
+#define ARRIVAL_JOBSNAPSHOTGENERATOR_H
+
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+
+#include <expected>
+
+namespace Arrival::Generator
+{
+    /*!
+     * \brief The JobSnapshotOptions struct describes a pair of generated job exports.
+     */
+    struct JobSnapshotOptions
+    {
+        /*!
+         * \brief jobCount The amount of jobs. Each job is written to the old file, the new file or both.
+         */
+        int jobCount = 10000;
+
+        /*!
+         * \brief columnCount The amount of columns of both files.
+         */
+        int columnCount = 20;
+
+        /*!
+         * \brief jobNumberColumn The column holding the Jobnumber.
+         */
+        int jobNumberColumn = 1;
+
+        /*!
+         * \brief commentColumn The column holding free text comments, -1 for none.
+         */
+        int commentColumn = -1;
+
+        /*!
+         * \brief maximumCommentLength The maximum length of a comment in bytes. Comments are never empty.
+         */
+        int maximumCommentLength = 400;
+
+        /*!
+         * \brief addedRate The share of jobs only found in the new file.
+         */
+        double addedRate = 0.05;
+
+        /*!
+         * \brief removedRate The share of jobs only found in the old file.
+         */
+        double removedRate = 0.05;
+
+        /*!
+         * \brief modifiedRate The share of jobs found in both files with different cells.
+         */
+        double modifiedRate = 0.05;
+
+        /*!
+         * \brief multiLineRate The share of comments spanning several lines.
+         */
+        double multiLineRate = 0.01;
+
+        /*!
+         * \brief duplicateKeyRate The share of jobs written twice, with the same Jobnumber but different cells.
+         */
+        double duplicateKeyRate = 0.0;
+
+        /*!
+         * \brief seed The seed. The same options always generate the same files.
+         */
+        quint64 seed = 1;
+    };
+
+    /*!
+     * \brief The JobSnapshotStatistics struct describes what has been generated.
+     */
+    struct JobSnapshotStatistics
+    {
+        /*!
+         * \brief oldRowCount The amount of rows of the old file, without the header.
+         */
+        int oldRowCount = 0;
+
+        /*!
+         * \brief newRowCount The amount of rows of the new file, without the header.
+         */
+        int newRowCount = 0;
+
+        /*!
+         * \brief addedCount The amount of jobs only found in the new file.
+         */
+        int addedCount = 0;
+
+        /*!
+         * \brief removedCount The amount of jobs only found in the old file.
+         */
+        int removedCount = 0;
+
+        /*!
+         * \brief modifiedCount The amount of jobs found in both files with different cells.
+         */
+        int modifiedCount = 0;
+
+        /*!
+         * \brief duplicateKeyCount The amount of jobs written twice.
+         */
+        int duplicateKeyCount = 0;
+
+        /*!
+         * \brief oldSize The size of the old file in bytes.
+         */
+        qint64 oldSize = 0;
+
+        /*!
+         * \brief newSize The size of the new file in bytes.
+         */
+        qint64 newSize = 0;
+    };
+
+    /*!
+     * \brief The JobSnapshotGenerator class writes pairs of job exports, like the ones compared by Arrival.
+     * The Jobnumbers match \c CSVCombinedData::isJobNumber and ascend in both files.
+     */
+    class JobSnapshotGenerator
+    {
+    public:
+        /*!
+         * \brief maximumJobCount The maximum amount of jobs, so every Jobnumber has nine digits.
+         */
+        static constexpr int maximumJobCount = 225000000;
+
+        /*!
+         * \brief validate Checks the options.
+         * \param options The options.
+         * \return An empty string if the options are valid, the reason otherwise.
+         */
+        static QString validate(const JobSnapshotOptions& options);
+
+        /*!
+         * \brief write Writes the old and the new file.
+         * \param oldPath The path of the old file.
+         * \param newPath The path of the new file.
+         * \param options The options.
+         * \return Describes the generated files, or the reason they could not be written.
+         */
+        static std::expected<JobSnapshotStatistics, QString> write(const QString& oldPath, const QString& newPath, const JobSnapshotOptions& options = JobSnapshotOptions());
+
+        /*!
+         * \brief headerName Returns the name of a column.
+         * \param column The column.
+         * \param options The options.
+         * \return The name of the column.
+         */
+        static QByteArray headerName(int column, const JobSnapshotOptions& options);
+    };
+}
+
+#endif // ARRIVAL_JOBSNAPSHOTGENERATOR_H
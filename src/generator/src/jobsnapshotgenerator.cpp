@@ -0,0 +1,348 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#include <QByteArrayView>
+#include <QFile>
+#include <QVarLengthArray>
+
+#include <iterator>
+
+#include "data/hashing.h"
+#include "generator/jobsnapshotgenerator.h"
+
+namespace Arrival::Generator
+{
+    // The files are written in blocks of this size.
+    static constexpr qsizetype writeBlockSize = 1024 * 1024;
+
+    // The first Jobnumber. Nine digits, like the real ones.
+    static constexpr quint64 firstJobNumber = 100000000;
+
+    // The maximum amount of cells changed in a modified job.
+    static constexpr int maximumModifiedCells = 3;
+
+    static const char* const statuses[] = { "open", "booked", "picked up", "in transit", "customs hold", "delivered", "closed" };
+    static const char* const cities[] = { "Frankfurt", "Newark", "Singapore", "Basel", "Dublin", "Osaka", "São Paulo", "Zürich" };
+    static const char* const words[] = {
+        "shipment", "temperature", "logger", "courier", "collected", "delayed", "by", "customs", "the", "consignee",
+        "requested", "dry", "ice", "replenished", "at", "hub", "flight", "rebooked", "documents", "missing",
+        "pharmacy", "confirmed", "delivery", "window", "excursion", "none", "reported", "signed", "for", "gate"
+    };
+
+    // Small and fast generator, seeded per job and cell so every cell can be generated on its own.
+    struct SplitMix64
+    {
+        quint64 state;
+
+        quint64 next()
+        {
+            return Arrival::App::Hashing::mix(state += Arrival::App::Hashing::goldenRatio);
+        }
+
+        // Uniform in [0, 1).
+        double nextDouble()
+        {
+            return (next() >> 11) * 0x1.0p-53;
+        }
+
+        quint64 below(quint64 bound)
+        {
+            return next() % bound;
+        }
+    };
+
+    static SplitMix64 cellGenerator(quint64 seed, quint64 jobNumber, int column, int variant)
+    {
+        SplitMix64 mixer { seed };
+        mixer.state ^= SplitMix64 { jobNumber }.next();
+        mixer.state ^= SplitMix64 { (static_cast<quint64>(column) << 32) | static_cast<quint32>(variant) }.next();
+        return mixer;
+    }
+
+    static void appendField(QByteArray& line, QByteArrayView value)
+    {
+        bool needsDelimiters = false;
+        for (const char character : value)
+        {
+            if (character == ',' || character == '"' || character == '\n' || character == '\r')
+            {
+                needsDelimiters = true;
+                break;
+            }
+        }
+        if (!needsDelimiters)
+        {
+            line.append(value);
+            return;
+        }
+
+        line.append('"');
+        for (const char character : value)
+        {
+            if (character == '"')
+            {
+                line.append('"');
+            }
+            line.append(character);
+        }
+        line.append('"');
+    }
+
+    static void appendComment(QByteArray& cell, SplitMix64& random, const JobSnapshotOptions& options)
+    {
+        // Never empty: the reader drops an empty last field following a delimited one.
+        const qsizetype length = 1 + static_cast<qsizetype>(random.below(static_cast<quint64>(options.maximumCommentLength)));
+        const bool multiLine = random.nextDouble() < options.multiLineRate;
+        while (cell.size() < length)
+        {
+            // Sentences of up to twelve words.
+            const int wordCount = 1 + static_cast<int>(random.below(12));
+            for (int wordIterator = 0; wordIterator < wordCount && cell.size() < length; wordIterator++)
+            {
+                if (wordIterator > 0)
+                {
+                    cell.append(random.below(10) == 0 ? ", " : " ");
+                }
+                const char* const word = words[random.below(std::size(words))];
+                if (random.below(50) == 0)
+                {
+                    cell.append('"').append(word).append('"');
+                }
+                else
+                {
+                    cell.append(word);
+                }
+            }
+            cell.append('.');
+            if (cell.size() < length)
+            {
+                cell.append(multiLine ? "\n" : " ");
+            }
+        }
+    }
+
+    static void appendCellValue(QByteArray& cell, quint64 seed, quint64 jobNumber, int column, int variant, const JobSnapshotOptions& options)
+    {
+        SplitMix64 random = cellGenerator(seed, jobNumber, column, variant);
+        if (column == options.commentColumn)
+        {
+            appendComment(cell, random, options);
+            return;
+        }
+
+        switch (column % 6)
+        {
+        case 0:
+            cell.append(statuses[random.below(std::size(statuses))]);
+            break;
+        case 1:
+            cell.append(QByteArray::number(random.below(100000) / 100.0, 'f', 2));
+            break;
+        case 2:
+            cell.append(cities[random.below(std::size(cities))]);
+            break;
+        case 3:
+            cell.append("2023-")
+                .append(QByteArray::number(1 + random.below(12)).rightJustified(2, '0'))
+                .append('-')
+                .append(QByteArray::number(1 + random.below(28)).rightJustified(2, '0'));
+            break;
+        case 4:
+            cell.append("Dock ").append(QByteArray::number(random.below(100))).append(", Gate ").append(QByteArray::number(random.below(10)));
+            break;
+        default:
+            cell.append(random.below(2) == 0 ? "+2..+8 °C" : "+15..+25 °C");
+            break;
+        }
+    }
+
+    // Appends the row of a job. Modified cells get a different variant, so they differ from the old file.
+    static void appendRow(QByteArray& line, quint64 seed, quint64 jobNumber, int copy, const QVarLengthArray<int, maximumModifiedCells>& modifiedColumns, const JobSnapshotOptions& options)
+    {
+        QByteArray cell;
+        for (int columnIterator = 0; columnIterator < options.columnCount; columnIterator++)
+        {
+            if (columnIterator > 0)
+            {
+                line.append(',');
+            }
+            if (columnIterator == options.jobNumberColumn)
+            {
+                line.append(QByteArray::number(jobNumber)).append("CL");
+                continue;
+            }
+
+            cell.resize(0);
+            const int variant = copy * 2;
+            appendCellValue(cell, seed, jobNumber, columnIterator, variant, options);
+            if (modifiedColumns.contains(columnIterator))
+            {
+                QByteArray modifiedCell;
+                appendCellValue(modifiedCell, seed, jobNumber, columnIterator, variant + 1, options);
+                // Both variants may end up the same.
+                if (modifiedCell == cell)
+                {
+                    modifiedCell.append(" (revised)");
+                }
+                cell = modifiedCell;
+            }
+            appendField(line, cell);
+        }
+        line.append('\n');
+    }
+
+    QString JobSnapshotGenerator::validate(const JobSnapshotOptions& options)
+    {
+        if (options.jobCount < 0 || options.jobCount > maximumJobCount)
+        {
+            return QString("the amount of jobs has to be between 0 and %1").arg(maximumJobCount);
+        }
+        if (options.columnCount < 2)
+        {
+            return QStringLiteral("at least two columns are needed");
+        }
+        if (options.jobNumberColumn < 0 || options.jobNumberColumn >= options.columnCount)
+        {
+            return QStringLiteral("the Jobnumber column does not exist");
+        }
+        if (options.commentColumn != -1 && (options.commentColumn < 0 || options.commentColumn >= options.columnCount || options.commentColumn == options.jobNumberColumn))
+        {
+            return QStringLiteral("the comment column does not exist or holds the Jobnumber");
+        }
+        if (options.maximumCommentLength < 1)
+        {
+            return QStringLiteral("comments have to be at least one byte long");
+        }
+        for (const double rate : { options.addedRate, options.removedRate, options.modifiedRate, options.multiLineRate, options.duplicateKeyRate })
+        {
+            if (!(rate >= 0.0 && rate <= 1.0))
+            {
+                return QStringLiteral("rates have to be between 0 and 1");
+            }
+        }
+        if (options.addedRate + options.removedRate + options.modifiedRate > 1.0)
+        {
+            return QStringLiteral("the added, removed and modified rates add up to more than 1");
+        }
+        return QString();
+    }
+
+    std::expected<JobSnapshotStatistics, QString> JobSnapshotGenerator::write(const QString& oldPath, const QString& newPath, const JobSnapshotOptions& options)
+    {
+        if (const QString error = validate(options); !error.isEmpty())
+        {
+            return std::unexpected(error);
+        }
+
+        QFile oldFile(oldPath);
+        if (!oldFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            return std::unexpected("could not open " + oldPath);
+        }
+        QFile newFile(newPath);
+        if (!newFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            return std::unexpected("could not open " + newPath);
+        }
+
+        // Both files share the header.
+        QByteArray oldBuffer;
+        for (int columnIterator = 0; columnIterator < options.columnCount; columnIterator++)
+        {
+            if (columnIterator > 0)
+            {
+                oldBuffer.append(',');
+            }
+            appendField(oldBuffer, headerName(columnIterator, options));
+        }
+        oldBuffer.append('\n');
+        QByteArray newBuffer = oldBuffer;
+
+        const auto flush = [](QFile& file, QByteArray& buffer, qsizetype threshold) {
+            if (buffer.size() < threshold)
+            {
+                return true;
+            }
+            const bool written = file.write(buffer) == buffer.size();
+            buffer.resize(0);
+            return written;
+        };
+
+        JobSnapshotStatistics statistics;
+        SplitMix64 random { options.seed };
+        quint64 jobNumber = firstJobNumber;
+        const QVarLengthArray<int, maximumModifiedCells> unmodified;
+        for (int jobIterator = 0; jobIterator < options.jobCount; jobIterator++)
+        {
+            jobNumber += 1 + random.below(4);
+
+            // Decide the fate of the job.
+            const double draw = random.nextDouble();
+            const bool inOld = draw >= options.addedRate;
+            const bool inNew = draw < options.addedRate || draw >= options.addedRate + options.removedRate;
+            const bool modified = draw >= options.addedRate + options.removedRate && draw < options.addedRate + options.removedRate + options.modifiedRate;
+            const int copies = random.nextDouble() < options.duplicateKeyRate ? 2 : 1;
+
+            QVarLengthArray<int, maximumModifiedCells> modifiedColumns;
+            if (modified)
+            {
+                const int count = 1 + static_cast<int>(random.below(qMin(maximumModifiedCells, options.columnCount - 1)));
+                while (modifiedColumns.count() < count)
+                {
+                    const int column = static_cast<int>(random.below(options.columnCount));
+                    if (column != options.jobNumberColumn && !modifiedColumns.contains(column))
+                    {
+                        modifiedColumns.append(column);
+                    }
+                }
+            }
+
+            for (int copy = 0; copy < copies; copy++)
+            {
+                if (inOld)
+                {
+                    appendRow(oldBuffer, options.seed, jobNumber, copy, unmodified, options);
+                    statistics.oldRowCount++;
+                }
+                if (inNew)
+                {
+                    appendRow(newBuffer, options.seed, jobNumber, copy, modifiedColumns, options);
+                    statistics.newRowCount++;
+                }
+            }
+            statistics.addedCount += !inOld ? 1 : 0;
+            statistics.removedCount += !inNew ? 1 : 0;
+            statistics.modifiedCount += modified ? 1 : 0;
+            statistics.duplicateKeyCount += copies > 1 ? 1 : 0;
+
+            if (!flush(oldFile, oldBuffer, writeBlockSize) || !flush(newFile, newBuffer, writeBlockSize))
+            {
+                return std::unexpected(QStringLiteral("could not write the files"));
+            }
+        }
+
+        if (!flush(oldFile, oldBuffer, 0) || !flush(newFile, newBuffer, 0))
+        {
+            return std::unexpected(QStringLiteral("could not write the files"));
+        }
+        statistics.oldSize = oldFile.size();
+        statistics.newSize = newFile.size();
+        return statistics;
+    }
+
+    QByteArray JobSnapshotGenerator::headerName(int column, const JobSnapshotOptions& options)
+    {
+        if (column == options.jobNumberColumn)
+        {
+            return "Jobnumber";
+        }
+        if (column == options.commentColumn)
+        {
+            return "Comment";
+        }
+
+        static const char* const names[] = { "Status", "Weight", "Destination", "Pickup date", "Location", "Temperature range" };
+        return QByteArray(names[column % 6]).append(' ').append(QByteArray::number(column));
+    }
+}
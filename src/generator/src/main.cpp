@@ -0,0 +1,112 @@
+// Copyright 2023 WorldCourier. All rights reserved.
+//
+// Author: Felix Kahle, A123234, felix.kahle@worldcourier.de
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <cstdio>
+
+#include "generator/jobsnapshotgenerator.h"
+
+using namespace Arrival::Generator;
+
+static void printError(const QString& message)
+{
+    std::fputs(qPrintable("arrival-generate: " + message + '\n'), stderr);
+}
+
+// Main entry point.
+// Writes a pair of job exports and prints what has been generated.
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("arrival-generate");
+    QCoreApplication::setApplicationVersion("1.0");
+
+    const JobSnapshotOptions defaults;
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Writes an old and a new job export with a controllable churn.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("old", "The old .csv file to write.");
+    parser.addPositionalArgument("new", "The new .csv file to write.");
+
+    const QCommandLineOption jobsOption({ "n", "jobs" }, "Amount of jobs.", "count", QString::number(defaults.jobCount));
+    const QCommandLineOption columnsOption({ "c", "columns" }, "Amount of columns.", "count", QString::number(defaults.columnCount));
+    const QCommandLineOption keyColumnOption({ "k", "key-column" }, "Column holding the Jobnumber.", "column", QString::number(defaults.jobNumberColumn));
+    const QCommandLineOption commentColumnOption("comment-column", "Column holding free text comments, -1 for none.", "column", QString::number(defaults.commentColumn));
+    const QCommandLineOption commentLengthOption("comment-length", "Maximum length of a comment in bytes.", "bytes", QString::number(defaults.maximumCommentLength));
+    const QCommandLineOption addedOption("added", "Share of jobs only found in the new file.", "rate", QString::number(defaults.addedRate));
+    const QCommandLineOption removedOption("removed", "Share of jobs only found in the old file.", "rate", QString::number(defaults.removedRate));
+    const QCommandLineOption modifiedOption("modified", "Share of jobs with different cells in the new file.", "rate", QString::number(defaults.modifiedRate));
+    const QCommandLineOption multiLineOption("multi-line", "Share of comments spanning several lines.", "rate", QString::number(defaults.multiLineRate));
+    const QCommandLineOption duplicatesOption("duplicates", "Share of jobs written twice with the same Jobnumber.", "rate", QString::number(defaults.duplicateKeyRate));
+    const QCommandLineOption seedOption("seed", "Seed of the generated files.", "seed", QString::number(defaults.seed));
+    parser.addOptions({ jobsOption, columnsOption, keyColumnOption, commentColumnOption, commentLengthOption, addedOption, removedOption, modifiedOption, multiLineOption, duplicatesOption, seedOption });
+    parser.process(app);
+
+    const QStringList paths = parser.positionalArguments();
+    if (paths.count() != 2)
+    {
+        printError("expected exactly two files, see --help");
+        return 1;
+    }
+
+    // Every option is a number.
+    bool valid = true;
+    const auto integer = [&parser, &valid](const QCommandLineOption& option) {
+        bool isNumber = false;
+        const int value = parser.value(option).toInt(&isNumber);
+        valid = valid && isNumber;
+        return value;
+    };
+    const auto rate = [&parser, &valid](const QCommandLineOption& option) {
+        bool isNumber = false;
+        const double value = parser.value(option).toDouble(&isNumber);
+        valid = valid && isNumber;
+        return value;
+    };
+    JobSnapshotOptions options;
+    options.jobCount = integer(jobsOption);
+    options.columnCount = integer(columnsOption);
+    options.jobNumberColumn = integer(keyColumnOption);
+    options.commentColumn = integer(commentColumnOption);
+    options.maximumCommentLength = integer(commentLengthOption);
+    options.addedRate = rate(addedOption);
+    options.removedRate = rate(removedOption);
+    options.modifiedRate = rate(modifiedOption);
+    options.multiLineRate = rate(multiLineOption);
+    options.duplicateKeyRate = rate(duplicatesOption);
+    options.seed = parser.value(seedOption).toULongLong(&valid);
+    if (!valid)
+    {
+        printError("every option expects a number, see --help");
+        return 1;
+    }
+
+    const auto statistics = JobSnapshotGenerator::write(paths.at(0), paths.at(1), options);
+    if (!statistics.has_value())
+    {
+        printError(statistics.error());
+        return 1;
+    }
+
+    QJsonObject object;
+    object["old"] = paths.at(0);
+    object["new"] = paths.at(1);
+    object["seed"] = QString::number(options.seed);
+    object["oldRows"] = statistics->oldRowCount;
+    object["newRows"] = statistics->newRowCount;
+    object["added"] = statistics->addedCount;
+    object["removed"] = statistics->removedCount;
+    object["modified"] = statistics->modifiedCount;
+    object["duplicateKeys"] = statistics->duplicateKeyCount;
+    object["oldBytes"] = statistics->oldSize;
+    object["newBytes"] = statistics->newSize;
+    std::fputs(QJsonDocument(object).toJson(QJsonDocument::Compact).append('\n').constData(), stdout);
+
+    return 0;
+}
@@ -66,6 +66,20 @@ namespace QtCSV {
             const QString& textDelimiter = QString("\""),
             QStringConverter::Encoding codec = QStringConverter::Utf8);
 
+        // Read csv-file on several threads and save it's data as strings to
+        // QList<QList<QString>>. The file is split into ranges of bytes that
+        // are parsed in parallel, elements spanning several lines are never
+        // torn apart. threadCount limits the amount of threads, 0 uses
+        // QThread::idealThreadCount(). Single character separators and text
+        // delimiters and UTF-8 or Latin-1 data are required, otherwise the
+        // file is read like readToList() does.
+        static QList<QList<QString>> readToListParallel(
+            const QString& filePath,
+            const QString& separator = QString(","),
+            const QString& textDelimiter = QString("\""),
+            QStringConverter::Encoding codec = QStringConverter::Utf8,
+            int threadCount = 0);
+
         // Read csv-file and save it's data to AbstractData-based container
         // class
         static bool readToData(
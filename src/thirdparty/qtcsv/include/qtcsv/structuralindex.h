@@ -0,0 +1,145 @@
+#ifndef QTCSVSTRUCTURALINDEX_H
+#define QTCSVSTRUCTURALINDEX_H
+
+#include "qtcsv/qtcsv_global.h"
+#include <QList>
+#include <QtGlobal>
+#include <functional>
+
+class QThreadPool;
+
+namespace QtCSV {
+
+    // RawElement describes one element of a row as it is found in the raw
+    // csv-formatted bytes. Offsets are relative to the indexed data.
+    struct RawElement {
+        // Start of the element content. For delimited elements the opening
+        // text delimiter is not part of the content.
+        qsizetype begin = 0;
+
+        // End of the element content (exclusive). For delimited elements the
+        // closing text delimiter is not part of the content.
+        qsizetype end = 0;
+
+        // Element starts with the text delimiter symbol
+        bool isDelimited = false;
+
+        // Element content contains text delimiter symbols that might have to
+        // be unescaped
+        bool hasTextDelimiter = false;
+
+        // Element content spans several lines
+        bool hasLineBreak = false;
+    };
+
+    // StructuralIndex finds the structural symbols (separator, text delimiter
+    // and LF) of a block of csv-formatted bytes in a single pass. The bytes
+    // are classified 16 or 32 at a time with SSE2 or AVX2 instructions, the
+    // best kernel supported by the CPU is picked at runtime. A scalar kernel
+    // is used on other architectures.
+    //
+    // The row structure is recovered by walking over the found positions only,
+    // so the bytes inside of the elements are never looked at a second time.
+    // The separator and the text delimiter have to be ASCII characters, which
+    // makes the index work for UTF-8 and Latin-1 encoded data alike.
+    class QTCSVSHARED_EXPORT StructuralIndex {
+    public:
+        enum class Kernel {
+            Scalar,
+            Sse2,
+            Avx2
+        };
+
+        // Maximum amount of bytes that can be indexed at once
+        static constexpr qsizetype MaximumBlockSize = 0x7fffffff;
+
+        // Amount of bytes that splitRows() indexes at once
+        static constexpr qsizetype WindowSize = 4 * 1024 * 1024;
+
+        // Receives the elements of a row found by splitRows(). Offsets are
+        // relative to the start of the data. Returns False to stop splitting.
+        using RowHandler = std::function<bool(
+            qsizetype rowOffset, const QList<RawElement>& elements)>;
+
+        // Returns the fastest kernel supported by the CPU
+        static Kernel bestKernel();
+
+        explicit StructuralIndex(
+            char separator,
+            char textDelimiter,
+            Kernel kernel = bestKernel());
+
+        // Find the structural symbols of a block of bytes. The bytes are not
+        // copied and have to stay valid as long as the index is used.
+        void build(const char* data, qsizetype size);
+
+        // Split the row starting at position into its elements
+        // @input:
+        // - position - start of the row in the indexed data
+        // - isFinal - True if the indexed data is the end of the input
+        // - elements - receives the elements of the row. Empty for empty lines
+        // @output:
+        // - qsizetype - position right after the row or -1 if the row does not
+        // end inside of the indexed data and isFinal is False
+        qsizetype splitRow(
+            qsizetype position, bool isFinal, QList<RawElement>& elements);
+
+        // Split all rows of a range of bytes. The range is indexed window by
+        // window, so the index stays small for large inputs.
+        // @input:
+        // - data - csv-formatted bytes
+        // - begin - start of the first row
+        // - end - end of the range
+        // - isFinal - True if the range is the end of the input
+        // - handler - receives every row
+        // @output:
+        // - qsizetype - position right after the last row that was split.
+        // Equals end if every row of the range ends inside of it.
+        qsizetype splitRows(
+            const char* data,
+            qsizetype begin,
+            qsizetype end,
+            bool isFinal,
+            const RowHandler& handler);
+
+        // Split csv-formatted bytes into ranges that could be parsed in
+        // parallel. Every range is guessed to start at the beginning of a row
+        // by tracking the parity of the text delimiters from the start of the
+        // data, so rows with elements spanning several lines are not torn
+        // apart. The guess is only right for well-formed data: a range has to
+        // be verified by splitting its rows with splitRows(), it is right if
+        // the previous range was right and ended exactly at its start.
+        // @input:
+        // - data - csv-formatted bytes, starting at the beginning of a row
+        // - size - amount of bytes
+        // - textDelimiter - character that encloses elements
+        // - chunkCount - amount of ranges
+        // - pool - thread pool used to scan the ranges, nullptr to scan them
+        // on the calling thread
+        // @output:
+        // - QList<qsizetype> - chunkCount + 1 ascending boundaries, starting
+        // with 0 and ending with size
+        static QList<qsizetype> chunkBoundaries(
+            const char* data,
+            qsizetype size,
+            char textDelimiter,
+            int chunkCount,
+            QThreadPool* pool = nullptr);
+
+        Kernel kernel() const { return m_kernel; }
+        qsizetype count() const { return m_count; }
+        const quint32* positions() const { return m_positions.constData(); }
+
+    private:
+        char m_separator;
+        char m_textDelimiter;
+        Kernel m_kernel;
+        const char* m_data;
+        qsizetype m_size;
+        QList<quint32> m_positions;
+        qsizetype m_count;
+        qsizetype m_cursor;
+    };
+}
+
+#endif // QTCSVSTRUCTURALINDEX_H
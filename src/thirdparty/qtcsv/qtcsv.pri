@@ -10,6 +10,7 @@ SOURCES += \
     $$PWD/sources/variantdata.cpp \
     $$PWD/sources/stringdata.cpp \
     $$PWD/sources/reader.cpp \
+    $$PWD/sources/structuralindex.cpp \
     $$PWD/sources/contentiterator.cpp
 
 HEADERS += \
@@ -18,7 +19,9 @@ HEADERS += \
     $$PWD/include/qtcsv/variantdata.h \
     $$PWD/include/qtcsv/stringdata.h \
     $$PWD/include/qtcsv/reader.h \
+    $$PWD/include/qtcsv/structuralindex.h \
     $$PWD/include/qtcsv/abstractdata.h \
     $$PWD/sources/filechecker.h \
     $$PWD/sources/contentiterator.h \
+    $$PWD/sources/parallelfor.h \
     $$PWD/sources/symbols.h
@@ -0,0 +1,32 @@
+#ifndef QTCSVPARALLELFOR_H
+#define QTCSVPARALLELFOR_H
+
+#include <QThreadPool>
+#include <functional>
+
+namespace QtCSV {
+    // Call a function for every index from 0 to count - 1 on the threads of a
+    // pool and wait for all calls to finish
+    // @input:
+    // - pool - thread pool that is used exclusively by this call. If nullptr,
+    // all calls are made on the calling thread
+    // - count - amount of calls
+    // - function - function that is called with the index
+    inline void ParallelFor(
+        QThreadPool* pool, const int count,
+        const std::function<void(int)>& function)
+    {
+        if (nullptr == pool || count <= 1) {
+            for (auto i = 0; i < count; ++i) { function(i); }
+            return;
+        }
+
+        for (auto i = 0; i < count; ++i) {
+            pool->start([&function, i]() { function(i); });
+        }
+
+        pool->waitForDone();
+    }
+}
+
+#endif // QTCSVPARALLELFOR_H
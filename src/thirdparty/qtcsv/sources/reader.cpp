@@ -1,11 +1,16 @@
 #include "include/qtcsv/reader.h"
 #include "include/qtcsv/abstractdata.h"
+#include "include/qtcsv/structuralindex.h"
 #include "sources/filechecker.h"
+#include "sources/parallelfor.h"
 #include "sources/symbols.h"
 #include <QDebug>
 #include <QFile>
 #include <QStringView>
 #include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <cstring>
 
 using namespace QtCSV;
 
@@ -58,6 +63,43 @@ class ReaderPrivate {
     static void removeExtraSymbols(
         QList<QString>& elements, const QString& textDelimiter);
 
+    // Remove extra symbols (spaces, text delimeters...) of one element
+    static void removeExtraSymbols(
+        QString& element,
+        const QString& textDelimiter,
+        const QString& doubleTextDelimiter);
+
+    // Check if csv-data could be read with the structural index
+    static bool canReadIndexed(
+        QIODevice& ioDevice,
+        const QString& separator,
+        const QString& textDelimiter,
+        QStringConverter::Encoding codec);
+
+    // Read csv-data with the structural index
+    static bool readIndexed(
+        QIODevice& ioDevice,
+        Reader::AbstractProcessor& processor,
+        char separator,
+        const QString& textDelimiter,
+        QStringConverter::Encoding codec);
+
+    // Read a csv-file with the structural index on several threads
+    static bool readParallel(
+        QFile& file,
+        QList<QList<QString>>& rows,
+        char separator,
+        const QString& textDelimiter,
+        QStringConverter::Encoding codec,
+        int threadCount);
+
+    // Convert raw elements of a row to strings
+    static QList<QString> decodeElements(
+        const char* data,
+        const QList<RawElement>& rawElements,
+        const QString& textDelimiter,
+        QStringConverter::Encoding codec);
+
 public:
     // Function that really reads csv-data and transfer it's data to
     // AbstractProcessor-based processor
@@ -66,9 +108,26 @@ public:
         Reader::AbstractProcessor& processor,
         const QString& separator,
         const QString& textDelimiter,
-        QStringConverter::Encoding codec);
+        QStringConverter::Encoding codec,
+        bool needsRawLines = true);
+
+    // Read a csv-file on several threads if the structural index could be
+    // used for it
+    static bool readToListParallel(
+        QFile& file,
+        QList<QList<QString>>& rows,
+        const QString& separator,
+        const QString& textDelimiter,
+        QStringConverter::Encoding codec,
+        int threadCount);
 };
 
+// Amount of bytes that are read and indexed at once
+const qsizetype INDEXED_BLOCK_SIZE = 1 << 20;
+
+// Minimum amount of bytes that a thread parses when reading in parallel
+const qsizetype PARALLEL_CHUNK_SIZE = 1 << 20;
+
 // Function that really reads csv-data and transfer it's data to
 // AbstractProcessor-based processor
 // @input:
@@ -77,6 +136,7 @@ public:
 // - separator - string or character that separate values in a row
 // - textDelimiter - string or character that enclose row elements
 // - codec - pointer to codec object that would be used for file reading
+// - needsRawLines - True if the processor has to see every raw line
 // @output:
 // - bool - result of read operation
 bool ReaderPrivate::read(
@@ -84,7 +144,8 @@ bool ReaderPrivate::read(
     Reader::AbstractProcessor& processor,
     const QString& separator,
     const QString& textDelimiter,
-    const QStringConverter::Encoding codec)
+    const QStringConverter::Encoding codec,
+    const bool needsRawLines)
 {
     if (!checkParams(separator)) { return false; }
 
@@ -94,6 +155,14 @@ bool ReaderPrivate::read(
         return false;
     }
 
+    // Raw lines are never built by the structural index
+    if (!needsRawLines &&
+        canReadIndexed(ioDevice, separator, textDelimiter, codec))
+    {
+        return readIndexed(ioDevice, processor, separator.at(0).toLatin1(),
+                           textDelimiter, codec);
+    }
+
     QTextStream stream(&ioDevice);
     stream.setEncoding(codec);
 
@@ -417,44 +486,339 @@ void ReaderPrivate::removeExtraSymbols(
 
     const auto doubleTextDelim = textDelimiter + textDelimiter;
     for (auto i = 0; i < elements.size(); ++i) {
-        const auto str = QStringView{elements.at(i)};
-        if (str.isEmpty()) { continue; }
-
-        qsizetype startPos = 0, endPos = str.size() - 1;
-
-        // Find first non-space char
-        for (; startPos < str.size() &&
-               str.at(startPos).category() == QChar::Separator_Space;
-             ++startPos);
-
-        // Find last non-space char
-        for (;
-             endPos >= 0 && str.at(endPos).category() == QChar::Separator_Space;
-             --endPos);
-
-        if (!textDelimiter.isEmpty()) {
-            // Skip text delimiter symbol if element starts with it
-            const auto strStart = str.mid(startPos, textDelimiter.size());
-            if (strStart == textDelimiter) {
-                startPos += textDelimiter.size();
-            }
+        removeExtraSymbols(elements[i], textDelimiter, doubleTextDelim);
+    }
+}
 
-            // Skip text delimiter symbol if element ends with it
-            const auto strEnd = str.mid(
-                endPos - textDelimiter.size() + 1, textDelimiter.size());
-            if (strEnd == textDelimiter) {
-                endPos -= textDelimiter.size();
-            }
+// Remove extra symbols (spaces, text delimeters...) of one element
+// @input:
+// - element - row element
+// - textDelimiter - string that is used as text delimiter
+// - doubleTextDelimiter - text delimiter repeated twice
+void ReaderPrivate::removeExtraSymbols(
+    QString& element,
+    const QString& textDelimiter,
+    const QString& doubleTextDelimiter)
+{
+    const auto str = QStringView{element};
+    if (str.isEmpty()) { return; }
+
+    qsizetype startPos = 0, endPos = str.size() - 1;
+
+    // Find first non-space char
+    for (; startPos < str.size() &&
+           str.at(startPos).category() == QChar::Separator_Space;
+         ++startPos);
+
+    // Find last non-space char
+    for (;
+         endPos >= 0 && str.at(endPos).category() == QChar::Separator_Space;
+         --endPos);
+
+    if (!textDelimiter.isEmpty()) {
+        // Skip text delimiter symbol if element starts with it
+        const auto strStart = str.mid(startPos, textDelimiter.size());
+        if (strStart == textDelimiter) {
+            startPos += textDelimiter.size();
+        }
+
+        // Skip text delimiter symbol if element ends with it
+        const auto strEnd = str.mid(
+            endPos - textDelimiter.size() + 1, textDelimiter.size());
+        if (strEnd == textDelimiter) {
+            endPos -= textDelimiter.size();
+        }
+    }
+
+    if ((0 < startPos || endPos < str.size() - 1) &&
+        startPos <= endPos) {
+        element = element.mid(startPos, endPos - startPos + 1);
+    }
+
+    // Also replace double text delimiter with one text delimiter symbol
+    element.replace(doubleTextDelimiter, textDelimiter);
+}
+
+// Check if csv-data could be read with the structural index. The index works
+// on single byte ASCII separators and text delimiters in ASCII compatible
+// encodings.
+// @input:
+// - ioDevice - opened IO Device containing the csv-formatted data
+// - separator - string or character that separate elements in a row
+// - textDelimiter - string that is used as text delimiter
+// - codec - codec that would be used for file reading
+// @output:
+// - bool - True if the structural index could be used
+bool ReaderPrivate::canReadIndexed(
+    QIODevice& ioDevice,
+    const QString& separator,
+    const QString& textDelimiter,
+    const QStringConverter::Encoding codec)
+{
+    if (codec != QStringConverter::Utf8 && codec != QStringConverter::Latin1) {
+        return false;
+    }
+
+    if (separator.size() != 1 || textDelimiter.size() != 1) { return false; }
+
+    const auto sep = separator.at(0).unicode();
+    const auto delim = textDelimiter.at(0).unicode();
+    const auto isStructural = [](const char16_t symbol) {
+        return 0x80 <= symbol || LF_CHAR == symbol || CR_CHAR == symbol;
+    };
+
+    if (isStructural(sep) || isStructural(delim) || sep == delim) {
+        return false;
+    }
+
+    // QTextStream switches to UTF-16 or UTF-32 if it finds their byte order
+    // mark. Leave these files to it.
+    const auto start = ioDevice.peek(2);
+    return !start.startsWith("\xff\xfe") && !start.startsWith("\xfe\xff");
+}
+
+// Read csv-data with the structural index. Data is read in blocks, a row that
+// does not end inside of a block is carried over to the next one.
+// @input:
+// - ioDevice - opened IO Device containing the csv-formatted data
+// - processor - refernce to AbstractProcessor-based object
+// - separator - character that separate values in a row
+// - textDelimiter - string that is used as text delimiter
+// - codec - codec that would be used for file reading
+// @output:
+// - bool - result of read operation
+bool ReaderPrivate::readIndexed(
+    QIODevice& ioDevice,
+    Reader::AbstractProcessor& processor,
+    const char separator,
+    const QString& textDelimiter,
+    QStringConverter::Encoding codec)
+{
+    // Skip the byte order mark. Just like QTextStream, switch to UTF-8 if
+    // there is one.
+    if (ioDevice.peek(3) == "\xef\xbb\xbf") {
+        ioDevice.read(3);
+        codec = QStringConverter::Utf8;
+    }
+
+    StructuralIndex index(separator, textDelimiter.at(0).toLatin1());
+    QList<RawElement> rawElements;
+    QByteArray buffer;
+    auto readSize = INDEXED_BLOCK_SIZE;
+    auto atEnd = false;
+    while (!atEnd || !buffer.isEmpty()) {
+        if (!atEnd) {
+            const auto block = ioDevice.read(readSize);
+            buffer.append(block);
+            atEnd = block.isEmpty() || ioDevice.atEnd();
+        }
+
+        if (buffer.isEmpty()) { break; }
+
+        index.build(buffer.constData(), buffer.size());
+        qsizetype pos = 0;
+        while (pos < buffer.size()) {
+            const auto next = index.splitRow(pos, atEnd, rawElements);
+            if (next < 0) { break; }
+
+            const auto elements = decodeElements(
+                buffer.constData(), rawElements, textDelimiter, codec);
+            if (!processor.processRowElements(elements)) { return false; }
+
+            pos = next;
+        }
+
+        // Keep the beginning of the last row. If it did not fit into the
+        // buffer, read more data at once.
+        buffer.remove(0, pos);
+        readSize = qMax(INDEXED_BLOCK_SIZE, buffer.size());
+    }
+
+    return true;
+}
+
+// Read a csv-file on several threads if the structural index could be used
+// for it
+// @input:
+// - file - opened csv-file
+// - rows - receives the rows of the file
+// - separator - string or character that separate elements in a row
+// - textDelimiter - string or character that enclose each element in a row
+// - codec - codec that would be used for file reading
+// - threadCount - maximum amount of threads, 0 to use the ideal amount
+// @output:
+// - bool - False if the file has to be read with the line based reader
+bool ReaderPrivate::readToListParallel(
+    QFile& file,
+    QList<QList<QString>>& rows,
+    const QString& separator,
+    const QString& textDelimiter,
+    const QStringConverter::Encoding codec,
+    const int threadCount)
+{
+    if (!checkParams(separator) ||
+        !canReadIndexed(file, separator, textDelimiter, codec))
+    {
+        return false;
+    }
+
+    return readParallel(file, rows, separator.at(0).toLatin1(),
+                        textDelimiter, codec, threadCount);
+}
+
+// Read a csv-file with the structural index on several threads. The file is
+// split into ranges that are guessed to start at the beginning of a row, each
+// range is parsed on its own thread. The rows of a range are only kept if
+// the previous range ended exactly where the range starts. Otherwise the
+// rest of the file is parsed on the calling thread.
+// @input:
+// - file - opened csv-file
+// - rows - receives the rows of the file
+// - separator - character that separate values in a row
+// - textDelimiter - string that is used as text delimiter
+// - codec - codec that would be used for file reading
+// - threadCount - maximum amount of threads, 0 to use the ideal amount
+// @output:
+// - bool - result of read operation
+bool ReaderPrivate::readParallel(
+    QFile& file,
+    QList<QList<QString>>& rows,
+    const char separator,
+    const QString& textDelimiter,
+    QStringConverter::Encoding codec,
+    int threadCount)
+{
+    // Map the file if possible, so the threads share its pages
+    QByteArray buffer;
+    auto size = file.size();
+    const auto* data = 0 < size ?
+        reinterpret_cast<const char*>(file.map(0, size)) : nullptr;
+    if (nullptr == data) {
+        buffer = file.readAll();
+        data = buffer.constData();
+        size = buffer.size();
+    }
+
+    // Skip the byte order mark. Just like QTextStream, switch to UTF-8 if
+    // there is one.
+    qsizetype begin = 0;
+    if (3 <= size && 0 == std::memcmp(data, "\xef\xbb\xbf", 3)) {
+        begin = 3;
+        codec = QStringConverter::Utf8;
+    }
+
+    if (threadCount <= 0) { threadCount = QThread::idealThreadCount(); }
+    const auto chunkCount = static_cast<int>(qBound<qsizetype>(
+        1, (size - begin) / PARALLEL_CHUNK_SIZE, qMax(1, threadCount)));
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(chunkCount);
+
+    const auto delimiter = textDelimiter.at(0).toLatin1();
+    auto boundaries = StructuralIndex::chunkBoundaries(
+        data + begin, size - begin, delimiter, chunkCount, &pool);
+    for (auto& boundary : boundaries) { boundary += begin; }
+
+    struct Chunk {
+        QList<QList<QString>> rows;
+        qsizetype end = 0;
+    };
+
+    QList<Chunk> chunks(chunkCount);
+    auto* chunkData = chunks.data();
+    const auto* bounds = boundaries.constData();
+    ParallelFor(&pool, chunkCount, [&](const int i) {
+        auto& chunk = chunkData[i];
+        StructuralIndex index(separator, delimiter);
+        chunk.end = index.splitRows(
+            data, bounds[i], bounds[i + 1], bounds[i + 1] == size,
+            [&](qsizetype, const QList<RawElement>& rawElements) {
+                chunk.rows << decodeElements(
+                    data, rawElements, textDelimiter, codec);
+                return true;
+            });
+    });
+
+    // Stitch the ranges in order. A range that did not end at the start of
+    // the next one was guessed wrong, parse the rest of the file again.
+    for (auto i = 0; i < chunkCount; ++i) {
+        rows << std::move(chunkData[i].rows);
+        if (chunkData[i].end == bounds[i + 1]) { continue; }
+
+        StructuralIndex index(separator, delimiter);
+        index.splitRows(
+            data, chunkData[i].end, size, true,
+            [&](qsizetype, const QList<RawElement>& rawElements) {
+                rows << decodeElements(data, rawElements, textDelimiter, codec);
+                return true;
+            });
+        break;
+    }
+
+    return true;
+}
+
+// Convert raw elements of a row to strings and remove extra symbols in the
+// same way as the line based reader does
+// @input:
+// - data - indexed csv-formatted data
+// - rawElements - elements of the row
+// - textDelimiter - string that is used as text delimiter
+// - codec - codec of the data
+// @output:
+// - QList<QString> - list of elements
+QList<QString> ReaderPrivate::decodeElements(
+    const char* data,
+    const QList<RawElement>& rawElements,
+    const QString& textDelimiter,
+    const QStringConverter::Encoding codec)
+{
+    const auto decode = [&](const qsizetype begin, const qsizetype end) {
+        return codec == QStringConverter::Utf8 ?
+            QString::fromUtf8(data + begin, end - begin) :
+            QString::fromLatin1(data + begin, end - begin);
+    };
+
+    const auto doubleTextDelim = textDelimiter + textDelimiter;
+    QList<QString> elements;
+    elements.reserve(rawElements.size());
+    for (const auto& rawElement : rawElements) {
+        if (!rawElement.hasLineBreak) {
+            auto element = decode(rawElement.begin, rawElement.end);
+            removeExtraSymbols(element, textDelimiter, doubleTextDelim);
+            elements << element;
+            continue;
         }
 
-        if ((0 < startPos || endPos < str.size() - 1) &&
-            startPos <= endPos) {
-            elements[i] = elements[i].mid(startPos, endPos - startPos + 1);
+        // The line based reader cleans up every line of the element on its
+        // own and joins them with LF
+        QString element;
+        auto lineStart = rawElement.begin;
+        while (true) {
+            const auto* lineBreak = static_cast<const char*>(std::memchr(
+                data + lineStart, LF_CHAR, rawElement.end - lineStart));
+            const auto isLastLine = nullptr == lineBreak;
+            const auto lineEnd = isLastLine ? rawElement.end : lineBreak - data;
+            auto contentEnd = lineEnd;
+            if (!isLastLine && contentEnd > lineStart &&
+                CR_CHAR == data[contentEnd - 1])
+            {
+                --contentEnd;
+            }
+
+            auto line = decode(lineStart, contentEnd);
+            if (lineStart != rawElement.begin) { line.prepend(LF); }
+            removeExtraSymbols(line, textDelimiter, doubleTextDelim);
+            element.append(line);
+
+            if (isLastLine) { break; }
+            lineStart = lineEnd + 1;
         }
 
-        // Also replace double text delimiter with one text delimiter symbol
-        elements[i].replace(doubleTextDelim, textDelimiter);
+        elements << element;
     }
+
+    return elements;
 }
 
 // ReadToListProcessor - processor that saves rows of elements to list.
@@ -497,10 +861,43 @@ QList<QList<QString>> Reader::readToList(
     const QStringConverter::Encoding codec)
 {
     ReadToListProcessor processor;
-    ReaderPrivate::read(ioDevice, processor, separator, textDelimiter, codec);
+    ReaderPrivate::read(
+        ioDevice, processor, separator, textDelimiter, codec, false);
     return processor.data;
 }
 
+// Read csv-file on several threads and save it's data as strings to
+// QList<QList<QString>>. Falls back to readToList() if the parameters do not
+// allow it.
+// @input:
+// - filePath - string with absolute path to csv-file
+// - separator - string or character that separate elements in a row
+// - textDelimiter - string or character that enclose each element in a row
+// - codec - pointer to codec object that would be used for file reading
+// - threadCount - maximum amount of threads, 0 to use the ideal amount
+// @output:
+// - QList<QList<QString>> - list of values (as strings) from csv-file. In case of
+// error will return empty QList<QList<QString>>.
+QList<QList<QString>> Reader::readToListParallel(
+    const QString& filePath,
+    const QString& separator,
+    const QString& textDelimiter,
+    const QStringConverter::Encoding codec,
+    const int threadCount)
+{
+    QFile file;
+    if (!openFile(filePath, file)) { return QList<QList<QString>>(); }
+
+    QList<QList<QString>> rows;
+    if (ReaderPrivate::readToListParallel(
+            file, rows, separator, textDelimiter, codec, threadCount))
+    {
+        return rows;
+    }
+
+    return readToList(file, separator, textDelimiter, codec);
+}
+
 // Read csv-file and save it's data to AbstractData-based container class
 // @input:
 // - filePath - string with absolute path to csv-file
@@ -533,7 +930,7 @@ bool Reader::readToData(
 {
     ReadToListProcessor processor;
     const auto result = ReaderPrivate::read(
-        ioDevice, processor, separator, textDelimiter, codec);
+        ioDevice, processor, separator, textDelimiter, codec, false);
     if (result) {
         for (auto i = 0; i < processor.data.size(); ++i) {
             data.addRow(processor.data.at(i));
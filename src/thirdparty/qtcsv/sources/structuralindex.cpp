@@ -0,0 +1,500 @@
+#include "include/qtcsv/structuralindex.h"
+#include "sources/parallelfor.h"
+#include <QtAlgorithms>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define QTCSV_HAS_X86_KERNELS
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(QTCSV_HAS_X86_KERNELS) && !defined(_MSC_VER)
+#define QTCSV_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define QTCSV_TARGET_AVX2
+#endif
+
+using namespace QtCSV;
+
+namespace {
+    const char LF_SYMBOL = '\n';
+    const char CR_SYMBOL = '\r';
+
+    // Write the positions of all set bits of a 64 bit mask
+    // @input:
+    // - mask - one bit for each of 64 consecutive bytes
+    // - base - position of the first of these bytes
+    // - positions - output buffer
+    // - count - amount of positions already written
+    inline void flatten(quint64 mask, qsizetype base, quint32* positions,
+                        qsizetype& count)
+    {
+        while (0 != mask) {
+            positions[count++] = static_cast<quint32>(
+                base + qCountTrailingZeroBits(mask));
+            mask &= mask - 1;
+        }
+    }
+
+    // Classify bytes one at a time. Used for the tail of a block and on
+    // architectures without a vectorized kernel.
+    qsizetype findScalar(const char* data, qsizetype begin, qsizetype size,
+                         char separator, char textDelimiter, quint32* positions,
+                         qsizetype count)
+    {
+        for (auto i = begin; i < size; ++i) {
+            const auto symbol = data[i];
+            positions[count] = static_cast<quint32>(i);
+            count += (symbol == separator || symbol == textDelimiter ||
+                      symbol == LF_SYMBOL) ? 1 : 0;
+        }
+
+        return count;
+    }
+
+#if defined(QTCSV_HAS_X86_KERNELS)
+    // Classify 64 bytes per iteration with four 16 byte SSE2 comparisons
+    qsizetype findSse2(const char* data, qsizetype size, char separator,
+                       char textDelimiter, quint32* positions)
+    {
+        const auto separators = _mm_set1_epi8(separator);
+        const auto delimiters = _mm_set1_epi8(textDelimiter);
+        const auto lineFeeds = _mm_set1_epi8(LF_SYMBOL);
+
+        qsizetype count = 0;
+        qsizetype i = 0;
+        for (; i + 64 <= size; i += 64) {
+            quint64 mask = 0;
+            for (auto lane = 0; lane < 4; ++lane) {
+                const auto bytes = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(data + i + lane * 16));
+                const auto matches = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(bytes, separators),
+                                 _mm_cmpeq_epi8(bytes, delimiters)),
+                    _mm_cmpeq_epi8(bytes, lineFeeds));
+                mask |= static_cast<quint64>(static_cast<quint32>(
+                            _mm_movemask_epi8(matches))) << (lane * 16);
+            }
+
+            flatten(mask, i, positions, count);
+        }
+
+        return findScalar(data, i, size, separator, textDelimiter, positions,
+                          count);
+    }
+
+    // Classify 64 bytes per iteration with two 32 byte AVX2 comparisons
+    QTCSV_TARGET_AVX2
+    qsizetype findAvx2(const char* data, qsizetype size, char separator,
+                       char textDelimiter, quint32* positions)
+    {
+        const auto separators = _mm256_set1_epi8(separator);
+        const auto delimiters = _mm256_set1_epi8(textDelimiter);
+        const auto lineFeeds = _mm256_set1_epi8(LF_SYMBOL);
+
+        qsizetype count = 0;
+        qsizetype i = 0;
+        for (; i + 64 <= size; i += 64) {
+            quint64 mask = 0;
+            for (auto lane = 0; lane < 2; ++lane) {
+                const auto bytes = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(data + i + lane * 32));
+                const auto matches = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(bytes, separators),
+                                    _mm256_cmpeq_epi8(bytes, delimiters)),
+                    _mm256_cmpeq_epi8(bytes, lineFeeds));
+                mask |= static_cast<quint64>(static_cast<quint32>(
+                            _mm256_movemask_epi8(matches))) << (lane * 32);
+            }
+
+            flatten(mask, i, positions, count);
+        }
+
+        return findScalar(data, i, size, separator, textDelimiter, positions,
+                          count);
+    }
+
+    // Check if the CPU and the operating system support AVX2
+    bool isAvx2Supported()
+    {
+#if defined(_MSC_VER)
+        int info[4] = {0, 0, 0, 0};
+        __cpuid(info, 0);
+        if (info[0] < 7) { return false; }
+
+        // The OS has to save the YMM registers on context switches
+        __cpuid(info, 1);
+        const auto osxsave = 0 != (info[2] & (1 << 27));
+        const auto avx = 0 != (info[2] & (1 << 28));
+        if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) { return false; }
+
+        __cpuidex(info, 7, 0);
+        return 0 != (info[1] & (1 << 5));
+#else
+        __builtin_cpu_init();
+        return 0 != __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+}
+
+// Returns the fastest kernel supported by the CPU
+StructuralIndex::Kernel StructuralIndex::bestKernel()
+{
+#if defined(QTCSV_HAS_X86_KERNELS)
+    static const auto kernel = isAvx2Supported() ? Kernel::Avx2 : Kernel::Sse2;
+    return kernel;
+#else
+    return Kernel::Scalar;
+#endif
+}
+
+StructuralIndex::StructuralIndex(
+    const char separator, const char textDelimiter, const Kernel kernel) :
+    m_separator(separator),
+    m_textDelimiter(textDelimiter),
+    m_kernel(kernel),
+    m_data(nullptr),
+    m_size(0),
+    m_positions(),
+    m_count(0),
+    m_cursor(0)
+{
+#if !defined(QTCSV_HAS_X86_KERNELS)
+    m_kernel = Kernel::Scalar;
+#endif
+}
+
+// Find the structural symbols of a block of bytes
+// @input:
+// - data - csv-formatted bytes
+// - size - amount of bytes, at most MaximumBlockSize
+void StructuralIndex::build(const char* data, const qsizetype size)
+{
+    Q_ASSERT(size <= MaximumBlockSize);
+
+    m_data = data;
+    m_size = size;
+    m_cursor = 0;
+
+    // Every byte could be a structural symbol
+    if (m_positions.size() < size) { m_positions.resize(size); }
+
+    auto* positions = m_positions.data();
+    switch (m_kernel) {
+#if defined(QTCSV_HAS_X86_KERNELS)
+    case Kernel::Avx2:
+        m_count = findAvx2(data, size, m_separator, m_textDelimiter, positions);
+        break;
+    case Kernel::Sse2:
+        m_count = findSse2(data, size, m_separator, m_textDelimiter, positions);
+        break;
+#else
+    case Kernel::Avx2:
+    case Kernel::Sse2:
+#endif
+    case Kernel::Scalar:
+        m_count = findScalar(data, 0, size, m_separator, m_textDelimiter,
+                             positions, 0);
+        break;
+    }
+}
+
+// Split the row starting at position into its elements. Follows the rules of
+// the line based reader:
+// - an element that starts with the text delimiter ends at a text delimiter
+// that is followed by the separator or the end of the line. Pairs of text
+// delimiters belong to the content of the element;
+// - any other element ends at the next separator or at the end of the line;
+// - a separator at the end of a line is followed by an empty element, unless
+// it closes a delimited element;
+// - lines end with LF or CR LF, a single CR belongs to the content.
+qsizetype StructuralIndex::splitRow(
+    qsizetype position, const bool isFinal, QList<RawElement>& elements)
+{
+    elements.resize(0);
+
+    const auto* data = m_data;
+    const auto size = m_size;
+    const auto* positions = m_positions.constData();
+
+    // Move to the first structural symbol of the row
+    auto cursor = m_cursor;
+    if (cursor > 0 && positions[cursor - 1] >= position) {
+        cursor = std::lower_bound(positions, positions + m_count,
+                                  static_cast<quint32>(position)) - positions;
+    }
+    while (cursor < m_count && positions[cursor] < position) { ++cursor; }
+
+    // Returns the length of the line break at a position, 0 if there is none
+    // and -1 if the data ends before it is known
+    const auto lineBreakAt = [&](const qsizetype pos) -> qsizetype {
+        if (pos >= size) { return isFinal ? 0 : -1; }
+        if (LF_SYMBOL == data[pos]) { return 1; }
+        if (CR_SYMBOL != data[pos]) { return 0; }
+        if (pos + 1 >= size) { return isFinal ? 0 : -1; }
+        return LF_SYMBOL == data[pos + 1] ? 2 : 0;
+    };
+
+    // Empty line
+    const auto emptyLine = lineBreakAt(position);
+    if (emptyLine < 0) { return -1; }
+    if (emptyLine > 0) {
+        m_cursor = cursor;
+        return position + emptyLine;
+    }
+
+    while (true) {
+        RawElement element;
+        if (position < size && m_textDelimiter == data[position]) {
+            element.isDelimited = true;
+            element.begin = position + 1;
+            ++cursor;
+
+            auto isClosed = false;
+            while (!isClosed) {
+                if (cursor >= m_count) {
+                    if (!isFinal) { return -1; }
+
+                    // Element was not closed. It lasts till the end of the
+                    // data, without the last line break.
+                    element.end = size;
+                    if (element.end > element.begin &&
+                        LF_SYMBOL == data[element.end - 1])
+                    {
+                        --element.end;
+                        if (element.end > element.begin &&
+                            CR_SYMBOL == data[element.end - 1])
+                        {
+                            --element.end;
+                        }
+                    }
+
+                    elements.append(element);
+                    m_cursor = cursor;
+                    return size;
+                }
+
+                const qsizetype symbolPos = positions[cursor];
+                const auto symbol = data[symbolPos];
+                if (LF_SYMBOL == symbol) {
+                    element.hasLineBreak = true;
+                    ++cursor;
+                    continue;
+                }
+
+                if (m_textDelimiter != symbol) {
+                    ++cursor;
+                    continue;
+                }
+
+                // Double text delimiter
+                if (symbolPos + 1 < size &&
+                    m_textDelimiter == data[symbolPos + 1])
+                {
+                    element.hasTextDelimiter = true;
+                    cursor += 2;
+                    continue;
+                }
+
+                // Text delimiter at the end of the line closes the element
+                // and the row
+                const auto lineBreak = lineBreakAt(symbolPos + 1);
+                if (lineBreak < 0) { return -1; }
+                if (lineBreak > 0 || symbolPos + 1 >= size) {
+                    element.end = symbolPos;
+                    elements.append(element);
+                    m_cursor = cursor + 1;
+                    return symbolPos + 1 + lineBreak;
+                }
+
+                // Text delimiter followed by the separator closes the element
+                if (m_separator == data[symbolPos + 1]) {
+                    element.end = symbolPos;
+                    elements.append(element);
+                    cursor += 2;
+                    position = symbolPos + 2;
+                    isClosed = true;
+                    continue;
+                }
+
+                // Any other text delimiter is part of the content
+                element.hasTextDelimiter = true;
+                ++cursor;
+            }
+
+            // No empty element follows a separator at the end of the line
+            const auto lineBreak = lineBreakAt(position);
+            if (lineBreak < 0) { return -1; }
+            if (lineBreak > 0 || position >= size) {
+                m_cursor = cursor;
+                return position + lineBreak;
+            }
+
+            continue;
+        }
+
+        // Element ends at the next separator or line break
+        element.begin = position;
+        while (cursor < m_count && m_textDelimiter == data[positions[cursor]]) {
+            element.hasTextDelimiter = true;
+            ++cursor;
+        }
+
+        if (cursor >= m_count) {
+            if (!isFinal) { return -1; }
+
+            element.end = size;
+            elements.append(element);
+            m_cursor = cursor;
+            return size;
+        }
+
+        const qsizetype symbolPos = positions[cursor++];
+        element.end = symbolPos;
+        if (m_separator == data[symbolPos]) {
+            elements.append(element);
+            position = symbolPos + 1;
+            continue;
+        }
+
+        if (element.end > element.begin && CR_SYMBOL == data[element.end - 1]) {
+            --element.end;
+        }
+
+        elements.append(element);
+        m_cursor = cursor;
+        return symbolPos + 1;
+    }
+}
+
+// Split all rows of a range of bytes window by window
+// @input:
+// - data - csv-formatted bytes
+// - begin - start of the first row
+// - end - end of the range
+// - isFinal - True if the range is the end of the input
+// - handler - receives every row
+// @output:
+// - qsizetype - position right after the last row that was split
+qsizetype StructuralIndex::splitRows(
+    const char* data,
+    const qsizetype begin,
+    const qsizetype end,
+    const bool isFinal,
+    const RowHandler& handler)
+{
+    QList<RawElement> elements;
+    auto windowOffset = begin;
+    auto windowSize = WindowSize;
+    while (windowOffset < end) {
+        const auto size = qMin(windowSize, end - windowOffset);
+        const auto isFinalWindow = isFinal && windowOffset + size == end;
+        build(data + windowOffset, size);
+
+        qsizetype pos = 0;
+        while (pos < size) {
+            const auto next = splitRow(pos, isFinalWindow, elements);
+            if (next < 0) { break; }
+
+            for (auto& element : elements) {
+                element.begin += windowOffset;
+                element.end += windowOffset;
+            }
+
+            if (!handler(windowOffset + pos, elements)) {
+                return windowOffset + next;
+            }
+
+            pos = next;
+        }
+
+        // The last row does not end inside of the range
+        if (pos < size && windowOffset + size == end) {
+            return windowOffset + pos;
+        }
+
+        // A single row is larger than the window
+        if (0 == pos) {
+            windowSize = qMin(windowSize * 2, MaximumBlockSize);
+            continue;
+        }
+
+        windowOffset += pos;
+    }
+
+    return windowOffset;
+}
+
+// Split csv-formatted bytes into ranges that could be parsed in parallel
+// @input:
+// - data - csv-formatted bytes, starting at the beginning of a row
+// - size - amount of bytes
+// - textDelimiter - character that encloses elements
+// - chunkCount - amount of ranges
+// - pool - thread pool used to scan the ranges
+// @output:
+// - QList<qsizetype> - chunkCount + 1 ascending boundaries
+QList<qsizetype> StructuralIndex::chunkBoundaries(
+    const char* data,
+    const qsizetype size,
+    const char textDelimiter,
+    int chunkCount,
+    QThreadPool* pool)
+{
+    chunkCount = qMax(1, chunkCount);
+
+    // Ranges of equal size are the first guess
+    const auto guess = [&](const int i) {
+        return size / chunkCount * i + size % chunkCount * i / chunkCount;
+    };
+
+    // Parity of the amount of text delimiters in every range is found in
+    // parallel
+    QList<char> parities(chunkCount);
+    auto* parity = parities.data();
+    ParallelFor(pool, chunkCount, [&](const int i) {
+        const auto count =
+            std::count(data + guess(i), data + guess(i + 1), textDelimiter);
+        parity[i] = static_cast<char>(count & 1);
+    });
+
+    // A range starts inside of a delimited element if an odd number of text
+    // delimiters comes before it
+    QList<char> insideDelimiters(chunkCount);
+    auto* isInside = insideDelimiters.data();
+    for (auto i = 1; i < chunkCount; ++i) {
+        isInside[i] = static_cast<char>(isInside[i - 1] ^ parity[i - 1]);
+    }
+
+    // Move every boundary behind the first line break that is not part of a
+    // delimited element
+    QList<qsizetype> boundaries(chunkCount + 1);
+    auto* bounds = boundaries.data();
+    bounds[chunkCount] = size;
+    ParallelFor(pool, chunkCount - 1, [&](const int chunk) {
+        const auto i = chunk + 1;
+        auto isDelimited = 0 != isInside[i];
+        for (auto pos = guess(i); pos < size; ++pos) {
+            const auto symbol = data[pos];
+            if (textDelimiter == symbol) {
+                isDelimited = !isDelimited;
+            }
+            else if (LF_SYMBOL == symbol && !isDelimited) {
+                bounds[i] = pos + 1;
+                return;
+            }
+        }
+
+        bounds[i] = size;
+    });
+
+    for (auto i = 1; i <= chunkCount; ++i) {
+        bounds[i] = qMax(bounds[i], bounds[i - 1]);
+    }
+
+    return boundaries;
+}
@@ -7,6 +7,8 @@ namespace QtCSV {
     const QString DOUBLE_QUOTE("\"");
     const QString CR("\r");
     const QString LF("\n");
+    const char CR_CHAR = '\r';
+    const char LF_CHAR = '\n';
 }
 
 #endif // SYMBOLS_H
@@ -290,6 +290,16 @@ void TestReader::testReadFieldWithCRLFLong() {
     }
 }
 
+void TestReader::testReadFieldWithCRLFLongParallel() {
+    const auto path = getPathToFileTestFieldWithCRLFLong();
+    const auto data =
+        QtCSV::Reader::readToListParallel(path, ",", "\"",
+                                          QStringConverter::Utf8, 4);
+    QVERIFY2(!data.isEmpty(), "Failed to read file content");
+    QVERIFY2(QtCSV::Reader::readToList(path, ",", "\"") == data,
+             "Wrong row data");
+}
+
 void TestReader::testReadFieldEndTripleQuotes() {
     const auto path = getPathToFileTestFieldEndTripleQuotes();
     const auto data = QtCSV::Reader::readToList(path, ",", "\"");
@@ -27,6 +27,7 @@ private Q_SLOTS:
     void testReadFieldWithCR();
     void testReadFieldWithCRLF();
     void testReadFieldWithCRLFLong();
+    void testReadFieldWithCRLFLongParallel();
     void testReadFieldEndTripleQuotes();
     void testReadFileDataCorrectness();
     void testReadFileWorldCitiesPop();
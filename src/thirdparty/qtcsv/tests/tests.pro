@@ -32,12 +32,14 @@ SOURCES += \
     teststringdata.cpp \
     testvariantdata.cpp \
     testreader.cpp \
+    teststructuralindex.cpp \
     testwriter.cpp
 
 HEADERS += \
     teststringdata.h \
     testvariantdata.h \
     testreader.h \
+    teststructuralindex.h \
     testwriter.h
 
 DISTFILES += \
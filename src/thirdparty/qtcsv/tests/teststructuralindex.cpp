@@ -0,0 +1,219 @@
+#include "teststructuralindex.h"
+#include "qtcsv/reader.h"
+#include "qtcsv/structuralindex.h"
+#include <QBuffer>
+#include <QByteArray>
+#include <QTemporaryFile>
+#include <QTest>
+
+namespace {
+    // Split all rows of the data and return their elements as strings
+    QList<QList<QByteArray>> splitAll(
+        const QByteArray& data,
+        QtCSV::StructuralIndex::Kernel kernel =
+            QtCSV::StructuralIndex::bestKernel())
+    {
+        QtCSV::StructuralIndex index(',', '"', kernel);
+        index.build(data.constData(), data.size());
+
+        QList<QList<QByteArray>> rows;
+        QList<QtCSV::RawElement> elements;
+        qsizetype pos = 0;
+        while (pos < data.size()) {
+            pos = index.splitRow(pos, true, elements);
+            QList<QByteArray> row;
+            for (const auto& element : elements) {
+                row << data.mid(element.begin, element.end - element.begin);
+            }
+
+            rows << row;
+        }
+
+        return rows;
+    }
+}
+
+void TestStructuralIndex::testKernelsFindSameSymbols() {
+    QByteArray data;
+    for (auto i = 0; i < 1000; ++i) {
+        data.append(static_cast<char>("ab,\"\n\r x"[(i * 7919) % 8]));
+    }
+
+    QtCSV::StructuralIndex scalar(
+        ',', '"', QtCSV::StructuralIndex::Kernel::Scalar);
+    scalar.build(data.constData(), data.size());
+
+    for (const auto kernel : {QtCSV::StructuralIndex::Kernel::Sse2,
+                              QtCSV::StructuralIndex::Kernel::Avx2}) {
+        if (kernel > QtCSV::StructuralIndex::bestKernel()) { continue; }
+
+        QtCSV::StructuralIndex index(',', '"', kernel);
+        index.build(data.constData(), data.size());
+        QVERIFY2(scalar.count() == index.count(), "Wrong number of symbols");
+        for (qsizetype i = 0; i < scalar.count(); ++i) {
+            QVERIFY2(scalar.positions()[i] == index.positions()[i],
+                     "Wrong symbol position");
+        }
+    }
+}
+
+void TestStructuralIndex::testSplitSimpleRows() {
+    const auto rows = splitAll("one,two,three\r\n\r\nfour,\nfive");
+
+    QList<QList<QByteArray>> expected;
+    expected << (QList<QByteArray>() << "one" << "two" << "three");
+    expected << QList<QByteArray>();
+    expected << (QList<QByteArray>() << "four" << "");
+    expected << (QList<QByteArray>() << "five");
+
+    QVERIFY2(expected == rows, "Wrong row data");
+}
+
+void TestStructuralIndex::testSplitDelimitedElements() {
+    const auto rows = splitAll("\"a,b\",\"c\"\"d\",\"e\",\n\"f\"g\",h\n");
+
+    QList<QList<QByteArray>> expected;
+    expected << (QList<QByteArray>() << "a,b" << "c\"\"d" << "e");
+    expected << (QList<QByteArray>() << "f\"g" << "h");
+
+    QVERIFY2(expected == rows, "Wrong row data");
+}
+
+void TestStructuralIndex::testSplitElementWithLineBreaks() {
+    const QByteArray data("a,\"b\r\nc\",d\r\ne");
+    QtCSV::StructuralIndex index(',', '"');
+    index.build(data.constData(), data.size());
+
+    QList<QtCSV::RawElement> elements;
+    const auto next = index.splitRow(0, true, elements);
+    QVERIFY2(12 == next, "Wrong end of row");
+    QVERIFY2(3 == elements.size(), "Wrong number of elements");
+    QVERIFY2(elements.at(1).isDelimited, "Element is not delimited");
+    QVERIFY2(elements.at(1).hasLineBreak, "Line break was not found");
+    QVERIFY2("b\r\nc" == data.mid(elements.at(1).begin,
+                                   elements.at(1).end - elements.at(1).begin),
+             "Wrong element data");
+}
+
+void TestStructuralIndex::testSplitIncompleteRow() {
+    const QByteArray data("a,b\nc,\"d\ne");
+    QtCSV::StructuralIndex index(',', '"');
+    index.build(data.constData(), data.size());
+
+    QList<QtCSV::RawElement> elements;
+    const auto next = index.splitRow(0, false, elements);
+    QVERIFY2(4 == next, "Wrong end of row");
+    QVERIFY2(-1 == index.splitRow(next, false, elements),
+             "Incomplete row was split");
+    QVERIFY2(data.size() == index.splitRow(next, true, elements),
+             "Last row was not split");
+    QVERIFY2(2 == elements.size(), "Wrong number of elements");
+}
+
+void TestStructuralIndex::testReadLargeFile() {
+    // Rows cross the boundaries of the blocks the reader works on
+    QByteArray content;
+    for (auto i = 0; i < 100000; ++i) {
+        content.append("row,\"quoted, element\",\"multi\nline\",");
+        content.append(QByteArray::number(i));
+        content.append("\r\n");
+    }
+
+    QBuffer buffer(&content);
+    const auto data = QtCSV::Reader::readToList(buffer);
+    QVERIFY2(100000 == data.size(), "Wrong number of rows");
+
+    const auto expected = QList<QString>() << "row" << "quoted, element" <<
+                          "multi\nline" << "99999";
+    QVERIFY2(expected == data.last(), "Wrong row data");
+}
+
+void TestStructuralIndex::testSplitRows() {
+    const QByteArray data("a,b\n\"c\nd\",e\r\nf");
+
+    QtCSV::StructuralIndex index(',', '"');
+    QList<qsizetype> offsets;
+    const auto end = index.splitRows(
+        data.constData(), 0, data.size(), true,
+        [&](qsizetype rowOffset, const QList<QtCSV::RawElement>&) {
+            offsets << rowOffset;
+            return true;
+        });
+
+    QVERIFY2(data.size() == end, "Wrong end of the rows");
+    QVERIFY2((QList<qsizetype>() << 0 << 4 << 13) == offsets,
+             "Wrong row offsets");
+
+    // The handler stops the split after the first row
+    const auto stop = index.splitRows(
+        data.constData(), 0, data.size(), true,
+        [](qsizetype, const QList<QtCSV::RawElement>&) { return false; });
+    QVERIFY2(4 == stop, "Wrong position after the stop");
+
+    // The last row does not end inside of the range
+    const auto incomplete = index.splitRows(
+        data.constData(), 0, 8, false,
+        [](qsizetype, const QList<QtCSV::RawElement>&) { return true; });
+    QVERIFY2(4 == incomplete, "Wrong position of the incomplete row");
+}
+
+void TestStructuralIndex::testChunkBoundaries() {
+    // Every row holds an element that spans several lines
+    QByteArray data;
+    for (auto i = 0; i < 1000; ++i) {
+        data.append("one,\"two\nthree,\"\"four\"\"\nfive\",");
+        data.append(QByteArray::number(i));
+        data.append("\n");
+    }
+
+    const auto boundaries = QtCSV::StructuralIndex::chunkBoundaries(
+        data.constData(), data.size(), '"', 7);
+    QVERIFY2(8 == boundaries.size(), "Wrong number of boundaries");
+    QVERIFY2(0 == boundaries.first(), "Wrong first boundary");
+    QVERIFY2(data.size() == boundaries.last(), "Wrong last boundary");
+
+    // Every range ends right where the next one starts
+    qsizetype rowCount = 0;
+    for (auto i = 0; i + 1 < boundaries.size(); ++i) {
+        QtCSV::StructuralIndex index(',', '"');
+        const auto end = index.splitRows(
+            data.constData(), boundaries.at(i), boundaries.at(i + 1),
+            data.size() == boundaries.at(i + 1),
+            [&](qsizetype, const QList<QtCSV::RawElement>& elements) {
+                rowCount += 4 == elements.size() ? 1 : 0;
+                return true;
+            });
+        QVERIFY2(boundaries.at(i + 1) == end, "Range was guessed wrong");
+    }
+
+    QVERIFY2(1000 == rowCount, "Wrong number of rows");
+}
+
+void TestStructuralIndex::testReadLargeFileParallel() {
+    QByteArray content;
+    for (auto i = 0; i < 100000; ++i) {
+        content.append("row,\"quoted, element\",\"multi\nline\",");
+        content.append(QByteArray::number(i));
+        content.append("\r\n");
+    }
+
+    // An unbalanced text delimiter makes the guessed ranges wrong, the rows
+    // after it have to be read again
+    content.append("\"unbalanced,row\n");
+    for (auto i = 0; i < 100000; ++i) {
+        content.append("row,");
+        content.append(QByteArray::number(i));
+        content.append("\n");
+    }
+
+    QTemporaryFile file;
+    QVERIFY2(file.open(), "Failed to create temporary file");
+    QVERIFY2(content.size() == file.write(content), "Failed to write file");
+    file.close();
+
+    const auto expected = QtCSV::Reader::readToList(file.fileName());
+    const auto data = QtCSV::Reader::readToListParallel(
+        file.fileName(), ",", "\"", QStringConverter::Utf8, 4);
+    QVERIFY2(100001 == data.size(), "Wrong number of rows");
+    QVERIFY2(expected == data, "Wrong row data");
+}
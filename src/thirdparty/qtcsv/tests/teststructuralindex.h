@@ -0,0 +1,24 @@
+#ifndef TESTSTRUCTURALINDEX_H
+#define TESTSTRUCTURALINDEX_H
+
+#include <QtTest>
+
+class TestStructuralIndex : public QObject {
+    Q_OBJECT
+
+public:
+    TestStructuralIndex() = default;
+
+private Q_SLOTS:
+    void testKernelsFindSameSymbols();
+    void testSplitSimpleRows();
+    void testSplitDelimitedElements();
+    void testSplitElementWithLineBreaks();
+    void testSplitIncompleteRow();
+    void testReadLargeFile();
+    void testSplitRows();
+    void testChunkBoundaries();
+    void testReadLargeFileParallel();
+};
+
+#endif // TESTSTRUCTURALINDEX_H
@@ -2,6 +2,7 @@
 
 #include "testreader.h"
 #include "teststringdata.h"
+#include "teststructuralindex.h"
 #include "testvariantdata.h"
 #include "testwriter.h"
 
@@ -18,6 +19,7 @@ int main() {
     status |= AssertTest(new TestVariantData());
     status |= AssertTest(new TestReader());
     status |= AssertTest(new TestWriter());
+    status |= AssertTest(new TestStructuralIndex());
 
     return status;
 }